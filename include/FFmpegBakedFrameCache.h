@@ -0,0 +1,300 @@
+/* 
+ * File:   FFmpegBakedFrameCache.h
+ * Author: TheSHEEEP
+ *
+ * Created on 20. Oktober 2026, 00:50
+ */
+
+#ifndef FFMPEGBAKEDFRAMECACHE_H
+#define	FFMPEGBAKEDFRAMECACHE_H
+
+#include "FFmpegPluginPrerequisites.h"
+#include "FFmpegResidentClipCache.h"
+#include "FFmpegStreamInfoCache.h"
+
+#include <boost/shared_ptr.hpp>
+#include <fstream>
+#include <map>
+#include <vector>
+#include <stdint.h>
+
+// Forward declarations
+namespace boost
+{
+    class mutex;
+}
+
+/**
+ * Writes the decoded frames of a video into a bake file, in the order they are decoded.
+ * Frames are stored as they are, video in the player's output format and audio in its sample format.
+ * Created by FFmpegBakedFrameCache::createWriter. A writer that is deleted before it is finished removes its file.
+ */
+class BakedClipWriter
+{
+public:
+    /**
+     * @param p_path    The bake file to write.
+     */
+    BakedClipWriter(const Ogre::String& p_path);
+
+    /**
+     * Destructor. Removes the file if the bake was not finished.
+     */
+    ~BakedClipWriter();
+
+    /**
+     * @return  True if the file could be created and everything so far could be written.
+     */
+    bool getIsGood() const;
+
+    /**
+     * Appends a decoded video frame.
+     */
+    void addVideoFrame(const VideoFrame& p_frame);
+
+    /**
+     * Appends a decoded audio frame.
+     */
+    void addAudioFrame(const AudioFrame& p_frame);
+
+    /**
+     * Writes the frame index and closes the file.
+     * @param p_videoInfo   The information of the decoded video.
+     * @return  True if the bake file is complete.
+     */
+    bool finish(const VideoInfo& p_videoInfo);
+
+    /**
+     * @return  True if the bake file is complete.
+     */
+    bool getIsFinished() const;
+
+    /**
+     * @return  The bake file.
+     */
+    const Ogre::String& getPath() const;
+
+    /**
+     * @return  How large the bake file is so far, in bytes.
+     */
+    uint64_t getBytes() const;
+
+private:
+    struct VideoFrameEntry
+    {
+        double          pts;
+        double          lifeTime;
+        uint32_t        width;
+        uint32_t        height;
+        uint32_t        format;         // Ogre::PixelFormat
+        uint64_t        offset;
+        uint32_t        size;
+    };
+
+    struct AudioFrameEntry
+    {
+        double          lifeTime;
+        uint64_t        offset;
+        uint32_t        size;
+    };
+
+    Ogre::String                    _path;
+    std::ofstream                   _file;
+    uint64_t                        _bytes;
+    bool                            _isFinished;
+    std::vector<VideoFrameEntry>    _videoEntries;
+    std::vector<AudioFrameEntry>    _audioEntries;
+};
+
+/**
+ * The frames of a bake file, mapped into memory.
+ * The frames point right into the mapping, so showing them needs no decoding and no copy.
+ * Copies of the frames keep the file mapped, also after the clip is deleted.
+ */
+class BakedClip : public FrameClip
+{
+public:
+    /**
+     * Maps a bake file.
+     * @param p_path    The bake file to map.
+     */
+    BakedClip(const Ogre::String& p_path);
+
+    /**
+     * Destructor.
+     */
+    virtual ~BakedClip();
+
+    /**
+     * @return  True if the file could be mapped and is a complete bake.
+     */
+    bool getIsOpen() const;
+
+    // FrameClip
+    virtual const VideoFrame* getFrameForTime(double p_time) const;
+    virtual unsigned int getNumAudioFrames() const;
+    virtual const AudioFrame* getAudioFrame(unsigned int p_index) const;
+    virtual double getDuration() const;
+    virtual const VideoInfo& getVideoInfo() const;
+    virtual size_t getBytes() const;
+
+private:
+    /**
+     * Reads the frame index at the end of the mapped file.
+     * @return  False if the file is no complete bake.
+     */
+    bool readIndex();
+
+    boost::shared_ptr<void>     _mapping;       // Shared by all frames pointing into it
+    size_t                      _size;
+    std::vector<VideoFrame*>    _videoFrames;
+    std::vector<AudioFrame*>    _audioFrames;
+    VideoInfo                   _videoInfo;
+};
+
+typedef boost::shared_ptr<BakedClip> BakedClipPtr;
+
+// Helpful defines
+#define FFMPEG_BAKED_FRAME_CACHE FFmpegBakedFrameCache::getSingletonPtr()
+
+/**
+ * Keeps fully decoded videos in bake files, so videos that are too expensive to decode in real time
+ * can be played again and again without decoding.
+ *
+ * Bakes are named by what was decoded (file, tracks, audio format), and remember the version of the
+ * video they were decoded from. A bake of a video that changed since is removed when it is looked up.
+ * When the bakes grow beyond the size limit, the least recently used ones are removed.
+ * This class is thread safe.
+ */
+class _FFmpegPluginExport FFmpegBakedFrameCache
+{
+private:
+    /**
+     * Constructor.
+     */
+    FFmpegBakedFrameCache();
+
+    static FFmpegBakedFrameCache* _instance;
+
+public:
+    /**
+     * @return A pointer to the instance of this singleton.
+     */
+    static FFmpegBakedFrameCache* getSingletonPtr()
+    {
+        if (!_instance)
+        {
+            _instance = new FFmpegBakedFrameCache();
+        }
+        return _instance;
+    }
+
+    /**
+     * Destructor.
+     */
+    ~FFmpegBakedFrameCache();
+
+    /**
+     * Sets the directory the bake files are kept in and loads the index of the bakes in it.
+     * Nothing is baked until a directory is set.
+     * @param p_directory   An existing directory.
+     * @return  True if the index could be loaded or there is none yet.
+     */
+    bool setCacheDirectory(const Ogre::String& p_directory);
+
+    /**
+     * @return  The directory the bake files are kept in.
+     */
+    Ogre::String getCacheDirectory() const;
+
+    /**
+     * @param p_bytes   How large all bake files may be together. 0 for no limit, which is the default.
+     *                  The least recently used bakes are removed right away if they are larger.
+     */
+    void setSizeLimit(uint64_t p_bytes);
+
+    /**
+     * @return  How large all bake files may be together, 0 for no limit.
+     */
+    uint64_t getSizeLimit() const;
+
+    /**
+     * Starts a new bake file.
+     * @note    Make sure to pass the writer to addBake, or to delete it if baking failed.
+     * @return  The writer, NULL if no cache directory is set or the file can not be created.
+     */
+    BakedClipWriter* createWriter();
+
+    /**
+     * Takes over a finished bake, replacing an older bake with the same name.
+     * The writer is deleted, also if the bake is not finished.
+     * @param p_name    What was decoded.
+     * @param p_source  The version of the video the bake was decoded from.
+     * @return  True if the bake was added.
+     */
+    bool addBake(const Ogre::String& p_name, const StreamInfoKey& p_source, BakedClipWriter* p_writer);
+
+    /**
+     * Maps a bake and marks it as recently used.
+     * @param p_name    What was decoded.
+     * @param p_source  The current version of the video. A bake of another version is removed.
+     * @return  The mapped bake, empty if there is none.
+     */
+    BakedClipPtr openClip(const Ogre::String& p_name, const StreamInfoKey& p_source);
+
+    /**
+     * Removes all bakes and their files.
+     */
+    void clear();
+
+    /**
+     * @return  The number of bakes.
+     */
+    unsigned int getNumBakes() const;
+
+    /**
+     * @return  How large all bake files are together, in bytes.
+     */
+    uint64_t getBytes() const;
+
+private:
+    struct BakeEntry
+    {
+        Ogre::String    fileName;       // Relative to the cache directory
+        StreamInfoKey   source;
+        uint64_t        bytes;
+        uint64_t        lastUsed;       // Increases with each use
+    };
+
+    /**
+     * Reads the index of the cache directory. Expects the mutex to be locked.
+     */
+    bool load();
+
+    /**
+     * Writes the index of the cache directory. Expects the mutex to be locked.
+     */
+    bool save();
+
+    /**
+     * Removes a bake and its file. Expects the mutex to be locked.
+     */
+    void removeBake(std::map<Ogre::String, BakeEntry>::iterator p_entry);
+
+    /**
+     * Removes the least recently used bakes until the rest fits into the size limit.
+     * Expects the mutex to be locked.
+     * @param p_keep    A bake that is not removed, even if it is the oldest.
+     */
+    void evictBakes(const Ogre::String& p_keep);
+
+    std::map<Ogre::String, BakeEntry>   _entries;
+    Ogre::String                        _directory;
+    uint64_t                            _sizeLimit;
+    uint64_t                            _bytes;
+    uint64_t                            _useCounter;
+    unsigned int                        _nextFileId;
+    boost::mutex*                       _mutex;
+};
+
+#endif	/* FFMPEGBAKEDFRAMECACHE_H */
@@ -0,0 +1,132 @@
+/* 
+ * File:   FFmpegBinaryIO.h
+ * Author: TheSHEEEP
+ *
+ * Created on 20. Oktober 2026, 03:00
+ *
+ * Reads and writes the values of the plugin's binary cache files.
+ * Internal to the plugin, it is not installed.
+ *
+ * Everything read from a file may come from a truncated or broken one,
+ * so sizes and counts are checked against what is left of the file before anything is allocated for them.
+ */
+
+#ifndef FFMPEGBINARYIO_H
+#define	FFMPEGBINARYIO_H
+
+#include <OgreString.h>
+#include <fstream>
+#include <vector>
+#include <stdint.h>
+
+//------------------------------------------------------------------------------
+template <typename T>
+inline void
+writeValue(std::ofstream& p_file, const T& p_value)
+{
+    p_file.write((const char*)&p_value, sizeof(T));
+}
+
+//------------------------------------------------------------------------------
+template <typename T>
+inline bool
+readValue(std::ifstream& p_file, T& p_outValue)
+{
+    p_file.read((char*)&p_outValue, sizeof(T));
+    return p_file.good();
+}
+
+//------------------------------------------------------------------------------
+/**
+ * @return  How many bytes are left to read, 0 if the file can not be read any more.
+ */
+inline uint64_t
+getRemainingBytes(std::ifstream& p_file)
+{
+    std::streampos position = p_file.tellg();
+    if (!p_file.good() || position < 0)
+    {
+        return 0;
+    }
+    p_file.seekg(0, std::ios::end);
+    std::streampos end = p_file.tellg();
+    p_file.seekg(position);
+    return p_file.good() && end > position ? (uint64_t)(end - position) : 0;
+}
+
+//------------------------------------------------------------------------------
+/**
+ * Reads the number of elements that follow.
+ * A count that does not fit fails the file like a read past its end, so later reads fail too.
+ * @param p_minElementSize  The least bytes each element takes in the file.
+ * @return  False if the count could not be read or that many elements do not fit into the rest of the file.
+ */
+inline bool
+readCount(std::ifstream& p_file, uint32_t& p_outCount, uint32_t p_minElementSize)
+{
+    if (!readValue(p_file, p_outCount))
+    {
+        return false;
+    }
+    if ((uint64_t)p_outCount * p_minElementSize > getRemainingBytes(p_file))
+    {
+        p_outCount = 0;
+        p_file.setstate(std::ios::failbit);
+        return false;
+    }
+    return true;
+}
+
+//------------------------------------------------------------------------------
+inline void
+writeBytes(std::ofstream& p_file, const void* p_data, uint32_t p_size)
+{
+    writeValue(p_file, p_size);
+    if (p_size > 0)
+    {
+        p_file.write((const char*)p_data, p_size);
+    }
+}
+
+//------------------------------------------------------------------------------
+inline bool
+readBytes(std::ifstream& p_file, std::vector<uint8_t>& p_outData)
+{
+    uint32_t size = 0;
+    if (!readCount(p_file, size, 1))
+    {
+        return false;
+    }
+    p_outData.resize(size);
+    if (size > 0)
+    {
+        p_file.read((char*)&p_outData[0], size);
+    }
+    return p_file.good();
+}
+
+//------------------------------------------------------------------------------
+inline void
+writeString(std::ofstream& p_file, const Ogre::String& p_string)
+{
+    writeBytes(p_file, p_string.c_str(), p_string.length());
+}
+
+//------------------------------------------------------------------------------
+inline bool
+readString(std::ifstream& p_file, Ogre::String& p_outString)
+{
+    uint32_t length = 0;
+    if (!readCount(p_file, length, 1))
+    {
+        return false;
+    }
+    p_outString.resize(length);
+    if (length > 0)
+    {
+        p_file.read(&p_outString[0], length);
+    }
+    return p_file.good();
+}
+
+#endif	/* FFMPEGBINARYIO_H */
@@ -0,0 +1,244 @@
+/* 
+ * File:   FFmpegDecoderPool.h
+ * Author: TheSHEEEP
+ *
+ * Created on 19. Oktober 2026, 16:05
+ */
+
+#ifndef FFMPEGDECODERPOOL_H
+#define	FFMPEGDECODERPOOL_H
+
+#include "FFmpegPluginPrerequisites.h"
+#include "FFmpegThreadSettings.h"
+
+#include <list>
+
+// Forward declarations
+namespace Ogre
+{
+    class Log;
+}
+namespace boost
+{
+    class thread_group;
+    class mutex;
+    class condition_variable;
+}
+
+enum DecodingPriority
+{
+    DP_FOREGROUND,      // Always scheduled before background videos
+    DP_BACKGROUND       // Only gets workers that no foreground video needs
+};
+
+/**
+ * Scheduling metrics of the decoder pool.
+ */
+struct DecoderPoolStats
+{
+    DecoderPoolStats();
+
+    unsigned int    numSteps;           // How many decoding steps were run
+    double          averageLatency;     // Average time a ready job waited for a worker, in seconds
+    double          maxLatency;         // Longest time a ready job waited for a worker, in seconds
+    unsigned int    numDeadlineMisses;  // How many steps started after the job's buffers already ran dry
+};
+
+// Helpful defines
+#define FFMPEG_DECODER_POOL FFmpegDecoderPool::getSingletonPtr()
+
+/**
+ * A fixed number of worker threads that decode for all videos.
+ *
+ * Videos are decoded in small steps. After each step, a worker picks the job with the
+ * earliest deadline, which is the moment its buffers would run dry at the current
+ * playback rate. Foreground jobs always go before background jobs.
+ */
+class _FFmpegPluginExport FFmpegDecoderPool
+{
+public:
+    enum JobStepResult
+    {
+        JSR_CONTINUE,   // There is more to decode
+        JSR_WAIT,       // The buffers are full, wait until woken up with wakeJob
+        JSR_FINISHED    // The job is done and will not be scheduled again
+    };
+
+    /**
+     * Something that can be decoded step by step.
+     * All methods are called from the worker threads.
+     */
+    class Job
+    {
+    public:
+        virtual ~Job() {}
+
+        /**
+         * Decodes a small amount of data. This should not take longer than a few milliseconds.
+         */
+        virtual JobStepResult step() = 0;
+
+        /**
+         * @return  How many seconds are left until the buffers of this job run dry.
+         */
+        virtual double getSecondsUntilDeadline() = 0;
+
+        /**
+         * @return  The priority class of this job.
+         */
+        virtual DecodingPriority getPriority() = 0;
+    };
+
+private:
+    /**
+     * Constructor.
+     */
+    FFmpegDecoderPool();
+
+    static FFmpegDecoderPool* _instance;
+
+public:
+    /**
+     * @return A pointer to the instance of this singleton.
+     */
+    static FFmpegDecoderPool* getSingletonPtr()
+    {
+        if (!_instance)
+        {
+            _instance = new FFmpegDecoderPool();
+        }
+        return _instance;
+    }
+
+    /**
+     * Destructor. Stops all workers, jobs are not deleted.
+     */
+    ~FFmpegDecoderPool();
+
+    /**
+     * @param p_log The log the pool uses to report the placement of its workers. Pass 0 for no logging.
+     */
+    void setLog(Ogre::Log* p_log);
+
+    /**
+     * @param p_settings    Affinity, priority and core limit of the workers and their codec threads.
+     * @note    Running workers finish their current step before they are replaced.
+     */
+    void setThreadSettings(const DecoderThreadSettings& p_settings);
+
+    /**
+     * @return  Affinity, priority and core limit of the workers and their codec threads.
+     */
+    DecoderThreadSettings getThreadSettings() const;
+
+    /**
+     * @param p_numWorkers  How many worker threads decode.
+     *                      Pass 0 to use one worker per hardware thread (the default),
+     *                      or one per core if the thread settings limit the number of cores.
+     * @note    Running workers finish their current step before they are replaced.
+     */
+    void setNumWorkers(unsigned int p_numWorkers);
+
+    /**
+     * @return  How many worker threads decode.
+     */
+    unsigned int getNumWorkers() const;
+
+    /**
+     * Adds a job. It is scheduled right away.
+     * @param p_job The job to add. The pool does not take ownership.
+     */
+    void addJob(Job* p_job);
+
+    /**
+     * Schedules a waiting job again, e.g. because frames were taken out of its buffers.
+     * Does nothing if the job is not waiting.
+     */
+    void wakeJob(Job* p_job);
+
+    /**
+     * Blocks until the job returned JSR_FINISHED. The job is woken up first.
+     */
+    void waitForJob(Job* p_job);
+
+    /**
+     * Removes a job. If a worker is currently running a step of it, this waits until the step is done.
+     * Afterwards, the job can safely be deleted.
+     */
+    void removeJob(Job* p_job);
+
+    /**
+     * Stops and joins all workers, e.g. when the plugin shuts down.
+     * Jobs stay in the pool, the workers start again when a job is added or waited for.
+     */
+    void stopWorkers();
+
+    /**
+     * @return  True if the job returned JSR_FINISHED or was never added.
+     */
+    bool getIsJobFinished(Job* p_job) const;
+
+    /**
+     * @return  The scheduling metrics since the last reset.
+     */
+    DecoderPoolStats getStats() const;
+
+    /**
+     * Resets the scheduling metrics.
+     */
+    void resetStats();
+
+private:
+    struct JobEntry
+    {
+        Job*                job;
+        DecodingPriority    priority;
+        double              deadline;       // Absolute time at which the job's buffers run dry
+        double              readySince;     // Absolute time since which the job waits for a worker
+        double              wakeTime;       // Absolute time at which a waiting job checks its buffers again
+        bool                isReady;
+        bool                wakePending;    // wakeJob was called while a step was running
+        bool                isRunning;
+        bool                isFinished;
+    };
+
+    /**
+     * The loop of each worker thread.
+     */
+    void workerLoop();
+
+    /**
+     * Starts the workers if they are not running yet. Expects the mutex to be locked.
+     */
+    void startWorkers();
+
+    /**
+     * @return  The ready job to run next, or NULL if there is none. Expects the mutex to be locked.
+     */
+    JobEntry* pickJob(double p_now);
+
+    /**
+     * @return  The entry of the passed job, NULL if there is none. Expects the mutex to be locked.
+     */
+    JobEntry* findEntry(Job* p_job);
+
+    /**
+     * @return  Seconds on a monotonic clock.
+     */
+    static double getTime();
+
+    std::list<JobEntry>         _jobs;
+    boost::thread_group*        _workers;
+    boost::mutex*               _mutex;
+    boost::condition_variable*  _workCondVar;
+    boost::condition_variable*  _stepDoneCondVar;
+    unsigned int                _numWorkers;
+    bool                        _quit;
+    DecoderThreadSettings       _threadSettings;
+    Ogre::Log*                  _log;
+
+    DecoderPoolStats            _stats;
+    double                      _totalLatency;
+};
+
+#endif	/* FFMPEGDECODERPOOL_H */
@@ -0,0 +1,201 @@
+/* 
+ * File:   FFmpegFrameScrubber.h
+ * Author: TheSHEEEP
+ *
+ * Created on 19. Oktober 2026, 15:20
+ */
+
+#ifndef FFMPEGFRAMESCRUBBER_H
+#define	FFMPEGFRAMESCRUBBER_H
+
+#include "FFmpegPluginPrerequisites.h"
+#include "FFmpegVideoStreamDecoder.h"
+#include "FFmpegVideoFrameCache.h"
+
+#include <OgreFrameListener.h>
+#include <vector>
+
+// Forward declarations
+struct VideoFrame;
+namespace boost
+{
+    class thread;
+    class mutex;
+    class condition_variable;
+}
+
+/**
+ * Gets single frames of a video at arbitrary times, e.g. for scrubbing a timeline back and forth.
+ * 
+ * Frames are decoded on a worker thread and kept in an LRU cache, so scrubbing over the
+ * same region again does not need the decoder. After each request, the neighbouring frames
+ * in scrub direction are prefetched.
+ * 
+ * The scrubber registers itself as a frame listener, so completed requests are reported 
+ * on the main thread at the start of each frame.
+ */
+class _FFmpegPluginExport FFmpegFrameScrubber : public Ogre::FrameListener
+{
+public:
+    /**
+     * Gets notified when a requested frame is ready.
+     */
+    class Listener
+    {
+    public:
+        virtual ~Listener() {}
+        
+        /**
+         * Called on the main thread when a requested frame is ready.
+         * @note    Make sure to delete the frame when you are done with it!
+         * @param p_requestedTime   The time that was passed to requestFrameAt.
+         * @param p_frame           The frame shown at that time, or NULL if the video has no frames.
+         */
+        virtual void scrubFrameReady(double p_requestedTime, VideoFrame* p_frame) = 0;
+    };
+    
+    /**
+     * Constructor.
+     */
+    FFmpegFrameScrubber();
+    
+    /**
+     * Destructor.
+     */
+    ~FFmpegFrameScrubber();
+    
+    /**
+     * Opens a video and starts the worker thread.
+     * @param p_filename    The video file to scrub through.
+     * @return  True if everything worked correctly. See getError otherwise.
+     */
+    bool open(const Ogre::String& p_filename);
+    
+    /**
+     * Stops the worker thread and closes the video. Pending requests are dropped.
+     */
+    void close();
+    
+    /**
+     * @return  The last error that happened.
+     */
+    const Ogre::String& getError() const;
+    
+    /**
+     * Requests the frame shown at the passed time. The listener is notified when it is ready.
+     * Only the most recent request is served, requests that were not started yet when a 
+     * new one comes in are dropped.
+     * @param p_time        The time in seconds.
+     * @param p_listener    The listener to notify.
+     */
+    void requestFrameAt(double p_time, Listener* p_listener);
+    
+    /**
+     * @param p_bytes   How much memory the frame cache may use. Default is 128 MB.
+     */
+    void setCacheBudget(size_t p_bytes);
+    
+    /**
+     * @return  How much memory the frame cache may use, in bytes.
+     */
+    size_t getCacheBudget() const;
+    
+    /**
+     * @param p_numFrames   How many frames in scrub direction are decoded after each request.
+     *                      Default is 8.
+     */
+    void setPrefetchCount(unsigned int p_numFrames);
+    
+    /**
+     * @return  How many frames in scrub direction are decoded after each request.
+     */
+    unsigned int getPrefetchCount() const;
+    
+    /**
+     * @return  How many requests were served from the cache.
+     */
+    unsigned int getCacheHits() const;
+    
+    /**
+     * @return  How many requests needed the decoder.
+     */
+    unsigned int getCacheMisses() const;
+    
+    /**
+     * Notifies the listeners of all completed requests.
+     * This is called automatically at the start of each frame.
+     */
+    void dispatchCompletedRequests();
+    
+    /**
+     * Dispatches completed requests.
+     * @param p_evt The frame event.
+     * @return  Always true.
+     */
+    virtual bool frameStarted(const Ogre::FrameEvent& p_evt);
+    
+private:
+    struct Request
+    {
+        double      time;
+        Listener*   listener;
+        VideoFrame* frame;
+    };
+    
+    /**
+     * The worker thread's main function.
+     */
+    void run();
+    
+    /**
+     * @return  True if a new request is waiting.
+     */
+    bool hasPendingRequest();
+    
+    /**
+     * Decodes until the frame shown at the passed time is cached.
+     * @return  The cached frame, or NULL.
+     */
+    const VideoFrame* decodeUntil(double p_time);
+    
+    /**
+     * Decodes the neighbouring frames of the passed time into the cache.
+     * Stops early when a new request comes in.
+     * @param p_direction   1 when scrubbing forward, -1 when scrubbing backwards.
+     */
+    void prefetch(double p_time, int p_direction);
+    
+    /**
+     * Decodes the next frame into the cache.
+     * @return  The decoded frame, or NULL at the end of the stream.
+     */
+    const VideoFrame* decodeIntoCache();
+    
+    FFmpegVideoStreamDecoder    _decoder;
+    VideoFrameCache             _cache;
+    double                      _decodedUntil;      // End time of the last decoded frame, -1 after a seek
+    Ogre::String                _error;
+    
+    boost::thread*              _thread;
+    boost::mutex*               _mutex;
+    boost::condition_variable*  _condVar;
+    bool                        _quit;
+    bool                        _hasRequest;
+    Request                     _request;
+    std::vector<Request>        _completedRequests;
+    size_t                      _cacheBudget;
+    unsigned int                _prefetchCount;
+    unsigned int                _cacheHits;
+    unsigned int                _cacheMisses;
+    bool                        _isFrameListener;
+};
+
+//------------------------------------------------------------------------------
+inline
+const Ogre::String& 
+FFmpegFrameScrubber::getError() const
+{
+    return _error;
+}
+
+#endif	/* FFMPEGFRAMESCRUBBER_H */
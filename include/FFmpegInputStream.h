@@ -0,0 +1,184 @@
+/* 
+ * File:   FFmpegInputStream.h
+ * Author: TheSHEEEP
+ *
+ * Created on 19. Oktober 2026, 20:10
+ */
+
+#ifndef FFMPEGINPUTSTREAM_H
+#define	FFMPEGINPUTSTREAM_H
+
+#include "FFmpegPluginPrerequisites.h"
+
+#include <OgrePrerequisites.h>
+#include <OgreDataStream.h>
+#include <stdint.h>
+
+// The default size of FFmpeg's read buffer. Large, so archives are read in few big chunks.
+#define FFMPEG_DEFAULT_READ_BUFFER_SIZE (1024 * 1024)
+
+// Forward declarations
+struct AVIOContext;
+struct AVFormatContext;
+struct StreamInfoKey;
+namespace boost
+{
+    class thread;
+    class mutex;
+    class condition_variable;
+}
+
+enum InputMode
+{
+    IM_STREAM,          // Read through Ogre's data streams, or by FFmpeg itself for files that are no resource
+    IM_MEMORY_MAPPED    // Map local files into memory. Resources that are not plain files are still streamed.
+};
+
+/**
+ * How a video is read.
+ */
+struct _FFmpegPluginExport InputSettings
+{
+    InputSettings();
+
+    InputMode       mode;
+    size_t          readBufferSize;     // The size of FFmpeg's read buffer in bytes
+    size_t          readAheadBytes;     // Memory mapped files only: the OS is told to load this much ahead of the reader
+    bool            usePrefetchThread;  // Memory mapped files only: a thread loads the read-ahead bytes
+                                        // instead of just hinting the OS
+    unsigned int    probeSize;          // At most this many bytes are read to find the streams, 0 for FFmpeg's default
+    double          analyzeDuration;    // At most this many seconds are decoded to find the stream parameters,
+                                        // 0 for FFmpeg's default
+    bool            useStreamInfoCache; // Skip probing if the stream info cache knows the file. Default is true.
+};
+
+/**
+ * How reading went.
+ */
+struct _FFmpegPluginExport InputStats
+{
+    InputStats();
+
+    uint64_t        bytesRead;          // Bytes handed to FFmpeg
+    unsigned int    numReads;           // How often FFmpeg asked for data
+    double          blockedTime;        // Seconds the decoder spent waiting for data, in total
+    double          maxBlockedTime;     // Longest single wait for data, in seconds
+};
+
+/**
+ * Lets FFmpeg read from an Ogre data stream or a memory mapped file,
+ * so videos can come from any archive Ogre knows.
+ *
+ * Streams whose data is already in memory are read from that memory directly.
+ */
+class _FFmpegPluginExport FFmpegInputStream
+{
+public:
+    /**
+     * Constructor. Reads from an Ogre data stream.
+     * @param p_stream      The stream to read from.
+     * @param p_settings    Only the read buffer size is used.
+     */
+    FFmpegInputStream(const Ogre::DataStreamPtr& p_stream, const InputSettings& p_settings);
+
+    /**
+     * Constructor. Maps a file into memory.
+     * @param p_filename    The path of the file.
+     * @param p_settings    The read buffer size and the read-ahead settings.
+     */
+    FFmpegInputStream(const Ogre::String& p_filename, const InputSettings& p_settings);
+
+    /**
+     * Destructor. Frees the IO context, so the format context using it must be closed first.
+     */
+    ~FFmpegInputStream();
+
+    /**
+     * @return  The IO context to set as the pb of a format context. NULL if the input could not be opened.
+     */
+    AVIOContext* getIOContext();
+
+    /**
+     * @return  The statistics of this input. Only call this from the thread that reads.
+     */
+    const InputStats& getStats() const;
+
+private:
+    /**
+     * Allocates the IO context.
+     */
+    void createIOContext(size_t p_bufferSize);
+
+    /**
+     * Tells the OS which part of a mapped file is needed soon.
+     * @param p_position    The read position.
+     */
+    void adviseReadAhead(size_t p_position);
+
+    /**
+     * The loop of the prefetch thread. Touches the pages ahead of the reader.
+     */
+    void prefetchLoop();
+
+    /**
+     * The read callback of the IO context.
+     */
+    static int read(void* p_opaque, uint8_t* p_buffer, int p_bufferSize);
+
+    /**
+     * The seek callback of the IO context.
+     */
+    static int64_t seek(void* p_opaque, int64_t p_offset, int p_whence);
+
+    Ogre::DataStreamPtr         _stream;
+    const unsigned char*        _memory;        // The data of memory streams and mapped files, NULL for all others
+    size_t                      _size;
+    size_t                      _position;
+    AVIOContext*                _ioContext;
+    InputStats                  _stats;
+
+    void*                       _mapping;       // The mapped file, NULL if no file is mapped
+    size_t                      _readAheadBytes;
+    size_t                      _advisedUntil;  // The end of the part the OS was last told about
+
+    boost::thread*              _prefetchThread;
+    boost::mutex*               _prefetchMutex;
+    boost::condition_variable*  _prefetchCondVar;
+    size_t                      _prefetchPosition;  // The read position as seen by the prefetch thread
+    bool                        _quitPrefetch;
+};
+
+/**
+ * Opens a video and finds its streams, either by probing or from the stream info cache.
+ * The name is looked up in Ogre's resource groups first. If no resource has that name, it is opened as a file.
+ * @param p_name            The resource name or path of the video.
+ * @param p_resourceGroup   The resource group to look in, AUTODETECT_RESOURCE_GROUP_NAME to search all of them.
+ * @param p_settings        How the video is read.
+ * @param p_outContext      Set to the opened format context.
+ * @param p_outError        Set to the error if opening failed.
+ * @param p_outInfoFromCache    If given, set to whether the streams were set up from the stream info cache.
+ * @return  True if the video could be opened.
+ */
+bool openVideoInput(const Ogre::String& p_name, const Ogre::String& p_resourceGroup, const InputSettings& p_settings,
+                    AVFormatContext*& p_outContext, Ogre::String& p_outError, bool* p_outInfoFromCache = NULL);
+
+/**
+ * Identifies the current version of a video, so caches can tell when it changed.
+ * The name is looked up like openVideoInput does.
+ * @return  False if the video can not be identified.
+ */
+bool getVideoInputKey(const Ogre::String& p_name, const Ogre::String& p_resourceGroup, StreamInfoKey& p_outKey);
+
+/**
+ * @return  The statistics of a format context opened with openVideoInput.
+ *          Empty if FFmpeg reads the file itself. Only call this from the thread that reads.
+ */
+InputStats getVideoInputStats(AVFormatContext* p_context);
+
+/**
+ * Closes a format context opened with openVideoInput, including its input stream.
+ * Sets the context to NULL.
+ */
+void closeVideoInput(AVFormatContext*& p_context);
+
+#endif	/* FFMPEGINPUTSTREAM_H */
@@ -0,0 +1,174 @@
+/* 
+ * File:   FFmpegMediaCatalog.h
+ * Author: TheSHEEEP
+ *
+ * Created on 19. Oktober 2026, 23:05
+ */
+
+#ifndef FFMPEGMEDIACATALOG_H
+#define	FFMPEGMEDIACATALOG_H
+
+#include "FFmpegPluginPrerequisites.h"
+#include "FFmpegInputStream.h"
+#include "FFmpegThreadSettings.h"
+#include "FFmpegVideoPlayer.h"
+
+#include <OgreResourceGroupManager.h>
+#include <vector>
+#include <stdint.h>
+
+// Forward declarations
+namespace Ogre
+{
+    class Log;
+}
+namespace boost
+{
+    class mutex;
+}
+
+/**
+ * What the catalog knows about one video.
+ */
+struct _FFmpegPluginExport CatalogEntry
+{
+    CatalogEntry();
+
+    Ogre::String            name;               // The file path or resource name the video was scanned with
+    Ogre::String            error;              // Why the video could not be scanned, empty if it could
+
+    double                  duration;           // Duration in seconds
+    unsigned int            bitRate;            // Bit rate of the whole file
+    Ogre::String            videoCodec;         // Codec of the best video stream, empty if there is none
+    unsigned int            videoWidth;         // The width of the best video stream in pixels
+    unsigned int            videoHeight;        // The height of the best video stream in pixels
+    double                  frameRate;          // Frames per second of the best video stream
+    Ogre::String            audioCodec;         // Codec of the best audio stream, empty if there is none
+    unsigned int            audioSampleRate;    // Sample rate of the best audio stream
+    unsigned int            audioNumChannels;   // Number of channels of the best audio stream
+    std::vector<StreamInfo> streams;            // All streams of the video file
+
+    unsigned int            posterWidth;        // Size of the poster frame, 0 if there is none
+    unsigned int            posterHeight;
+    std::vector<uint8_t>    posterData;         // The poster frame in RGBA, empty if there is none
+};
+
+/**
+ * How videos are scanned.
+ */
+struct _FFmpegPluginExport CatalogScanSettings
+{
+    CatalogScanSettings();
+
+    unsigned int            numThreads;         // Number of files scanned at the same time, 0 for one per core
+    DecoderThreadSettings   threadSettings;     // Applied to the scanning threads, e.g. to keep them off the main core
+    Ogre::String            resourceGroup;      // The resource group names are looked up in, files are found anyway
+    InputSettings           inputSettings;      // How the videos are read
+    bool                    extractPoster;      // Decode a poster frame of each video. Default is false.
+    double                  posterTime;         // Where the poster frame is taken, in seconds.
+                                                // Negative for a tenth into the video, which is the default.
+    unsigned int            posterWidth;        // Width of the poster frames, the height keeps the aspect ratio.
+                                                // 0 keeps the video's width. Default is 256.
+};
+
+/**
+ * Keeps metadata of many videos, e.g. for the video library of a launcher,
+ * without opening each of them with a player.
+ *
+ * Videos are probed in parallel, each scanning thread opens one video at a time.
+ * The catalog can be written to a compact binary file and loaded from it again without touching the videos.
+ * Scanning, loading and reading entries must not happen at the same time.
+ */
+class _FFmpegPluginExport FFmpegMediaCatalog
+{
+public:
+    /**
+     * Constructor.
+     */
+    FFmpegMediaCatalog();
+
+    /**
+     * Destructor.
+     */
+    ~FFmpegMediaCatalog();
+
+    /**
+     * @param p_log The log scan errors are reported to. Pass 0 for no logging.
+     */
+    void setLog(Ogre::Log* p_log);
+
+    /**
+     * Scans the videos and adds them to the catalog. Entries with the same name are replaced.
+     * Blocks until all videos are scanned.
+     * @param p_names   File paths or resource names of the videos.
+     * @return  True if all videos could be scanned. The entries of the others have their error set.
+     */
+    bool scanFiles(const Ogre::StringVector& p_names, const CatalogScanSettings& p_settings = CatalogScanSettings());
+
+    /**
+     * Scans all videos of a directory. See scanFiles.
+     * @param p_directory   The directory to look in.
+     * @param p_pattern     Which files are scanned, e.g. "*.webm".
+     * @param p_recursive   Also look in subdirectories.
+     * @return  True if the directory could be read and all videos in it could be scanned.
+     */
+    bool scanDirectory(const Ogre::String& p_directory, const Ogre::String& p_pattern, bool p_recursive = true,
+                       const CatalogScanSettings& p_settings = CatalogScanSettings());
+
+    /**
+     * @return  The entry of a video, NULL if it is not in the catalog.
+     */
+    const CatalogEntry* findEntry(const Ogre::String& p_name) const;
+
+    /**
+     * @return  All entries, in the order they were added.
+     */
+    const std::vector<CatalogEntry>& getEntries() const;
+
+    /**
+     * Removes all entries.
+     */
+    void clear();
+
+    /**
+     * Writes all entries to a file.
+     * @return  True if the file could be written.
+     */
+    bool save(const Ogre::String& p_path) const;
+
+    /**
+     * Replaces all entries with the ones of a file written by save.
+     * @return  True if the file could be read. The catalog is empty otherwise.
+     */
+    bool load(const Ogre::String& p_path);
+
+private:
+    /**
+     * Takes the next video to scan until none are left.
+     */
+    void scanLoop(const Ogre::StringVector* p_names, std::vector<CatalogEntry>* p_outEntries,
+                  const CatalogScanSettings* p_settings);
+
+    /**
+     * Probes a single video and decodes its poster frame.
+     * @return  True if the video could be scanned.
+     */
+    static bool scanVideo(const Ogre::String& p_name, const CatalogScanSettings& p_settings,
+                          CatalogEntry& p_outEntry);
+
+    std::vector<CatalogEntry>   _entries;
+    Ogre::Log*                  _log;
+
+    boost::mutex*               _scanMutex;
+    unsigned int                _nextScanIndex;     // The next video a scanning thread takes
+};
+
+//------------------------------------------------------------------------------
+inline
+const std::vector<CatalogEntry>&
+FFmpegMediaCatalog::getEntries() const
+{
+    return _entries;
+}
+
+#endif	/* FFMPEGMEDIACATALOG_H */
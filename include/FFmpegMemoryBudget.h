@@ -0,0 +1,195 @@
+/* 
+ * File:   FFmpegMemoryBudget.h
+ * Author: TheSHEEEP
+ *
+ * Created on 19. Oktober 2026, 21:30
+ */
+
+#ifndef FFMPEGMEMORYBUDGET_H
+#define	FFMPEGMEMORYBUDGET_H
+
+#include "FFmpegPluginPrerequisites.h"
+
+#include <OgreFrameListener.h>
+#include <vector>
+#include <cstddef>
+
+// Forward declarations
+class FFmpegVideoPlayer;
+
+/**
+ * Memory used by the decoded frames of a player.
+ */
+struct MemoryUsage
+{
+    MemoryUsage();
+    
+    /**
+     * @return  All bytes together.
+     */
+    size_t getTotal() const;
+    
+    size_t  videoBytes;         // Buffered video frames
+    size_t  audioBytes;         // Buffered audio frames
+    size_t  backupBytes;        // The first frames kept for looping, as far as no other frame shares their data
+    size_t  residentBytes;      // The player's share of its resident clip. Players sharing a clip split it evenly.
+    double  bufferedTime;       // How many seconds of playback the buffered frames last
+};
+
+// Helpful defines
+#define FFMPEG_MEMORY_BUDGET FFmpegMemoryBudget::getSingletonPtr()
+
+/**
+ * Keeps the decoded frames of all players within a process-wide memory budget.
+ * 
+ * Once per render frame, the budget measures what each player buffers and splits the budget 
+ * among them. Foreground players are served first. Within a priority class, each player gets 
+ * an even share, and what a player does not need at its buffer target goes to the others.
+ * A player stops decoding when its buffers reach its share, which lowers its buffer target 
+ * in effect. Background players that are over their share also drop their newest frames.
+ * 
+ * Players register themselves. Use this from the render thread only.
+ */
+class _FFmpegPluginExport FFmpegMemoryBudget : public Ogre::FrameListener
+{
+private:
+    /**
+     * Constructor.
+     */
+    FFmpegMemoryBudget();
+    
+    static FFmpegMemoryBudget* _instance;
+    
+public:
+    /**
+     * @return A pointer to the instance of this singleton.
+     */
+    static FFmpegMemoryBudget* getSingletonPtr()
+    {
+        if (!_instance)
+        {
+            _instance = new FFmpegMemoryBudget();
+        }
+        return _instance;
+    }
+    
+    /**
+     * Destructor.
+     */
+    ~FFmpegMemoryBudget();
+    
+    /**
+     * @param p_bytes   How much memory the decoded frames of all players may use together. 
+     *                  0 for no limit (default).
+     */
+    void setBudget(size_t p_bytes);
+    
+    /**
+     * @return  How much memory the decoded frames of all players may use together.
+     */
+    size_t getBudget() const;
+    
+    /**
+     * @return  How much memory the decoded frames of all players used at the last measurement.
+     */
+    size_t getCurrentUsage() const;
+    
+    /**
+     * @return  The highest usage measured since the last reset.
+     */
+    size_t getPeakUsage() const;
+    
+    /**
+     * Sets the peak usage to the current usage.
+     */
+    void resetPeakUsage();
+    
+    /**
+     * @return  What the passed player used at the last measurement.
+     */
+    MemoryUsage getPlayerUsage(const FFmpegVideoPlayer* p_player) const;
+    
+    /**
+     * Called by each player when it is created.
+     */
+    void registerPlayer(FFmpegVideoPlayer* p_player);
+    
+    /**
+     * Called by each player when it is destroyed.
+     */
+    void unregisterPlayer(FFmpegVideoPlayer* p_player);
+    
+    /**
+     * Measures all players and hands out their shares of the budget.
+     */
+    void update();
+    
+    /**
+     * Calls update.
+     */
+    virtual bool frameStarted(const Ogre::FrameEvent& p_evt);
+    
+private:
+    struct PlayerEntry
+    {
+        FFmpegVideoPlayer*  player;
+        MemoryUsage         usage;
+        size_t              demand;     // What the buffers would take at the full buffer target
+        size_t              allowance;
+    };
+    
+    std::vector<PlayerEntry>    _players;
+    size_t                      _budget;
+    size_t                      _currentUsage;
+    size_t                      _peakUsage;
+};
+
+//------------------------------------------------------------------------------
+inline
+size_t 
+MemoryUsage::getTotal() const
+{
+    return videoBytes + audioBytes + backupBytes + residentBytes;
+}
+
+//------------------------------------------------------------------------------
+inline
+void 
+FFmpegMemoryBudget::setBudget(size_t p_bytes)
+{
+    _budget = p_bytes;
+}
+
+//------------------------------------------------------------------------------
+inline
+size_t 
+FFmpegMemoryBudget::getBudget() const
+{
+    return _budget;
+}
+
+//------------------------------------------------------------------------------
+inline
+size_t 
+FFmpegMemoryBudget::getCurrentUsage() const
+{
+    return _currentUsage;
+}
+
+//------------------------------------------------------------------------------
+inline
+size_t 
+FFmpegMemoryBudget::getPeakUsage() const
+{
+    return _peakUsage;
+}
+
+//------------------------------------------------------------------------------
+inline
+void 
+FFmpegMemoryBudget::resetPeakUsage()
+{
+    _peakUsage = _currentUsage;
+}
+
+#endif	/* FFMPEGMEMORYBUDGET_H */
@@ -0,0 +1,122 @@
+/* 
+ * File:   FFmpegPlayerRegistry.h
+ * Author: TheSHEEEP
+ *
+ * Created on 19. Oktober 2026, 20:15
+ */
+
+#ifndef FFMPEGPLAYERREGISTRY_H
+#define	FFMPEGPLAYERREGISTRY_H
+
+#include "FFmpegPluginPrerequisites.h"
+
+#include <OgreString.h>
+#include <map>
+#include <vector>
+
+// Forward declarations
+namespace Ogre
+{
+    class Log;
+}
+class FFmpegVideoPlayer;
+
+// Helpful defines
+#define FFMPEG_PLAYER_REGISTRY FFmpegPlayerRegistry::getSingletonPtr()
+
+/**
+ * Hands out one player per video file and playback clock.
+ * 
+ * All surfaces that show the same file on the same clock get the same player, which shows 
+ * the video on all of their texture units. The video is decoded, converted and uploaded once, 
+ * no matter how many surfaces show it. Surfaces that should show the same file at different 
+ * positions use different clock names.
+ * Use this from the render thread only.
+ */
+class _FFmpegPluginExport FFmpegPlayerRegistry
+{
+private:
+    /**
+     * Constructor.
+     */
+    FFmpegPlayerRegistry();
+    
+    static FFmpegPlayerRegistry* _instance;
+    
+public:
+    /**
+     * @return A pointer to the instance of this singleton.
+     */
+    static FFmpegPlayerRegistry* getSingletonPtr()
+    {
+        if (!_instance)
+        {
+            _instance = new FFmpegPlayerRegistry();
+        }
+        return _instance;
+    }
+    
+    /**
+     * Destructor. Stops and deletes all players that were not released.
+     */
+    ~FFmpegPlayerRegistry();
+    
+    /**
+     * @param p_log The log new players use. Pass 0 for no logging.
+     */
+    void setLog(Ogre::Log* p_log);
+    
+    /**
+     * Gets the player for the file and clock and shows its video on the passed texture unit.
+     * A new player is registered as a frame listener, but does not play yet. 
+     * Set it up and call startPlaying() if getIsPlaying() and getIsWaitingForBuffers() are false.
+     * @param p_filename        The video file.
+     * @param p_materialName    The material to show the video on.
+     * @param p_textureUnitName The texture unit inside that material.
+     * @param p_clockName       Surfaces with the same file and clock name share a player.
+     * @return  The player. Release it with releasePlayer, do not delete it.
+     */
+    FFmpegVideoPlayer* acquirePlayer(const Ogre::String& p_filename, const Ogre::String& p_materialName, 
+                                     const Ogre::String& p_textureUnitName, const Ogre::String& p_clockName = "");
+    
+    /**
+     * Stops showing the video on the texture unit. 
+     * The player is stopped and deleted when no texture unit shows its video anymore.
+     */
+    void releasePlayer(FFmpegVideoPlayer* p_player, const Ogre::String& p_materialName, 
+                       const Ogre::String& p_textureUnitName);
+    
+    /**
+     * @return  How many players are currently shared.
+     */
+    unsigned int getNumPlayers() const;
+    
+private:
+    typedef std::pair<Ogre::String, Ogre::String> SourceKey;    // File and clock name
+    typedef std::pair<Ogre::String, Ogre::String> Binding;      // Material and texture unit name
+    
+    struct SharedPlayer
+    {
+        FFmpegVideoPlayer*      player;
+        std::vector<Binding>    bindings;   // One entry per acquirePlayer call
+    };
+    
+    /**
+     * Stops, unregisters and deletes a player.
+     */
+    void destroyPlayer(FFmpegVideoPlayer* p_player);
+    
+    std::map<SourceKey, SharedPlayer>   _players;
+    unsigned int                        _numCreatedPlayers;
+    Ogre::Log*                          _log;
+};
+
+//------------------------------------------------------------------------------
+inline
+unsigned int 
+FFmpegPlayerRegistry::getNumPlayers() const
+{
+    return _players.size();
+}
+
+#endif	/* FFMPEGPLAYERREGISTRY_H */
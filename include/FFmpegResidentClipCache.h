@@ -0,0 +1,200 @@
+/* 
+ * File:   FFmpegResidentClipCache.h
+ * Author: TheSHEEEP
+ *
+ * Created on 20. Oktober 2026, 00:10
+ */
+
+#ifndef FFMPEGRESIDENTCLIPCACHE_H
+#define	FFMPEGRESIDENTCLIPCACHE_H
+
+#include "FFmpegPluginPrerequisites.h"
+#include "FFmpegVideoPlayer.h"
+
+#include <boost/shared_ptr.hpp>
+#include <boost/weak_ptr.hpp>
+#include <map>
+#include <vector>
+
+/**
+ * Decoded frames a player can show and play without decoding.
+ * The frames never change, so several players can use the same clip at the same time.
+ */
+class FrameClip
+{
+public:
+    /**
+     * Destructor.
+     */
+    virtual ~FrameClip() {}
+
+    /**
+     * @param p_time    Seconds from the start of the clip.
+     * @return  The frame shown at that time, NULL if the clip has no frames.
+     */
+    virtual const VideoFrame* getFrameForTime(double p_time) const = 0;
+
+    /**
+     * @return  The number of audio frames in the clip.
+     */
+    virtual unsigned int getNumAudioFrames() const = 0;
+
+    /**
+     * @return  The audio frame with the passed index.
+     */
+    virtual const AudioFrame* getAudioFrame(unsigned int p_index) const = 0;
+
+    /**
+     * @return  How long the clip lasts, in seconds.
+     */
+    virtual double getDuration() const = 0;
+
+    /**
+     * @return  The information of the video the clip was decoded from.
+     */
+    virtual const VideoInfo& getVideoInfo() const = 0;
+
+    /**
+     * @return  How much frame data the clip holds on the heap, in bytes.
+     */
+    virtual size_t getBytes() const = 0;
+
+protected:
+    /**
+     * @param p_frames  Frames sorted by their presentation time.
+     * @return  The last frame that starts at or before the passed time, NULL if there are no frames.
+     */
+    static const VideoFrame* findFrameForTime(const std::vector<VideoFrame*>& p_frames, double p_time);
+};
+
+/**
+ * All decoded frames of a short looping clip, so it can loop without being decoded again.
+ *
+ * The clip is filled while the video is decoded for the first time. If the frames do not fit into
+ * the size limit or do not follow each other without gaps, the clip is abandoned.
+ * Once it is complete, it never changes again, so several players can show it at the same time.
+ */
+class ResidentClip : public FrameClip
+{
+public:
+    /**
+     * @param p_maxBytes    How much frame data the clip may hold at most.
+     */
+    ResidentClip(size_t p_maxBytes);
+
+    /**
+     * Destructor. Deletes all frames.
+     */
+    virtual ~ResidentClip();
+
+    /**
+     * Adds the next decoded video frame to the clip. The clip shares the frame's data.
+     * Frames that are already in the clip are ignored, e.g. when the decoder decodes them again after a trim.
+     * @return  False if the clip can not be completed anymore.
+     */
+    bool addVideoFrame(const VideoFrame& p_frame);
+
+    /**
+     * Adds the next decoded audio frame to the clip. The clip shares the frame's data.
+     * @return  False if the clip can not be completed anymore.
+     */
+    bool addAudioFrame(const AudioFrame& p_frame);
+
+    /**
+     * Ends filling the clip once the whole video was decoded.
+     * @param p_videoInfo   The information of the decoded video, kept for players that share the clip.
+     * @return  False if the clip can not be used.
+     */
+    bool complete(const VideoInfo& p_videoInfo);
+
+    /**
+     * @return  True if the clip is complete.
+     */
+    bool getIsComplete() const;
+
+    // FrameClip
+    virtual const VideoFrame* getFrameForTime(double p_time) const;
+    virtual unsigned int getNumAudioFrames() const;
+    virtual const AudioFrame* getAudioFrame(unsigned int p_index) const;
+    virtual double getDuration() const;
+    virtual const VideoInfo& getVideoInfo() const;
+    virtual size_t getBytes() const;
+
+private:
+    std::vector<VideoFrame*>    _videoFrames;
+    std::vector<AudioFrame*>    _audioFrames;
+    VideoInfo                   _videoInfo;
+    size_t                      _bytes;
+    size_t                      _maxBytes;
+    bool                        _isComplete;
+    bool                        _isBroken;      // The clip can not be completed anymore
+};
+
+typedef boost::shared_ptr<ResidentClip> ResidentClipPtr;
+
+// Helpful defines
+#define FFMPEG_RESIDENT_CLIP_CACHE FFmpegResidentClipCache::getSingletonPtr()
+
+/**
+ * Lets players share complete resident clips of the same video.
+ * The cache does not keep clips alive, a clip is deleted as soon as no player shows it anymore.
+ * Use this from the render thread only.
+ */
+class _FFmpegPluginExport FFmpegResidentClipCache
+{
+private:
+    /**
+     * Constructor.
+     */
+    FFmpegResidentClipCache();
+
+    static FFmpegResidentClipCache* _instance;
+
+public:
+    /**
+     * @return A pointer to the instance of this singleton.
+     */
+    static FFmpegResidentClipCache* getSingletonPtr()
+    {
+        if (!_instance)
+        {
+            _instance = new FFmpegResidentClipCache();
+        }
+        return _instance;
+    }
+
+    /**
+     * Destructor.
+     */
+    ~FFmpegResidentClipCache();
+
+    /**
+     * @return  The complete clip of a video, empty if no player shows one.
+     */
+    ResidentClipPtr findClip(const Ogre::String& p_key);
+
+    /**
+     * Offers a complete clip to other players of the same video.
+     */
+    void addClip(const Ogre::String& p_key, const ResidentClipPtr& p_clip);
+
+    /**
+     * @return  The number of clips players currently show.
+     */
+    unsigned int getNumClips();
+
+    /**
+     * @return  How much frame data the clips players currently show hold together, each clip counted once.
+     */
+    size_t getBytes();
+
+private:
+    /**
+     * Forgets the clips no player shows anymore.
+     */
+    void removeExpiredClips();
+
+    std::map<Ogre::String, boost::weak_ptr<ResidentClip> >  _clips;
+};
+
+#endif	/* FFMPEGRESIDENTCLIPCACHE_H */
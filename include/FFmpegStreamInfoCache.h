@@ -0,0 +1,172 @@
+/* 
+ * File:   FFmpegStreamInfoCache.h
+ * Author: TheSHEEEP
+ *
+ * Created on 19. Oktober 2026, 22:20
+ */
+
+#ifndef FFMPEGSTREAMINFOCACHE_H
+#define	FFMPEGSTREAMINFOCACHE_H
+
+#include "FFmpegPluginPrerequisites.h"
+
+#include <OgreString.h>
+#include <map>
+#include <vector>
+#include <stdint.h>
+
+// Forward declarations
+struct AVFormatContext;
+namespace boost
+{
+    class mutex;
+}
+
+/**
+ * Identifies a version of a video file.
+ */
+struct StreamInfoKey
+{
+    StreamInfoKey();
+
+    Ogre::String    path;
+    uint64_t        size;
+    int64_t         modifiedTime;
+};
+
+// Helpful defines
+#define FFMPEG_STREAM_INFO_CACHE FFmpegStreamInfoCache::getSingletonPtr()
+
+/**
+ * Remembers the stream parameters FFmpeg found when probing a video, so the next open of the same file
+ * can set up its codecs without probing again.
+ *
+ * Entries are keyed by path, size and modification time, so changed files are probed again.
+ * The cache can be kept in a file across runs.
+ * This class is thread safe once the instance exists, the plugin creates it when it is installed.
+ */
+class _FFmpegPluginExport FFmpegStreamInfoCache
+{
+private:
+    /**
+     * Constructor.
+     */
+    FFmpegStreamInfoCache();
+
+    static FFmpegStreamInfoCache* _instance;
+
+public:
+    /**
+     * @return A pointer to the instance of this singleton.
+     */
+    static FFmpegStreamInfoCache* getSingletonPtr()
+    {
+        if (!_instance)
+        {
+            _instance = new FFmpegStreamInfoCache();
+        }
+        return _instance;
+    }
+
+    /**
+     * Destructor.
+     */
+    ~FFmpegStreamInfoCache();
+
+    /**
+     * Sets the file the cache is kept in and loads the entries in it.
+     * @param p_path    The path of the cache file. An empty path keeps the cache in memory only, which is the default.
+     * @return  True if the file could be loaded or does not exist yet.
+     */
+    bool setCacheFile(const Ogre::String& p_path);
+
+    /**
+     * Writes all entries to the cache file, if one is set and something changed.
+     * @return  True if the entries were written or nothing needed to be written.
+     */
+    bool save();
+
+    /**
+     * Sets up the streams of an opened video with the cached parameters.
+     * @return  True if there was a matching entry and the streams are ready for their codecs to be opened.
+     *          False if the video must be probed.
+     */
+    bool applyStreamInfo(const StreamInfoKey& p_key, AVFormatContext* p_formatContext);
+
+    /**
+     * Remembers the parameters of a probed video.
+     */
+    void storeStreamInfo(const StreamInfoKey& p_key, AVFormatContext* p_formatContext);
+
+    /**
+     * Removes all entries.
+     */
+    void clear();
+
+    /**
+     * @return  How many videos are cached.
+     */
+    unsigned int getNumEntries() const;
+
+    /**
+     * @return  How often a video could skip probing since the program started.
+     */
+    unsigned int getNumHits() const;
+
+    /**
+     * @return  How often a video had to be probed since the program started.
+     */
+    unsigned int getNumMisses() const;
+
+private:
+    struct CachedRational
+    {
+        int     num;
+        int     den;
+    };
+
+    struct CachedStream
+    {
+        int                     codecType;
+        int                     codecId;
+        unsigned int            codecTag;
+        int                     width;
+        int                     height;
+        int                     pixelFormat;
+        int                     sampleRate;
+        int                     numChannels;
+        uint64_t                channelLayout;
+        int                     sampleFormat;
+        int                     bitRate;
+        CachedRational          codecTimeBase;
+        CachedRational          timeBase;
+        CachedRational          realFrameRate;
+        CachedRational          averageFrameRate;
+        int64_t                 startTime;
+        int64_t                 duration;
+        std::vector<uint8_t>    extradata;
+    };
+
+    struct CacheEntry
+    {
+        uint64_t                    size;
+        int64_t                     modifiedTime;
+        int64_t                     startTime;
+        int64_t                     duration;
+        std::vector<CachedStream>   streams;
+    };
+
+    /**
+     * Reads the entries of the cache file. Expects the mutex to be locked.
+     */
+    bool load();
+
+    std::map<Ogre::String, CacheEntry>  _entries;
+    Ogre::String                        _cacheFile;
+    bool                                _isDirty;
+    unsigned int                        _numHits;
+    unsigned int                        _numMisses;
+    boost::mutex*                       _mutex;
+};
+
+#endif	/* FFMPEGSTREAMINFOCACHE_H */
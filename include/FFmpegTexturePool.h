@@ -0,0 +1,165 @@
+/* 
+ * File:   FFmpegTexturePool.h
+ * Author: TheSHEEEP
+ *
+ * Created on 19. Oktober 2026, 21:30
+ */
+
+#ifndef FFMPEGTEXTUREPOOL_H
+#define	FFMPEGTEXTUREPOOL_H
+
+#include "FFmpegPluginPrerequisites.h"
+
+#include <OgreTexture.h>
+#include <map>
+
+// Forward declarations
+namespace Ogre
+{
+    class Log;
+}
+
+/**
+ * Metrics of the texture pool.
+ */
+struct TexturePoolStats
+{
+    TexturePoolStats();
+
+    unsigned int    numHits;            // How often a free texture of the wanted size could be handed out
+    unsigned int    numMisses;          // How often a new texture had to be created
+    unsigned int    numFreeTextures;    // Textures waiting to be handed out again
+    unsigned int    numUsedTextures;    // Textures currently handed out
+};
+
+// Helpful defines
+#define FFMPEG_TEXTURE_POOL FFmpegTexturePool::getSingletonPtr()
+
+/**
+ * Hands out dynamic textures and takes them back, so videos do not create and destroy
+ * textures each time they start. Textures are reused by size and pixel format,
+ * across videos and players.
+ * Use this from the render thread only.
+ */
+class _FFmpegPluginExport FFmpegTexturePool
+{
+private:
+    /**
+     * Constructor.
+     */
+    FFmpegTexturePool();
+
+    static FFmpegTexturePool* _instance;
+
+public:
+    /**
+     * @return A pointer to the instance of this singleton.
+     */
+    static FFmpegTexturePool* getSingletonPtr()
+    {
+        if (!_instance)
+        {
+            _instance = new FFmpegTexturePool();
+        }
+        return _instance;
+    }
+
+    /**
+     * Destructor. Removes the free textures.
+     */
+    ~FFmpegTexturePool();
+
+    /**
+     * @param p_log The log the pool reports created textures to. Pass 0 for no logging.
+     */
+    void setLog(Ogre::Log* p_log);
+
+    /**
+     * Creates free textures up front, e.g. while loading a level.
+     * @param p_numTextures How many textures of that size and format to create.
+     */
+    void preallocate(unsigned int p_width, unsigned int p_height, Ogre::PixelFormat p_format,
+                     unsigned int p_numTextures);
+
+    /**
+     * @return  A free texture of that size and format. One is created if there is none.
+     */
+    Ogre::TexturePtr acquireTexture(unsigned int p_width, unsigned int p_height, Ogre::PixelFormat p_format);
+
+    /**
+     * Gives a texture back. Pending uploads to it must be cancelled first.
+     * If there are more free textures than the limit, the oldest free texture is removed.
+     */
+    void releaseTexture(const Ogre::TexturePtr& p_texture);
+
+    /**
+     * @param p_maxFreeTextures How many free textures are kept at most. Default is 8.
+     */
+    void setMaxFreeTextures(unsigned int p_maxFreeTextures);
+
+    /**
+     * @return  How many free textures are kept at most.
+     */
+    unsigned int getMaxFreeTextures() const;
+
+    /**
+     * Removes all free textures. Textures that are handed out are not affected.
+     */
+    void clear();
+
+    /**
+     * @return  The metrics since the last reset.
+     */
+    TexturePoolStats getStats() const;
+
+    /**
+     * Resets the hit and miss counts.
+     */
+    void resetStats();
+
+private:
+    struct TextureKey
+    {
+        unsigned int        width;
+        unsigned int        height;
+        Ogre::PixelFormat   format;
+
+        bool operator<(const TextureKey& p_other) const;
+    };
+
+    struct FreeTexture
+    {
+        Ogre::TexturePtr    texture;
+        unsigned int        releaseSerial;  // Lower values were released earlier
+    };
+
+    typedef std::multimap<TextureKey, FreeTexture> FreeTextureMap;
+
+    /**
+     * @return  A new texture of that size and format.
+     */
+    Ogre::TexturePtr createTexture(const TextureKey& p_key);
+
+    /**
+     * Removes the oldest free textures until the limit is kept.
+     */
+    void trimFreeTextures();
+
+    FreeTextureMap  _freeTextures;
+    unsigned int    _maxFreeTextures;
+    unsigned int    _numCreatedTextures;
+    unsigned int    _releaseSerial;
+    Ogre::Log*      _log;
+
+    TexturePoolStats    _stats;
+};
+
+//------------------------------------------------------------------------------
+inline
+unsigned int
+FFmpegTexturePool::getMaxFreeTextures() const
+{
+    return _maxFreeTextures;
+}
+
+#endif	/* FFMPEGTEXTUREPOOL_H */
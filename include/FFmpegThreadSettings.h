@@ -0,0 +1,51 @@
+/* 
+ * File:   FFmpegThreadSettings.h
+ * Author: TheSHEEEP
+ *
+ * Created on 19. Oktober 2026, 17:55
+ */
+
+#ifndef FFMPEGTHREADSETTINGS_H
+#define	FFMPEGTHREADSETTINGS_H
+
+#include "FFmpegPluginPrerequisites.h"
+
+#include <stdint.h>
+
+// Forward declarations
+namespace Ogre
+{
+    class Log;
+}
+
+/**
+ * Where and how urgently decoder threads run.
+ * FFmpeg's codec threads are created by the decoder thread when the codec is opened,
+ * so they inherit its placement.
+ */
+struct _FFmpegPluginExport DecoderThreadSettings
+{
+    DecoderThreadSettings();
+    
+    uint64_t        affinityMask;   // Bit i allows the thread to run on core i. 0 keeps the inherited affinity.
+    int             niceValue;      // From -20 (most urgent) to 19 (least urgent), 0 keeps the inherited priority.
+                                    // On Windows, this is mapped to the closest thread priority.
+    unsigned int    maxCores;       // Decoding uses at most this many cores, the lowest ones of the affinity mask.
+                                    // Also limits FFmpeg's codec threads. 0 for no limit.
+};
+
+/**
+ * Applies the settings to the calling thread and logs the effective placement.
+ * Affinity is not supported on Apple platforms and is ignored there.
+ * @param p_name    Name of the thread for the log.
+ * @return  True if all requested settings could be applied.
+ */
+bool applyDecoderThreadSettings(const DecoderThreadSettings& p_settings, Ogre::Log* p_log, const char* p_name);
+
+/**
+ * @return  The number of codec threads FFmpeg should use with these settings, 
+ *          0 to keep FFmpeg's default.
+ */
+int getCodecThreadCount(const DecoderThreadSettings& p_settings);
+
+#endif	/* FFMPEGTHREADSETTINGS_H */
@@ -0,0 +1,233 @@
+/* 
+ * File:   FFmpegUploadScheduler.h
+ * Author: TheSHEEEP
+ *
+ * Created on 19. Oktober 2026, 18:40
+ */
+
+#ifndef FFMPEGUPLOADSCHEDULER_H
+#define	FFMPEGUPLOADSCHEDULER_H
+
+#include "FFmpegPluginPrerequisites.h"
+
+#include <OgreFrameListener.h>
+#include <OgreTexture.h>
+#include <map>
+
+// Forward declarations
+struct VideoFrame;
+
+/**
+ * Upload metrics of the scheduler.
+ */
+struct UploadStats
+{
+    UploadStats();
+    
+    unsigned int    numUploads;         // How many frames were uploaded
+    size_t          numBytes;           // How many bytes were uploaded
+    unsigned int    numDeferred;        // How often an upload was moved to the next render frame
+    unsigned int    numSkipped;         // How many frames were never uploaded because a newer one replaced them
+    double          lastFrameTime;      // How long the uploads of the last render frame took, in seconds
+    double          maxFrameTime;       // Longest time the uploads of a single render frame took, in seconds
+};
+
+// Helpful defines
+#define FFMPEG_UPLOAD_SCHEDULER FFmpegUploadScheduler::getSingletonPtr()
+
+/**
+ * Spreads video texture uploads of all videos across render frames.
+ * 
+ * Players submit their new frames instead of uploading them right away. Each render frame,
+ * the scheduler uploads the most important pending frames until the time or byte budget
+ * is used up. The rest waits for the next frame. If a newer frame of the same texture arrives
+ * before that, it replaces the waiting one.
+ * 
+ * Uploads happen in frameRenderingQueued, while the GPU is busy with the frame, 
+ * so they are visible in the next frame.
+ * Use this from the render thread only.
+ */
+class _FFmpegPluginExport FFmpegUploadScheduler : public Ogre::FrameListener
+{
+private:
+    /**
+     * Constructor.
+     */
+    FFmpegUploadScheduler();
+    
+    static FFmpegUploadScheduler* _instance;
+    
+public:
+    /**
+     * @return A pointer to the instance of this singleton.
+     */
+    static FFmpegUploadScheduler* getSingletonPtr()
+    {
+        if (!_instance)
+        {
+            _instance = new FFmpegUploadScheduler();
+        }
+        return _instance;
+    }
+    
+    /**
+     * Destructor. Deletes all pending frames.
+     */
+    ~FFmpegUploadScheduler();
+    
+    /**
+     * @param p_seconds How long the uploads of a single render frame may take. 0 for no limit (default).
+     */
+    void setTimeBudget(double p_seconds);
+    
+    /**
+     * @return  How long the uploads of a single render frame may take, in seconds.
+     */
+    double getTimeBudget() const;
+    
+    /**
+     * @param p_bytes   How many bytes may be uploaded in a single render frame. 0 for no limit (default).
+     */
+    void setByteBudget(size_t p_bytes);
+    
+    /**
+     * @return  How many bytes may be uploaded in a single render frame.
+     */
+    size_t getByteBudget() const;
+    
+    /**
+     * @param p_numFrames   Uploads that waited this many render frames are done regardless of the budget,
+     *                      so unimportant videos do not freeze completely. Default is 4.
+     */
+    void setMaxDeferFrames(unsigned int p_numFrames);
+    
+    /**
+     * @return  After how many render frames an upload is done regardless of the budget.
+     */
+    unsigned int getMaxDeferFrames() const;
+    
+    /**
+     * Queues a frame for upload. A frame that waits for the same texture is replaced.
+     * @param p_texture     The texture to upload to.
+     * @param p_frame       The frame to upload. The scheduler takes ownership.
+     * @param p_width       Width of the frame in pixels.
+     * @param p_height      Height of the frame in pixels.
+     * @param p_priority    Frames with a higher priority are uploaded first, e.g. visible or important videos.
+     */
+    void submitUpload(const Ogre::TexturePtr& p_texture, VideoFrame* p_frame, 
+                      unsigned int p_width, unsigned int p_height, double p_priority);
+    
+    /**
+     * Drops the pending upload for a texture. Call this before removing the texture.
+     */
+    void cancelUpload(const Ogre::String& p_textureName);
+    
+    /**
+     * Uploads pending frames until the budget of this render frame is used up.
+     * This is called automatically in frameRenderingQueued.
+     */
+    void processUploads();
+    
+    /**
+     * @return  The number of frames waiting for upload.
+     */
+    unsigned int getNumPendingUploads() const;
+    
+    /**
+     * @return  The upload metrics since the last reset.
+     */
+    const UploadStats& getStats() const;
+    
+    /**
+     * Resets the upload metrics.
+     */
+    void resetStats();
+    
+    /**
+     * Uploads pending frames.
+     */
+    virtual bool frameRenderingQueued(const Ogre::FrameEvent& p_evt);
+    
+private:
+    struct PendingUpload
+    {
+        Ogre::TexturePtr    texture;
+        VideoFrame*         frame;
+        unsigned int        width;
+        unsigned int        height;
+        double              priority;
+        unsigned int        framesWaited;
+    };
+    
+    std::map<Ogre::String, PendingUpload>   _pendingUploads;
+    double                                  _timeBudget;
+    size_t                                  _byteBudget;
+    unsigned int                            _maxDeferFrames;
+    UploadStats                             _stats;
+};
+
+//------------------------------------------------------------------------------
+inline
+void 
+FFmpegUploadScheduler::setTimeBudget(double p_seconds)
+{
+    _timeBudget = p_seconds;
+}
+
+//------------------------------------------------------------------------------
+inline
+double 
+FFmpegUploadScheduler::getTimeBudget() const
+{
+    return _timeBudget;
+}
+
+//------------------------------------------------------------------------------
+inline
+void 
+FFmpegUploadScheduler::setByteBudget(size_t p_bytes)
+{
+    _byteBudget = p_bytes;
+}
+
+//------------------------------------------------------------------------------
+inline
+size_t 
+FFmpegUploadScheduler::getByteBudget() const
+{
+    return _byteBudget;
+}
+
+//------------------------------------------------------------------------------
+inline
+void 
+FFmpegUploadScheduler::setMaxDeferFrames(unsigned int p_numFrames)
+{
+    _maxDeferFrames = p_numFrames;
+}
+
+//------------------------------------------------------------------------------
+inline
+unsigned int 
+FFmpegUploadScheduler::getMaxDeferFrames() const
+{
+    return _maxDeferFrames;
+}
+
+//------------------------------------------------------------------------------
+inline
+unsigned int 
+FFmpegUploadScheduler::getNumPendingUploads() const
+{
+    return _pendingUploads.size();
+}
+
+//------------------------------------------------------------------------------
+inline
+const UploadStats& 
+FFmpegUploadScheduler::getStats() const
+{
+    return _stats;
+}
+
+#endif	/* FFMPEGUPLOADSCHEDULER_H */
@@ -8,8 +8,26 @@
 #ifndef FFMPEGVIDEODECODINGTHREAD_H
 #define	FFMPEGVIDEODECODINGTHREAD_H
 
+#include "FFmpegDecoderPool.h"
+#include "FFmpegThreadSettings.h"
+
+#include <deque>
+#include <vector>
+#include <stdint.h>
+
 // Forward declarations
 class FFmpegVideoPlayer;
+struct VideoInfo;
+struct StreamInfo;
+struct VideoFrame;
+struct AudioFrame;
+struct AVFrame;
+struct AVStream;
+struct AVFormatContext;
+struct AVCodecContext;
+struct AVPacket;
+struct SwsContext;
+struct SwrContext;
 namespace boost
 {
     class thread;
@@ -28,6 +46,191 @@ struct ThreadInfo
     boost::mutex*               playerMutex;
     boost::condition_variable*  playerCondVar;
     bool                        isLoop;         
+    double                      startTime;      // Position to start decoding at, in seconds
+    bool                        isReverse;      // Decode backwards, starting at startTime
+    DecoderThreadSettings       threadSettings; // Applied to a dedicated decoding thread
+    int                         codecThreadCount;   // Number of FFmpeg codec threads, 0 for FFmpeg's default
+};
+
+/**
+ * The playback rate settings as they are applied to the decoders.
+ */
+struct RateState
+{
+    RateState()
+        : rate(1.0)
+        , keyframesOnly(false)
+        , muteAudio(false)
+    {}
+    
+    double  rate;
+    bool    keyframesOnly;
+    bool    muteAudio;
+};
+
+enum DecodingStepResult
+{
+    DSR_DECODED,        // A packet was decoded, there is more to do
+    DSR_BUFFERS_FULL,   // Nothing was decoded, the player's buffers are full
+    DSR_FINISHED        // Decoding is done, aborted or failed
+};
+
+/**
+ * Holds everything needed to decode one video and decodes it step by step.
+ * This is shared by the dedicated decoding thread and the decoder pool.
+ */
+class DecodingContext
+{
+public:
+    /**
+     * @param p_threadInfo  The decoding settings. This is deleted by the constructor.
+     */
+    DecodingContext(ThreadInfo* p_threadInfo);
+    
+    /**
+     * Destructor. Closes everything that is still open.
+     */
+    ~DecodingContext();
+    
+    /**
+     * Opens the video file and the codecs and fills the player's VideoInfo.
+     * The player is woken up when the VideoInfo is filled or an error occurred.
+     * @return  True if decoding can start.
+     */
+    bool open();
+    
+    /**
+     * Decodes the next packet.
+     * Reverse playback is decoded in a single step that only returns when it is done.
+     */
+    DecodingStepResult step();
+    
+    /**
+     * Frees all FFmpeg objects and marks decoding as done if it finished without errors.
+     */
+    void close();
+    
+    /**
+     * @return  True if the video plays backwards.
+     */
+    bool getIsReverse() const;
+    
+    /**
+     * @param p_collect If this is true, decoded frames are kept by the context instead of 
+     *                  being added to the player right away. Does not affect reverse playback.
+     */
+    void setCollectFrames(bool p_collect);
+    
+    /**
+     * Moves all collected frames to the end of the passed lists.
+     */
+    void takeCollectedFrames(std::deque<VideoFrame*>& p_outVideoFrames, std::deque<AudioFrame*>& p_outAudioFrames);
+    
+private:
+    /**
+     * Continues decoding at the keyframe before the passed time, frames before it are skipped.
+     * @param p_keepAudio   If this is true, the player kept its audio, so audio frames are skipped 
+     *                      until the end of what was already decoded.
+     */
+    void seek(double p_time, bool p_keepAudio);
+    
+    /**
+     * @return  The decoder resolution (as a power of two divisor) that fits the player's level of detail.
+     */
+    int getWantedLowres() const;
+    
+    /**
+     * Hands the frames the video decoder still holds back to the player, then opens 
+     * the decoder again with another resolution. Must be called right before a keyframe.
+     * @return  False if the decoder could not be opened again.
+     */
+    bool reopenVideoCodec(int p_lowres);
+    
+    FFmpegVideoPlayer*          _player;
+    VideoInfo*                  _videoInfo;
+    boost::mutex*               _decodingMutex;
+    boost::condition_variable*  _decodingCondVar;
+    boost::condition_variable*  _playerCondVar;
+    bool                        _isLoop;
+    double                      _startTime;
+    bool                        _isReverse;
+    int                         _codecThreadCount;
+    bool                        _isOpen;
+    
+    AVFormatContext*    _formatContext;
+    AVStream*           _audioStream;
+    AVCodecContext*     _audioCodecContext;
+    int                 _audioStreamIndex;
+    unsigned int        _audioTrackSerial;
+    AVStream*           _videoStream;
+    AVCodecContext*     _videoCodecContext;
+    int                 _videoStreamIndex;
+    AVPacket*           _packet;
+    AVFrame*            _frame;
+    SwsContext*         _swsContext;
+    RateState           _rateState;
+    SwrContext*         _swrContext;
+    uint8_t**           _destBuffer;
+    int                 _destBufferLinesize;
+    double              _skipUntil;
+    double              _audioSkipUntil;
+    unsigned int        _seekSerial;
+    double              _openStartTime;     // Steady clock time in seconds when opening started
+    
+    bool                        _collectFrames;
+    std::deque<VideoFrame*>     _collectedVideoFrames;
+    std::deque<AudioFrame*>     _collectedAudioFrames;
+};
+
+//------------------------------------------------------------------------------
+inline
+bool 
+DecodingContext::getIsReverse() const
+{
+    return _isReverse;
+}
+
+//------------------------------------------------------------------------------
+inline
+void 
+DecodingContext::setCollectFrames(bool p_collect)
+{
+    _collectFrames = p_collect;
+}
+
+/**
+ * Decodes a video on the shared decoder pool instead of a thread of its own.
+ * Each step decodes packets for a short time slice, so the pool can switch 
+ * to the video that is closest to running out of frames.
+ */
+class PlayerDecodingJob : public FFmpegDecoderPool::Job
+{
+public:
+    /**
+     * @param p_threadInfo  The decoding settings. This is deleted by the constructor.
+     */
+    PlayerDecodingJob(ThreadInfo* p_threadInfo);
+    
+    virtual ~PlayerDecodingJob();
+    
+    virtual FFmpegDecoderPool::JobStepResult step();
+    virtual double getSecondsUntilDeadline();
+    virtual DecodingPriority getPriority();
+    
+    /**
+     * @param p_collect If this is true, decoded frames are kept until deliverCollectedFrames is called.
+     */
+    void setCollectFrames(bool p_collect);
+    
+    /**
+     * Adds all frames decoded since the last call to the player.
+     */
+    void deliverCollectedFrames();
+    
+private:
+    FFmpegVideoPlayer*  _player;
+    DecodingContext     _context;
+    bool                _isOpen;
 };
 
 /**
@@ -37,8 +240,36 @@ struct ThreadInfo
  * The video player wakes it up regularly so it checks if it must continue decoding.
  * 
  * Such a thread is started each time a new video is being played/decoded.
+ * 
+ * For reverse playback, the thread seeks to the keyframe before the current position,
+ * decodes that GOP once and hands its frames to the player in reverse order. 
+ * While the player shows them, the thread already decodes the GOP before.
  */
 void videoDecodingThread(ThreadInfo* p_threadInfo);
 
+/**
+ * Converts the timestamp of a decoded frame into seconds relative to the start of the stream.
+ * @param p_fallback    Returned if the frame has no usable timestamp at all.
+ */
+double getFramePts(AVFrame* p_frame, AVStream* p_stream, double p_fallback);
+
+/**
+ * Seeks to the keyframe at or before the passed time.
+ * @param p_time    Seconds relative to the start of the stream.
+ * @return  True if the seek succeeded.
+ */
+bool seekToKeyframe(AVFormatContext* p_formatContext, AVStream* p_stream, double p_time);
+
+/**
+ * Fills a StreamInfo for each stream of the format context.
+ */
+void fillStreamInfos(AVFormatContext* p_formatContext, std::vector<StreamInfo>& p_outStreams);
+
+/**
+ * Registers FFmpeg's formats and codecs and a lock manager, so codecs can be opened from several threads 
+ * at once. Only the first call does anything, call it before using FFmpeg from any thread.
+ */
+void initializeFFmpeg();
+
 #endif	/* FFMPEGVIDEODECODINGTHREAD_H */
 
@@ -0,0 +1,110 @@
+/* 
+ * File:   FFmpegVideoFrameCache.h
+ * Author: TheSHEEEP
+ *
+ * Created on 19. Oktober 2026, 14:40
+ */
+
+#ifndef FFMPEGVIDEOFRAMECACHE_H
+#define	FFMPEGVIDEOFRAMECACHE_H
+
+#include <map>
+#include <list>
+#include <cstddef>
+
+// Forward declarations
+struct VideoFrame;
+
+/**
+ * Cache of decoded video frames, keyed by their presentation timestamps.
+ * When the cache grows beyond its byte budget, the least recently used frames are deleted.
+ * 
+ * This class is not thread safe.
+ */
+class VideoFrameCache
+{
+public:
+    /**
+     * Constructor.
+     */
+    VideoFrameCache();
+    
+    /**
+     * Destructor. Deletes all cached frames.
+     */
+    ~VideoFrameCache();
+    
+    /**
+     * @param p_bytes   How much image data the cache may hold. 
+     *                  Frames are evicted right away if the cache is bigger.
+     */
+    void setBudget(size_t p_bytes);
+    
+    /**
+     * @return  How much image data the cache may hold, in bytes.
+     */
+    size_t getBudget() const;
+    
+    /**
+     * @return  How much image data the cache currently holds, in bytes.
+     */
+    size_t getBytes() const;
+    
+    /**
+     * @return  The number of cached frames.
+     */
+    size_t size() const;
+    
+    /**
+     * Adds a frame as the most recently used one. 
+     * A cached frame with the same timestamp is replaced.
+     * @param p_frame   The frame to add. The cache takes ownership of the frame.
+     */
+    void insert(VideoFrame* p_frame);
+    
+    /**
+     * Looks up the frame that is shown at the passed time and marks it as recently used.
+     * @param p_time    The time in seconds.
+     * @return  The cached frame, or NULL if it is not cached. The cache keeps ownership.
+     */
+    const VideoFrame* find(double p_time);
+    
+    /**
+     * @param p_time    The time in seconds.
+     * @return  True if the frame shown at that time is cached. Does not count as a use.
+     */
+    bool contains(double p_time) const;
+    
+    /**
+     * Deletes all cached frames.
+     */
+    void clear();
+    
+private:
+    typedef std::list<double> LruList;
+    
+    struct Entry
+    {
+        VideoFrame*         frame;
+        LruList::iterator   lruPosition;
+    };
+    typedef std::map<double, Entry> EntryMap;
+    
+    /**
+     * @return  The entry of the frame shown at the passed time, or _entries.end().
+     */
+    EntryMap::const_iterator findEntry(double p_time) const;
+    
+    /**
+     * Deletes least recently used frames until the cache fits into the budget.
+     * The most recently used frame is always kept.
+     */
+    void evict();
+    
+    EntryMap    _entries;
+    LruList     _lru;       // Most recently used first
+    size_t      _bytes;
+    size_t      _budget;
+};
+
+#endif	/* FFMPEGVIDEOFRAMECACHE_H */
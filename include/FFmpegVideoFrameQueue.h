@@ -0,0 +1,195 @@
+/* 
+ * File:   FFmpegVideoFrameQueue.h
+ * Author: TheSHEEEP
+ *
+ * Created on 19. Oktober 2026, 10:12
+ */
+
+#ifndef FFMPEGVIDEOFRAMEQUEUE_H
+#define	FFMPEGVIDEOFRAMEQUEUE_H
+
+#include <vector>
+#include <cstddef>
+
+// Forward declarations
+struct VideoFrame;
+
+/**
+ * Ring of decoded video frames, ordered by their presentation timestamps.
+ * 
+ * The player asks for the frame that is due at a certain playback time instead of
+ * counting down frame durations, so variable frame rates and inaccurate durations
+ * do not add up to a drift.
+ * 
+ * For reverse playback, the queue holds frames in descending presentation order and 
+ * playback time moves backwards.
+ * 
+ * This class is not thread safe, the player guards it with its mutex.
+ */
+class VideoFrameQueue
+{
+public:
+    /**
+     * Constructor.
+     */
+    VideoFrameQueue();
+    
+    /**
+     * Destructor. Deletes all frames that are still queued.
+     */
+    ~VideoFrameQueue();
+    
+    /**
+     * @param p_reversed    If this is true, frames are queued and looked up for reverse playback.
+     * @note    Only change this while the queue is empty.
+     */
+    void setReversed(bool p_reversed);
+    
+    /**
+     * @return  True if the queue is set up for reverse playback.
+     */
+    bool getReversed() const;
+    
+    /**
+     * @param p_frame   The frame to add. Frames must be added in presentation order 
+     *                  (descending when reversed).
+     *                  The queue takes ownership of the frame.
+     */
+    void push(VideoFrame* p_frame);
+    
+    /**
+     * Looks up the frame that is due at the passed time, which is the last frame with a 
+     * presentation timestamp less or equal to that time. 
+     * When reversed, it is the last frame that ends at or after that time.
+     * All frames before it are deleted in one go. As playback time only moves forward,
+     * each frame is looked at once, making the lookup constant time per frame.
+     * @note    Make sure to delete the frame when you are done with it!
+     * @param p_time            The playback time in seconds.
+     * @param p_outNumReleased  Increased by the number of frames that were deleted.
+     * @return  The due frame, removed from the queue. 
+     *          Or NULL if no queued frame is due yet.
+     */
+    VideoFrame* getFrameForTime(double p_time, unsigned int& p_outNumReleased);
+    
+    /**
+     * Removes the frame that was queued last.
+     * @return  The frame, removed from the queue. Or NULL if the queue is empty.
+     */
+    VideoFrame* popBack();
+    
+    /**
+     * Deletes all frames.
+     */
+    void clear();
+    
+    /**
+     * @return  The number of queued frames.
+     */
+    size_t size() const;
+    
+    /**
+     * @return  True if there are no queued frames.
+     */
+    bool empty() const;
+    
+    /**
+     * @return  The time span covered by the queued frames, in seconds.
+     */
+    double getBufferedTime() const;
+    
+    /**
+     * @return  The presentation timestamp of the last queued frame, 
+     *          or -1.0 if the queue is empty.
+     */
+    double getLastPts() const;
+    
+    /**
+     * @return  The size of the image data of all queued frames, in bytes.
+     */
+    size_t getBufferedBytes() const;
+    
+    /**
+     * @return  The frame that is shown next, without taking it out of the queue. NULL if the queue is empty.
+     */
+    VideoFrame* front() const;
+    
+private:
+    /**
+     * @return  True if the passed frame is due at the passed time.
+     */
+    bool isDue(const VideoFrame* p_frame, double p_time) const;
+    
+    /**
+     * @return  The frame at the passed position, counted from the oldest frame.
+     */
+    VideoFrame* at(size_t p_position) const;
+    
+    /**
+     * Doubles the capacity of the ring.
+     */
+    void grow();
+    
+    std::vector<VideoFrame*>    _ring;
+    size_t                      _head;
+    size_t                      _count;
+    size_t                      _bytes;
+    bool                        _reversed;
+};
+
+//------------------------------------------------------------------------------
+inline
+void 
+VideoFrameQueue::setReversed(bool p_reversed)
+{
+    _reversed = p_reversed;
+}
+
+//------------------------------------------------------------------------------
+inline
+bool 
+VideoFrameQueue::getReversed() const
+{
+    return _reversed;
+}
+
+//------------------------------------------------------------------------------
+inline
+VideoFrame* 
+VideoFrameQueue::front() const
+{
+    return _count > 0 ? at(0) : NULL;
+}
+
+//------------------------------------------------------------------------------
+inline
+size_t 
+VideoFrameQueue::getBufferedBytes() const
+{
+    return _bytes;
+}
+
+//------------------------------------------------------------------------------
+inline
+size_t 
+VideoFrameQueue::size() const
+{
+    return _count;
+}
+
+//------------------------------------------------------------------------------
+inline
+bool 
+VideoFrameQueue::empty() const
+{
+    return _count == 0;
+}
+
+//------------------------------------------------------------------------------
+inline
+VideoFrame* 
+VideoFrameQueue::at(size_t p_position) const
+{
+    return _ring[(_head + p_position) & (_ring.size() - 1)];
+}
+
+#endif	/* FFMPEGVIDEOFRAMEQUEUE_H */
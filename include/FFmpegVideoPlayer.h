@@ -10,10 +10,18 @@
 
 #include "FFmpegPluginPrerequisites.h"
 #include "FFmpegVideoDecodingThread.h"
+#include "FFmpegVideoFrameQueue.h"
+#include "FFmpegMemoryBudget.h"
+#include "FFmpegInputStream.h"
+#include "FFmpegYUVPlanes.h"
 
 #include <OgreFrameListener.h>
+#include <OgreRenderObjectListener.h>
 #include <OgreTextureManager.h>
+#include <boost/shared_ptr.hpp>
+#include <boost/checked_delete.hpp>
 #include <deque>
+#include <vector>
 
 #include <stdint.h>
 
@@ -22,6 +30,34 @@ namespace Ogre
 {
     class Log;
 }
+class FrameClip;
+class ResidentClip;
+class BakedClipWriter;
+
+enum StreamType
+{
+    STREAMTYPE_OTHER,
+    STREAMTYPE_VIDEO,
+    STREAMTYPE_AUDIO
+};
+
+/**
+ * Helper struct that describes a single stream of the video file.
+ */
+struct StreamInfo
+{
+    StreamInfo();
+    
+    int             index;              // The index of the stream inside the container
+    StreamType      type;               // Video, audio or anything else
+    Ogre::String    codecName;          // Name of the codec the stream is encoded with
+    Ogre::String    language;           // Language tag of the stream (e.g. "eng"), empty if unknown
+    Ogre::String    title;              // Title of the stream, empty if unknown
+    unsigned int    audioSampleRate;    // Sample rate (audio streams only)
+    unsigned int    audioNumChannels;   // Number of channels (audio streams only)
+    unsigned int    videoWidth;         // Width in pixels (video streams only)
+    unsigned int    videoHeight;        // Height in pixels (video streams only)
+};
 
 /**
  * Helper struct that holds various video information.
@@ -48,9 +84,21 @@ struct VideoInfo
     double          videoDuration;          // Video duration in seconds
     unsigned int    videoWidth;             // The width of the video in pixels
     unsigned int    videoHeight;            // The height of the video in pixels
+    YUVColorMatrix  videoColorMatrix;       // The matrix the video's colors are meant to be converted with
+    bool            videoFullRange;         // True if the video's colors use the full range
     
     double          longerDuration;         // The duration of video or audio, whatever is longer
     Ogre::String    error;                  // This is set to the error that happened
+    
+    std::vector<StreamInfo> streams;        // All streams of the video file
+    int             audioStreamIndex;       // Index of the audio stream that is currently decoded
+    int             videoStreamIndex;       // Index of the video stream that is currently decoded
+    
+    double          openDuration;           // Seconds it took to open the file and set up the decoders
+    double          firstFrameLatency;      // Seconds from the start of opening until the first video frame 
+                                            // was decoded, -1 until then
+    bool            streamInfoFromCache;    // True if the streams were set up from the stream info cache
+                                            // instead of probing the file
 };
 
 enum LogLevel
@@ -62,6 +110,34 @@ enum LogLevel
     NUM_LOGLEVELS
 };
 
+enum AudioRatePolicy
+{
+    ARP_MUTE,       // Audio is silent whenever the playback rate is not 1
+    ARP_RESAMPLE,   // Audio is resampled to the playback rate (pitch changes with the rate),
+                    // muted when decoding keyframes only
+};
+
+enum InvisiblePolicy
+{
+    IP_KEEP_DECODING,       // Decode as usual, only the texture uploads are skipped
+    IP_THROTTLE_DECODING,   // Only decode keyframes while invisible, continue at the current position when visible again
+    IP_PAUSE_DECODING       // Stop decoding while invisible, continue at the current position when visible again
+};
+
+enum DecodingMode
+{
+    DM_THREAD,          // A decoding thread of its own
+    DM_DECODER_POOL,    // The shared FFmpegDecoderPool
+    DM_WORK_QUEUE       // Requests on Ogre's WorkQueue, frames are handed over on the main thread
+};
+
+enum VideoOutputFormat
+{
+    VOF_RGBA,           // Converted to RGBA while decoding, any material can show it
+    VOF_YUV_PLANES      // The decoded Y, U and V planes in one PF_L8 texture, the material converts them to RGB
+                        // (see FFmpegYUVPlanes and media/FFmpegYUV.material)
+};
+
 enum AudioSampleFormat
 {
 	ASF_FLOAT, // AV_SAMPLE_FMT_FLT
@@ -70,6 +146,10 @@ enum AudioSampleFormat
 
 /**
  * Struct that holds one audio frame.
+ * 
+ * Frames are handles to their data. Copies share the data instead of copying it, 
+ * and the data is freed with the last frame that uses it. So the data of a frame must not be changed 
+ * once it was handed on, other frames may show it. Deleting a frame you got is still how you give it back.
  */
 struct AudioFrame
 {
@@ -79,58 +159,86 @@ struct AudioFrame
         , dataSize(0)
     {}
     
-    AudioFrame(const AudioFrame& other)
-    {
-        lifeTime = other.lifeTime;
-        dataSize = other.dataSize;
-        data = new uint8_t[dataSize];
-        memcpy(data, other.data, dataSize);
-    }
-    
-    ~AudioFrame()
+    /**
+     * Allocates new data for the frame, which is only shared with later copies.
+     */
+    void allocate(unsigned int p_size)
     {
-        if (data != NULL)
-        {
-            delete [] data;
-        }
+        data = new uint8_t[p_size];
+        dataSize = p_size;
+        buffer.reset(data, boost::checked_array_deleter<uint8_t>());
     }
     
-    double          lifeTime;   // How long this frame should last. In seconds.
-    uint8_t*        data;
-    unsigned int    dataSize;
+    double                      lifeTime;   // How long this frame should last. In seconds.
+    uint8_t*                    data;
+    unsigned int                dataSize;
+    boost::shared_ptr<void>     buffer;     // Keeps the data alive, shared by all copies of the frame
 };
 
 /**
  * Struct that holds one video frame.
+ * Copies share the data, like the copies of audio frames do.
  */
 struct VideoFrame
 {
     VideoFrame()
-        : lifeTime (0.0)
+        : pts(0.0)
+        , lifeTime (0.0)
+        , width(0)
+        , height(0)
+        , format(Ogre::PF_BYTE_RGBA)
         , data(NULL)
         , dataSize(0)
     {}
     
-    VideoFrame(const VideoFrame& other)
+    /**
+     * Allocates new data for the frame, which is only shared with later copies.
+     */
+    void allocate(unsigned int p_size)
     {
-        lifeTime = other.lifeTime;
-        dataSize = other.dataSize;
-        data = new uint8_t[dataSize];
-        memcpy(data, other.data, dataSize);
+        data = new uint8_t[p_size];
+        dataSize = p_size;
+        buffer.reset(data, boost::checked_array_deleter<uint8_t>());
     }
     
-    ~VideoFrame()
-    {
-        if (data != NULL)
-        {
-            delete [] data;
-        }
-    }
+    double                      pts;        // When this frame should be shown, relative to the start of the video. In seconds.
+    double                      lifeTime;   // How long this frame should last. In seconds.
+    unsigned int                width;      // Width of the image in pixels, depends on the level of detail it was decoded with
+    unsigned int                height;     // Height of the image in pixels
+    Ogre::PixelFormat           format;     // PF_BYTE_RGBA, or PF_L8 for the planes of a YUV frame (see FFmpegYUVPlanes)
+    uint8_t*                    data;       // The image data
+    unsigned int                dataSize;
+    boost::shared_ptr<void>     buffer;     // Keeps the data alive, shared by all copies of the frame
+};
+
+/**
+ * What the adaptive buffer target is based on.
+ */
+struct BufferStats
+{
+    BufferStats();
     
+    double          bufferTarget;           // The buffer target in use, in seconds
+    double          decodeLoad;             // Seconds of decoding work per second of video, averaged
+    double          decodeLoadDeviation;    // Standard deviation of the decode load
+    double          bitrate;                // Bytes of video data per second of video, averaged
+    double          bitrateDeviation;       // Standard deviation of the bitrate
+    unsigned int    numUnderruns;           // How often the video buffer ran dry during playback
+};
+
+/**
+ * A texture unit the video is shown on.
+ */
+struct MaterialBinding
+{
+    MaterialBinding();
     
-    double          lifeTime;   // How long this frame should last. In seconds.
-    uint8_t*        data;       // The image data
-    unsigned int    dataSize;
+    Ogre::String            materialName;
+    Ogre::String            textureUnitName;
+    bool                    isMain;                 // Set up by setMaterialName and setTextureUnitName
+    const Ogre::Material*   material;               // Found when the video starts playing
+    Ogre::TextureUnitState* textureUnitState;
+    Ogre::String            originalTextureName;    // What the texture unit showed before the video
 };
 
 // Helpful defines
@@ -142,7 +250,7 @@ struct VideoFrame
  * 
  * Playback assumes video master for synchronization.
  */
-class _FFmpegPluginExport FFmpegVideoPlayer : public Ogre::FrameListener
+class _FFmpegPluginExport FFmpegVideoPlayer : public Ogre::FrameListener, public Ogre::RenderObjectListener
 {
 private:
     /**
@@ -152,6 +260,9 @@ private:
     
     static FFmpegVideoPlayer* _instance;
     
+    // Creates the players that are shared between surfaces
+    friend class FFmpegPlayerRegistry;
+    
 public:
     /**
      * @return A pointer to the instance of this singleton.
@@ -211,6 +322,69 @@ public:
      */
     const Ogre::String& getTextureUnitName() const;
     
+    /**
+     * Shows the video on another texture unit as well. All texture units share the same texture,
+     * so the video is still decoded and uploaded only once. Can be called while the video plays.
+     * @param p_materialName    The material to play the video on.
+     * @param p_textureUnitName The texture unit inside that material.
+     */
+    void addMaterialBinding(const Ogre::String& p_materialName, const Ogre::String& p_textureUnitName);
+    
+    /**
+     * Stops showing the video on a texture unit added with addMaterialBinding. 
+     * It shows its original texture again.
+     */
+    void removeMaterialBinding(const Ogre::String& p_materialName, const Ogre::String& p_textureUnitName);
+    
+    /**
+     * @return  How many texture units the video is shown on, including the one set by setMaterialName.
+     */
+    unsigned int getNumMaterialBindings() const;
+    
+    /**
+     * @param p_name    The name of the texture the video is uploaded to. Default is "FFmpegVideoTexture".
+     *                  Players that play at the same time need different names. Can not be changed while playing.
+     */
+    void setVideoTextureName(const Ogre::String& p_name);
+    
+    /**
+     * @return  The name of the texture the video is uploaded to.
+     */
+    const Ogre::String& getVideoTextureName() const;
+    
+    /**
+     * @param p_use If this is true, the video texture is taken from the texture pool instead of being created, 
+     *              and given back when the video stops. The texture then has the pool's name instead of the 
+     *              video texture name, use getVideoTexture to get it. Default is false.
+     * @note    Only has an effect on the next call to startPlaying.
+     */
+    void setUseTexturePool(bool p_use);
+    
+    /**
+     * @return  True if the video texture is taken from the texture pool.
+     */
+    bool getUseTexturePool() const;
+    
+    /**
+     * @param p_format  How decoded frames are put into the video texture. Default is VOF_RGBA.
+     *                  With VOF_YUV_PLANES, frames are not converted to RGB while decoding and take 
+     *                  less than half the memory and upload bandwidth, but the material has to convert them. 
+     *                  media/FFmpegYUV.material shows how. The player sets the program parameter "yuvToRgb" 
+     *                  of the material's passes to the conversion of the video's colors.
+     * @note    Set this before the video starts playing. The material must fit it.
+     */
+    void setVideoOutputFormat(VideoOutputFormat p_format);
+    
+    /**
+     * @return  How decoded frames are put into the video texture.
+     */
+    VideoOutputFormat getVideoOutputFormat() const;
+    
+    /**
+     * @return  The texture the video is uploaded to. Null if there is none.
+     */
+    const Ogre::TexturePtr& getVideoTexture() const;
+    
     /**
      * @param p_name    The video filename.
      */
@@ -221,6 +395,41 @@ public:
      */
     const Ogre::String& getVideoFilename() const;
     
+    /**
+     * @param p_group   The resource group the video is looked up in. 
+     *                  Videos that are not a resource in that group are opened as a file.
+     *                  Default is AUTODETECT_RESOURCE_GROUP_NAME, which searches all groups.
+     */
+    void setResourceGroup(const Ogre::String& p_group);
+    
+    /**
+     * @return  The resource group the video is looked up in.
+     */
+    const Ogre::String& getResourceGroup() const;
+    
+    /**
+     * @param p_settings    How the video is read: the read buffer size, and whether local files are memory mapped.
+     * @note    Only has an effect before decoding starts.
+     */
+    void setInputSettings(const InputSettings& p_settings);
+    
+    /**
+     * @return  How the video is read.
+     */
+    const InputSettings& getInputSettings() const;
+    
+    /**
+     * @return  How reading the current video went, including the time the decoder was blocked waiting for data.
+     *          Empty if FFmpeg reads the file itself, which is the case for files that are no resource 
+     *          in the IM_STREAM input mode.
+     */
+    InputStats getInputStats();
+    
+    /**
+     * Used by the decoder to report how reading went.
+     */
+    void setInputStats(const InputStats& p_stats);
+    
     /**
      * @return  The VideoInfo object. Use this to read/write information about the video.
      *          This is being updated with video information as soon as the video starts decoding.
@@ -237,6 +446,65 @@ public:
      */
     float getBufferTarget() const;
     
+    /**
+     * @param p_thresholdSeconds    Playback starts as soon as both buffers hold this much, 
+     *                              while they keep filling up to the buffer target.
+     *                              A negative value waits for the full buffer target, which is the default.
+     */
+    void setStartThreshold(double p_thresholdSeconds);
+    
+    /**
+     * @return  How much both buffers must hold before playback starts. Negative if the full buffer target is used.
+     */
+    double getStartThreshold() const;
+    
+    /**
+     * @param p_show    If this is true, the first decoded frame is shown right away while the buffers fill up.
+     *                  Otherwise the original textures stay until playback starts. Default is false.
+     */
+    void setShowPosterFrame(bool p_show);
+    
+    /**
+     * @return  True if the first decoded frame is shown right away.
+     */
+    bool getShowPosterFrame() const;
+    
+    /**
+     * @param p_adaptive    If this is true, the player picks the buffer target itself, based on how fast
+     *                      the video decodes compared to the playback rate and how much its bitrate varies.
+     *                      It starts at the target set by setBufferTarget. Default is false.
+     */
+    void setIsBufferTargetAdaptive(bool p_adaptive);
+    
+    /**
+     * @return  True if the player picks the buffer target itself.
+     */
+    bool getIsBufferTargetAdaptive() const;
+    
+    /**
+     * @param p_minSeconds  The adaptive buffer target never goes below this. Default is 0.5.
+     * @param p_maxSeconds  The adaptive buffer target never goes above this. Default is 5.
+     */
+    void setBufferTargetBounds(double p_minSeconds, double p_maxSeconds);
+    
+    /**
+     * @return  The buffer target in use, either the adaptive one or the one set by setBufferTarget.
+     */
+    double getCurrentBufferTarget() const;
+    
+    /**
+     * @return  The buffer target in use and the measurements it is based on.
+     */
+    BufferStats getBufferStats();
+    
+    /**
+     * Used by the decoder to report how long decoding took.
+     * @param p_workTime    The time spent decoding, in seconds.
+     * @param p_videoTime   How many seconds of video were decoded in that time.
+     * @param p_videoBytes  How many bytes of video data were decoded in that time.
+     */
+    void addDecodeMeasurement(double p_workTime, double p_videoTime, size_t p_videoBytes);
+    
     /**
      * @param p_numChannels The number of audio channels FFmpeg will decode to.
      *                      Pass 0 to keep the number of channels of the video source.
@@ -246,264 +514,957 @@ public:
     void setForcedAudioChannels(int p_numChannels);
     
     /**
-     * @param p_frame   The video frame to add to the end of the buffer.
+     * Selects the audio stream to decode. All streams that are not selected are discarded
+     * by the demuxer, so they cost neither I/O nor demuxing time.
+     * @param p_streamIndex The container index of the audio stream (see VideoInfo::streams).
+     *                      Pass -1 to let FFmpeg pick the best audio stream.
+     * @note    This can be called while decoding. The decoder then switches to the new stream
+     *          without reopening the file. Audio frames that are already buffered are still
+     *          played, so the switch is audible after the buffered time.
      */
-    void addAudioFrame(AudioFrame* p_frame);
+    void setAudioTrack(int p_streamIndex);
     
     /**
-     * @param p_frame   The video frame to add to the end of the buffer.
+     * Selects the first audio stream that is tagged with the passed language.
+     * If no such stream exists, FFmpeg's best audio stream is used.
+     * @param p_language    The language tag to look for (e.g. "eng", "deu").
+     * @note    Like setAudioTrack, this can be called while decoding.
      */
-    void addVideoFrame(VideoFrame* p_frame);
+    void setAudioTrackByLanguage(const Ogre::String& p_language);
     
     /**
-     * @return  Returns true if the audio buffer is full (contains buffer target in seconds).
+     * @return  The requested audio stream index, -1 if the stream is chosen automatically.
+     *          Use VideoInfo::audioStreamIndex to get the stream that is actually decoded.
      */
-    bool getAudioBufferIsFull();
+    int getAudioTrack() const;
     
     /**
-     * @return  Returns true if the video buffer is full (contains buffer target in seconds).
+     * @return  The requested audio language, empty if none was requested.
      */
-    bool getVideoBufferIsFull();
+    Ogre::String getAudioTrackLanguage() const;
     
     /**
-     * @return  True if there currently is a video playing.
+     * @return  A number that increases each time the audio track selection changes.
+     *          Used by the decoding thread to detect track switches.
      */
-    bool getIsPlaying() const;
+    unsigned int getAudioTrackSerial() const;
     
     /**
-     * @return True if the video is currently paused. 
-     *          Will only return true if a playing video is paused, 
-     *          not if there is no video playing at all.
+     * Selects the video stream to decode.
+     * @param p_streamIndex The container index of the video stream (see VideoInfo::streams).
+     *                      Pass -1 to let FFmpeg pick the best video stream.
+     * @note    Only has an effect when called before decoding starts.
      */
-    bool getIsPaused() const;
+    void setVideoTrack(int p_streamIndex);
     
     /**
-     * @return  True if the player is currently waiting for the buffers to fill.
+     * @return  The requested video stream index, -1 if the stream is chosen automatically.
      */
-    bool getIsWaitingForBuffers() const;
+    int getVideoTrack() const;
     
     /**
-     * Notifies the player that the audio playback is done.
+     * Sets the playback speed. 
+     * Already buffered frames are kept, the new rate applies to them right away.
+     * @param p_rate    The playback rate, 1.0 is normal speed. Clamped to [0.25, 8].
      */
-    void setAudioPlaybackDone();
+    void setPlaybackRate(double p_rate);
     
     /**
-     * @param p_looping If this is true, the video will loop.
-     * @note:   Looping requires slightly more memory as the first 0.5 second of the video is 
-     *          always stored to be able to start from beginning faster.
-     *          IMPORTANT: You MUST call setAudioPlaybackDone when you are done with the audio playback if 
-     *                      you want the video to loop.
+     * @return  The playback rate, 1.0 is normal speed.
      */
-    void setIsLooping(bool p_looping);
+    double getPlaybackRate() const;
     
     /**
-     * @return True if the video palyer is in looping playback.
+     * @param p_rate    Playback rates above this only decode keyframes, so decoding gets 
+     *                  cheaper the faster the playback is. Default is 2.
      */
-    bool getIsLooping() const;
+    void setKeyframeOnlyRate(double p_rate);
     
     /**
-     * Starts playing the video.
-     * This will decode the video and while doing so, play the video on a material.
-     * Audio handling is still up to you.
-     * 
-     * If you want to take care of the playback all yourself, use startDecoding instead.
-     * 
-     * @return  True if everything worked correctly.
+     * @return  The playback rate above which only keyframes are decoded.
      */
-    bool startPlaying();
+    double getKeyframeOnlyRate() const;
     
     /**
-     * Starts decoding the video.
-     * 
-     * Does not do any kind of playback, only fills the audio and video buffers.
-     * You have to take care of the playback.
-     * 
-     * If you want the video to be automatically played on a material (no sound!),
-     * you need to use startPlaying().
-     * 
-     * @param p_leaveFramesIntact   If this is true, the left over video and audio 
-     *                              frames will not be deleted. Useful for looping.
-     * @return  True if everything worked correctly.
+     * Switches between forward and reverse playback.
+     * Decoding is restarted at the current position, buffered frames are dropped.
+     * Reverse playback has no audio and stops at the start of the video.
+     * @param p_reversed    If this is true, the video plays backwards.
      */
-    bool startDecoding(bool p_leaveFramesIntact = false);
+    void setIsReversed(bool p_reversed);
     
     /**
-     * Pauses the video playback.
+     * @return  True if the video plays backwards.
      */
-    void pauseVideo();
+    bool getIsReversed() const;
     
     /**
-     * Resumes the video playback.
+     * @param p_bytes   How much memory the decoded frames for reverse playback may use.
+     *                  This includes the frames waiting for playback and the GOP that is being 
+     *                  decoded. GOPs that are bigger than half of this are decoded in several passes.
+     *                  Default is 256 MB.
      */
-    void resumeVideo();
+    void setReverseCacheBudget(size_t p_bytes);
     
     /**
-     * Stops video playback. 
-     * This clears all buffers and stops the decoding.
+     * @return  How much memory the decoded frames for reverse playback may use, in bytes.
      */
-    void stopVideo();
+    size_t getReverseCacheBudget() const;
     
     /**
-     * Distributes all decoded audio frame data into the passed vectors.
-     * As evenly as possible. This means that if you want 4 buffers to be filled, 
-     * but only 2 audio frames are decoded, it will still only fill two buffers.
-     * @param p_numBuffers             The number of buffers to fill.
-     * @param p_outAudioBuffers        The vector to put the buffers into.
-     * @param p_outAudioBufferSizes    The size of each buffer in bytes.
-     * @param p_outTotalBuffersTime    The total play time of all out buffers.
-     * @return  How many buffers could be filled.
+     * @return  The size of the image data of all buffered video frames, in bytes.
      */
-    int distributeDecodedAudioFrames(   unsigned int p_numBuffers, 
-                                        std::vector<uint8_t*>& p_outAudioBuffers, 
-                                        std::vector<unsigned int>& p_outAudioBufferSizes,
-                                        double& p_outTotalBuffersTime);
+    size_t getBufferedVideoBytes();
     
     /**
-     * This is how you get the video frames to play.
-     * READ CAREFULLY:
-     *      You have to call this function in your update loop and pass it the time since the last frame.
-     *      The function will then make sure you get the correct frame for the current time.
-     *      If the time since the last update is very long, some frames will get dropped.
-     *      If the time since the last update is not long enough, the last frame will be repeated.
-     * @note    Make sure to delete the frame when you are done with it!
-     * @param p_time    The time since the last frame. In seconds.
-     * @return  The current video frame to play. Or NULL if you are supposed to keep the last returned frame.
+     * @param p_mode    Where the video is decoded. Reverse playback always uses a thread of its own.
+     *                  If there is no WorkQueue with worker threads, DM_WORK_QUEUE falls back to DM_THREAD.
+     * @note    Only has an effect when called before decoding starts.
      */
-    VideoFrame* passVideoTimeAndGetFrame(double p_time);
+    void setDecodingMode(DecodingMode p_mode);
     
     /**
-     * Will check the decoding for errors and update the Ogre material if in playback mode.
-     * @param p_evt The frame event. Contains the time since the last frame.
-     * @return  True to go ahead, false to abort rendering and drop out of the rendering loop.
+     * @return  Where the video is decoded.
      */
-    virtual bool frameStarted(const Ogre::FrameEvent& p_evt);
-
+    DecodingMode getDecodingMode() const;
+    
     /**
-     * Returns the desired sample format for the decoding thread to use when converting audio
+     * @param p_priority    The priority class of this video in the decoder pool.
+     *                      Foreground videos are always decoded before background videos.
      */
-    AudioSampleFormat getAudioSampleFormat(void);
-
-	/**
-     * Sets the desired sample format for the decoding thread to use when converting audio
+    void setDecodingPriority(DecodingPriority p_priority);
+    
+    /**
+     * @return  The priority class of this video in the decoder pool.
      */
-    void setAudioSampleFormat(AudioSampleFormat fmt);
-
+    DecodingPriority getDecodingPriority() const;
+    
     /**
-     * Obtains the number of video frames currently buffered.
+     * @param p_settings    Affinity, priority and core limit of this video's decoding thread and 
+     *                      its codec threads. Applied when decoding starts.
+     *                      In DM_DECODER_POOL mode, the pool's settings are used instead.
+     *                      In DM_WORK_QUEUE mode, only the core limit for codec threads is used,
+     *                      the WorkQueue's threads belong to the engine.
      */
-    unsigned int getBufferedVideoFrames() const;
-
+    void setDecoderThreadSettings(const DecoderThreadSettings& p_settings);
+    
     /**
-     * Obtains the number of audio frames currently buffered.
+     * @return  Affinity, priority and core limit of this video's decoding thread.
      */
-    unsigned int getBufferedAudioFrames() const;
+    const DecoderThreadSettings& getDecoderThreadSettings() const;
     
-private:
-    Ogre::String    _materialName;
-    Ogre::String    _textureUnitName;
-    Ogre::String    _videoFileName;
-    VideoInfo       _videoInfo;
-    double          _bufferTarget;
-    int             _forcedAudioChannels;
+    /**
+     * @param p_useScheduler    If this is true, new frames are uploaded to the texture by the 
+     *                          FFmpegUploadScheduler, which spreads the uploads of all videos 
+     *                          over render frames. Frames then show up one render frame later.
+     */
+    void setUseUploadScheduler(bool p_useScheduler);
     
-    bool                        _isPlaying;
-    bool                        _isPaused;
-    bool                        _isWaitingForBuffers;
-    double                      _audioPlaybackTime;
-    double                      _videoPlaybackTime;
-    bool                        _videoBuffersFilledWithBackup;
-    bool                        _isDecoding;
-    bool                        _isLooping;
-    boost::thread*              _currentDecodingThread;
-    boost::mutex*               _playerMutex;
-    boost::condition_variable*  _playerCondVar;
-    boost::mutex*               _decodingMutex;
-    boost::condition_variable*  _decodingCondVar;
+    /**
+     * @return  True if new frames are uploaded by the FFmpegUploadScheduler.
+     */
+    bool getUseUploadScheduler() const;
     
-    double                      _currentAudioStorage;
-    double                      _currentAudioBackupStorage;
-    std::deque<AudioFrame*>     _audioFrames; 
-    std::deque<AudioFrame*>     _backupAudioFrames;
+    /**
+     * @param p_priority    Videos with a higher priority get their frames uploaded first 
+     *                      when the upload budget is tight. Default is 1.
+     */
+    void setUploadPriority(double p_priority);
     
-    double                      _currentVideoStorage;
-    double                      _currentVideoBackupStorage;
-    double                      _lastVideoFrameTimeRemaining;   // How much time remains until the next 
-                                                                // frame in the queue must be used
-    Ogre::TexturePtr            _texturePtr;
-    Ogre::String                _originalTextureName;
-    Ogre::TextureUnitState*     _originalTextureUnitState;
-    std::deque<VideoFrame*>     _videoFrames;
+    /**
+     * @return  The upload priority of this video.
+     */
+    double getUploadPriority() const;
+    
+    /**
+     * Sets how big the video currently appears on screen. Call this every frame when the size changes.
+     * Smaller videos are decoded and uploaded at a lower resolution, see setMaxLodLevel.
+     * @param p_width   Estimated on-screen width in pixels. Pass 0 to always use the full resolution.
+     * @param p_height  Estimated on-screen height in pixels.
+     */
+    void setOnScreenSize(unsigned int p_width, unsigned int p_height);
+    
+    /**
+     * @param p_level   The lowest level of detail to use. Each level halves width and height of the video.
+     *                  Pass 0 to always use the full resolution. Default is 3.
+     */
+    void setMaxLodLevel(unsigned int p_level);
+    
+    /**
+     * @return  The lowest level of detail to use.
+     */
+    unsigned int getMaxLodLevel() const;
+    
+    /**
+     * @param p_hysteresis  How much smaller than a lower level of detail the on-screen size has to be 
+     *                      before switching to it, e.g. 0.2 for 20 percent. Default is 0.2.
+     *                      Switching to a higher level of detail always happens right away.
+     */
+    void setLodHysteresis(double p_hysteresis);
+    
+    /**
+     * @return  How much smaller than a lower level of detail the on-screen size has to be.
+     */
+    double getLodHysteresis() const;
+    
+    /**
+     * @return  The level of detail new frames are decoded with, 0 is the full resolution.
+     */
+    unsigned int getLodLevel() const;
+    
+    /**
+     * @param p_level       The level of detail.
+     * @param p_outWidth    Width of the frames decoded with that level of detail.
+     * @param p_outHeight   Height of the frames decoded with that level of detail.
+     */
+    void getLodSize(unsigned int p_level, unsigned int& p_outWidth, unsigned int& p_outHeight) const;
+    
+    /**
+     * Tracks whether the pass with the video texture is rendered by the passed scene manager.
+     * While the video is not visible, no frames are uploaded and decoding follows the invisible policy.
+     * @param p_sceneManager    The scene manager that renders the video material. 
+     *                          Pass 0 to stop tracking, the video then always counts as visible.
+     */
+    void setVisibilitySceneManager(Ogre::SceneManager* p_sceneManager);
+    
+    /**
+     * @param p_numFrames   The video counts as invisible if it was not rendered in this many frames. Default is 5.
+     */
+    void setInvisibleAfterFrames(unsigned int p_numFrames);
+    
+    /**
+     * @return  After how many frames without being rendered the video counts as invisible.
+     */
+    unsigned int getInvisibleAfterFrames() const;
+    
+    /**
+     * @param p_policy  What happens to decoding while the video is invisible.
+     */
+    void setInvisiblePolicy(InvisiblePolicy p_policy);
+    
+    /**
+     * @return  What happens to decoding while the video is invisible.
+     */
+    InvisiblePolicy getInvisiblePolicy() const;
+    
+    /**
+     * @return  True if the video was rendered recently, or if visibility is not tracked.
+     */
+    bool getIsVisible() const;
+    
+    /**
+     * @return  True if only keyframes should be decoded because the video is invisible.
+     */
+    bool getIsDecodingThrottled() const;
+    
+    /**
+     * @return  True if nothing should be decoded because the video is invisible.
+     */
+    bool getIsDecodingSuspended() const;
+    
+    /**
+     * Used by the decoder to find out if it has to seek.
+     * @param p_ioSerial    The serial of the last seek the decoder did. Updated if there is a new one.
+     * @param p_outTime     The position to seek to, in seconds.
+     * @param p_outKeepAudio True if the buffered audio was kept. Audio then continues where it was.
+     * @return  True if the decoder has to seek.
+     */
+    bool getPendingSeek(unsigned int& p_ioSerial, double& p_outTime, bool& p_outKeepAudio);
+    
+    /**
+     * Notifies the player that the decoder did the seek with the passed serial.
+     * Frames are accepted again afterwards.
+     */
+    void setSeekDone(unsigned int p_serial);
+    
+    /**
+     * @return  How much memory the decoded frames of this player use.
+     */
+    MemoryUsage getMemoryUsage();
+    
+    /**
+     * Set by the memory budget. Decoding pauses while the buffered frames use more memory than this.
+     * @param p_bytes   The limit in bytes, 0 for no limit.
+     */
+    void setMemoryLimit(size_t p_bytes);
+    
+    /**
+     * @return  The memory limit set by the memory budget, 0 for no limit.
+     */
+    size_t getMemoryLimit() const;
+    
+    /**
+     * Drops the newest buffered video frames until the buffers fit into the passed size.
+     * Decoding continues after the last frame that was kept, the buffered audio is kept.
+     * Used by the memory budget for background players.
+     * @param p_maxBytes    How much memory the buffered frames may use afterwards.
+     */
+    void trimBuffers(size_t p_maxBytes);
+    
+    /**
+     * @return  How many seconds of playback the buffered frames last at the current playback rate.
+     *          This is the time left until the video stalls if nothing more is decoded.
+     */
+    double getBufferedPlaybackTime();
+    
+    /**
+     * @param p_policy  How audio is handled when the playback rate is not 1.
+     */
+    void setAudioRatePolicy(AudioRatePolicy p_policy);
+    
+    /**
+     * @return  How audio is handled when the playback rate is not 1.
+     */
+    AudioRatePolicy getAudioRatePolicy() const;
+    
+    /**
+     * @param p_frame   The video frame to add to the end of the buffer.
+     */
+    void addAudioFrame(AudioFrame* p_frame);
+    
+    /**
+     * @param p_frame   The video frame to add to the end of the buffer.
+     */
+    void addVideoFrame(VideoFrame* p_frame);
+    
+    /**
+     * @return  Returns true if the audio buffer is full (contains buffer target in seconds).
+     */
+    bool getAudioBufferIsFull();
+    
+    /**
+     * @return  Returns true if the video buffer is full (contains buffer target in seconds).
+     */
+    bool getVideoBufferIsFull();
+    
+    /**
+     * @return  True if there currently is a video playing.
+     */
+    bool getIsPlaying() const;
+    
+    /**
+     * @return True if the video is currently paused. 
+     *          Will only return true if a playing video is paused, 
+     *          not if there is no video playing at all.
+     */
+    bool getIsPaused() const;
+    
+    /**
+     * @return  True if the player is currently waiting for the buffers to fill.
+     */
+    bool getIsWaitingForBuffers() const;
+    
+    /**
+     * Notifies the player that the audio playback is done.
+     */
+    void setAudioPlaybackDone();
+    
+    /**
+     * @param p_looping If this is true, the video will loop.
+     * @note:   Looping requires slightly more memory as the first 0.5 second of the video is 
+     *          always stored to be able to start from beginning faster.
+     *          IMPORTANT: You MUST call setAudioPlaybackDone when you are done with the audio playback if 
+     *                      you want the video to loop.
+     */
+    void setIsLooping(bool p_looping);
+    
+    /**
+     * @return True if the video palyer is in looping playback.
+     */
+    bool getIsLooping() const;
+    
+    /**
+     * @param p_maxBytes    Looping videos whose decoded frames fit into this many bytes are decoded only once.
+     *                      All their frames are kept during the first loop, after that the video loops 
+     *                      from memory. 0 turns this off, which is the default.
+     * @note    Only has an effect on the next call to startPlaying. Videos that turn out to be larger, or that
+     *          skip frames during the first loop (e.g. while invisible or reversed), keep looping the normal way.
+     */
+    void setResidentClipMaxBytes(size_t p_maxBytes);
+    
+    /**
+     * @return  The size up to which looping videos are kept in memory.
+     */
+    size_t getResidentClipMaxBytes() const;
+    
+    /**
+     * @param p_share   If this is true, players of the same video share its resident clip, 
+     *                  so only the first one decodes it. Default is true.
+     */
+    void setShareResidentClips(bool p_share);
+    
+    /**
+     * @return  True if players of the same video share its resident clip.
+     */
+    bool getShareResidentClips() const;
+    
+    /**
+     * @return  True if the video loops from memory without decoding.
+     */
+    bool getIsResident() const;
+    
+    /**
+     * Decodes the whole video as fast as possible into the baked frame cache, so later plays need no decoding.
+     * Uses the video file, tracks, audio format and video output format set right now.
+     * Blocks until the video is decoded.
+     * @note    The baked frame cache needs a cache directory. The video must not be playing.
+     * @return  True if the bake was written.
+     */
+    bool bakeVideo();
+    
+    /**
+     * @param p_use If this is true, videos that were baked before are played from the baked frame cache
+     *              instead of being decoded. Default is false.
+     * @note    Only has an effect on the next call to startPlaying.
+     */
+    void setUseBakedFrames(bool p_use);
+    
+    /**
+     * @return  True if baked videos are played from the baked frame cache.
+     */
+    bool getUseBakedFrames() const;
+    
+    /**
+     * @return  True if the video plays from the baked frame cache without decoding.
+     */
+    bool getIsPlayingBaked() const;
+    
+    /**
+     * Starts playing the video.
+     * This will decode the video and while doing so, play the video on a material.
+     * Audio handling is still up to you.
+     * 
+     * If you want to take care of the playback all yourself, use startDecoding instead.
+     * 
+     * @return  True if everything worked correctly.
+     */
+    bool startPlaying();
+    
+    /**
+     * Starts decoding the video.
+     * 
+     * Does not do any kind of playback, only fills the audio and video buffers.
+     * You have to take care of the playback.
+     * 
+     * If you want the video to be automatically played on a material (no sound!),
+     * you need to use startPlaying().
+     * 
+     * @param p_leaveFramesIntact   If this is true, the left over video and audio 
+     *                              frames will not be deleted. Useful for looping.
+     * @return  True if everything worked correctly.
+     */
+    bool startDecoding(bool p_leaveFramesIntact = false);
+    
+    /**
+     * @return  The current playback position in seconds.
+     */
+    double getPlaybackTime() const;
+    
+    /**
+     * Pauses the video playback.
+     */
+    void pauseVideo();
+    
+    /**
+     * Resumes the video playback.
+     */
+    void resumeVideo();
+    
+    /**
+     * Stops video playback. 
+     * This clears all buffers and stops the decoding.
+     */
+    void stopVideo();
+    
+    /**
+     * Distributes all decoded audio frame data into the passed vectors.
+     * As evenly as possible. This means that if you want 4 buffers to be filled, 
+     * but only 2 audio frames are decoded, it will still only fill two buffers.
+     * @param p_numBuffers             The number of buffers to fill.
+     * @param p_outAudioBuffers        The vector to put the buffers into.
+     * @param p_outAudioBufferSizes    The size of each buffer in bytes.
+     * @param p_outTotalBuffersTime    The total play time of all out buffers.
+     * @return  How many buffers could be filled.
+     */
+    int distributeDecodedAudioFrames(   unsigned int p_numBuffers, 
+                                        std::vector<uint8_t*>& p_outAudioBuffers, 
+                                        std::vector<unsigned int>& p_outAudioBufferSizes,
+                                        double& p_outTotalBuffersTime);
+    
+    /**
+     * This is how you get the video frames to play.
+     * READ CAREFULLY:
+     *      You have to call this function in your update loop and pass it the time since the last frame.
+     *      The function will then make sure you get the correct frame for the current time.
+     *      If the time since the last update is very long, some frames will get dropped.
+     *      If the time since the last update is not long enough, the last frame will be repeated.
+     * @note    Make sure to delete the frame when you are done with it!
+     * @param p_time    The time since the last frame. In seconds.
+     * @return  The current video frame to play. Or NULL if you are supposed to keep the last returned frame.
+     */
+    VideoFrame* passVideoTimeAndGetFrame(double p_time);
+    
+    /**
+     * Gets the frame that is due at the passed playback time.
+     * All frames before that frame are dropped. Unlike passVideoTimeAndGetFrame, this does not
+     * advance the player's own playback time, so you can drive playback by your own clock.
+     * @note    Make sure to delete the frame when you are done with it!
+     * @param p_time    The playback time, relative to the start of the video. In seconds.
+     * @return  The video frame to show at that time. Or NULL if you are supposed to keep the last returned frame.
+     */
+    VideoFrame* getFrameForTime(double p_time);
+    
+    /**
+     * Will check the decoding for errors and update the Ogre material if in playback mode.
+     * @param p_evt The frame event. Contains the time since the last frame.
+     * @return  True to go ahead, false to abort rendering and drop out of the rendering loop.
+     */
+    virtual bool frameStarted(const Ogre::FrameEvent& p_evt);
+    
+    /**
+     * Notes when the pass with the video texture is rendered.
+     */
+    virtual void notifyRenderSingleObject(Ogre::Renderable* p_renderable, const Ogre::Pass* p_pass, 
+                                          const Ogre::AutoParamDataSource* p_source, 
+                                          const Ogre::LightList* p_lightList, bool p_suppressRenderStateChanges);
+
+    /**
+     * Returns the desired sample format for the decoding thread to use when converting audio
+     */
+    AudioSampleFormat getAudioSampleFormat(void);
+
+	/**
+     * Sets the desired sample format for the decoding thread to use when converting audio
+     */
+    void setAudioSampleFormat(AudioSampleFormat fmt);
+
+    /**
+     * Obtains the number of video frames currently buffered.
+     */
+    unsigned int getBufferedVideoFrames() const;
+
+    /**
+     * Obtains the number of audio frames currently buffered.
+     */
+    unsigned int getBufferedAudioFrames() const;
+    
+private:
+    /**
+     * Stops the decoding thread, drops all buffered frames and starts decoding again 
+     * at the passed position, in the current playback direction.
+     * @param p_time    The position to continue at, in seconds.
+     * @return  True if decoding could be restarted.
+     */
+    bool restartDecodingAt(double p_time);
+    
+    /**
+     * Drops all buffered frames and lets the decoder continue at the passed position
+     * without restarting it.
+     * @param p_time    The position to continue at, in seconds.
+     */
+    void seekDecoding(double p_time);
+    
+    /**
+     * Looks for the texture unit of the binding and remembers what it showed.
+     * @return  False if the material or texture unit does not exist.
+     */
+    bool bindTextureUnit(MaterialBinding& p_binding);
+    
+    /**
+     * Sets the YUV to RGB conversion of the video on the pass of a bound texture unit, 
+     * if its fragment program has a "yuvToRgb" parameter.
+     */
+    void applyColorConversion(MaterialBinding& p_binding);
+    
+    /**
+     * Shows the video texture on all bound texture units, or their original textures.
+     */
+    void showVideoTexture(bool p_show);
+    
+    /**
+     * Checks if the video was rendered recently and applies the invisible policy when that changes.
+     */
+    void updateVisibility();
+    
+    /**
+     * Grows the adaptive buffer target when decoding can not keep up, shrinks it when there is headroom.
+     * @param p_time    The time since the last frame. In seconds.
+     */
+    void updateAdaptiveBufferTarget(double p_time);
+    
+    /**
+     * Picks the level of detail that fits the on-screen size.
+     */
+    void updateLodLevel();
+    
+    /**
+     * @return  True if the buffered frames use more memory than the limit, never while baking. 
+     *          Expects the player mutex to be locked.
+     */
+    bool getIsOverMemoryLimit() const;
+    
+    /**
+     * Resizes the video texture to the size and format of the passed frame if needed.
+     * The texture stays bound to the material, so this does not interrupt playback.
+     */
+    void fitTextureToFrame(const VideoFrame* p_frame);
+    
+    /**
+     * Gives the video texture back to the pool, or removes it if it is not from the pool.
+     */
+    void releaseVideoTexture();
+    
+    /**
+     * @return  True if enough is buffered to start playback.
+     */
+    bool getCanStartPlayback();
+    
+    /**
+     * Uploads the first decoded frame and shows the video texture, if there is a frame already.
+     */
+    void showPosterFrame();
+    
+    /**
+     * @return  The name resident clips and bakes of what this player decodes are known under.
+     */
+    Ogre::String getFrameClipKey() const;
+    
+    /**
+     * Stops decoding and plays the passed complete clip from now on.
+     * The clip is then only held as the playing clip, not as the clip being filled.
+     */
+    void startResidentPlayback(const boost::shared_ptr<FrameClip>& p_clip);
+    
+    /**
+     * Advances the playback time through the clip and uploads the frame shown at that time.
+     * Looping players wrap around, the others stop at the end.
+     * @param p_time    The time since the last frame. In seconds.
+     */
+    void updateResidentPlayback(double p_time);
+    
+    /**
+     * Fills audio buffers straight from the frames of the clip. Expects the player mutex to be locked.
+     * @see distributeDecodedAudioFrames
+     */
+    int distributeResidentAudioFrames(unsigned int p_numBuffers, std::vector<uint8_t*>& p_outAudioBuffers, 
+                                      std::vector<unsigned int>& p_outAudioBufferSizes, 
+                                      double& p_outTotalBuffersTime);
+    
+    /**
+     * Deletes the first frames kept for looping.
+     */
+    void clearLoopBackup();
+    
+    /**
+     * Gives up keeping the first loop, e.g. because it does not fit. Expects the player mutex to be locked.
+     */
+    void dropResidentClip();
+    
+    /**
+     * Advances the playback time in the current direction.
+     * @param p_time    The time since the last frame. In seconds.
+     */
+    void advancePlaybackTime(double p_time);
+    
+    /**
+     * Waits until the decoding thread or pool job is done, then deletes it.
+     */
+    void joinDecoding();
+    
+    /**
+     * Wakes up the decoding thread or pool job, so it checks if it must continue decoding.
+     */
+    void wakeDecoder();
+    
+    Ogre::String    _materialName;
+    Ogre::String    _textureUnitName;
+    Ogre::String    _videoFileName;
+    Ogre::String    _resourceGroup;
+    InputSettings   _inputSettings;
+    InputStats      _inputStats;
+    VideoInfo       _videoInfo;
+    double          _bufferTarget;
+    bool            _isBufferTargetAdaptive;
+    double          _minBufferTarget;
+    double          _maxBufferTarget;
+    double          _adaptiveBufferTarget;
+    BufferStats     _bufferStats;
+    double          _decodeLoadVariance;
+    double          _bitrateVariance;
+    unsigned int    _numDecodeSamples;
+    double          _measuredWorkTime;
+    double          _measuredVideoTime;
+    size_t          _measuredVideoBytes;
+    bool            _isUnderrun;
+    int             _forcedAudioChannels;
+    int             _audioTrack;
+    Ogre::String    _audioTrackLanguage;
+    unsigned int    _audioTrackSerial;
+    int             _videoTrack;
+    double          _playbackRate;
+    double          _keyframeOnlyRate;
+    AudioRatePolicy _audioRatePolicy;
+    bool            _isReversed;
+    size_t          _reverseCacheBudget;
+    double          _decodingStartTime;
+    DecodingMode    _decodingMode;
+    DecodingPriority _decodingPriority;
+    DecoderThreadSettings _decoderThreadSettings;
+    bool            _useUploadScheduler;
+    double          _uploadPriority;
+    unsigned int    _onScreenWidth;
+    unsigned int    _onScreenHeight;
+    unsigned int    _maxLodLevel;
+    double          _lodHysteresis;
+    unsigned int    _lodLevel;
+    Ogre::SceneManager* _visibilitySceneManager;
+    unsigned long   _lastRenderedFrame;
+    unsigned int    _invisibleAfterFrames;
+    InvisiblePolicy _invisiblePolicy;
+    bool            _isVisible;
+    bool            _isDecodingSuspended;
+    unsigned int    _seekSerial;
+    double          _seekTime;
+    bool            _isSeekPending;
+    bool            _seekKeepsAudio;
+    size_t          _memoryLimit;
+    
+    size_t                              _residentClipMaxBytes;
+    bool                                _shareResidentClips;
+    boost::shared_ptr<ResidentClip>     _residentClip;          // The clip being filled
+    boost::shared_ptr<FrameClip>        _frameClip;             // The resident clip or bake that plays
+    bool                                _isResident;            // Plays the frame clip instead of decoding
+    bool                                _useBakedFrames;
+    bool                                _isPlayingBaked;
+    BakedClipWriter*                    _bakeWriter;            // Takes all decoded frames while baking
+    const VideoFrame*                   _residentFrame;         // The clip frame on the texture
+    unsigned int                        _residentAudioFrame;    // The next clip audio frame to hand out
+    double                              _residentAudioAhead;    // Seconds of clip audio handed out ahead of playback
+    
+    bool                        _isPlaying;
+    bool                        _isPaused;
+    bool                        _isWaitingForBuffers;
+    double                      _startThreshold;
+    bool                        _showPosterFrame;
+    bool                        _isPosterShown;
+    double                      _audioPlaybackTime;
+    double                      _videoPlaybackTime;
+    bool                        _videoBuffersFilledWithBackup;
+    bool                        _isDecoding;
+    bool                        _isLooping;
+    boost::thread*              _currentDecodingThread;
+    PlayerDecodingJob*          _decodingJob;
+    DecodingMode                _decodingJobMode;
+    boost::mutex*               _playerMutex;
+    boost::condition_variable*  _playerCondVar;
+    boost::mutex*               _decodingMutex;
+    boost::condition_variable*  _decodingCondVar;
+    
+    double                      _currentAudioStorage;
+    size_t                      _currentAudioBytes;
+    double                      _currentAudioBackupStorage;
+    std::deque<AudioFrame*>     _audioFrames; 
+    std::deque<AudioFrame*>     _backupAudioFrames;
+    
+    double                      _currentVideoBackupStorage;
+    Ogre::TexturePtr            _texturePtr;
+    Ogre::String                    _videoTextureName;
+    bool                            _useTexturePool;
+    bool                            _isTextureFromPool;
+    VideoOutputFormat               _videoOutputFormat;
+    std::vector<MaterialBinding>    _bindings;
+    VideoFrameQueue             _videoFrames;
     std::deque<VideoFrame*>     _backupVideoFrames;
     AudioSampleFormat			_decodedAudioFormat;
-    int _framesPopped;
+    unsigned int                _framesPopped;
     
     Ogre::Log*  _log;
     LogLevel    _logLevel;
 };
 
-    
+    
+//------------------------------------------------------------------------------
+inline 
+Ogre::Log* 
+FFmpegVideoPlayer::getLog()
+{
+    return _log;
+}
+
+//------------------------------------------------------------------------------
+inline
+void 
+FFmpegVideoPlayer::setLogLevel(LogLevel p_level)
+{
+    _logLevel = p_level;
+}
+
+//------------------------------------------------------------------------------
+inline
+LogLevel 
+FFmpegVideoPlayer::getLogLevel() const
+{
+    return _logLevel;
+}
+
+//------------------------------------------------------------------------------
+inline
+const Ogre::String& 
+FFmpegVideoPlayer::getMaterialName() const
+{
+    return _materialName;
+}
+
+//------------------------------------------------------------------------------
+inline
+const Ogre::String& 
+FFmpegVideoPlayer::getTextureUnitName() const
+{
+    return _textureUnitName;
+}
+
+//------------------------------------------------------------------------------
+inline
+const Ogre::String& 
+FFmpegVideoPlayer::getVideoFilename() const
+{
+    return _videoFileName;
+}
+
+//------------------------------------------------------------------------------
+inline
+const Ogre::String& 
+FFmpegVideoPlayer::getResourceGroup() const
+{
+    return _resourceGroup;
+}
+
+//------------------------------------------------------------------------------
+inline
+const InputSettings& 
+FFmpegVideoPlayer::getInputSettings() const
+{
+    return _inputSettings;
+}
+
+//------------------------------------------------------------------------------
+inline
+VideoInfo& 
+FFmpegVideoPlayer::getVideoInfo()
+{
+    return _videoInfo;
+}
+
+//------------------------------------------------------------------------------
+inline
+float 
+FFmpegVideoPlayer::getBufferTarget() const
+{
+    return _bufferTarget;
+}
+
+//------------------------------------------------------------------------------
+inline
+bool 
+FFmpegVideoPlayer::getUseTexturePool() const
+{
+    return _useTexturePool;
+}
+
+//------------------------------------------------------------------------------
+inline
+VideoOutputFormat 
+FFmpegVideoPlayer::getVideoOutputFormat() const
+{
+    return _videoOutputFormat;
+}
+
 //------------------------------------------------------------------------------
-inline 
-Ogre::Log* 
-FFmpegVideoPlayer::getLog()
+inline
+void 
+FFmpegVideoPlayer::setResidentClipMaxBytes(size_t p_maxBytes)
 {
-    return _log;
+    _residentClipMaxBytes = p_maxBytes;
+}
+
+//------------------------------------------------------------------------------
+inline
+size_t 
+FFmpegVideoPlayer::getResidentClipMaxBytes() const
+{
+    return _residentClipMaxBytes;
 }
 
 //------------------------------------------------------------------------------
 inline
 void 
-FFmpegVideoPlayer::setLogLevel(LogLevel p_level)
+FFmpegVideoPlayer::setShareResidentClips(bool p_share)
 {
-    _logLevel = p_level;
+    _shareResidentClips = p_share;
 }
 
 //------------------------------------------------------------------------------
 inline
-LogLevel 
-FFmpegVideoPlayer::getLogLevel() const
+bool 
+FFmpegVideoPlayer::getShareResidentClips() const
 {
-    return _logLevel;
+    return _shareResidentClips;
 }
 
 //------------------------------------------------------------------------------
 inline
-const Ogre::String& 
-FFmpegVideoPlayer::getMaterialName() const
+bool 
+FFmpegVideoPlayer::getIsResident() const
 {
-    return _materialName;
+    return _isResident && !_isPlayingBaked;
 }
 
 //------------------------------------------------------------------------------
 inline
-const Ogre::String& 
-FFmpegVideoPlayer::getTextureUnitName() const
+void 
+FFmpegVideoPlayer::setUseBakedFrames(bool p_use)
 {
-    return _textureUnitName;
+    _useBakedFrames = p_use;
 }
 
 //------------------------------------------------------------------------------
 inline
-const Ogre::String& 
-FFmpegVideoPlayer::getVideoFilename() const
+bool 
+FFmpegVideoPlayer::getUseBakedFrames() const
 {
-    return _videoFileName;
+    return _useBakedFrames;
 }
 
 //------------------------------------------------------------------------------
 inline
-VideoInfo& 
-FFmpegVideoPlayer::getVideoInfo()
+bool 
+FFmpegVideoPlayer::getIsPlayingBaked() const
 {
-    return _videoInfo;
+    return _isPlayingBaked;
 }
 
 //------------------------------------------------------------------------------
 inline
-float 
-FFmpegVideoPlayer::getBufferTarget() const
+const Ogre::TexturePtr& 
+FFmpegVideoPlayer::getVideoTexture() const
 {
-    return _bufferTarget;
+    return _texturePtr;
+}
+
+//------------------------------------------------------------------------------
+inline
+double 
+FFmpegVideoPlayer::getStartThreshold() const
+{
+    return _startThreshold;
+}
+
+//------------------------------------------------------------------------------
+inline
+bool 
+FFmpegVideoPlayer::getShowPosterFrame() const
+{
+    return _showPosterFrame;
 }
 
 //------------------------------------------------------------------------------
@@ -514,6 +1475,307 @@ FFmpegVideoPlayer::setForcedAudioChannels(int p_numChannels)
     _forcedAudioChannels = p_numChannels;
 }
 
+//------------------------------------------------------------------------------
+inline
+int 
+FFmpegVideoPlayer::getVideoTrack() const
+{
+    return _videoTrack;
+}
+
+//------------------------------------------------------------------------------
+inline
+void 
+FFmpegVideoPlayer::setAudioRatePolicy(AudioRatePolicy p_policy)
+{
+    _audioRatePolicy = p_policy;
+}
+
+//------------------------------------------------------------------------------
+inline
+AudioRatePolicy 
+FFmpegVideoPlayer::getAudioRatePolicy() const
+{
+    return _audioRatePolicy;
+}
+
+//------------------------------------------------------------------------------
+inline
+void 
+FFmpegVideoPlayer::setDecodingMode(DecodingMode p_mode)
+{
+    if (!_isDecoding)
+    {
+        _decodingMode = p_mode;
+    }
+}
+
+//------------------------------------------------------------------------------
+inline
+DecodingMode 
+FFmpegVideoPlayer::getDecodingMode() const
+{
+    return _decodingMode;
+}
+
+//------------------------------------------------------------------------------
+inline
+void 
+FFmpegVideoPlayer::setDecodingPriority(DecodingPriority p_priority)
+{
+    _decodingPriority = p_priority;
+}
+
+//------------------------------------------------------------------------------
+inline
+DecodingPriority 
+FFmpegVideoPlayer::getDecodingPriority() const
+{
+    return _decodingPriority;
+}
+
+//------------------------------------------------------------------------------
+inline
+void 
+FFmpegVideoPlayer::setDecoderThreadSettings(const DecoderThreadSettings& p_settings)
+{
+    _decoderThreadSettings = p_settings;
+}
+
+//------------------------------------------------------------------------------
+inline
+const DecoderThreadSettings& 
+FFmpegVideoPlayer::getDecoderThreadSettings() const
+{
+    return _decoderThreadSettings;
+}
+
+//------------------------------------------------------------------------------
+inline
+void 
+FFmpegVideoPlayer::setUseUploadScheduler(bool p_useScheduler)
+{
+    _useUploadScheduler = p_useScheduler;
+}
+
+//------------------------------------------------------------------------------
+inline
+bool 
+FFmpegVideoPlayer::getUseUploadScheduler() const
+{
+    return _useUploadScheduler;
+}
+
+//------------------------------------------------------------------------------
+inline
+void 
+FFmpegVideoPlayer::setUploadPriority(double p_priority)
+{
+    _uploadPriority = p_priority;
+}
+
+//------------------------------------------------------------------------------
+inline
+double 
+FFmpegVideoPlayer::getUploadPriority() const
+{
+    return _uploadPriority;
+}
+
+//------------------------------------------------------------------------------
+inline
+bool 
+FFmpegVideoPlayer::getIsBufferTargetAdaptive() const
+{
+    return _isBufferTargetAdaptive;
+}
+
+//------------------------------------------------------------------------------
+inline
+double 
+FFmpegVideoPlayer::getCurrentBufferTarget() const
+{
+    return _isBufferTargetAdaptive ? _adaptiveBufferTarget : _bufferTarget;
+}
+
+//------------------------------------------------------------------------------
+inline
+size_t 
+FFmpegVideoPlayer::getMemoryLimit() const
+{
+    return _memoryLimit;
+}
+
+//------------------------------------------------------------------------------
+inline
+bool 
+FFmpegVideoPlayer::getIsOverMemoryLimit() const
+{
+    return !_bakeWriter && _memoryLimit > 0 && _videoFrames.getBufferedBytes() + _currentAudioBytes >= _memoryLimit;
+}
+
+//------------------------------------------------------------------------------
+inline
+unsigned int 
+FFmpegVideoPlayer::getNumMaterialBindings() const
+{
+    // The main binding is only added when the video starts, and may have changed since
+    unsigned int numBindings = _materialName != "" && _textureUnitName != "" ? 1 : 0;
+    for (unsigned int i = 0; i < _bindings.size(); ++i)
+    {
+        if (!_bindings[i].isMain)
+        {
+            ++numBindings;
+        }
+    }
+    return numBindings;
+}
+
+//------------------------------------------------------------------------------
+inline
+const Ogre::String& 
+FFmpegVideoPlayer::getVideoTextureName() const
+{
+    return _videoTextureName;
+}
+
+//------------------------------------------------------------------------------
+inline
+void 
+FFmpegVideoPlayer::setOnScreenSize(unsigned int p_width, unsigned int p_height)
+{
+    _onScreenWidth = p_width;
+    _onScreenHeight = p_height;
+}
+
+//------------------------------------------------------------------------------
+inline
+void 
+FFmpegVideoPlayer::setMaxLodLevel(unsigned int p_level)
+{
+    _maxLodLevel = p_level;
+}
+
+//------------------------------------------------------------------------------
+inline
+unsigned int 
+FFmpegVideoPlayer::getMaxLodLevel() const
+{
+    return _maxLodLevel;
+}
+
+//------------------------------------------------------------------------------
+inline
+void 
+FFmpegVideoPlayer::setLodHysteresis(double p_hysteresis)
+{
+    _lodHysteresis = p_hysteresis;
+}
+
+//------------------------------------------------------------------------------
+inline
+double 
+FFmpegVideoPlayer::getLodHysteresis() const
+{
+    return _lodHysteresis;
+}
+
+//------------------------------------------------------------------------------
+inline
+unsigned int 
+FFmpegVideoPlayer::getLodLevel() const
+{
+    return _lodLevel;
+}
+
+//------------------------------------------------------------------------------
+inline
+void 
+FFmpegVideoPlayer::setInvisibleAfterFrames(unsigned int p_numFrames)
+{
+    _invisibleAfterFrames = p_numFrames;
+}
+
+//------------------------------------------------------------------------------
+inline
+unsigned int 
+FFmpegVideoPlayer::getInvisibleAfterFrames() const
+{
+    return _invisibleAfterFrames;
+}
+
+//------------------------------------------------------------------------------
+inline
+void 
+FFmpegVideoPlayer::setInvisiblePolicy(InvisiblePolicy p_policy)
+{
+    _invisiblePolicy = p_policy;
+}
+
+//------------------------------------------------------------------------------
+inline
+InvisiblePolicy 
+FFmpegVideoPlayer::getInvisiblePolicy() const
+{
+    return _invisiblePolicy;
+}
+
+//------------------------------------------------------------------------------
+inline
+bool 
+FFmpegVideoPlayer::getIsVisible() const
+{
+    return _isVisible;
+}
+
+//------------------------------------------------------------------------------
+inline
+bool 
+FFmpegVideoPlayer::getIsDecodingThrottled() const
+{
+    return !_isVisible && _invisiblePolicy == IP_THROTTLE_DECODING && !_isReversed;
+}
+
+//------------------------------------------------------------------------------
+inline
+bool 
+FFmpegVideoPlayer::getIsDecodingSuspended() const
+{
+    return _isDecodingSuspended;
+}
+
+//------------------------------------------------------------------------------
+inline
+bool 
+FFmpegVideoPlayer::getIsReversed() const
+{
+    return _isReversed;
+}
+
+//------------------------------------------------------------------------------
+inline
+void 
+FFmpegVideoPlayer::setReverseCacheBudget(size_t p_bytes)
+{
+    _reverseCacheBudget = p_bytes;
+}
+
+//------------------------------------------------------------------------------
+inline
+size_t 
+FFmpegVideoPlayer::getReverseCacheBudget() const
+{
+    return _reverseCacheBudget;
+}
+
+//------------------------------------------------------------------------------
+inline
+double 
+FFmpegVideoPlayer::getPlaybackTime() const
+{
+    return _videoPlaybackTime;
+}
+
 //------------------------------------------------------------------------------
 inline
 bool 
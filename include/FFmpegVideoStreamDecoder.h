@@ -0,0 +1,179 @@
+/* 
+ * File:   FFmpegVideoStreamDecoder.h
+ * Author: TheSHEEEP
+ *
+ * Created on 19. Oktober 2026, 14:05
+ */
+
+#ifndef FFMPEGVIDEOSTREAMDECODER_H
+#define	FFMPEGVIDEOSTREAMDECODER_H
+
+#include "FFmpegPluginPrerequisites.h"
+
+#include "FFmpegInputStream.h"
+
+#include <OgrePrerequisites.h>
+#include <OgreResourceGroupManager.h>
+
+// Forward declarations
+struct VideoFrame;
+struct AVFormatContext;
+struct AVCodecContext;
+struct AVStream;
+struct AVFrame;
+struct SwsContext;
+
+/**
+ * Decodes single video frames of a file, independent of the player.
+ * Used wherever frames are needed outside of regular playback, e.g. for scrubbing.
+ * 
+ * Audio is not decoded at all.
+ * This class is not thread safe, use one decoder per thread. Decoders of different threads can be opened concurrently.
+ */
+class _FFmpegPluginExport FFmpegVideoStreamDecoder
+{
+public:
+    /**
+     * Constructor.
+     */
+    FFmpegVideoStreamDecoder();
+    
+    /**
+     * Destructor.
+     */
+    ~FFmpegVideoStreamDecoder();
+    
+    /**
+     * Opens the file and the codec of its best video stream.
+     * @param p_filename        The video file to open, or the name of a resource.
+     * @param p_outError        Set to the error if opening failed.
+     * @param p_resourceGroup   The resource group the video is looked up in.
+     * @param p_settings        How the video is read.
+     * @return  True if everything worked correctly.
+     */
+    bool open(const Ogre::String& p_filename, Ogre::String& p_outError, 
+              const Ogre::String& p_resourceGroup = Ogre::ResourceGroupManager::AUTODETECT_RESOURCE_GROUP_NAME,
+              const InputSettings& p_settings = InputSettings());
+    
+    /**
+     * Closes the file. Called automatically on destruction.
+     */
+    void close();
+    
+    /**
+     * @return  True if a file is open.
+     */
+    bool getIsOpen() const;
+    
+    /**
+     * Seeks to the keyframe at or before the passed time.
+     * The next decoded frame will be that keyframe.
+     * @param p_time    The position in seconds.
+     * @return  True if the seek succeeded.
+     */
+    bool seek(double p_time);
+    
+    /**
+     * Decodes the next frame and converts it to RGBA in the output size.
+     * @note    Make sure to delete the frame when you are done with it!
+     * @return  The decoded frame, or NULL if the end of the stream is reached.
+     */
+    VideoFrame* decodeNextFrame();
+    
+    /**
+     * Lets the codec decode at a reduced resolution that is still at least this large, if it supports that.
+     * The scaler does the rest. Only takes effect when the file is opened.
+     * @param p_width   The smallest width to decode at, 0 to always decode at full resolution.
+     * @param p_height  The smallest height to decode at, 0 to always decode at full resolution.
+     */
+    void setLowresTarget(unsigned int p_width, unsigned int p_height);
+    
+    /**
+     * @return  The resolution the codec decodes at, as a power of two divisor.
+     */
+    int getLowres() const;
+    
+    /**
+     * @param p_keyframesOnly   If this is true, the codec skips all frames that are no keyframes. 
+     *                          The next frame after a seek is then the keyframe the seek went to.
+     */
+    void setKeyframesOnly(bool p_keyframesOnly);
+    
+    /**
+     * @param p_width   The width of the decoded frames, 0 to keep the width of the video.
+     * @param p_height  The height of the decoded frames, 0 to keep the height of the video.
+     */
+    void setOutputSize(unsigned int p_width, unsigned int p_height);
+    
+    /**
+     * @return  The width of the decoded frames.
+     */
+    unsigned int getOutputWidth() const;
+    
+    /**
+     * @return  The height of the decoded frames.
+     */
+    unsigned int getOutputHeight() const;
+    
+    /**
+     * @return  The width of the video in pixels, as the codec decodes it.
+     */
+    unsigned int getVideoWidth() const;
+    
+    /**
+     * @return  The height of the video in pixels, as the codec decodes it.
+     */
+    unsigned int getVideoHeight() const;
+    
+    /**
+     * @return  The duration of the video in seconds.
+     */
+    double getDuration() const;
+    
+    /**
+     * @return  The nominal duration of a single frame in seconds.
+     */
+    double getFrameDuration() const;
+    
+private:
+    /**
+     * Converts the last decoded frame into a new VideoFrame.
+     */
+    VideoFrame* convertFrame();
+    
+    AVFormatContext*    _formatContext;
+    AVCodecContext*     _codecContext;
+    AVStream*           _stream;
+    AVFrame*            _frame;
+    SwsContext*         _swsContext;
+    unsigned int        _outputWidth;
+    unsigned int        _outputHeight;
+    unsigned int        _lowresTargetWidth;
+    unsigned int        _lowresTargetHeight;
+    bool                _keyframesOnly;
+    double              _duration;
+    double              _frameDuration;
+    double              _lastPts;
+    bool                _endOfStream;
+};
+
+/**
+ * Decodes a single small picture of a video, e.g. for the thumbnails of a video grid.
+ * Only the keyframe at or before the passed time is decoded, at the lowest resolution the codec supports
+ * for that size, and scaled to fit into a square of the passed size.
+ * Can be called from several threads at the same time.
+ * @note    Make sure to delete the frame when you are done with it!
+ * @param p_filename        The video file, or the name of a resource.
+ * @param p_time            The position of the thumbnail in seconds.
+ * @param p_maxSize         Width and height of the thumbnail are at most this many pixels. Videos are never enlarged.
+ * @param p_outError        Set to the error if no thumbnail could be decoded.
+ * @param p_resourceGroup   The resource group the video is looked up in.
+ * @param p_settings        How the video is read.
+ * @return  The thumbnail in RGBA, NULL if there is none.
+ */
+VideoFrame* extractThumbnail(const Ogre::String& p_filename, double p_time, unsigned int p_maxSize, 
+                             Ogre::String& p_outError, 
+                             const Ogre::String& p_resourceGroup = Ogre::ResourceGroupManager::AUTODETECT_RESOURCE_GROUP_NAME,
+                             const InputSettings& p_settings = InputSettings());
+
+#endif	/* FFMPEGVIDEOSTREAMDECODER_H */
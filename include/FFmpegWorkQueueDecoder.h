@@ -0,0 +1,133 @@
+/* 
+ * File:   FFmpegWorkQueueDecoder.h
+ * Author: TheSHEEEP
+ *
+ * Created on 19. Oktober 2026, 17:10
+ */
+
+#ifndef FFMPEGWORKQUEUEDECODER_H
+#define	FFMPEGWORKQUEUEDECODER_H
+
+#include "FFmpegPluginPrerequisites.h"
+
+#include <OgreWorkQueue.h>
+#include <map>
+
+// Forward declarations
+class PlayerDecodingJob;
+namespace boost
+{
+    class mutex;
+    class condition_variable;
+}
+
+/**
+ * Runs video decoding as requests on Ogre's WorkQueue, so decoding shares the engine's 
+ * worker threads instead of having threads of its own.
+ * 
+ * Each request decodes and converts for a short time slice on a worker thread. 
+ * The decoded frames are handed to the player by the response handler on the main thread, 
+ * which then queues the next request.
+ */
+class _FFmpegPluginExport FFmpegWorkQueueDecoder 
+    : public Ogre::WorkQueue::RequestHandler
+    , public Ogre::WorkQueue::ResponseHandler
+{
+private:
+    /**
+     * Constructor.
+     */
+    FFmpegWorkQueueDecoder();
+    
+    static FFmpegWorkQueueDecoder* _instance;
+    
+public:
+    /**
+     * @return A pointer to the instance of this singleton.
+     */
+    static FFmpegWorkQueueDecoder* getSingletonPtr()
+    {
+        if (!_instance)
+        {
+            _instance = new FFmpegWorkQueueDecoder();
+        }
+        return _instance;
+    }
+    
+    /**
+     * Destructor. Unregisters from the WorkQueue, jobs are not deleted.
+     */
+    ~FFmpegWorkQueueDecoder();
+    
+    /**
+     * Aborts the queued requests and removes the handlers from the WorkQueue, e.g. when the plugin shuts down.
+     * They are registered again when a job is added.
+     */
+    void unregisterHandlers();
+    
+    /**
+     * @return  True if there is a WorkQueue with worker threads to decode on.
+     */
+    static bool getIsAvailable();
+    
+    /**
+     * Adds a job and queues its first request.
+     * @param p_job The job to add. The decoder does not take ownership.
+     */
+    void addJob(PlayerDecodingJob* p_job);
+    
+    /**
+     * Queues a request for a job that waits for room in its buffers.
+     * Does nothing if the job is not waiting.
+     */
+    void wakeJob(PlayerDecodingJob* p_job);
+    
+    /**
+     * Removes a job. Queued requests are aborted, if a request is currently decoding
+     * for the job, this waits until it is done. Afterwards, the job can safely be deleted.
+     */
+    void removeJob(PlayerDecodingJob* p_job);
+    
+    /**
+     * Decodes for one job. Called on a WorkQueue worker thread.
+     */
+    virtual Ogre::WorkQueue::Response* handleRequest(const Ogre::WorkQueue::Request* p_request, 
+                                                     const Ogre::WorkQueue* p_srcQueue);
+    
+    /**
+     * Hands the decoded frames to the player and queues the next request. Called on the main thread.
+     */
+    virtual void handleResponse(const Ogre::WorkQueue::Response* p_response, const Ogre::WorkQueue* p_srcQueue);
+    
+private:
+    struct JobEntry
+    {
+        PlayerDecodingJob*          job;
+        Ogre::WorkQueue::RequestID  requestId;
+        bool                        isQueued;       // A request is queued or running
+        bool                        isRunning;      // A request is decoding right now
+        bool                        isWaiting;      // The buffers were full, nothing is queued
+        bool                        wakePending;    // wakeJob was called while a request was queued
+        bool                        isFinished;
+    };
+    
+    /**
+     * Queues the next request for a job. The mutex must not be locked, the WorkQueue 
+     * may process requests right away.
+     */
+    void queueRequest(unsigned int p_jobId);
+    
+    /**
+     * Registers the handlers at the WorkQueue if this did not happen yet.
+     */
+    void registerHandlers();
+    
+    std::map<unsigned int, JobEntry>    _jobs;
+    unsigned int                        _nextJobId;
+    Ogre::uint16                        _channel;
+    bool                                _isRegistered;
+    boost::mutex*                       _mutex;
+    boost::condition_variable*          _requestDoneCondVar;
+};
+
+#endif	/* FFMPEGWORKQUEUEDECODER_H */
@@ -0,0 +1,102 @@
+/* 
+ * File:   FFmpegYUVPlanes.h
+ * Author: TheSHEEEP
+ *
+ * Created on 20. Oktober 2026, 01:30
+ */
+
+#ifndef FFMPEGYUVPLANES_H
+#define	FFMPEGYUVPLANES_H
+
+#include "FFmpegPluginPrerequisites.h"
+
+#include <stdint.h>
+
+/**
+ * The matrix YUV is converted to RGB with.
+ */
+enum YUVColorMatrix
+{
+    YCM_BT601,      // Standard definition video
+    YCM_BT709       // High definition video
+};
+
+/**
+ * Puts the Y, U and V planes of a 4:2:0 video frame into one single-channel image, so the frame can be
+ * uploaded as one PF_L8 texture and converted to RGB by the material (see media/FFmpegYUV.material).
+ *
+ * The image is twice the chroma width wide and three times the chroma height high:
+ * Y fills the upper two thirds, U the left and V the right half of the lower third.
+ * So the planes are found at the same texture coordinates whatever the size of the video.
+ * Videos of odd width or height repeat their last luma column or row to fill the Y part.
+ *
+ * Needs no Ogre and no decoder, only the planes of a frame.
+ */
+class _FFmpegPluginExport FFmpegYUVPlanes
+{
+public:
+    /**
+     * @param p_width       Width of the video frame in pixels.
+     * @param p_height      Height of the video frame in pixels.
+     * @param p_outWidth    Width of the image holding all planes.
+     * @param p_outHeight   Height of the image holding all planes.
+     */
+    static void getImageSize(unsigned int p_width, unsigned int p_height,
+                             unsigned int& p_outWidth, unsigned int& p_outHeight);
+
+    /**
+     * Where the planes lie inside the image, e.g. to let a scaler write right into them.
+     * @param p_image       The image, as large as getImageSize says.
+     * @param p_outData     The first pixel of the Y, U and V plane.
+     * @param p_outLinesize The bytes from one row of a plane to the next, the same for all planes.
+     */
+    static void getPlanes(unsigned int p_width, unsigned int p_height, uint8_t* p_image,
+                          uint8_t* p_outData[3], int p_outLinesize[3]);
+
+    /**
+     * @param p_pixelFormat The AVPixelFormat of a decoded frame.
+     * @return  True if extractPlanes can copy the frame's planes as they are.
+     *          That is the case for YUV420P, YUVJ420P, NV12 and NV21.
+     */
+    static bool getCanExtract(int p_pixelFormat);
+
+    /**
+     * Copies the planes of a decoded frame into the image, without converting or scaling them.
+     * @param p_data        The planes of the frame, as in AVFrame.
+     * @param p_linesize    The line sizes of the planes, as in AVFrame.
+     * @param p_pixelFormat The AVPixelFormat of the frame.
+     * @param p_image       The image, as large as getImageSize says.
+     * @return  False if the pixel format can not be extracted.
+     */
+    static bool extractPlanes(const uint8_t* const p_data[], const int p_linesize[], int p_pixelFormat,
+                              unsigned int p_width, unsigned int p_height, uint8_t* p_image);
+
+    /**
+     * Fills the part of the Y plane beyond odd sizes by repeating the last luma column and row.
+     * extractPlanes does this itself, call it after writing the planes any other way.
+     */
+    static void fillPadding(unsigned int p_width, unsigned int p_height, uint8_t* p_image);
+
+    /**
+     * @param p_colorSpace  The AVColorSpace of the video.
+     * @param p_height      Height of the video, decides if the color space is unspecified.
+     * @return  The matrix the video is meant to be converted with.
+     */
+    static YUVColorMatrix getColorMatrix(int p_colorSpace, unsigned int p_height);
+
+    /**
+     * @param p_colorRange  The AVColorRange of the video.
+     * @param p_pixelFormat The AVPixelFormat of the video, the YUVJ formats are always full range.
+     * @return  True if luma and chroma use the full 0 to 255 range instead of 16 to 235 and 16 to 240.
+     */
+    static bool getIsFullRange(int p_colorRange, int p_pixelFormat);
+
+    /**
+     * Calculates the conversion the material applies to the sampled planes.
+     * @param p_outMatrix   The 3x4 matrix, row by row, that turns (y, u, v, 1) with values
+     *                      from 0 to 1 into (r, g, b).
+     */
+    static void getConversionMatrix(YUVColorMatrix p_matrix, bool p_fullRange, float p_outMatrix[12]);
+};
+
+#endif	/* FFMPEGYUVPLANES_H */
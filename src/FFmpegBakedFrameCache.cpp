@@ -0,0 +1,750 @@
+/* 
+ * File:   FFmpegBakedFrameCache.cpp
+ * Author: TheSHEEEP
+ *
+ * Created on 20. Oktober 2026, 00:50
+ */
+
+#include "FFmpegBakedFrameCache.h"
+#include "FFmpegBinaryIO.h"
+
+#include <OgrePixelFormat.h>
+
+#include <boost/thread.hpp>
+#include <boost/lexical_cast.hpp>
+#include <cstdio>
+#include <cstring>
+
+#if OGRE_PLATFORM == OGRE_PLATFORM_WIN32 || OGRE_PLATFORM == OGRE_PLATFORM_WINRT
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+// Identifies bake files and the bake index, and their layout. Files of another version are ignored.
+static const uint32_t sBakeFileMagic = 0x454B4246;
+static const uint32_t sBakeFileVersion = 2;
+static const uint32_t sBakeIndexMagic = 0x58494246;
+static const uint32_t sBakeIndexVersion = 1;
+
+// Magic, version and the offset of the frame index
+static const uint64_t sBakeHeaderSize = 16;
+
+// Frame data starts at multiples of this, so frames can be uploaded straight from the mapping
+static const uint64_t sFrameAlignment = 16;
+
+//------------------------------------------------------------------------------
+/**
+ * Reads a value from the mapping and moves past it.
+ * @return  False if the value is not inside the mapping.
+ */
+template <typename T>
+static bool
+readMappedValue(const uint8_t* p_mapping, size_t p_size, uint64_t& p_position, T& p_outValue)
+{
+    if (p_position + sizeof(T) > p_size)
+    {
+        return false;
+    }
+    memcpy(&p_outValue, p_mapping + p_position, sizeof(T));
+    p_position += sizeof(T);
+    return true;
+}
+
+//------------------------------------------------------------------------------
+BakedClipWriter::BakedClipWriter(const Ogre::String& p_path)
+    : _path(p_path)
+    , _file(p_path.c_str(), std::ios::binary | std::ios::trunc)
+    , _bytes(0)
+    , _isFinished(false)
+{
+    // The offset of the frame index is filled in by finish
+    writeValue(_file, sBakeFileMagic);
+    writeValue(_file, sBakeFileVersion);
+    writeValue(_file, (uint64_t)0);
+    _bytes = sBakeHeaderSize;
+}
+
+//------------------------------------------------------------------------------
+BakedClipWriter::~BakedClipWriter()
+{
+    if (!_isFinished)
+    {
+        _file.close();
+        std::remove(_path.c_str());
+    }
+}
+
+//------------------------------------------------------------------------------
+bool
+BakedClipWriter::getIsGood() const
+{
+    return _file.is_open() && _file.good();
+}
+
+//------------------------------------------------------------------------------
+void
+BakedClipWriter::addVideoFrame(const VideoFrame& p_frame)
+{
+    if (!getIsGood() || _isFinished)
+    {
+        return;
+    }
+
+    while (_bytes % sFrameAlignment != 0)
+    {
+        _file.put(0);
+        ++_bytes;
+    }
+
+    VideoFrameEntry entry;
+    entry.pts = p_frame.pts;
+    entry.lifeTime = p_frame.lifeTime;
+    entry.width = p_frame.width;
+    entry.height = p_frame.height;
+    entry.format = p_frame.format;
+    entry.offset = _bytes;
+    entry.size = p_frame.dataSize;
+    _videoEntries.push_back(entry);
+
+    _file.write((const char*)p_frame.data, p_frame.dataSize);
+    _bytes += p_frame.dataSize;
+}
+
+//------------------------------------------------------------------------------
+void
+BakedClipWriter::addAudioFrame(const AudioFrame& p_frame)
+{
+    if (!getIsGood() || _isFinished)
+    {
+        return;
+    }
+
+    AudioFrameEntry entry;
+    entry.lifeTime = p_frame.lifeTime;
+    entry.offset = _bytes;
+    entry.size = p_frame.dataSize;
+    _audioEntries.push_back(entry);
+
+    _file.write((const char*)p_frame.data, p_frame.dataSize);
+    _bytes += p_frame.dataSize;
+}
+
+//------------------------------------------------------------------------------
+bool
+BakedClipWriter::finish(const VideoInfo& p_videoInfo)
+{
+    if (!getIsGood() || _isFinished || _videoEntries.empty())
+    {
+        return false;
+    }
+
+    // The index follows the frames
+    uint64_t indexOffset = _bytes;
+    writeValue(_file, (uint32_t)p_videoInfo.audioSampleRate);
+    writeValue(_file, (uint32_t)p_videoInfo.audioBitRate);
+    writeValue(_file, (uint32_t)p_videoInfo.audioNumChannels);
+    writeValue(_file, (uint32_t)p_videoInfo.videoWidth);
+    writeValue(_file, (uint32_t)p_videoInfo.videoHeight);
+    writeValue(_file, (uint32_t)p_videoInfo.videoColorMatrix);
+    writeValue(_file, (uint32_t)p_videoInfo.videoFullRange);
+    writeValue(_file, p_videoInfo.audioDuration);
+    writeValue(_file, p_videoInfo.videoDuration);
+
+    writeValue(_file, (uint32_t)_videoEntries.size());
+    for (unsigned int i = 0; i < _videoEntries.size(); ++i)
+    {
+        const VideoFrameEntry& entry = _videoEntries[i];
+        writeValue(_file, entry.pts);
+        writeValue(_file, entry.lifeTime);
+        writeValue(_file, entry.width);
+        writeValue(_file, entry.height);
+        writeValue(_file, entry.format);
+        writeValue(_file, entry.offset);
+        writeValue(_file, entry.size);
+    }
+    writeValue(_file, (uint32_t)_audioEntries.size());
+    for (unsigned int i = 0; i < _audioEntries.size(); ++i)
+    {
+        const AudioFrameEntry& entry = _audioEntries[i];
+        writeValue(_file, entry.lifeTime);
+        writeValue(_file, entry.offset);
+        writeValue(_file, entry.size);
+    }
+    _bytes = (uint64_t)_file.tellp();
+
+    // Only a bake with the index offset set is complete
+    _file.seekp(8);
+    writeValue(_file, indexOffset);
+    _file.close();
+    if (_file.fail())
+    {
+        return false;
+    }
+
+    _isFinished = true;
+    return true;
+}
+
+//------------------------------------------------------------------------------
+bool
+BakedClipWriter::getIsFinished() const
+{
+    return _isFinished;
+}
+
+//------------------------------------------------------------------------------
+const Ogre::String&
+BakedClipWriter::getPath() const
+{
+    return _path;
+}
+
+//------------------------------------------------------------------------------
+uint64_t
+BakedClipWriter::getBytes() const
+{
+    return _bytes;
+}
+
+//------------------------------------------------------------------------------
+/**
+ * Unmaps a bake file once nothing points into it anymore.
+ */
+struct MappingDeleter
+{
+    MappingDeleter(size_t p_size)
+        : size(p_size)
+    {}
+
+    void operator()(void* p_mapping) const
+    {
+#if OGRE_PLATFORM == OGRE_PLATFORM_WIN32 || OGRE_PLATFORM == OGRE_PLATFORM_WINRT
+        UnmapViewOfFile(p_mapping);
+#else
+        munmap(p_mapping, size);
+#endif
+    }
+
+    size_t  size;
+};
+
+//------------------------------------------------------------------------------
+BakedClip::BakedClip(const Ogre::String& p_path)
+    : _size(0)
+{
+#if OGRE_PLATFORM == OGRE_PLATFORM_WIN32 || OGRE_PLATFORM == OGRE_PLATFORM_WINRT
+    HANDLE file = CreateFileA(p_path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, NULL,
+                              OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE)
+    {
+        return;
+    }
+    LARGE_INTEGER fileSize;
+    if (GetFileSizeEx(file, &fileSize) && fileSize.QuadPart > 0)
+    {
+        HANDLE fileMapping = CreateFileMapping(file, NULL, PAGE_READONLY, 0, 0, NULL);
+        if (fileMapping)
+        {
+            void* mapping = MapViewOfFile(fileMapping, FILE_MAP_READ, 0, 0, 0);
+            if (mapping)
+            {
+                _size = (size_t)fileSize.QuadPart;
+                _mapping.reset(mapping, MappingDeleter(_size));
+            }
+            CloseHandle(fileMapping);
+        }
+    }
+    CloseHandle(file);
+#else
+    int file = open(p_path.c_str(), O_RDONLY);
+    if (file < 0)
+    {
+        return;
+    }
+    struct stat fileStat;
+    if (fstat(file, &fileStat) == 0 && fileStat.st_size > 0)
+    {
+        void* mapping = mmap(NULL, (size_t)fileStat.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+        if (mapping != MAP_FAILED)
+        {
+            _size = (size_t)fileStat.st_size;
+            _mapping.reset(mapping, MappingDeleter(_size));
+
+            // Playback reads the frames front to back
+            madvise(mapping, _size, MADV_SEQUENTIAL);
+        }
+    }
+    close(file);
+#endif
+
+    if (_mapping && !readIndex())
+    {
+        for (unsigned int i = 0; i < _videoFrames.size(); ++i)
+        {
+            delete _videoFrames[i];
+        }
+        _videoFrames.clear();
+        for (unsigned int i = 0; i < _audioFrames.size(); ++i)
+        {
+            delete _audioFrames[i];
+        }
+        _audioFrames.clear();
+    }
+}
+
+//------------------------------------------------------------------------------
+BakedClip::~BakedClip()
+{
+    // Copies of the frames may still be around, the last one unmaps the file
+    for (unsigned int i = 0; i < _videoFrames.size(); ++i)
+    {
+        delete _videoFrames[i];
+    }
+    for (unsigned int i = 0; i < _audioFrames.size(); ++i)
+    {
+        delete _audioFrames[i];
+    }
+}
+
+//------------------------------------------------------------------------------
+bool
+BakedClip::readIndex()
+{
+    const uint8_t* mapping = (const uint8_t*)_mapping.get();
+    uint64_t position = 0;
+    uint32_t magic = 0;
+    uint32_t version = 0;
+    uint64_t indexOffset = 0;
+    if (!readMappedValue(mapping, _size, position, magic) || !readMappedValue(mapping, _size, position, version)
+        || !readMappedValue(mapping, _size, position, indexOffset) || magic != sBakeFileMagic
+        || version != sBakeFileVersion || indexOffset < sBakeHeaderSize || indexOffset >= _size)
+    {
+        return false;
+    }
+
+    position = indexOffset;
+    uint32_t audioSampleRate = 0;
+    uint32_t audioBitRate = 0;
+    uint32_t audioNumChannels = 0;
+    uint32_t videoWidth = 0;
+    uint32_t videoHeight = 0;
+    uint32_t videoColorMatrix = 0;
+    uint32_t videoFullRange = 0;
+    uint32_t numVideoFrames = 0;
+    if (!readMappedValue(mapping, _size, position, audioSampleRate)
+        || !readMappedValue(mapping, _size, position, audioBitRate)
+        || !readMappedValue(mapping, _size, position, audioNumChannels)
+        || !readMappedValue(mapping, _size, position, videoWidth)
+        || !readMappedValue(mapping, _size, position, videoHeight)
+        || !readMappedValue(mapping, _size, position, videoColorMatrix)
+        || !readMappedValue(mapping, _size, position, videoFullRange)
+        || !readMappedValue(mapping, _size, position, _videoInfo.audioDuration)
+        || !readMappedValue(mapping, _size, position, _videoInfo.videoDuration)
+        || !readMappedValue(mapping, _size, position, numVideoFrames))
+    {
+        return false;
+    }
+    _videoInfo.audioSampleRate = audioSampleRate;
+    _videoInfo.audioBitRate = audioBitRate;
+    _videoInfo.audioNumChannels = audioNumChannels;
+    _videoInfo.videoWidth = videoWidth;
+    _videoInfo.videoHeight = videoHeight;
+    _videoInfo.videoColorMatrix = videoColorMatrix == YCM_BT709 ? YCM_BT709 : YCM_BT601;
+    _videoInfo.videoFullRange = videoFullRange != 0;
+    _videoInfo.longerDuration = _videoInfo.videoDuration > _videoInfo.audioDuration ?
+                                _videoInfo.videoDuration : _videoInfo.audioDuration;
+    _videoInfo.infoFilled = true;
+    _videoInfo.decodingDone = true;
+
+    // Frames must lie between the header and the index
+    for (uint32_t i = 0; i < numVideoFrames; ++i)
+    {
+        VideoFrame* frame = new VideoFrame();
+        _videoFrames.push_back(frame);
+        uint32_t width = 0;
+        uint32_t height = 0;
+        uint32_t format = 0;
+        uint64_t offset = 0;
+        uint32_t size = 0;
+        if (!readMappedValue(mapping, _size, position, frame->pts)
+            || !readMappedValue(mapping, _size, position, frame->lifeTime)
+            || !readMappedValue(mapping, _size, position, width)
+            || !readMappedValue(mapping, _size, position, height)
+            || !readMappedValue(mapping, _size, position, format)
+            || !readMappedValue(mapping, _size, position, offset)
+            || !readMappedValue(mapping, _size, position, size)
+            || (format != Ogre::PF_BYTE_RGBA && format != Ogre::PF_L8)
+            || offset < sBakeHeaderSize || offset + size > indexOffset 
+            || size != width * height * Ogre::PixelUtil::getNumElemBytes((Ogre::PixelFormat)format))
+        {
+            return false;
+        }
+        frame->width = width;
+        frame->height = height;
+        frame->format = (Ogre::PixelFormat)format;
+        frame->data = (uint8_t*)mapping + offset;
+        frame->dataSize = size;
+        frame->buffer = _mapping;
+    }
+
+    uint32_t numAudioFrames = 0;
+    if (!readMappedValue(mapping, _size, position, numAudioFrames))
+    {
+        return false;
+    }
+    for (uint32_t i = 0; i < numAudioFrames; ++i)
+    {
+        AudioFrame* frame = new AudioFrame();
+        _audioFrames.push_back(frame);
+        uint64_t offset = 0;
+        uint32_t size = 0;
+        if (!readMappedValue(mapping, _size, position, frame->lifeTime)
+            || !readMappedValue(mapping, _size, position, offset)
+            || !readMappedValue(mapping, _size, position, size)
+            || offset < sBakeHeaderSize || offset + size > indexOffset)
+        {
+            return false;
+        }
+        frame->data = (uint8_t*)mapping + offset;
+        frame->dataSize = size;
+        frame->buffer = _mapping;
+    }
+    return !_videoFrames.empty();
+}
+
+//------------------------------------------------------------------------------
+bool
+BakedClip::getIsOpen() const
+{
+    return !_videoFrames.empty();
+}
+
+//------------------------------------------------------------------------------
+const VideoFrame*
+BakedClip::getFrameForTime(double p_time) const
+{
+    return findFrameForTime(_videoFrames, p_time);
+}
+
+//------------------------------------------------------------------------------
+unsigned int
+BakedClip::getNumAudioFrames() const
+{
+    return _audioFrames.size();
+}
+
+//------------------------------------------------------------------------------
+const AudioFrame*
+BakedClip::getAudioFrame(unsigned int p_index) const
+{
+    return _audioFrames[p_index];
+}
+
+//------------------------------------------------------------------------------
+double
+BakedClip::getDuration() const
+{
+    return _videoInfo.longerDuration;
+}
+
+//------------------------------------------------------------------------------
+const VideoInfo&
+BakedClip::getVideoInfo() const
+{
+    return _videoInfo;
+}
+
+//------------------------------------------------------------------------------
+size_t
+BakedClip::getBytes() const
+{
+    // The frames are in the mapping, which the OS pages in and out as it likes
+    return 0;
+}
+
+FFmpegBakedFrameCache* FFmpegBakedFrameCache::_instance = NULL;
+//------------------------------------------------------------------------------
+FFmpegBakedFrameCache::FFmpegBakedFrameCache()
+    : _directory("")
+    , _sizeLimit(0)
+    , _bytes(0)
+    , _useCounter(0)
+    , _nextFileId(0)
+    , _mutex(new boost::mutex())
+{
+}
+
+//------------------------------------------------------------------------------
+FFmpegBakedFrameCache::~FFmpegBakedFrameCache()
+{
+    delete _mutex;
+}
+
+//------------------------------------------------------------------------------
+bool
+FFmpegBakedFrameCache::setCacheDirectory(const Ogre::String& p_directory)
+{
+    boost::mutex::scoped_lock lock(*_mutex);
+    _directory = p_directory;
+    return _directory.length() > 0 ? load() : true;
+}
+
+//------------------------------------------------------------------------------
+Ogre::String
+FFmpegBakedFrameCache::getCacheDirectory() const
+{
+    boost::mutex::scoped_lock lock(*_mutex);
+    return _directory;
+}
+
+//------------------------------------------------------------------------------
+void
+FFmpegBakedFrameCache::setSizeLimit(uint64_t p_bytes)
+{
+    boost::mutex::scoped_lock lock(*_mutex);
+    _sizeLimit = p_bytes;
+    evictBakes("");
+    save();
+}
+
+//------------------------------------------------------------------------------
+uint64_t
+FFmpegBakedFrameCache::getSizeLimit() const
+{
+    boost::mutex::scoped_lock lock(*_mutex);
+    return _sizeLimit;
+}
+
+//------------------------------------------------------------------------------
+BakedClipWriter*
+FFmpegBakedFrameCache::createWriter()
+{
+    boost::mutex::scoped_lock lock(*_mutex);
+    if (_directory.length() == 0)
+    {
+        return NULL;
+    }
+
+    // File names are never used twice, so a running bake never writes over a mapped one
+    Ogre::String path = _directory + "/bake" + boost::lexical_cast<std::string>(_nextFileId++) + ".bin";
+    save();
+    BakedClipWriter* writer = new BakedClipWriter(path);
+    if (!writer->getIsGood())
+    {
+        delete writer;
+        return NULL;
+    }
+    return writer;
+}
+
+//------------------------------------------------------------------------------
+bool
+FFmpegBakedFrameCache::addBake(const Ogre::String& p_name, const StreamInfoKey& p_source, BakedClipWriter* p_writer)
+{
+    boost::mutex::scoped_lock lock(*_mutex);
+    if (!p_writer->getIsFinished() || _directory.length() == 0 || p_writer->getPath().find(_directory + "/") != 0)
+    {
+        delete p_writer;
+        return false;
+    }
+
+    std::map<Ogre::String, BakeEntry>::iterator it = _entries.find(p_name);
+    if (it != _entries.end())
+    {
+        removeBake(it);
+    }
+
+    BakeEntry entry;
+    entry.fileName = p_writer->getPath().substr(_directory.length() + 1);
+    entry.source = p_source;
+    entry.bytes = p_writer->getBytes();
+    entry.lastUsed = ++_useCounter;
+    _entries[p_name] = entry;
+    _bytes += entry.bytes;
+    delete p_writer;
+
+    evictBakes(p_name);
+    save();
+    return true;
+}
+
+//------------------------------------------------------------------------------
+BakedClipPtr
+FFmpegBakedFrameCache::openClip(const Ogre::String& p_name, const StreamInfoKey& p_source)
+{
+    boost::mutex::scoped_lock lock(*_mutex);
+    std::map<Ogre::String, BakeEntry>::iterator it = _entries.find(p_name);
+    if (it == _entries.end())
+    {
+        return BakedClipPtr();
+    }
+
+    // The video changed since it was baked
+    const StreamInfoKey& source = it->second.source;
+    if (source.path != p_source.path || source.size != p_source.size || source.modifiedTime != p_source.modifiedTime)
+    {
+        removeBake(it);
+        save();
+        return BakedClipPtr();
+    }
+
+    BakedClipPtr clip(new BakedClip(_directory + "/" + it->second.fileName));
+    if (!clip->getIsOpen())
+    {
+        removeBake(it);
+        save();
+        return BakedClipPtr();
+    }
+
+    it->second.lastUsed = ++_useCounter;
+    save();
+    return clip;
+}
+
+//------------------------------------------------------------------------------
+void
+FFmpegBakedFrameCache::clear()
+{
+    boost::mutex::scoped_lock lock(*_mutex);
+    while (!_entries.empty())
+    {
+        removeBake(_entries.begin());
+    }
+    save();
+}
+
+//------------------------------------------------------------------------------
+unsigned int
+FFmpegBakedFrameCache::getNumBakes() const
+{
+    boost::mutex::scoped_lock lock(*_mutex);
+    return _entries.size();
+}
+
+//------------------------------------------------------------------------------
+uint64_t
+FFmpegBakedFrameCache::getBytes() const
+{
+    boost::mutex::scoped_lock lock(*_mutex);
+    return _bytes;
+}
+
+//------------------------------------------------------------------------------
+bool
+FFmpegBakedFrameCache::load()
+{
+    _entries.clear();
+    _bytes = 0;
+    _useCounter = 0;
+    _nextFileId = 0;
+
+    std::ifstream file((_directory + "/bakes.index").c_str(), std::ios::binary);
+    if (!file.is_open())
+    {
+        return true;
+    }
+
+    uint32_t magic = 0;
+    uint32_t version = 0;
+    uint32_t numEntries = 0;
+    if (!readValue(file, magic) || !readValue(file, version) || magic != sBakeIndexMagic
+        || version != sBakeIndexVersion || !readValue(file, _useCounter) || !readValue(file, _nextFileId)
+        || !readValue(file, numEntries))
+    {
+        return false;
+    }
+
+    std::map<Ogre::String, BakeEntry> entries;
+    for (uint32_t i = 0; i < numEntries; ++i)
+    {
+        Ogre::String name;
+        BakeEntry entry;
+        readString(file, name);
+        readString(file, entry.fileName);
+        readString(file, entry.source.path);
+        readValue(file, entry.source.size);
+        readValue(file, entry.source.modifiedTime);
+        readValue(file, entry.bytes);
+        if (!readValue(file, entry.lastUsed))
+        {
+            return false;
+        }
+        entries[name] = entry;
+    }
+
+    _entries.swap(entries);
+    for (std::map<Ogre::String, BakeEntry>::const_iterator it = _entries.begin(); it != _entries.end(); ++it)
+    {
+        _bytes += it->second.bytes;
+    }
+    return true;
+}
+
+//------------------------------------------------------------------------------
+bool
+FFmpegBakedFrameCache::save()
+{
+    if (_directory.length() == 0)
+    {
+        return true;
+    }
+
+    std::ofstream file((_directory + "/bakes.index").c_str(), std::ios::binary | std::ios::trunc);
+    if (!file.is_open())
+    {
+        return false;
+    }
+    writeValue(file, sBakeIndexMagic);
+    writeValue(file, sBakeIndexVersion);
+    writeValue(file, _useCounter);
+    writeValue(file, _nextFileId);
+    writeValue(file, (uint32_t)_entries.size());
+    for (std::map<Ogre::String, BakeEntry>::const_iterator it = _entries.begin(); it != _entries.end(); ++it)
+    {
+        const BakeEntry& entry = it->second;
+        writeString(file, it->first);
+        writeString(file, entry.fileName);
+        writeString(file, entry.source.path);
+        writeValue(file, entry.source.size);
+        writeValue(file, entry.source.modifiedTime);
+        writeValue(file, entry.bytes);
+        writeValue(file, entry.lastUsed);
+    }
+    return file.good();
+}
+
+//------------------------------------------------------------------------------
+void
+FFmpegBakedFrameCache::removeBake(std::map<Ogre::String, BakeEntry>::iterator p_entry)
+{
+    // Mapped bakes stay readable until they are unmapped
+    std::remove((_directory + "/" + p_entry->second.fileName).c_str());
+    _bytes -= p_entry->second.bytes;
+    _entries.erase(p_entry);
+}
+
+//------------------------------------------------------------------------------
+void
+FFmpegBakedFrameCache::evictBakes(const Ogre::String& p_keep)
+{
+    while (_sizeLimit > 0 && _bytes > _sizeLimit)
+    {
+        std::map<Ogre::String, BakeEntry>::iterator oldest = _entries.end();
+        for (std::map<Ogre::String, BakeEntry>::iterator it = _entries.begin(); it != _entries.end(); ++it)
+        {
+            if (it->first != p_keep && (oldest == _entries.end() || it->second.lastUsed < oldest->second.lastUsed))
+            {
+                oldest = it;
+            }
+        }
+        if (oldest == _entries.end())
+        {
+            return;
+        }
+        removeBake(oldest);
+    }
+}
@@ -0,0 +1,427 @@
+/* 
+ * File:   FFmpegDecoderPool.cpp
+ * Author: TheSHEEEP
+ *
+ * Created on 19. Oktober 2026, 16:05
+ */
+
+#include "FFmpegDecoderPool.h"
+
+#include <boost/thread.hpp>
+#include <boost/chrono.hpp>
+
+// Waiting jobs check their buffers again after this time, even if nobody woke them up
+static const double sWaitTimeout = 0.1;
+
+//------------------------------------------------------------------------------
+DecoderPoolStats::DecoderPoolStats()
+    : numSteps(0)
+    , averageLatency(0.0)
+    , maxLatency(0.0)
+    , numDeadlineMisses(0)
+{
+}
+
+FFmpegDecoderPool* FFmpegDecoderPool::_instance = NULL;
+//------------------------------------------------------------------------------
+FFmpegDecoderPool::FFmpegDecoderPool()
+    : _workers(NULL)
+    , _mutex(NULL)
+    , _workCondVar(NULL)
+    , _stepDoneCondVar(NULL)
+    , _numWorkers(0)
+    , _quit(false)
+    , _log(NULL)
+    , _totalLatency(0.0)
+{
+    _mutex = new boost::mutex();
+    _workCondVar = new boost::condition_variable();
+    _stepDoneCondVar = new boost::condition_variable();
+}
+
+//------------------------------------------------------------------------------
+FFmpegDecoderPool::~FFmpegDecoderPool()
+{
+    stopWorkers();
+
+    delete _mutex;
+    delete _workCondVar;
+    delete _stepDoneCondVar;
+}
+
+//------------------------------------------------------------------------------
+void
+FFmpegDecoderPool::setLog(Ogre::Log* p_log)
+{
+    boost::mutex::scoped_lock lock(*_mutex);
+    _log = p_log;
+}
+
+//------------------------------------------------------------------------------
+void
+FFmpegDecoderPool::setThreadSettings(const DecoderThreadSettings& p_settings)
+{
+    {
+        boost::mutex::scoped_lock lock(*_mutex);
+        _threadSettings = p_settings;
+    }
+
+    // Replace the running workers, the settings are applied when a worker starts
+    stopWorkers();
+    boost::mutex::scoped_lock lock(*_mutex);
+    if (!_jobs.empty())
+    {
+        startWorkers();
+    }
+}
+
+//------------------------------------------------------------------------------
+DecoderThreadSettings
+FFmpegDecoderPool::getThreadSettings() const
+{
+    boost::mutex::scoped_lock lock(*_mutex);
+    return _threadSettings;
+}
+
+//------------------------------------------------------------------------------
+void
+FFmpegDecoderPool::setNumWorkers(unsigned int p_numWorkers)
+{
+    {
+        boost::mutex::scoped_lock lock(*_mutex);
+        if (p_numWorkers == _numWorkers)
+        {
+            return;
+        }
+        _numWorkers = p_numWorkers;
+    }
+
+    // Replace the running workers
+    stopWorkers();
+    boost::mutex::scoped_lock lock(*_mutex);
+    if (!_jobs.empty())
+    {
+        startWorkers();
+    }
+}
+
+//------------------------------------------------------------------------------
+unsigned int
+FFmpegDecoderPool::getNumWorkers() const
+{
+    boost::mutex::scoped_lock lock(*_mutex);
+    if (_numWorkers > 0)
+    {
+        return _numWorkers;
+    }
+    if (_threadSettings.maxCores > 0)
+    {
+        return _threadSettings.maxCores;
+    }
+    unsigned int numHardwareThreads = boost::thread::hardware_concurrency();
+    return numHardwareThreads > 0 ? numHardwareThreads : 1;
+}
+
+//------------------------------------------------------------------------------
+void
+FFmpegDecoderPool::addJob(Job* p_job)
+{
+    // The deadline is not known before the first step, so the job starts right away
+    DecodingPriority priority = p_job->getPriority();
+    {
+        boost::mutex::scoped_lock lock(*_mutex);
+        double now = getTime();
+
+        JobEntry entry;
+        entry.job = p_job;
+        entry.priority = priority;
+        entry.deadline = now;
+        entry.readySince = now;
+        entry.wakeTime = now;
+        entry.isReady = true;
+        entry.wakePending = false;
+        entry.isRunning = false;
+        entry.isFinished = false;
+        _jobs.push_back(entry);
+
+        startWorkers();
+    }
+    _workCondVar->notify_one();
+}
+
+//------------------------------------------------------------------------------
+void
+FFmpegDecoderPool::wakeJob(Job* p_job)
+{
+    {
+        boost::mutex::scoped_lock lock(*_mutex);
+        JobEntry* entry = findEntry(p_job);
+        if (!entry || entry->isFinished || entry->isReady)
+        {
+            return;
+        }
+
+        // Running jobs are scheduled again right after their step
+        if (entry->isRunning)
+        {
+            entry->wakePending = true;
+            return;
+        }
+
+        entry->isReady = true;
+        entry->readySince = getTime();
+    }
+    _workCondVar->notify_one();
+}
+
+//------------------------------------------------------------------------------
+void
+FFmpegDecoderPool::waitForJob(Job* p_job)
+{
+    wakeJob(p_job);
+
+    boost::mutex::scoped_lock lock(*_mutex);
+    JobEntry* entry = NULL;
+    while ((entry = findEntry(p_job)) != NULL && !entry->isFinished)
+    {
+        // The workers may have been stopped since the job was added
+        startWorkers();
+        _stepDoneCondVar->wait(lock);
+    }
+}
+
+//------------------------------------------------------------------------------
+void
+FFmpegDecoderPool::removeJob(Job* p_job)
+{
+    boost::mutex::scoped_lock lock(*_mutex);
+    for (std::list<JobEntry>::iterator it = _jobs.begin(); it != _jobs.end(); ++it)
+    {
+        if (it->job == p_job)
+        {
+            while (it->isRunning)
+            {
+                _stepDoneCondVar->wait(lock);
+            }
+            _jobs.erase(it);
+            return;
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+bool
+FFmpegDecoderPool::getIsJobFinished(Job* p_job) const
+{
+    boost::mutex::scoped_lock lock(*_mutex);
+    for (std::list<JobEntry>::const_iterator it = _jobs.begin(); it != _jobs.end(); ++it)
+    {
+        if (it->job == p_job)
+        {
+            return it->isFinished;
+        }
+    }
+    return true;
+}
+
+//------------------------------------------------------------------------------
+DecoderPoolStats
+FFmpegDecoderPool::getStats() const
+{
+    boost::mutex::scoped_lock lock(*_mutex);
+    DecoderPoolStats stats = _stats;
+    stats.averageLatency = stats.numSteps > 0 ? _totalLatency / stats.numSteps : 0.0;
+    return stats;
+}
+
+//------------------------------------------------------------------------------
+void
+FFmpegDecoderPool::resetStats()
+{
+    boost::mutex::scoped_lock lock(*_mutex);
+    _stats = DecoderPoolStats();
+    _totalLatency = 0.0;
+}
+
+//------------------------------------------------------------------------------
+void
+FFmpegDecoderPool::workerLoop()
+{
+    // Codecs opened by this worker create their threads from here, so they inherit the placement
+    DecoderThreadSettings threadSettings;
+    Ogre::Log* log = NULL;
+    {
+        boost::mutex::scoped_lock lock(*_mutex);
+        threadSettings = _threadSettings;
+        log = _log;
+    }
+    applyDecoderThreadSettings(threadSettings, log, "pool worker");
+
+    while (true)
+    {
+        // Wait for a job that is ready
+        JobEntry* entry = NULL;
+        {
+            boost::mutex::scoped_lock lock(*_mutex);
+            while (!_quit && (entry = pickJob(getTime())) == NULL)
+            {
+                // Waiting jobs are checked again regularly
+                boost::chrono::steady_clock::time_point const timeOut =
+                    boost::chrono::steady_clock::now() + boost::chrono::milliseconds((int)(sWaitTimeout * 1000));
+                _workCondVar->wait_until(lock, timeOut);
+            }
+            if (_quit)
+            {
+                break;
+            }
+
+            // Scheduling metrics
+            double now = getTime();
+            double latency = now - entry->readySince;
+            latency = latency > 0.0 ? latency : 0.0;
+            ++_stats.numSteps;
+            _totalLatency += latency;
+            _stats.maxLatency = latency > _stats.maxLatency ? latency : _stats.maxLatency;
+            if (now > entry->deadline)
+            {
+                ++_stats.numDeadlineMisses;
+            }
+
+            entry->isReady = false;
+            entry->wakePending = false;
+            entry->isRunning = true;
+        }
+
+        // The entry stays valid, removeJob waits until the step is done
+        Job* job = entry->job;
+        JobStepResult result = job->step();
+        double deadline = getTime() + job->getSecondsUntilDeadline();
+        DecodingPriority priority = job->getPriority();
+
+        {
+            boost::mutex::scoped_lock lock(*_mutex);
+            double now = getTime();
+            entry->isRunning = false;
+            entry->deadline = deadline;
+            entry->priority = priority;
+            if (result == JSR_FINISHED)
+            {
+                entry->isFinished = true;
+            }
+            else if (result == JSR_CONTINUE || entry->wakePending)
+            {
+                entry->isReady = true;
+                entry->readySince = now;
+            }
+            else
+            {
+                entry->wakeTime = now + sWaitTimeout;
+            }
+            entry->wakePending = false;
+        }
+        _stepDoneCondVar->notify_all();
+    }
+}
+
+//------------------------------------------------------------------------------
+void
+FFmpegDecoderPool::startWorkers()
+{
+    if (_workers)
+    {
+        return;
+    }
+
+    unsigned int numWorkers = _numWorkers;
+    if (numWorkers == 0 && _threadSettings.maxCores > 0)
+    {
+        numWorkers = _threadSettings.maxCores;
+    }
+    else if (numWorkers == 0)
+    {
+        numWorkers = boost::thread::hardware_concurrency();
+        numWorkers = numWorkers > 0 ? numWorkers : 1;
+    }
+
+    _quit = false;
+    _workers = new boost::thread_group();
+    for (unsigned int i = 0; i < numWorkers; ++i)
+    {
+        _workers->add_thread(new boost::thread(&FFmpegDecoderPool::workerLoop, this));
+    }
+}
+
+//------------------------------------------------------------------------------
+void
+FFmpegDecoderPool::stopWorkers()
+{
+    boost::thread_group* workers = NULL;
+    {
+        boost::mutex::scoped_lock lock(*_mutex);
+        workers = _workers;
+        _workers = NULL;
+        _quit = true;
+    }
+    _workCondVar->notify_all();
+
+    if (workers)
+    {
+        workers->join_all();
+        delete workers;
+    }
+}
+
+//------------------------------------------------------------------------------
+FFmpegDecoderPool::JobEntry*
+FFmpegDecoderPool::pickJob(double p_now)
+{
+    // Earliest deadline first, foreground before background
+    JobEntry* best = NULL;
+    for (std::list<JobEntry>::iterator it = _jobs.begin(); it != _jobs.end(); ++it)
+    {
+        JobEntry& entry = *it;
+        if (entry.isRunning || entry.isFinished)
+        {
+            continue;
+        }
+
+        // Waiting jobs check their buffers again after a while
+        if (!entry.isReady)
+        {
+            if (p_now < entry.wakeTime)
+            {
+                continue;
+            }
+            entry.isReady = true;
+            entry.readySince = entry.wakeTime;
+        }
+
+        if (!best || entry.priority < best->priority
+            || (entry.priority == best->priority && entry.deadline < best->deadline))
+        {
+            best = &entry;
+        }
+    }
+    return best;
+}
+
+//------------------------------------------------------------------------------
+FFmpegDecoderPool::JobEntry*
+FFmpegDecoderPool::findEntry(Job* p_job)
+{
+    for (std::list<JobEntry>::iterator it = _jobs.begin(); it != _jobs.end(); ++it)
+    {
+        if (it->job == p_job)
+        {
+            return &(*it);
+        }
+    }
+    return NULL;
+}
+
+//------------------------------------------------------------------------------
+double
+FFmpegDecoderPool::getTime()
+{
+    return boost::chrono::duration<double>(boost::chrono::steady_clock::now().time_since_epoch()).count();
+}
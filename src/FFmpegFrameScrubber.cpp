@@ -0,0 +1,336 @@
+/* 
+ * File:   FFmpegFrameScrubber.cpp
+ * Author: TheSHEEEP
+ * 
+ * Created on 19. Oktober 2026, 15:20
+ */
+
+#include "FFmpegFrameScrubber.h"
+#include "FFmpegVideoPlayer.h"
+
+#include <OgreRoot.h>
+#include <boost/thread.hpp>
+
+// If the requested time is at most this far ahead of the decoder, decoding simply continues.
+// Otherwise, the decoder seeks.
+static const double sMaxDecodeAhead = 1.0;
+
+//------------------------------------------------------------------------------
+FFmpegFrameScrubber::FFmpegFrameScrubber()
+    : _decodedUntil(-1.0)
+    , _error("")
+    , _thread(NULL)
+    , _mutex(NULL)
+    , _condVar(NULL)
+    , _quit(false)
+    , _hasRequest(false)
+    , _cacheBudget(128 * 1024 * 1024)
+    , _prefetchCount(8)
+    , _cacheHits(0)
+    , _cacheMisses(0)
+    , _isFrameListener(false)
+{
+    _mutex = new boost::mutex();
+    _condVar = new boost::condition_variable();
+    _request.time = 0.0;
+    _request.listener = NULL;
+    _request.frame = NULL;
+}
+
+//------------------------------------------------------------------------------
+FFmpegFrameScrubber::~FFmpegFrameScrubber()
+{
+    close();
+    delete _mutex;
+    delete _condVar;
+}
+
+//------------------------------------------------------------------------------
+bool 
+FFmpegFrameScrubber::open(const Ogre::String& p_filename)
+{
+    close();
+    
+    _error = "";
+    if (!_decoder.open(p_filename, _error))
+    {
+        return false;
+    }
+    _decodedUntil = -1.0;
+    _cacheHits = 0;
+    _cacheMisses = 0;
+    
+    // Report completed requests at the start of each frame
+    if (Ogre::Root::getSingletonPtr())
+    {
+        Ogre::Root::getSingletonPtr()->addFrameListener(this);
+        _isFrameListener = true;
+    }
+    
+    _quit = false;
+    _thread = new boost::thread(&FFmpegFrameScrubber::run, this);
+    return true;
+}
+
+//------------------------------------------------------------------------------
+void 
+FFmpegFrameScrubber::close()
+{
+    if (_thread)
+    {
+        {
+            boost::mutex::scoped_lock lock(*_mutex);
+            _quit = true;
+        }
+        _condVar->notify_all();
+        _thread->join();
+        delete _thread;
+        _thread = NULL;
+    }
+    
+    if (_isFrameListener)
+    {
+        Ogre::Root::getSingletonPtr()->removeFrameListener(this);
+        _isFrameListener = false;
+    }
+    
+    // Drop requests that were not dispatched yet
+    for (unsigned int i = 0; i < _completedRequests.size(); ++i)
+    {
+        delete _completedRequests[i].frame;
+    }
+    _completedRequests.clear();
+    _hasRequest = false;
+    
+    _cache.clear();
+    _decoder.close();
+}
+
+//------------------------------------------------------------------------------
+void 
+FFmpegFrameScrubber::requestFrameAt(double p_time, Listener* p_listener)
+{
+    {
+        boost::mutex::scoped_lock lock(*_mutex);
+        _request.time = p_time;
+        _request.listener = p_listener;
+        _hasRequest = true;
+    }
+    _condVar->notify_all();
+}
+
+//------------------------------------------------------------------------------
+void 
+FFmpegFrameScrubber::setCacheBudget(size_t p_bytes)
+{
+    boost::mutex::scoped_lock lock(*_mutex);
+    _cacheBudget = p_bytes;
+}
+
+//------------------------------------------------------------------------------
+size_t 
+FFmpegFrameScrubber::getCacheBudget() const
+{
+    boost::mutex::scoped_lock lock(*_mutex);
+    return _cacheBudget;
+}
+
+//------------------------------------------------------------------------------
+void 
+FFmpegFrameScrubber::setPrefetchCount(unsigned int p_numFrames)
+{
+    boost::mutex::scoped_lock lock(*_mutex);
+    _prefetchCount = p_numFrames;
+}
+
+//------------------------------------------------------------------------------
+unsigned int 
+FFmpegFrameScrubber::getPrefetchCount() const
+{
+    boost::mutex::scoped_lock lock(*_mutex);
+    return _prefetchCount;
+}
+
+//------------------------------------------------------------------------------
+unsigned int 
+FFmpegFrameScrubber::getCacheHits() const
+{
+    boost::mutex::scoped_lock lock(*_mutex);
+    return _cacheHits;
+}
+
+//------------------------------------------------------------------------------
+unsigned int 
+FFmpegFrameScrubber::getCacheMisses() const
+{
+    boost::mutex::scoped_lock lock(*_mutex);
+    return _cacheMisses;
+}
+
+//------------------------------------------------------------------------------
+void 
+FFmpegFrameScrubber::dispatchCompletedRequests()
+{
+    std::vector<Request> completed;
+    {
+        boost::mutex::scoped_lock lock(*_mutex);
+        completed.swap(_completedRequests);
+    }
+    
+    for (unsigned int i = 0; i < completed.size(); ++i)
+    {
+        completed[i].listener->scrubFrameReady(completed[i].time, completed[i].frame);
+    }
+}
+
+//------------------------------------------------------------------------------
+bool 
+FFmpegFrameScrubber::frameStarted(const Ogre::FrameEvent& p_evt)
+{
+    dispatchCompletedRequests();
+    return true;
+}
+
+//------------------------------------------------------------------------------
+void 
+FFmpegFrameScrubber::run()
+{
+    double lastTime = 0.0;
+    while (true)
+    {
+        // Wait for the next request
+        Request request;
+        unsigned int prefetchCount;
+        {
+            boost::mutex::scoped_lock lock(*_mutex);
+            while (!_hasRequest && !_quit)
+            {
+                _condVar->wait(lock);
+            }
+            if (_quit)
+            {
+                break;
+            }
+            request = _request;
+            _hasRequest = false;
+            prefetchCount = _prefetchCount;
+            _cache.setBudget(_cacheBudget);
+        }
+        
+        // Serve it from the cache if possible
+        const VideoFrame* frame = _cache.find(request.time);
+        bool hit = frame != NULL;
+        if (!hit)
+        {
+            frame = decodeUntil(request.time);
+        }
+        
+        // The listener gets its own frame, the cached one may be evicted any time
+        request.frame = frame ? new VideoFrame(*frame) : NULL;
+        {
+            boost::mutex::scoped_lock lock(*_mutex);
+            _completedRequests.push_back(request);
+            if (hit)
+            {
+                ++_cacheHits;
+            }
+            else
+            {
+                ++_cacheMisses;
+            }
+        }
+        
+        // Get the neighbours in scrub direction
+        int direction = request.time >= lastTime ? 1 : -1;
+        lastTime = request.time;
+        for (unsigned int i = 1; i <= prefetchCount; ++i)
+        {
+            prefetch(request.time + direction * i * _decoder.getFrameDuration(), direction);
+            if (hasPendingRequest())
+            {
+                break;
+            }
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+bool 
+FFmpegFrameScrubber::hasPendingRequest()
+{
+    boost::mutex::scoped_lock lock(*_mutex);
+    return _hasRequest || _quit;
+}
+
+//------------------------------------------------------------------------------
+const VideoFrame* 
+FFmpegFrameScrubber::decodeUntil(double p_time)
+{
+    // Continue decoding if the time is a bit ahead of the decoder, seek otherwise
+    if (_decodedUntil < 0.0 || p_time < _decodedUntil || p_time - _decodedUntil > sMaxDecodeAhead)
+    {
+        _decoder.seek(p_time);
+        _decodedUntil = -1.0;
+    }
+    
+    // All frames on the way are cached as well
+    const VideoFrame* lastFrame = NULL;
+    const VideoFrame* frame = NULL;
+    while ((frame = decodeIntoCache()) != NULL)
+    {
+        lastFrame = frame;
+        if (frame->pts + frame->lifeTime > p_time)
+        {
+            return frame;
+        }
+    }
+    
+    // We hit the end of the video, the last frame stays on screen
+    return lastFrame;
+}
+
+//------------------------------------------------------------------------------
+void 
+FFmpegFrameScrubber::prefetch(double p_time, int p_direction)
+{
+    if (p_time < 0.0 || p_time >= _decoder.getDuration() || _cache.contains(p_time))
+    {
+        return;
+    }
+    
+    // Forward, the decoder usually is right in front of the time
+    if (p_direction > 0)
+    {
+        decodeUntil(p_time);
+        return;
+    }
+    
+    // Backwards, decode the whole prefetch window at once instead of seeking for each frame
+    double windowStart = p_time - getPrefetchCount() * _decoder.getFrameDuration();
+    decodeUntil(windowStart > 0.0 ? windowStart : 0.0);
+    while (_decodedUntil >= 0.0 && _decodedUntil <= p_time && !hasPendingRequest())
+    {
+        if (!decodeIntoCache())
+        {
+            break;
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+const VideoFrame* 
+FFmpegFrameScrubber::decodeIntoCache()
+{
+    VideoFrame* frame = _decoder.decodeNextFrame();
+    if (!frame)
+    {
+        // Seek again with the next request
+        _decodedUntil = -1.0;
+        return NULL;
+    }
+    
+    // The most recently inserted frame is never evicted right away
+    _decodedUntil = frame->pts + frame->lifeTime;
+    _cache.insert(frame);
+    return frame;
+}
@@ -0,0 +1,607 @@
+/* 
+ * File:   FFmpegInputStream.cpp
+ * Author: TheSHEEEP
+ *
+ * Created on 19. Oktober 2026, 20:10
+ */
+
+#include "FFmpegInputStream.h"
+#include "FFmpegStreamInfoCache.h"
+
+extern "C"
+{
+    #ifndef INT64_C
+    #define INT64_C(c) (c ## LL)
+    #define UINT64_C(c) (c ## ULL)
+    #endif
+    #include <libavformat/avformat.h>
+}
+
+#include <OgreResourceGroupManager.h>
+#include <OgreArchive.h>
+#include <OgreException.h>
+#include <boost/thread.hpp>
+#include <boost/chrono.hpp>
+#include <cstring>
+#include <cstdio>
+#include <sys/stat.h>
+
+#if OGRE_PLATFORM == OGRE_PLATFORM_WIN32 || OGRE_PLATFORM == OGRE_PLATFORM_WINRT
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+// The prefetch thread touches this many bytes before it checks the read position again
+static const size_t sPrefetchChunkSize = 256 * 1024;
+
+//------------------------------------------------------------------------------
+InputSettings::InputSettings()
+    : mode(IM_STREAM)
+    , readBufferSize(FFMPEG_DEFAULT_READ_BUFFER_SIZE)
+    , readAheadBytes(16 * 1024 * 1024)
+    , usePrefetchThread(false)
+    , probeSize(0)
+    , analyzeDuration(0.0)
+    , useStreamInfoCache(true)
+{
+}
+
+//------------------------------------------------------------------------------
+InputStats::InputStats()
+    : bytesRead(0)
+    , numReads(0)
+    , blockedTime(0.0)
+    , maxBlockedTime(0.0)
+{
+}
+
+//------------------------------------------------------------------------------
+/**
+ * @return  The size of a memory page.
+ */
+static size_t
+getPageSize()
+{
+#if OGRE_PLATFORM == OGRE_PLATFORM_WIN32 || OGRE_PLATFORM == OGRE_PLATFORM_WINRT
+    SYSTEM_INFO systemInfo;
+    GetSystemInfo(&systemInfo);
+    return systemInfo.dwPageSize;
+#else
+    long pageSize = sysconf(_SC_PAGESIZE);
+    return pageSize > 0 ? (size_t)pageSize : 4096;
+#endif
+}
+
+//------------------------------------------------------------------------------
+FFmpegInputStream::FFmpegInputStream(const Ogre::DataStreamPtr& p_stream, const InputSettings& p_settings)
+    : _stream(p_stream)
+    , _memory(NULL)
+    , _size(p_stream->size())
+    , _position(0)
+    , _ioContext(NULL)
+    , _mapping(NULL)
+    , _readAheadBytes(0)
+    , _advisedUntil(0)
+    , _prefetchThread(NULL)
+    , _prefetchMutex(NULL)
+    , _prefetchCondVar(NULL)
+    , _prefetchPosition(0)
+    , _quitPrefetch(false)
+{
+    // Archives that are loaded into memory already hold the whole file, no need to read it again
+    Ogre::MemoryDataStream* memoryStream = dynamic_cast<Ogre::MemoryDataStream*>(_stream.get());
+    if (memoryStream)
+    {
+        _memory = memoryStream->getPtr();
+    }
+
+    createIOContext(p_settings.readBufferSize);
+}
+
+//------------------------------------------------------------------------------
+FFmpegInputStream::FFmpegInputStream(const Ogre::String& p_filename, const InputSettings& p_settings)
+    : _memory(NULL)
+    , _size(0)
+    , _position(0)
+    , _ioContext(NULL)
+    , _mapping(NULL)
+    , _readAheadBytes(p_settings.readAheadBytes)
+    , _advisedUntil(0)
+    , _prefetchThread(NULL)
+    , _prefetchMutex(NULL)
+    , _prefetchCondVar(NULL)
+    , _prefetchPosition(0)
+    , _quitPrefetch(false)
+{
+    // The mapping stays valid after the file is closed
+#if OGRE_PLATFORM == OGRE_PLATFORM_WIN32 || OGRE_PLATFORM == OGRE_PLATFORM_WINRT
+    HANDLE file = CreateFileA(p_filename.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+                              FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if (file == INVALID_HANDLE_VALUE)
+    {
+        return;
+    }
+    LARGE_INTEGER fileSize;
+    if (GetFileSizeEx(file, &fileSize) && fileSize.QuadPart > 0)
+    {
+        HANDLE fileMapping = CreateFileMapping(file, NULL, PAGE_READONLY, 0, 0, NULL);
+        if (fileMapping)
+        {
+            _mapping = MapViewOfFile(fileMapping, FILE_MAP_READ, 0, 0, 0);
+            _size = (size_t)fileSize.QuadPart;
+            CloseHandle(fileMapping);
+        }
+    }
+    CloseHandle(file);
+#else
+    int file = open(p_filename.c_str(), O_RDONLY);
+    if (file < 0)
+    {
+        return;
+    }
+    struct stat fileStat;
+    if (fstat(file, &fileStat) == 0 && fileStat.st_size > 0)
+    {
+        void* mapping = mmap(NULL, (size_t)fileStat.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+        if (mapping != MAP_FAILED)
+        {
+            _mapping = mapping;
+            _size = (size_t)fileStat.st_size;
+
+            // The file is read front to back, so pages behind the reader can go early
+            madvise(_mapping, _size, MADV_SEQUENTIAL);
+#if OGRE_PLATFORM == OGRE_PLATFORM_LINUX
+            posix_fadvise(file, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+        }
+    }
+    close(file);
+#endif
+
+    if (!_mapping)
+    {
+        return;
+    }
+    _memory = (const unsigned char*)_mapping;
+
+    createIOContext(p_settings.readBufferSize);
+    if (_ioContext && p_settings.usePrefetchThread && _readAheadBytes > 0)
+    {
+        _prefetchMutex = new boost::mutex();
+        _prefetchCondVar = new boost::condition_variable();
+        _prefetchThread = new boost::thread(&FFmpegInputStream::prefetchLoop, this);
+    }
+}
+
+//------------------------------------------------------------------------------
+FFmpegInputStream::~FFmpegInputStream()
+{
+    if (_prefetchThread)
+    {
+        {
+            boost::mutex::scoped_lock lock(*_prefetchMutex);
+            _quitPrefetch = true;
+        }
+        _prefetchCondVar->notify_all();
+        _prefetchThread->join();
+        delete _prefetchThread;
+        delete _prefetchMutex;
+        delete _prefetchCondVar;
+    }
+
+    if (_ioContext)
+    {
+        // FFmpeg may have replaced the buffer meanwhile
+        av_free(_ioContext->buffer);
+        av_free(_ioContext);
+    }
+
+    if (_mapping)
+    {
+#if OGRE_PLATFORM == OGRE_PLATFORM_WIN32 || OGRE_PLATFORM == OGRE_PLATFORM_WINRT
+        UnmapViewOfFile(_mapping);
+#else
+        munmap(_mapping, _size);
+#endif
+    }
+    if (!_stream.isNull())
+    {
+        _stream->close();
+    }
+}
+
+//------------------------------------------------------------------------------
+AVIOContext*
+FFmpegInputStream::getIOContext()
+{
+    return _ioContext;
+}
+
+//------------------------------------------------------------------------------
+const InputStats&
+FFmpegInputStream::getStats() const
+{
+    return _stats;
+}
+
+//------------------------------------------------------------------------------
+void
+FFmpegInputStream::createIOContext(size_t p_bufferSize)
+{
+    unsigned char* buffer = (unsigned char*)av_malloc(p_bufferSize);
+    if (buffer)
+    {
+        _ioContext = avio_alloc_context(buffer, (int)p_bufferSize, 0, this, &FFmpegInputStream::read, NULL,
+                                        &FFmpegInputStream::seek);
+        if (!_ioContext)
+        {
+            av_free(buffer);
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+void
+FFmpegInputStream::adviseReadAhead(size_t p_position)
+{
+    if (!_mapping || _readAheadBytes == 0)
+    {
+        return;
+    }
+
+    // Only tell the OS again when the reader got close to the end of the advised part, or seeked away from it
+    size_t advisedFrom = _advisedUntil > _readAheadBytes ? _advisedUntil - _readAheadBytes : 0;
+    if (_advisedUntil > 0 && p_position >= advisedFrom && p_position + _readAheadBytes / 2 < _advisedUntil)
+    {
+        return;
+    }
+    _advisedUntil = p_position + _readAheadBytes < _size ? p_position + _readAheadBytes : _size;
+
+#if OGRE_PLATFORM != OGRE_PLATFORM_WIN32 && OGRE_PLATFORM != OGRE_PLATFORM_WINRT
+    // madvise needs a page aligned address
+    size_t start = p_position - p_position % getPageSize();
+    madvise((unsigned char*)_mapping + start, _advisedUntil - start, MADV_WILLNEED);
+#endif
+}
+
+//------------------------------------------------------------------------------
+void
+FFmpegInputStream::prefetchLoop()
+{
+    size_t pageSize = getPageSize();
+    size_t touchedUntil = 0;
+    volatile unsigned char pageSum = 0;
+
+    boost::mutex::scoped_lock lock(*_prefetchMutex);
+    while (!_quitPrefetch)
+    {
+        size_t position = _prefetchPosition;
+        size_t end = position + _readAheadBytes < _size ? position + _readAheadBytes : _size;
+
+        // Start over at the read position after seeks
+        if (touchedUntil < position || touchedUntil > end)
+        {
+            touchedUntil = position;
+        }
+        if (touchedUntil >= end)
+        {
+            _prefetchCondVar->wait(lock);
+            continue;
+        }
+
+        // Reading one byte per page makes the OS load it, the reader does not wait on the lock meanwhile
+        size_t chunkEnd = touchedUntil + sPrefetchChunkSize < end ? touchedUntil + sPrefetchChunkSize : end;
+        lock.unlock();
+        for (size_t i = touchedUntil - touchedUntil % pageSize; i < chunkEnd; i += pageSize)
+        {
+            pageSum += _memory[i];
+        }
+        lock.lock();
+        touchedUntil = chunkEnd;
+    }
+}
+
+//------------------------------------------------------------------------------
+int
+FFmpegInputStream::read(void* p_opaque, uint8_t* p_buffer, int p_bufferSize)
+{
+    FFmpegInputStream* input = (FFmpegInputStream*)p_opaque;
+    if (input->_position >= input->_size || p_bufferSize <= 0)
+    {
+        return AVERROR_EOF;
+    }
+    input->adviseReadAhead(input->_position);
+
+    // Copying from a mapped file waits for the disk if the pages are not loaded yet
+    boost::chrono::steady_clock::time_point readStart = boost::chrono::steady_clock::now();
+    size_t bytesRead = 0;
+    if (input->_memory)
+    {
+        bytesRead = input->_size - input->_position;
+        bytesRead = bytesRead < (size_t)p_bufferSize ? bytesRead : (size_t)p_bufferSize;
+        memcpy(p_buffer, input->_memory + input->_position, bytesRead);
+    }
+    else
+    {
+        bytesRead = input->_stream->read(p_buffer, p_bufferSize);
+    }
+    input->_position += bytesRead;
+
+    double blockedTime = boost::chrono::duration<double>(boost::chrono::steady_clock::now() - readStart).count();
+    input->_stats.bytesRead += bytesRead;
+    ++input->_stats.numReads;
+    input->_stats.blockedTime += blockedTime;
+    input->_stats.maxBlockedTime = blockedTime > input->_stats.maxBlockedTime ?
+                                   blockedTime : input->_stats.maxBlockedTime;
+
+    if (input->_prefetchThread)
+    {
+        {
+            boost::mutex::scoped_lock lock(*input->_prefetchMutex);
+            input->_prefetchPosition = input->_position;
+        }
+        input->_prefetchCondVar->notify_one();
+    }
+    return bytesRead > 0 ? (int)bytesRead : AVERROR_EOF;
+}
+
+//------------------------------------------------------------------------------
+int64_t
+FFmpegInputStream::seek(void* p_opaque, int64_t p_offset, int p_whence)
+{
+    FFmpegInputStream* input = (FFmpegInputStream*)p_opaque;
+    int64_t position = 0;
+    switch (p_whence & ~AVSEEK_FORCE)
+    {
+    case AVSEEK_SIZE:
+        return (int64_t)input->_size;
+    case SEEK_SET:
+        position = p_offset;
+        break;
+    case SEEK_CUR:
+        position = (int64_t)input->_position + p_offset;
+        break;
+    case SEEK_END:
+        position = (int64_t)input->_size + p_offset;
+        break;
+    default:
+        return -1;
+    }
+    if (position < 0 || position > (int64_t)input->_size)
+    {
+        return -1;
+    }
+
+    if (!input->_memory)
+    {
+        input->_stream->seek((size_t)position);
+    }
+    input->_position = (size_t)position;
+    return position;
+}
+
+//------------------------------------------------------------------------------
+/**
+ * Finds the archive entry of a resource.
+ * @return  False if the resource is in no archive.
+ */
+static bool
+findResourceFile(const Ogre::String& p_name, const Ogre::String& p_resourceGroup, Ogre::FileInfo& p_outFileInfo)
+{
+    Ogre::ResourceGroupManager& resourceManager = Ogre::ResourceGroupManager::getSingleton();
+    Ogre::String group = p_resourceGroup;
+    if (group == Ogre::ResourceGroupManager::AUTODETECT_RESOURCE_GROUP_NAME)
+    {
+        group = resourceManager.findGroupContainingResource(p_name);
+    }
+
+    Ogre::FileInfoListPtr fileInfos = resourceManager.findResourceFileInfo(group, p_name);
+    if (fileInfos->empty() || !fileInfos->front().archive)
+    {
+        return false;
+    }
+    p_outFileInfo = fileInfos->front();
+    return true;
+}
+
+//------------------------------------------------------------------------------
+/**
+ * @return  The path of a resource if it is a plain file, an empty string otherwise.
+ */
+static Ogre::String
+getResourceFilePath(const Ogre::String& p_name, const Ogre::String& p_resourceGroup)
+{
+    Ogre::FileInfo fileInfo;
+    if (!findResourceFile(p_name, p_resourceGroup, fileInfo) || fileInfo.archive->getType() != "FileSystem")
+    {
+        return "";
+    }
+    return fileInfo.archive->getName() + "/" + fileInfo.filename;
+}
+
+//------------------------------------------------------------------------------
+/**
+ * Identifies the current version of a video for the stream info cache.
+ * @return  False if the video can not be identified, so it can not be cached.
+ */
+static bool
+getStreamInfoKey(const Ogre::String& p_name, const Ogre::String& p_resourceGroup, bool p_isResource,
+                 StreamInfoKey& p_outKey)
+{
+    if (p_isResource)
+    {
+        Ogre::FileInfo fileInfo;
+        if (!findResourceFile(p_name, p_resourceGroup, fileInfo))
+        {
+            return false;
+        }
+        Ogre::Archive* archive = const_cast<Ogre::Archive*>(fileInfo.archive);
+        p_outKey.path = archive->getName() + "/" + fileInfo.filename;
+        p_outKey.size = fileInfo.uncompressedSize;
+        p_outKey.modifiedTime = archive->getModifiedTime(fileInfo.filename);
+        return true;
+    }
+
+    struct stat fileStat;
+    if (stat(p_name.c_str(), &fileStat) != 0)
+    {
+        return false;
+    }
+    p_outKey.path = p_name;
+    p_outKey.size = fileStat.st_size;
+    p_outKey.modifiedTime = fileStat.st_mtime;
+    return true;
+}
+
+//------------------------------------------------------------------------------
+bool
+getVideoInputKey(const Ogre::String& p_name, const Ogre::String& p_resourceGroup, StreamInfoKey& p_outKey)
+{
+    Ogre::ResourceGroupManager& resourceManager = Ogre::ResourceGroupManager::getSingleton();
+    bool isResource = p_resourceGroup == Ogre::ResourceGroupManager::AUTODETECT_RESOURCE_GROUP_NAME ?
+                      resourceManager.resourceExistsInAnyGroup(p_name) :
+                      resourceManager.resourceExists(p_resourceGroup, p_name);
+    return getStreamInfoKey(p_name, p_resourceGroup, isResource, p_outKey);
+}
+
+//------------------------------------------------------------------------------
+bool
+openVideoInput(const Ogre::String& p_name, const Ogre::String& p_resourceGroup, const InputSettings& p_settings,
+               AVFormatContext*& p_outContext, Ogre::String& p_outError, bool* p_outInfoFromCache)
+{
+    p_outContext = NULL;
+    if (p_outInfoFromCache)
+    {
+        *p_outInfoFromCache = false;
+    }
+
+    // Look for the video in the resource groups
+    Ogre::ResourceGroupManager& resourceManager = Ogre::ResourceGroupManager::getSingleton();
+    bool isResource = p_resourceGroup == Ogre::ResourceGroupManager::AUTODETECT_RESOURCE_GROUP_NAME ?
+                      resourceManager.resourceExistsInAnyGroup(p_name) :
+                      resourceManager.resourceExists(p_resourceGroup, p_name);
+
+    // Map the file if it is one
+    FFmpegInputStream* input = NULL;
+    if (p_settings.mode == IM_MEMORY_MAPPED)
+    {
+        Ogre::String path = isResource ? getResourceFilePath(p_name, p_resourceGroup) : p_name;
+        if (path.length() > 0)
+        {
+            input = new FFmpegInputStream(path, p_settings);
+            if (!input->getIOContext())
+            {
+                delete input;
+                input = NULL;
+            }
+        }
+    }
+
+    // Otherwise stream resources, files that are no resource are opened by FFmpeg itself
+    if (!input && isResource)
+    {
+        Ogre::DataStreamPtr stream;
+        try
+        {
+            stream = resourceManager.openResource(p_name, p_resourceGroup);
+        }
+        catch (Ogre::Exception& e)
+        {
+            p_outError = "Could not open resource: " + p_name + " (" + e.getDescription() + ")";
+            return false;
+        }
+        input = new FFmpegInputStream(stream, p_settings);
+    }
+
+    p_outContext = avformat_alloc_context();
+    if ((input && !input->getIOContext()) || !p_outContext)
+    {
+        p_outError = "Out of memory.";
+        if (p_outContext)
+        {
+            avformat_free_context(p_outContext);
+            p_outContext = NULL;
+        }
+        delete input;
+        return false;
+    }
+    if (input)
+    {
+        p_outContext->pb = input->getIOContext();
+        p_outContext->flags |= AVFMT_FLAG_CUSTOM_IO;
+    }
+
+    // Limit how much is read and decoded to find the streams
+    if (p_settings.probeSize > 0)
+    {
+        p_outContext->probesize = p_settings.probeSize;
+    }
+    if (p_settings.analyzeDuration > 0.0)
+    {
+        p_outContext->max_analyze_duration = (int)(p_settings.analyzeDuration * AV_TIME_BASE);
+    }
+
+    // On failure, the context is freed but the custom IO is left to us
+    if (avformat_open_input(&p_outContext, p_name.c_str(), NULL, NULL) < 0)
+    {
+        p_outError = "Could not open input: " + p_name;
+        delete input;
+        return false;
+    }
+
+    // Probing can be skipped if the streams of this file are known already
+    StreamInfoKey key;
+    bool isCacheable = p_settings.useStreamInfoCache && getStreamInfoKey(p_name, p_resourceGroup, isResource, key);
+    if (isCacheable && FFMPEG_STREAM_INFO_CACHE->applyStreamInfo(key, p_outContext))
+    {
+        if (p_outInfoFromCache)
+        {
+            *p_outInfoFromCache = true;
+        }
+        return true;
+    }
+
+    if (avformat_find_stream_info(p_outContext, NULL) < 0)
+    {
+        p_outError = "Could not find stream information.";
+        closeVideoInput(p_outContext);
+        return false;
+    }
+    if (isCacheable)
+    {
+        FFMPEG_STREAM_INFO_CACHE->storeStreamInfo(key, p_outContext);
+    }
+    return true;
+}
+
+//------------------------------------------------------------------------------
+InputStats
+getVideoInputStats(AVFormatContext* p_context)
+{
+    if (!p_context || !(p_context->flags & AVFMT_FLAG_CUSTOM_IO) || !p_context->pb)
+    {
+        return InputStats();
+    }
+    return ((FFmpegInputStream*)p_context->pb->opaque)->getStats();
+}
+
+//------------------------------------------------------------------------------
+void
+closeVideoInput(AVFormatContext*& p_context)
+{
+    if (!p_context)
+    {
+        return;
+    }
+
+    FFmpegInputStream* input = NULL;
+    if ((p_context->flags & AVFMT_FLAG_CUSTOM_IO) && p_context->pb)
+    {
+        input = (FFmpegInputStream*)p_context->pb->opaque;
+    }
+    avformat_close_input(&p_context);
+    delete input;
+}
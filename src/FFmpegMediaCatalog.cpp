@@ -0,0 +1,470 @@
+/* 
+ * File:   FFmpegMediaCatalog.cpp
+ * Author: TheSHEEEP
+ *
+ * Created on 19. Oktober 2026, 23:05
+ */
+
+#include "FFmpegMediaCatalog.h"
+#include "FFmpegBinaryIO.h"
+
+extern "C"
+{
+    #ifndef INT64_C
+    #define INT64_C(c) (c ## LL)
+    #define UINT64_C(c) (c ## ULL)
+    #endif
+    #include <libavcodec/avcodec.h>
+    #include <libavformat/avformat.h>
+}
+
+#include "FFmpegVideoStreamDecoder.h"
+#include "FFmpegVideoDecodingThread.h"
+
+#include <OgreFileSystem.h>
+#include <OgreLog.h>
+#include <boost/thread.hpp>
+
+// Identifies catalog files, and their layout. Files of another version can not be loaded.
+static const uint32_t sCatalogFileMagic = 0x54414346;
+static const uint32_t sCatalogFileVersion = 1;
+
+// The least bytes an entry and a stream take in the file, with all strings empty and no poster
+static const uint32_t sEntryFileSize = 4 * sizeof(uint32_t) + 2 * sizeof(double) + 9 * sizeof(uint32_t);
+static const uint32_t sStreamFileSize = 2 * sizeof(int32_t) + 3 * sizeof(uint32_t) + 4 * sizeof(uint32_t);
+
+//------------------------------------------------------------------------------
+CatalogEntry::CatalogEntry()
+    : name("")
+    , error("")
+    , duration(0.0)
+    , bitRate(0)
+    , videoCodec("")
+    , videoWidth(0)
+    , videoHeight(0)
+    , frameRate(0.0)
+    , audioCodec("")
+    , audioSampleRate(0)
+    , audioNumChannels(0)
+    , posterWidth(0)
+    , posterHeight(0)
+{
+}
+
+//------------------------------------------------------------------------------
+CatalogScanSettings::CatalogScanSettings()
+    : numThreads(0)
+    , resourceGroup(Ogre::ResourceGroupManager::AUTODETECT_RESOURCE_GROUP_NAME)
+    , extractPoster(false)
+    , posterTime(-1.0)
+    , posterWidth(256)
+{
+}
+
+//------------------------------------------------------------------------------
+FFmpegMediaCatalog::FFmpegMediaCatalog()
+    : _log(NULL)
+    , _scanMutex(NULL)
+    , _nextScanIndex(0)
+{
+    _scanMutex = new boost::mutex();
+}
+
+//------------------------------------------------------------------------------
+FFmpegMediaCatalog::~FFmpegMediaCatalog()
+{
+    delete _scanMutex;
+}
+
+//------------------------------------------------------------------------------
+void
+FFmpegMediaCatalog::setLog(Ogre::Log* p_log)
+{
+    _log = p_log;
+}
+
+//------------------------------------------------------------------------------
+bool
+FFmpegMediaCatalog::scanFiles(const Ogre::StringVector& p_names, const CatalogScanSettings& p_settings)
+{
+    if (p_names.empty())
+    {
+        return true;
+    }
+
+    // The scan threads open codecs at the same time, which needs FFmpeg's lock manager
+    initializeFFmpeg();
+
+    unsigned int numThreads = p_settings.numThreads;
+    if (numThreads == 0)
+    {
+        numThreads = boost::thread::hardware_concurrency();
+        numThreads = numThreads > 0 ? numThreads : 1;
+    }
+    numThreads = numThreads < p_names.size() ? numThreads : p_names.size();
+
+    // Each thread writes the entries of the videos it took, so they need no lock
+    std::vector<CatalogEntry> scannedEntries(p_names.size());
+    _nextScanIndex = 0;
+    boost::thread_group threads;
+    for (unsigned int i = 0; i < numThreads; ++i)
+    {
+        threads.add_thread(new boost::thread(&FFmpegMediaCatalog::scanLoop, this,
+                                             &p_names, &scannedEntries, &p_settings));
+    }
+    threads.join_all();
+
+    bool allScanned = true;
+    for (unsigned int i = 0; i < scannedEntries.size(); ++i)
+    {
+        const CatalogEntry& scanned = scannedEntries[i];
+        if (scanned.error.length() > 0)
+        {
+            allScanned = false;
+            if (_log)
+            {
+                _log->logMessage("Catalog could not scan " + scanned.name + ": " + scanned.error,
+                                 Ogre::LML_CRITICAL);
+            }
+        }
+
+        CatalogEntry* existing = const_cast<CatalogEntry*>(findEntry(scanned.name));
+        if (existing)
+        {
+            *existing = scanned;
+        }
+        else
+        {
+            _entries.push_back(scanned);
+        }
+    }
+    return allScanned;
+}
+
+//------------------------------------------------------------------------------
+bool
+FFmpegMediaCatalog::scanDirectory(const Ogre::String& p_directory, const Ogre::String& p_pattern, bool p_recursive,
+                                  const CatalogScanSettings& p_settings)
+{
+    // A private archive, so directories that are also resource locations are not affected
+    Ogre::StringVector names;
+    try
+    {
+        Ogre::FileSystemArchive archive(p_directory, "FileSystem", true);
+        archive.load();
+        Ogre::StringVectorPtr files = archive.find(p_pattern, p_recursive);
+        for (Ogre::StringVector::const_iterator it = files->begin(); it != files->end(); ++it)
+        {
+            names.push_back(p_directory + "/" + *it);
+        }
+        archive.unload();
+    }
+    catch (Ogre::Exception& e)
+    {
+        if (_log)
+        {
+            _log->logMessage("Catalog could not read directory " + p_directory + ": " + e.getDescription(),
+                             Ogre::LML_CRITICAL);
+        }
+        return false;
+    }
+
+    return scanFiles(names, p_settings);
+}
+
+//------------------------------------------------------------------------------
+const CatalogEntry*
+FFmpegMediaCatalog::findEntry(const Ogre::String& p_name) const
+{
+    for (unsigned int i = 0; i < _entries.size(); ++i)
+    {
+        if (_entries[i].name == p_name)
+        {
+            return &_entries[i];
+        }
+    }
+    return NULL;
+}
+
+//------------------------------------------------------------------------------
+void
+FFmpegMediaCatalog::clear()
+{
+    _entries.clear();
+}
+
+//------------------------------------------------------------------------------
+bool
+FFmpegMediaCatalog::save(const Ogre::String& p_path) const
+{
+    std::ofstream file(p_path.c_str(), std::ios::binary | std::ios::trunc);
+    if (!file.is_open())
+    {
+        return false;
+    }
+
+    writeValue(file, sCatalogFileMagic);
+    writeValue(file, sCatalogFileVersion);
+    writeValue(file, (uint32_t)_entries.size());
+    for (unsigned int i = 0; i < _entries.size(); ++i)
+    {
+        const CatalogEntry& entry = _entries[i];
+        writeString(file, entry.name);
+        writeString(file, entry.error);
+        writeValue(file, entry.duration);
+        writeValue(file, (uint32_t)entry.bitRate);
+        writeString(file, entry.videoCodec);
+        writeValue(file, (uint32_t)entry.videoWidth);
+        writeValue(file, (uint32_t)entry.videoHeight);
+        writeValue(file, entry.frameRate);
+        writeString(file, entry.audioCodec);
+        writeValue(file, (uint32_t)entry.audioSampleRate);
+        writeValue(file, (uint32_t)entry.audioNumChannels);
+
+        writeValue(file, (uint32_t)entry.streams.size());
+        for (unsigned int j = 0; j < entry.streams.size(); ++j)
+        {
+            const StreamInfo& stream = entry.streams[j];
+            writeValue(file, (int32_t)stream.index);
+            writeValue(file, (int32_t)stream.type);
+            writeString(file, stream.codecName);
+            writeString(file, stream.language);
+            writeString(file, stream.title);
+            writeValue(file, (uint32_t)stream.audioSampleRate);
+            writeValue(file, (uint32_t)stream.audioNumChannels);
+            writeValue(file, (uint32_t)stream.videoWidth);
+            writeValue(file, (uint32_t)stream.videoHeight);
+        }
+
+        writeValue(file, (uint32_t)entry.posterWidth);
+        writeValue(file, (uint32_t)entry.posterHeight);
+        writeValue(file, (uint32_t)entry.posterData.size());
+        if (!entry.posterData.empty())
+        {
+            file.write((const char*)&entry.posterData[0], entry.posterData.size());
+        }
+    }
+    return file.good();
+}
+
+//------------------------------------------------------------------------------
+bool
+FFmpegMediaCatalog::load(const Ogre::String& p_path)
+{
+    _entries.clear();
+    std::ifstream file(p_path.c_str(), std::ios::binary);
+    if (!file.is_open())
+    {
+        return false;
+    }
+
+    uint32_t magic = 0;
+    uint32_t version = 0;
+    uint32_t numEntries = 0;
+    if (!readValue(file, magic) || !readValue(file, version) || magic != sCatalogFileMagic
+        || version != sCatalogFileVersion || !readCount(file, numEntries, sEntryFileSize))
+    {
+        return false;
+    }
+
+    // Fixed size values are read as they were written and checked once the entry is complete
+    std::vector<CatalogEntry> entries(numEntries);
+    for (uint32_t i = 0; i < numEntries; ++i)
+    {
+        CatalogEntry& entry = entries[i];
+        uint32_t bitRate = 0;
+        uint32_t videoWidth = 0;
+        uint32_t videoHeight = 0;
+        uint32_t audioSampleRate = 0;
+        uint32_t audioNumChannels = 0;
+        uint32_t numStreams = 0;
+        readString(file, entry.name);
+        readString(file, entry.error);
+        readValue(file, entry.duration);
+        readValue(file, bitRate);
+        readString(file, entry.videoCodec);
+        readValue(file, videoWidth);
+        readValue(file, videoHeight);
+        readValue(file, entry.frameRate);
+        readString(file, entry.audioCodec);
+        readValue(file, audioSampleRate);
+        readValue(file, audioNumChannels);
+        if (!readCount(file, numStreams, sStreamFileSize))
+        {
+            return false;
+        }
+        entry.bitRate = bitRate;
+        entry.videoWidth = videoWidth;
+        entry.videoHeight = videoHeight;
+        entry.audioSampleRate = audioSampleRate;
+        entry.audioNumChannels = audioNumChannels;
+
+        entry.streams.resize(numStreams);
+        for (uint32_t j = 0; j < numStreams; ++j)
+        {
+            StreamInfo& stream = entry.streams[j];
+            int32_t index = 0;
+            int32_t type = 0;
+            uint32_t sampleRate = 0;
+            uint32_t numChannels = 0;
+            uint32_t width = 0;
+            uint32_t height = 0;
+            readValue(file, index);
+            readValue(file, type);
+            readString(file, stream.codecName);
+            readString(file, stream.language);
+            readString(file, stream.title);
+            readValue(file, sampleRate);
+            readValue(file, numChannels);
+            readValue(file, width);
+            if (!readValue(file, height))
+            {
+                return false;
+            }
+            stream.index = index;
+            stream.type = (StreamType)type;
+            stream.audioSampleRate = sampleRate;
+            stream.audioNumChannels = numChannels;
+            stream.videoWidth = width;
+            stream.videoHeight = height;
+        }
+
+        uint32_t posterWidth = 0;
+        uint32_t posterHeight = 0;
+        uint32_t posterSize = 0;
+        readValue(file, posterWidth);
+        readValue(file, posterHeight);
+        if (!readCount(file, posterSize, 1) || (uint64_t)posterSize != (uint64_t)posterWidth * posterHeight * 4)
+        {
+            return false;
+        }
+        entry.posterWidth = posterWidth;
+        entry.posterHeight = posterHeight;
+        entry.posterData.resize(posterSize);
+        if (posterSize > 0)
+        {
+            file.read((char*)&entry.posterData[0], posterSize);
+        }
+        if (!file.good())
+        {
+            return false;
+        }
+    }
+
+    _entries.swap(entries);
+    return true;
+}
+
+//------------------------------------------------------------------------------
+void
+FFmpegMediaCatalog::scanLoop(const Ogre::StringVector* p_names, std::vector<CatalogEntry>* p_outEntries,
+                             const CatalogScanSettings* p_settings)
+{
+    applyDecoderThreadSettings(p_settings->threadSettings, _log, "catalog scanner");
+
+    while (true)
+    {
+        unsigned int index = 0;
+        {
+            boost::mutex::scoped_lock lock(*_scanMutex);
+            if (_nextScanIndex >= p_names->size())
+            {
+                return;
+            }
+            index = _nextScanIndex++;
+        }
+
+        scanVideo((*p_names)[index], *p_settings, (*p_outEntries)[index]);
+    }
+}
+
+//------------------------------------------------------------------------------
+bool
+FFmpegMediaCatalog::scanVideo(const Ogre::String& p_name, const CatalogScanSettings& p_settings,
+                              CatalogEntry& p_outEntry)
+{
+    p_outEntry = CatalogEntry();
+    p_outEntry.name = p_name;
+
+    AVFormatContext* formatContext = NULL;
+    if (!openVideoInput(p_name, p_settings.resourceGroup, p_settings.inputSettings, formatContext, p_outEntry.error))
+    {
+        return false;
+    }
+
+    fillStreamInfos(formatContext, p_outEntry.streams);
+    if (formatContext->duration != AV_NOPTS_VALUE)
+    {
+        p_outEntry.duration = ((double)formatContext->duration) / AV_TIME_BASE;
+    }
+    p_outEntry.bitRate = formatContext->bit_rate > 0 ? formatContext->bit_rate : 0;
+
+    int videoStreamIndex = av_find_best_stream(formatContext, AVMEDIA_TYPE_VIDEO, -1, -1, NULL, 0);
+    if (videoStreamIndex >= 0)
+    {
+        AVStream* stream = formatContext->streams[videoStreamIndex];
+        p_outEntry.videoCodec = avcodec_get_name(stream->codec->codec_id);
+        p_outEntry.videoWidth = stream->codec->width;
+        p_outEntry.videoHeight = stream->codec->height;
+        if (stream->r_frame_rate.num > 0 && stream->r_frame_rate.den > 0)
+        {
+            p_outEntry.frameRate = ((double)stream->r_frame_rate.num) / stream->r_frame_rate.den;
+        }
+    }
+    int audioStreamIndex = av_find_best_stream(formatContext, AVMEDIA_TYPE_AUDIO, -1, videoStreamIndex, NULL, 0);
+    if (audioStreamIndex >= 0)
+    {
+        AVStream* stream = formatContext->streams[audioStreamIndex];
+        p_outEntry.audioCodec = avcodec_get_name(stream->codec->codec_id);
+        p_outEntry.audioSampleRate = stream->codec->sample_rate;
+        p_outEntry.audioNumChannels = stream->codec->channels;
+    }
+    closeVideoInput(formatContext);
+
+    if (!p_settings.extractPoster || videoStreamIndex < 0 || p_outEntry.videoWidth == 0)
+    {
+        return true;
+    }
+
+    // Opening again does not probe again if the stream info cache is used
+    FFmpegVideoStreamDecoder decoder;
+    if (!decoder.open(p_name, p_outEntry.error, p_settings.resourceGroup, p_settings.inputSettings))
+    {
+        return false;
+    }
+    if (p_settings.posterWidth > 0)
+    {
+        unsigned int height = p_settings.posterWidth * p_outEntry.videoHeight / p_outEntry.videoWidth;
+        decoder.setOutputSize(p_settings.posterWidth, height > 0 ? height : 1);
+    }
+
+    double posterTime = p_settings.posterTime >= 0.0 ? p_settings.posterTime : p_outEntry.duration * 0.1;
+    if (posterTime > p_outEntry.duration - decoder.getFrameDuration())
+    {
+        posterTime = p_outEntry.duration - decoder.getFrameDuration();
+    }
+    if (posterTime > 0.0)
+    {
+        decoder.seek(posterTime);
+    }
+
+    // Decode from the keyframe up to the frame that is shown at the poster time
+    VideoFrame* poster = NULL;
+    while (VideoFrame* frame = decoder.decodeNextFrame())
+    {
+        delete poster;
+        poster = frame;
+        if (frame->pts + frame->lifeTime > posterTime)
+        {
+            break;
+        }
+    }
+    if (poster)
+    {
+        p_outEntry.posterWidth = poster->width;
+        p_outEntry.posterHeight = poster->height;
+        p_outEntry.posterData.assign(poster->data, poster->data + poster->dataSize);
+        delete poster;
+    }
+    return true;
+}
@@ -0,0 +1,169 @@
+/* 
+ * File:   FFmpegMemoryBudget.cpp
+ * Author: TheSHEEEP
+ * 
+ * Created on 19. Oktober 2026, 21:30
+ */
+
+#include "FFmpegMemoryBudget.h"
+#include "FFmpegVideoPlayer.h"
+
+#include <algorithm>
+#include <limits>
+
+//------------------------------------------------------------------------------
+MemoryUsage::MemoryUsage()
+    : videoBytes(0)
+    , audioBytes(0)
+    , backupBytes(0)
+    , residentBytes(0)
+    , bufferedTime(0.0)
+{
+}
+
+//------------------------------------------------------------------------------
+// Orders players by how much memory they want, the most modest first
+struct DemandOrder
+{
+    template <typename T>
+    bool operator()(const T* p_a, const T* p_b) const
+    {
+        return p_a->demand < p_b->demand;
+    }
+};
+
+FFmpegMemoryBudget* FFmpegMemoryBudget::_instance = NULL;
+//------------------------------------------------------------------------------
+FFmpegMemoryBudget::FFmpegMemoryBudget()
+    : _budget(0)
+    , _currentUsage(0)
+    , _peakUsage(0)
+{
+}
+
+//------------------------------------------------------------------------------
+FFmpegMemoryBudget::~FFmpegMemoryBudget()
+{
+}
+
+//------------------------------------------------------------------------------
+MemoryUsage
+FFmpegMemoryBudget::getPlayerUsage(const FFmpegVideoPlayer* p_player) const
+{
+    for (unsigned int i = 0; i < _players.size(); ++i)
+    {
+        if (_players[i].player == p_player)
+        {
+            return _players[i].usage;
+        }
+    }
+    return MemoryUsage();
+}
+
+//------------------------------------------------------------------------------
+void
+FFmpegMemoryBudget::registerPlayer(FFmpegVideoPlayer* p_player)
+{
+    PlayerEntry entry;
+    entry.player = p_player;
+    entry.demand = 0;
+    entry.allowance = 0;
+    _players.push_back(entry);
+}
+
+//------------------------------------------------------------------------------
+void
+FFmpegMemoryBudget::unregisterPlayer(FFmpegVideoPlayer* p_player)
+{
+    for (std::vector<PlayerEntry>::iterator it = _players.begin(); it != _players.end(); ++it)
+    {
+        if (it->player == p_player)
+        {
+            _players.erase(it);
+            return;
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+void
+FFmpegMemoryBudget::update()
+{
+    // Measure
+    size_t totalUsage = 0;
+    for (unsigned int i = 0; i < _players.size(); ++i)
+    {
+        PlayerEntry& entry = _players[i];
+        entry.usage = entry.player->getMemoryUsage();
+        totalUsage += entry.usage.getTotal();
+        
+        // Without anything buffered, there is no telling how much the player needs
+        entry.demand = std::numeric_limits<size_t>::max();
+        if (entry.usage.bufferedTime > 0.0)
+        {
+            double bytesPerSecond = (entry.usage.videoBytes + entry.usage.audioBytes) / entry.usage.bufferedTime;
+            entry.demand = entry.usage.backupBytes + entry.usage.residentBytes 
+                           + (size_t)(bytesPerSecond * entry.player->getCurrentBufferTarget());
+        }
+    }
+    _currentUsage = totalUsage;
+    _peakUsage = totalUsage > _peakUsage ? totalUsage : _peakUsage;
+    
+    if (_budget == 0)
+    {
+        for (unsigned int i = 0; i < _players.size(); ++i)
+        {
+            _players[i].player->setMemoryLimit(0);
+        }
+        return;
+    }
+    
+    // Foreground players first. Within a class, everyone gets an even share of what is left,
+    // players that need less than that leave the rest to the others.
+    size_t remaining = _budget;
+    for (int priority = DP_FOREGROUND; priority <= DP_BACKGROUND; ++priority)
+    {
+        std::vector<PlayerEntry*> entries;
+        for (unsigned int i = 0; i < _players.size(); ++i)
+        {
+            if (_players[i].player->getDecodingPriority() == priority)
+            {
+                entries.push_back(&_players[i]);
+            }
+        }
+        std::sort(entries.begin(), entries.end(), DemandOrder());
+        
+        for (unsigned int i = 0; i < entries.size(); ++i)
+        {
+            size_t share = remaining / (entries.size() - i);
+            entries[i]->allowance = entries[i]->demand < share ? entries[i]->demand : share;
+            remaining -= entries[i]->allowance;
+        }
+    }
+    
+    for (unsigned int i = 0; i < _players.size(); ++i)
+    {
+        PlayerEntry& entry = _players[i];
+        
+        // Loop backups and resident clips are needed no matter what, the buffers get the rest.
+        // A limit of at least one byte still lets a single frame through at a time.
+        size_t kept = entry.usage.backupBytes + entry.usage.residentBytes;
+        size_t limit = entry.allowance > kept ? entry.allowance - kept : 1;
+        entry.player->setMemoryLimit(limit);
+        
+        // Background players make room right away instead of waiting for their buffers to drain
+        size_t buffered = entry.usage.videoBytes + entry.usage.audioBytes;
+        if (totalUsage > _budget && buffered > limit && entry.player->getDecodingPriority() == DP_BACKGROUND)
+        {
+            entry.player->trimBuffers(limit);
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+bool
+FFmpegMemoryBudget::frameStarted(const Ogre::FrameEvent& p_evt)
+{
+    update();
+    return true;
+}
@@ -0,0 +1,125 @@
+/* 
+ * File:   FFmpegPlayerRegistry.cpp
+ * Author: TheSHEEEP
+ * 
+ * Created on 19. Oktober 2026, 20:15
+ */
+
+#include "FFmpegPlayerRegistry.h"
+#include "FFmpegVideoPlayer.h"
+
+#include <OgreRoot.h>
+#include <algorithm>
+#include <boost/lexical_cast.hpp>
+
+FFmpegPlayerRegistry* FFmpegPlayerRegistry::_instance = NULL;
+//------------------------------------------------------------------------------
+FFmpegPlayerRegistry::FFmpegPlayerRegistry()
+    : _numCreatedPlayers(0)
+    , _log(NULL)
+{
+}
+
+//------------------------------------------------------------------------------
+FFmpegPlayerRegistry::~FFmpegPlayerRegistry()
+{
+    for (std::map<SourceKey, SharedPlayer>::iterator it = _players.begin(); it != _players.end(); ++it)
+    {
+        destroyPlayer(it->second.player);
+    }
+    _players.clear();
+}
+
+//------------------------------------------------------------------------------
+void
+FFmpegPlayerRegistry::setLog(Ogre::Log* p_log)
+{
+    _log = p_log;
+}
+
+//------------------------------------------------------------------------------
+FFmpegVideoPlayer*
+FFmpegPlayerRegistry::acquirePlayer(const Ogre::String& p_filename, const Ogre::String& p_materialName, 
+                                    const Ogre::String& p_textureUnitName, const Ogre::String& p_clockName)
+{
+    Binding binding(p_materialName, p_textureUnitName);
+    
+    // Another surface already shows this file on this clock
+    SourceKey key(p_filename, p_clockName);
+    std::map<SourceKey, SharedPlayer>::iterator it = _players.find(key);
+    if (it != _players.end())
+    {
+        it->second.player->addMaterialBinding(p_materialName, p_textureUnitName);
+        it->second.bindings.push_back(binding);
+        return it->second.player;
+    }
+    
+    // Each player needs a texture of its own
+    FFmpegVideoPlayer* player = new FFmpegVideoPlayer();
+    player->setLog(_log);
+    player->setVideoFilename(p_filename);
+    player->setVideoTextureName("FFmpegVideoTexture" + boost::lexical_cast<std::string>(++_numCreatedPlayers));
+    player->addMaterialBinding(p_materialName, p_textureUnitName);
+    Ogre::Root::getSingletonPtr()->addFrameListener(player);
+    
+    SharedPlayer& sharedPlayer = _players[key];
+    sharedPlayer.player = player;
+    sharedPlayer.bindings.push_back(binding);
+    
+    if (_log)
+        _log->logMessage("Created shared player for " + p_filename 
+                            + (p_clockName.empty() ? "." : " on clock " + p_clockName + "."));
+    return player;
+}
+
+//------------------------------------------------------------------------------
+void
+FFmpegPlayerRegistry::releasePlayer(FFmpegVideoPlayer* p_player, const Ogre::String& p_materialName, 
+                                    const Ogre::String& p_textureUnitName)
+{
+    for (std::map<SourceKey, SharedPlayer>::iterator it = _players.begin(); it != _players.end(); ++it)
+    {
+        SharedPlayer& sharedPlayer = it->second;
+        if (sharedPlayer.player != p_player)
+        {
+            continue;
+        }
+        
+        // The texture unit keeps showing the video if it was acquired more than once
+        Binding binding(p_materialName, p_textureUnitName);
+        std::vector<Binding>::iterator bindingIt = 
+            std::find(sharedPlayer.bindings.begin(), sharedPlayer.bindings.end(), binding);
+        if (bindingIt == sharedPlayer.bindings.end())
+        {
+            return;
+        }
+        sharedPlayer.bindings.erase(bindingIt);
+        if (std::find(sharedPlayer.bindings.begin(), sharedPlayer.bindings.end(), binding) 
+            == sharedPlayer.bindings.end())
+        {
+            p_player->removeMaterialBinding(p_materialName, p_textureUnitName);
+        }
+        
+        // Nobody shows the video anymore
+        if (sharedPlayer.bindings.empty())
+        {
+            if (_log)
+                _log->logMessage("Destroying shared player for " + it->first.first + ".");
+            destroyPlayer(p_player);
+            _players.erase(it);
+        }
+        return;
+    }
+}
+
+//------------------------------------------------------------------------------
+void
+FFmpegPlayerRegistry::destroyPlayer(FFmpegVideoPlayer* p_player)
+{
+    Ogre::Root::getSingletonPtr()->removeFrameListener(p_player);
+    if (p_player->getIsPlaying() || p_player->getIsWaitingForBuffers())
+    {
+        p_player->stopVideo();
+    }
+    delete p_player;
+}
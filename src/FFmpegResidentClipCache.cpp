@@ -0,0 +1,247 @@
+/* 
+ * File:   FFmpegResidentClipCache.cpp
+ * Author: TheSHEEEP
+ *
+ * Created on 20. Oktober 2026, 00:10
+ */
+
+#include "FFmpegResidentClipCache.h"
+
+//------------------------------------------------------------------------------
+const VideoFrame*
+FrameClip::findFrameForTime(const std::vector<VideoFrame*>& p_frames, double p_time)
+{
+    if (p_frames.empty())
+    {
+        return NULL;
+    }
+
+    // The last frame that started at or before that time
+    unsigned int first = 0;
+    unsigned int last = p_frames.size() - 1;
+    while (first < last)
+    {
+        unsigned int middle = (first + last + 1) / 2;
+        if (p_frames[middle]->pts <= p_time)
+        {
+            first = middle;
+        }
+        else
+        {
+            last = middle - 1;
+        }
+    }
+    return p_frames[first];
+}
+
+//------------------------------------------------------------------------------
+ResidentClip::ResidentClip(size_t p_maxBytes)
+    : _bytes(0)
+    , _maxBytes(p_maxBytes)
+    , _isComplete(false)
+    , _isBroken(false)
+{
+}
+
+//------------------------------------------------------------------------------
+ResidentClip::~ResidentClip()
+{
+    for (unsigned int i = 0; i < _videoFrames.size(); ++i)
+    {
+        delete _videoFrames[i];
+    }
+    for (unsigned int i = 0; i < _audioFrames.size(); ++i)
+    {
+        delete _audioFrames[i];
+    }
+}
+
+//------------------------------------------------------------------------------
+bool
+ResidentClip::addVideoFrame(const VideoFrame& p_frame)
+{
+    if (_isComplete || _isBroken)
+    {
+        return false;
+    }
+
+    // The clip must start at the start of the video and may not skip frames,
+    // a frame lasting one and a half times as long as it should is the most that is tolerated
+    const VideoFrame* last = _videoFrames.empty() ? NULL : _videoFrames.back();
+    if (last && p_frame.pts <= last->pts)
+    {
+        return true;
+    }
+    double expectedPts = last ? last->pts + last->lifeTime : 0.0;
+    double lifeTime = last ? last->lifeTime : p_frame.lifeTime;
+    if (p_frame.pts > expectedPts + lifeTime * 0.5 || _bytes + p_frame.dataSize > _maxBytes)
+    {
+        _isBroken = true;
+        return false;
+    }
+
+    _videoFrames.push_back(new VideoFrame(p_frame));
+    _bytes += p_frame.dataSize;
+    return true;
+}
+
+//------------------------------------------------------------------------------
+bool
+ResidentClip::addAudioFrame(const AudioFrame& p_frame)
+{
+    if (_isComplete || _isBroken)
+    {
+        return false;
+    }
+    if (_bytes + p_frame.dataSize > _maxBytes)
+    {
+        _isBroken = true;
+        return false;
+    }
+
+    _audioFrames.push_back(new AudioFrame(p_frame));
+    _bytes += p_frame.dataSize;
+    return true;
+}
+
+//------------------------------------------------------------------------------
+bool
+ResidentClip::complete(const VideoInfo& p_videoInfo)
+{
+    if (_isBroken || _videoFrames.empty())
+    {
+        return false;
+    }
+
+    _videoInfo = p_videoInfo;
+    _isComplete = true;
+    return true;
+}
+
+//------------------------------------------------------------------------------
+bool
+ResidentClip::getIsComplete() const
+{
+    return _isComplete;
+}
+
+//------------------------------------------------------------------------------
+const VideoFrame*
+ResidentClip::getFrameForTime(double p_time) const
+{
+    return findFrameForTime(_videoFrames, p_time);
+}
+
+//------------------------------------------------------------------------------
+unsigned int
+ResidentClip::getNumAudioFrames() const
+{
+    return _audioFrames.size();
+}
+
+//------------------------------------------------------------------------------
+const AudioFrame*
+ResidentClip::getAudioFrame(unsigned int p_index) const
+{
+    return _audioFrames[p_index];
+}
+
+//------------------------------------------------------------------------------
+double
+ResidentClip::getDuration() const
+{
+    return _videoInfo.longerDuration;
+}
+
+//------------------------------------------------------------------------------
+const VideoInfo&
+ResidentClip::getVideoInfo() const
+{
+    return _videoInfo;
+}
+
+//------------------------------------------------------------------------------
+size_t
+ResidentClip::getBytes() const
+{
+    return _bytes;
+}
+
+FFmpegResidentClipCache* FFmpegResidentClipCache::_instance = NULL;
+//------------------------------------------------------------------------------
+FFmpegResidentClipCache::FFmpegResidentClipCache()
+{
+}
+
+//------------------------------------------------------------------------------
+FFmpegResidentClipCache::~FFmpegResidentClipCache()
+{
+}
+
+//------------------------------------------------------------------------------
+ResidentClipPtr
+FFmpegResidentClipCache::findClip(const Ogre::String& p_key)
+{
+    std::map<Ogre::String, boost::weak_ptr<ResidentClip> >::iterator it = _clips.find(p_key);
+    if (it == _clips.end())
+    {
+        return ResidentClipPtr();
+    }
+
+    ResidentClipPtr clip = it->second.lock();
+    if (!clip)
+    {
+        _clips.erase(it);
+    }
+    return clip;
+}
+
+//------------------------------------------------------------------------------
+void
+FFmpegResidentClipCache::addClip(const Ogre::String& p_key, const ResidentClipPtr& p_clip)
+{
+    if (p_clip && p_clip->getIsComplete())
+    {
+        _clips[p_key] = p_clip;
+    }
+}
+
+//------------------------------------------------------------------------------
+unsigned int
+FFmpegResidentClipCache::getNumClips()
+{
+    removeExpiredClips();
+    return _clips.size();
+}
+
+//------------------------------------------------------------------------------
+size_t
+FFmpegResidentClipCache::getBytes()
+{
+    removeExpiredClips();
+    size_t bytes = 0;
+    for (std::map<Ogre::String, boost::weak_ptr<ResidentClip> >::iterator it = _clips.begin(); it != _clips.end(); ++it)
+    {
+        ResidentClipPtr clip = it->second.lock();
+        bytes += clip ? clip->getBytes() : 0;
+    }
+    return bytes;
+}
+
+//------------------------------------------------------------------------------
+void
+FFmpegResidentClipCache::removeExpiredClips()
+{
+    std::map<Ogre::String, boost::weak_ptr<ResidentClip> >::iterator it = _clips.begin();
+    while (it != _clips.end())
+    {
+        if (it->second.expired())
+        {
+            _clips.erase(it++);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+}
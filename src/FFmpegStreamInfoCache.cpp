@@ -0,0 +1,350 @@
+/* 
+ * File:   FFmpegStreamInfoCache.cpp
+ * Author: TheSHEEEP
+ *
+ * Created on 19. Oktober 2026, 22:20
+ */
+
+#include "FFmpegStreamInfoCache.h"
+#include "FFmpegBinaryIO.h"
+
+extern "C"
+{
+    #ifndef INT64_C
+    #define INT64_C(c) (c ## LL)
+    #define UINT64_C(c) (c ## ULL)
+    #endif
+    #include <libavcodec/avcodec.h>
+    #include <libavformat/avformat.h>
+}
+
+#include <boost/thread.hpp>
+#include <cstring>
+
+// Identifies cache files, and their layout. Files of another version are ignored.
+static const uint32_t sCacheFileMagic = 0x43495346;
+static const uint32_t sCacheFileVersion = 1;
+
+// The fixed size part of a stream in the file, the extradata follows it
+static const uint32_t sStreamFileSize = 10 * sizeof(int32_t) + sizeof(uint64_t) + 8 * sizeof(int32_t)
+                                        + 2 * sizeof(int64_t) + sizeof(uint32_t);
+
+//------------------------------------------------------------------------------
+StreamInfoKey::StreamInfoKey()
+    : size(0)
+    , modifiedTime(0)
+{
+}
+
+FFmpegStreamInfoCache* FFmpegStreamInfoCache::_instance = NULL;
+//------------------------------------------------------------------------------
+FFmpegStreamInfoCache::FFmpegStreamInfoCache()
+    : _isDirty(false)
+    , _numHits(0)
+    , _numMisses(0)
+    , _mutex(NULL)
+{
+    _mutex = new boost::mutex();
+}
+
+//------------------------------------------------------------------------------
+FFmpegStreamInfoCache::~FFmpegStreamInfoCache()
+{
+    delete _mutex;
+}
+
+//------------------------------------------------------------------------------
+bool
+FFmpegStreamInfoCache::setCacheFile(const Ogre::String& p_path)
+{
+    boost::mutex::scoped_lock lock(*_mutex);
+    _cacheFile = p_path;
+    return _cacheFile.length() > 0 ? load() : true;
+}
+
+//------------------------------------------------------------------------------
+bool
+FFmpegStreamInfoCache::save()
+{
+    boost::mutex::scoped_lock lock(*_mutex);
+    if (_cacheFile.length() == 0 || !_isDirty)
+    {
+        return true;
+    }
+
+    std::ofstream file(_cacheFile.c_str(), std::ios::binary | std::ios::trunc);
+    if (!file.is_open())
+    {
+        return false;
+    }
+    writeValue(file, sCacheFileMagic);
+    writeValue(file, sCacheFileVersion);
+    writeValue(file, (uint32_t)_entries.size());
+    for (std::map<Ogre::String, CacheEntry>::const_iterator it = _entries.begin(); it != _entries.end(); ++it)
+    {
+        const CacheEntry& entry = it->second;
+        writeBytes(file, it->first.c_str(), it->first.length());
+        writeValue(file, entry.size);
+        writeValue(file, entry.modifiedTime);
+        writeValue(file, entry.startTime);
+        writeValue(file, entry.duration);
+        writeValue(file, (uint32_t)entry.streams.size());
+        for (unsigned int i = 0; i < entry.streams.size(); ++i)
+        {
+            // Everything but the extradata has a fixed size
+            const CachedStream& stream = entry.streams[i];
+            writeValue(file, stream.codecType);
+            writeValue(file, stream.codecId);
+            writeValue(file, stream.codecTag);
+            writeValue(file, stream.width);
+            writeValue(file, stream.height);
+            writeValue(file, stream.pixelFormat);
+            writeValue(file, stream.sampleRate);
+            writeValue(file, stream.numChannels);
+            writeValue(file, stream.channelLayout);
+            writeValue(file, stream.sampleFormat);
+            writeValue(file, stream.bitRate);
+            writeValue(file, stream.codecTimeBase);
+            writeValue(file, stream.timeBase);
+            writeValue(file, stream.realFrameRate);
+            writeValue(file, stream.averageFrameRate);
+            writeValue(file, stream.startTime);
+            writeValue(file, stream.duration);
+            writeBytes(file, stream.extradata.empty() ? NULL : &stream.extradata[0], stream.extradata.size());
+        }
+    }
+    if (!file.good())
+    {
+        return false;
+    }
+    _isDirty = false;
+    return true;
+}
+
+//------------------------------------------------------------------------------
+bool
+FFmpegStreamInfoCache::load()
+{
+    std::ifstream file(_cacheFile.c_str(), std::ios::binary);
+    if (!file.is_open())
+    {
+        return true;
+    }
+
+    uint32_t magic = 0;
+    uint32_t version = 0;
+    uint32_t numEntries = 0;
+    if (!readValue(file, magic) || !readValue(file, version) || magic != sCacheFileMagic
+        || version != sCacheFileVersion || !readValue(file, numEntries))
+    {
+        return false;
+    }
+
+    // A broken file loses only the entries after the broken one
+    for (uint32_t i = 0; i < numEntries; ++i)
+    {
+        std::vector<uint8_t> path;
+        CacheEntry entry;
+        uint32_t numStreams = 0;
+        if (!readBytes(file, path) || !readValue(file, entry.size) || !readValue(file, entry.modifiedTime)
+            || !readValue(file, entry.startTime) || !readValue(file, entry.duration)
+            || !readCount(file, numStreams, sStreamFileSize))
+        {
+            return false;
+        }
+        entry.streams.resize(numStreams);
+        for (uint32_t j = 0; j < numStreams; ++j)
+        {
+            CachedStream& stream = entry.streams[j];
+            if (!readValue(file, stream.codecType) || !readValue(file, stream.codecId)
+                || !readValue(file, stream.codecTag) || !readValue(file, stream.width)
+                || !readValue(file, stream.height) || !readValue(file, stream.pixelFormat)
+                || !readValue(file, stream.sampleRate) || !readValue(file, stream.numChannels)
+                || !readValue(file, stream.channelLayout) || !readValue(file, stream.sampleFormat)
+                || !readValue(file, stream.bitRate) || !readValue(file, stream.codecTimeBase)
+                || !readValue(file, stream.timeBase) || !readValue(file, stream.realFrameRate)
+                || !readValue(file, stream.averageFrameRate) || !readValue(file, stream.startTime)
+                || !readValue(file, stream.duration) || !readBytes(file, stream.extradata))
+            {
+                return false;
+            }
+        }
+        Ogre::String key = path.empty() ? "" : Ogre::String((const char*)&path[0], path.size());
+        _entries[key] = entry;
+    }
+    return true;
+}
+
+//------------------------------------------------------------------------------
+bool
+FFmpegStreamInfoCache::applyStreamInfo(const StreamInfoKey& p_key, AVFormatContext* p_formatContext)
+{
+    boost::mutex::scoped_lock lock(*_mutex);
+    std::map<Ogre::String, CacheEntry>::const_iterator it = _entries.find(p_key.path);
+    if (it == _entries.end() || it->second.size != p_key.size || it->second.modifiedTime != p_key.modifiedTime)
+    {
+        ++_numMisses;
+        return false;
+    }
+
+    // The streams the demuxer found in the header must be the ones that were cached,
+    // formats without a header have no streams before probing
+    const CacheEntry& entry = it->second;
+    if (entry.streams.size() != p_formatContext->nb_streams)
+    {
+        ++_numMisses;
+        return false;
+    }
+    for (unsigned int i = 0; i < p_formatContext->nb_streams; ++i)
+    {
+        AVCodecContext* codecContext = p_formatContext->streams[i]->codec;
+        const CachedStream& stream = entry.streams[i];
+        if (codecContext->codec_type != stream.codecType
+            || (codecContext->codec_id != AV_CODEC_ID_NONE && codecContext->codec_id != stream.codecId))
+        {
+            ++_numMisses;
+            return false;
+        }
+    }
+
+    // Only fill in what the header did not tell
+    for (unsigned int i = 0; i < p_formatContext->nb_streams; ++i)
+    {
+        AVStream* avStream = p_formatContext->streams[i];
+        AVCodecContext* codecContext = avStream->codec;
+        const CachedStream& stream = entry.streams[i];
+
+        codecContext->codec_id = (AVCodecID)stream.codecId;
+        codecContext->codec_tag = codecContext->codec_tag ? codecContext->codec_tag : stream.codecTag;
+        codecContext->width = codecContext->width ? codecContext->width : stream.width;
+        codecContext->height = codecContext->height ? codecContext->height : stream.height;
+        codecContext->pix_fmt = codecContext->pix_fmt != PIX_FMT_NONE ? codecContext->pix_fmt
+                                                                      : (PixelFormat)stream.pixelFormat;
+        codecContext->sample_rate = codecContext->sample_rate ? codecContext->sample_rate : stream.sampleRate;
+        codecContext->channels = codecContext->channels ? codecContext->channels : stream.numChannels;
+        codecContext->channel_layout = codecContext->channel_layout ? codecContext->channel_layout
+                                                                    : stream.channelLayout;
+        codecContext->sample_fmt = codecContext->sample_fmt != AV_SAMPLE_FMT_NONE ? codecContext->sample_fmt
+                                                                                  : (AVSampleFormat)stream.sampleFormat;
+        codecContext->bit_rate = codecContext->bit_rate ? codecContext->bit_rate : stream.bitRate;
+        if (codecContext->time_base.num == 0)
+        {
+            codecContext->time_base.num = stream.codecTimeBase.num;
+            codecContext->time_base.den = stream.codecTimeBase.den;
+        }
+        if (!codecContext->extradata && !stream.extradata.empty())
+        {
+            codecContext->extradata = (uint8_t*)av_mallocz(stream.extradata.size() + FF_INPUT_BUFFER_PADDING_SIZE);
+            if (codecContext->extradata)
+            {
+                memcpy(codecContext->extradata, &stream.extradata[0], stream.extradata.size());
+                codecContext->extradata_size = stream.extradata.size();
+            }
+        }
+
+        if (avStream->time_base.num == 0)
+        {
+            avStream->time_base.num = stream.timeBase.num;
+            avStream->time_base.den = stream.timeBase.den;
+        }
+        if (avStream->r_frame_rate.num == 0)
+        {
+            avStream->r_frame_rate.num = stream.realFrameRate.num;
+            avStream->r_frame_rate.den = stream.realFrameRate.den;
+        }
+        if (avStream->avg_frame_rate.num == 0)
+        {
+            avStream->avg_frame_rate.num = stream.averageFrameRate.num;
+            avStream->avg_frame_rate.den = stream.averageFrameRate.den;
+        }
+        avStream->start_time = avStream->start_time != AV_NOPTS_VALUE ? avStream->start_time : stream.startTime;
+        avStream->duration = avStream->duration != AV_NOPTS_VALUE ? avStream->duration : stream.duration;
+    }
+    p_formatContext->start_time = p_formatContext->start_time != AV_NOPTS_VALUE ? p_formatContext->start_time
+                                                                                : entry.startTime;
+    p_formatContext->duration = p_formatContext->duration != AV_NOPTS_VALUE ? p_formatContext->duration
+                                                                            : entry.duration;
+    ++_numHits;
+    return true;
+}
+
+//------------------------------------------------------------------------------
+void
+FFmpegStreamInfoCache::storeStreamInfo(const StreamInfoKey& p_key, AVFormatContext* p_formatContext)
+{
+    CacheEntry entry;
+    entry.size = p_key.size;
+    entry.modifiedTime = p_key.modifiedTime;
+    entry.startTime = p_formatContext->start_time;
+    entry.duration = p_formatContext->duration;
+    entry.streams.resize(p_formatContext->nb_streams);
+    for (unsigned int i = 0; i < p_formatContext->nb_streams; ++i)
+    {
+        AVStream* avStream = p_formatContext->streams[i];
+        AVCodecContext* codecContext = avStream->codec;
+        CachedStream& stream = entry.streams[i];
+
+        stream.codecType = codecContext->codec_type;
+        stream.codecId = codecContext->codec_id;
+        stream.codecTag = codecContext->codec_tag;
+        stream.width = codecContext->width;
+        stream.height = codecContext->height;
+        stream.pixelFormat = codecContext->pix_fmt;
+        stream.sampleRate = codecContext->sample_rate;
+        stream.numChannels = codecContext->channels;
+        stream.channelLayout = codecContext->channel_layout;
+        stream.sampleFormat = codecContext->sample_fmt;
+        stream.bitRate = codecContext->bit_rate;
+        stream.codecTimeBase.num = codecContext->time_base.num;
+        stream.codecTimeBase.den = codecContext->time_base.den;
+        stream.timeBase.num = avStream->time_base.num;
+        stream.timeBase.den = avStream->time_base.den;
+        stream.realFrameRate.num = avStream->r_frame_rate.num;
+        stream.realFrameRate.den = avStream->r_frame_rate.den;
+        stream.averageFrameRate.num = avStream->avg_frame_rate.num;
+        stream.averageFrameRate.den = avStream->avg_frame_rate.den;
+        stream.startTime = avStream->start_time;
+        stream.duration = avStream->duration;
+        if (codecContext->extradata && codecContext->extradata_size > 0)
+        {
+            stream.extradata.assign(codecContext->extradata, codecContext->extradata + codecContext->extradata_size);
+        }
+    }
+
+    boost::mutex::scoped_lock lock(*_mutex);
+    _entries[p_key.path] = entry;
+    _isDirty = true;
+}
+
+//------------------------------------------------------------------------------
+void
+FFmpegStreamInfoCache::clear()
+{
+    boost::mutex::scoped_lock lock(*_mutex);
+    _isDirty = _isDirty || !_entries.empty();
+    _entries.clear();
+}
+
+//------------------------------------------------------------------------------
+unsigned int
+FFmpegStreamInfoCache::getNumEntries() const
+{
+    boost::mutex::scoped_lock lock(*_mutex);
+    return _entries.size();
+}
+
+//------------------------------------------------------------------------------
+unsigned int
+FFmpegStreamInfoCache::getNumHits() const
+{
+    boost::mutex::scoped_lock lock(*_mutex);
+    return _numHits;
+}
+
+//------------------------------------------------------------------------------
+unsigned int
+FFmpegStreamInfoCache::getNumMisses() const
+{
+    boost::mutex::scoped_lock lock(*_mutex);
+    return _numMisses;
+}
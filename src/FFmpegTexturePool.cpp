@@ -0,0 +1,215 @@
+/* 
+ * File:   FFmpegTexturePool.cpp
+ * Author: TheSHEEEP
+ *
+ * Created on 19. Oktober 2026, 21:30
+ */
+
+#include "FFmpegTexturePool.h"
+
+#include <OgreTextureManager.h>
+#include <OgreResourceGroupManager.h>
+#include <OgreLog.h>
+#include <boost/lexical_cast.hpp>
+
+//------------------------------------------------------------------------------
+TexturePoolStats::TexturePoolStats()
+    : numHits(0)
+    , numMisses(0)
+    , numFreeTextures(0)
+    , numUsedTextures(0)
+{
+}
+
+//------------------------------------------------------------------------------
+bool
+FFmpegTexturePool::TextureKey::operator<(const TextureKey& p_other) const
+{
+    if (width != p_other.width)
+    {
+        return width < p_other.width;
+    }
+    if (height != p_other.height)
+    {
+        return height < p_other.height;
+    }
+    return format < p_other.format;
+}
+
+FFmpegTexturePool* FFmpegTexturePool::_instance = NULL;
+//------------------------------------------------------------------------------
+FFmpegTexturePool::FFmpegTexturePool()
+    : _maxFreeTextures(8)
+    , _numCreatedTextures(0)
+    , _releaseSerial(0)
+    , _log(NULL)
+{
+}
+
+//------------------------------------------------------------------------------
+FFmpegTexturePool::~FFmpegTexturePool()
+{
+    clear();
+}
+
+//------------------------------------------------------------------------------
+void
+FFmpegTexturePool::setLog(Ogre::Log* p_log)
+{
+    _log = p_log;
+}
+
+//------------------------------------------------------------------------------
+void
+FFmpegTexturePool::preallocate(unsigned int p_width, unsigned int p_height, Ogre::PixelFormat p_format,
+                               unsigned int p_numTextures)
+{
+    TextureKey key;
+    key.width = p_width;
+    key.height = p_height;
+    key.format = p_format;
+    for (unsigned int i = 0; i < p_numTextures; ++i)
+    {
+        FreeTexture freeTexture;
+        freeTexture.texture = createTexture(key);
+        freeTexture.releaseSerial = _releaseSerial++;
+        _freeTextures.insert(std::make_pair(key, freeTexture));
+    }
+
+    // Preallocated textures are meant to be kept
+    if (_freeTextures.size() > _maxFreeTextures)
+    {
+        _maxFreeTextures = _freeTextures.size();
+    }
+}
+
+//------------------------------------------------------------------------------
+Ogre::TexturePtr
+FFmpegTexturePool::acquireTexture(unsigned int p_width, unsigned int p_height, Ogre::PixelFormat p_format)
+{
+    TextureKey key;
+    key.width = p_width;
+    key.height = p_height;
+    key.format = p_format;
+
+    ++_stats.numUsedTextures;
+    FreeTextureMap::iterator it = _freeTextures.find(key);
+    if (it != _freeTextures.end())
+    {
+        ++_stats.numHits;
+        Ogre::TexturePtr texture = it->second.texture;
+        _freeTextures.erase(it);
+        return texture;
+    }
+
+    ++_stats.numMisses;
+    return createTexture(key);
+}
+
+//------------------------------------------------------------------------------
+void
+FFmpegTexturePool::releaseTexture(const Ogre::TexturePtr& p_texture)
+{
+    if (p_texture.isNull())
+    {
+        return;
+    }
+
+    TextureKey key;
+    key.width = p_texture->getWidth();
+    key.height = p_texture->getHeight();
+    key.format = p_texture->getFormat();
+
+    FreeTexture freeTexture;
+    freeTexture.texture = p_texture;
+    freeTexture.releaseSerial = _releaseSerial++;
+    _freeTextures.insert(std::make_pair(key, freeTexture));
+    if (_stats.numUsedTextures > 0)
+    {
+        --_stats.numUsedTextures;
+    }
+
+    trimFreeTextures();
+}
+
+//------------------------------------------------------------------------------
+void
+FFmpegTexturePool::setMaxFreeTextures(unsigned int p_maxFreeTextures)
+{
+    _maxFreeTextures = p_maxFreeTextures;
+    trimFreeTextures();
+}
+
+//------------------------------------------------------------------------------
+void
+FFmpegTexturePool::clear()
+{
+    // Nothing to remove from if Ogre is shut down already
+    Ogre::TextureManager* textureManager = Ogre::TextureManager::getSingletonPtr();
+    for (FreeTextureMap::iterator it = _freeTextures.begin(); it != _freeTextures.end(); ++it)
+    {
+        if (textureManager)
+        {
+            textureManager->remove(it->second.texture->getName());
+        }
+    }
+    _freeTextures.clear();
+}
+
+//------------------------------------------------------------------------------
+TexturePoolStats
+FFmpegTexturePool::getStats() const
+{
+    TexturePoolStats stats = _stats;
+    stats.numFreeTextures = _freeTextures.size();
+    return stats;
+}
+
+//------------------------------------------------------------------------------
+void
+FFmpegTexturePool::resetStats()
+{
+    _stats.numHits = 0;
+    _stats.numMisses = 0;
+}
+
+//------------------------------------------------------------------------------
+Ogre::TexturePtr
+FFmpegTexturePool::createTexture(const TextureKey& p_key)
+{
+    Ogre::String name = "FFmpegPooledTexture" + boost::lexical_cast<Ogre::String>(_numCreatedTextures++);
+    if (_log)
+    {
+        _log->logMessage("Texture pool creates " + name + " with size "
+                         + boost::lexical_cast<Ogre::String>(p_key.width) + "x"
+                         + boost::lexical_cast<Ogre::String>(p_key.height) + ".");
+    }
+
+    return Ogre::TextureManager::getSingleton().createManual(
+                name,
+                Ogre::ResourceGroupManager::DEFAULT_RESOURCE_GROUP_NAME,
+                Ogre::TEX_TYPE_2D,
+                p_key.width, p_key.height,
+                0,
+                p_key.format,
+                Ogre::TU_DYNAMIC_WRITE_ONLY_DISCARDABLE);
+}
+
+//------------------------------------------------------------------------------
+void
+FFmpegTexturePool::trimFreeTextures()
+{
+    while (_freeTextures.size() > _maxFreeTextures)
+    {
+        FreeTextureMap::iterator oldest = _freeTextures.begin();
+        for (FreeTextureMap::iterator it = _freeTextures.begin(); it != _freeTextures.end(); ++it)
+        {
+            if (it->second.releaseSerial < oldest->second.releaseSerial)
+            {
+                oldest = it;
+            }
+        }
+        Ogre::TextureManager::getSingleton().remove(oldest->second.texture->getName());
+        _freeTextures.erase(oldest);
+    }
+}
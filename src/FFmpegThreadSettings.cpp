@@ -0,0 +1,192 @@
+/* 
+ * File:   FFmpegThreadSettings.cpp
+ * Author: TheSHEEEP
+ * 
+ * Created on 19. Oktober 2026, 17:55
+ */
+
+#include "FFmpegThreadSettings.h"
+
+#include <OgreLog.h>
+#include <boost/thread.hpp>
+#include <boost/lexical_cast.hpp>
+
+#if OGRE_PLATFORM == OGRE_PLATFORM_LINUX
+#   include <pthread.h>
+#   include <sched.h>
+#   include <sys/resource.h>
+#   include <sys/syscall.h>
+#   include <unistd.h>
+#elif OGRE_PLATFORM == OGRE_PLATFORM_WIN32 || OGRE_PLATFORM == OGRE_PLATFORM_WINRT
+#   include <windows.h>
+#endif
+
+//------------------------------------------------------------------------------
+DecoderThreadSettings::DecoderThreadSettings()
+    : affinityMask(0)
+    , niceValue(0)
+    , maxCores(0)
+{
+}
+
+//------------------------------------------------------------------------------
+// Combines the affinity mask and the core limit. 0 means the affinity is not changed.
+static uint64_t getEffectiveAffinityMask(const DecoderThreadSettings& p_settings)
+{
+    if (p_settings.affinityMask == 0 && p_settings.maxCores == 0)
+    {
+        return 0;
+    }
+    
+    // Without a mask, all cores are allowed
+    uint64_t mask = p_settings.affinityMask;
+    if (mask == 0)
+    {
+        unsigned int numCores = boost::thread::hardware_concurrency();
+        mask = numCores >= 64 ? ~(uint64_t)0 : (((uint64_t)1 << numCores) - 1);
+    }
+    
+    // Keep the lowest maxCores cores of the mask
+    if (p_settings.maxCores > 0)
+    {
+        unsigned int numKept = 0;
+        for (unsigned int i = 0; i < 64; ++i)
+        {
+            uint64_t bit = (uint64_t)1 << i;
+            if (mask & bit)
+            {
+                if (numKept < p_settings.maxCores)
+                {
+                    ++numKept;
+                }
+                else
+                {
+                    mask &= ~bit;
+                }
+            }
+        }
+    }
+    
+    return mask;
+}
+
+//------------------------------------------------------------------------------
+// Lists the cores of a mask for the log
+static Ogre::String describeCores(uint64_t p_mask)
+{
+    Ogre::String cores = "";
+    for (unsigned int i = 0; i < 64; ++i)
+    {
+        if (p_mask & ((uint64_t)1 << i))
+        {
+            cores += (cores.empty() ? "" : ",") + boost::lexical_cast<std::string>(i);
+        }
+    }
+    return cores;
+}
+
+//------------------------------------------------------------------------------
+bool applyDecoderThreadSettings(const DecoderThreadSettings& p_settings, Ogre::Log* p_log, const char* p_name)
+{
+    bool success = true;
+    uint64_t mask = getEffectiveAffinityMask(p_settings);
+    uint64_t effectiveMask = 0;
+    int effectiveNice = 0;
+    
+#if OGRE_PLATFORM == OGRE_PLATFORM_LINUX
+    // Affinity
+    if (mask != 0)
+    {
+        cpu_set_t cpuSet;
+        CPU_ZERO(&cpuSet);
+        for (unsigned int i = 0; i < 64; ++i)
+        {
+            if (mask & ((uint64_t)1 << i))
+            {
+                CPU_SET(i, &cpuSet);
+            }
+        }
+        success = pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpuSet) == 0 && success;
+    }
+    
+    // The nice value is per thread on Linux
+    pid_t threadId = (pid_t)syscall(SYS_gettid);
+    if (p_settings.niceValue != 0)
+    {
+        success = setpriority(PRIO_PROCESS, threadId, p_settings.niceValue) == 0 && success;
+    }
+    
+    // Read back what we actually got
+    cpu_set_t effectiveSet;
+    CPU_ZERO(&effectiveSet);
+    if (pthread_getaffinity_np(pthread_self(), sizeof(cpu_set_t), &effectiveSet) == 0)
+    {
+        for (unsigned int i = 0; i < 64; ++i)
+        {
+            if (CPU_ISSET(i, &effectiveSet))
+            {
+                effectiveMask |= (uint64_t)1 << i;
+            }
+        }
+    }
+    effectiveNice = getpriority(PRIO_PROCESS, threadId);
+    
+#elif OGRE_PLATFORM == OGRE_PLATFORM_WIN32 || OGRE_PLATFORM == OGRE_PLATFORM_WINRT
+    // Affinity. Windows can only tell us the previous mask, so we log the new one if it worked.
+    if (mask != 0)
+    {
+        if (SetThreadAffinityMask(GetCurrentThread(), (DWORD_PTR)mask) != 0)
+        {
+            effectiveMask = mask;
+        }
+        else
+        {
+            success = false;
+        }
+    }
+    
+    // Map the nice value to the closest thread priority
+    if (p_settings.niceValue != 0)
+    {
+        int priority = THREAD_PRIORITY_NORMAL;
+        if (p_settings.niceValue <= -15)        priority = THREAD_PRIORITY_HIGHEST;
+        else if (p_settings.niceValue <= -5)    priority = THREAD_PRIORITY_ABOVE_NORMAL;
+        else if (p_settings.niceValue >= 15)    priority = THREAD_PRIORITY_LOWEST;
+        else if (p_settings.niceValue >= 5)     priority = THREAD_PRIORITY_BELOW_NORMAL;
+        success = SetThreadPriority(GetCurrentThread(), priority) != 0 && success;
+    }
+    effectiveNice = -5 * GetThreadPriority(GetCurrentThread());
+    
+#else
+    // No per thread affinity or priority here
+    success = mask == 0 && p_settings.niceValue == 0;
+#endif
+    
+    // Log the effective placement
+    if (p_log)
+    {
+        p_log->logMessage(Ogre::String("Decoder thread ") + p_name + " runs on cores " 
+                            + (effectiveMask != 0 ? describeCores(effectiveMask) : "(any)")
+                            + ", nice " + boost::lexical_cast<std::string>(effectiveNice)
+                            + (success ? "." : ". Not all requested settings could be applied."),
+                            success ? Ogre::LML_NORMAL : Ogre::LML_CRITICAL);
+    }
+    
+    return success;
+}
+
+//------------------------------------------------------------------------------
+int getCodecThreadCount(const DecoderThreadSettings& p_settings)
+{
+    // One codec thread per core the decoder thread may use
+    uint64_t mask = getEffectiveAffinityMask(p_settings);
+    int numCores = 0;
+    for (unsigned int i = 0; i < 64; ++i)
+    {
+        if (mask & ((uint64_t)1 << i))
+        {
+            ++numCores;
+        }
+    }
+    return numCores;
+}
@@ -0,0 +1,194 @@
+/* 
+ * File:   FFmpegUploadScheduler.cpp
+ * Author: TheSHEEEP
+ * 
+ * Created on 19. Oktober 2026, 18:40
+ */
+
+#include "FFmpegUploadScheduler.h"
+#include "FFmpegVideoPlayer.h"
+
+#include <OgreHardwarePixelBuffer.h>
+#include <boost/chrono.hpp>
+#include <algorithm>
+#include <vector>
+
+//------------------------------------------------------------------------------
+UploadStats::UploadStats()
+    : numUploads(0)
+    , numBytes(0)
+    , numDeferred(0)
+    , numSkipped(0)
+    , lastFrameTime(0.0)
+    , maxFrameTime(0.0)
+{
+}
+
+//------------------------------------------------------------------------------
+// Orders pending uploads: overdue ones first, then by priority, then the ones that waited longest
+struct UploadOrder
+{
+    UploadOrder(unsigned int p_maxDeferFrames)
+        : maxDeferFrames(p_maxDeferFrames)
+    {}
+    
+    template <typename T>
+    bool operator()(const T* p_a, const T* p_b) const
+    {
+        bool aOverdue = p_a->framesWaited >= maxDeferFrames;
+        bool bOverdue = p_b->framesWaited >= maxDeferFrames;
+        if (aOverdue != bOverdue)
+        {
+            return aOverdue;
+        }
+        if (p_a->priority != p_b->priority)
+        {
+            return p_a->priority > p_b->priority;
+        }
+        return p_a->framesWaited > p_b->framesWaited;
+    }
+    
+    unsigned int maxDeferFrames;
+};
+
+FFmpegUploadScheduler* FFmpegUploadScheduler::_instance = NULL;
+//------------------------------------------------------------------------------
+FFmpegUploadScheduler::FFmpegUploadScheduler()
+    : _timeBudget(0.0)
+    , _byteBudget(0)
+    , _maxDeferFrames(4)
+{
+}
+
+//------------------------------------------------------------------------------
+FFmpegUploadScheduler::~FFmpegUploadScheduler()
+{
+    std::map<Ogre::String, PendingUpload>::iterator it;
+    for (it = _pendingUploads.begin(); it != _pendingUploads.end(); ++it)
+    {
+        delete it->second.frame;
+    }
+    _pendingUploads.clear();
+}
+
+//------------------------------------------------------------------------------
+void 
+FFmpegUploadScheduler::submitUpload(const Ogre::TexturePtr& p_texture, VideoFrame* p_frame, 
+                                    unsigned int p_width, unsigned int p_height, double p_priority)
+{
+    const Ogre::String& name = p_texture->getName();
+    std::map<Ogre::String, PendingUpload>::iterator it = _pendingUploads.find(name);
+    
+    // A newer frame replaces the waiting one, but keeps its place in the line
+    if (it != _pendingUploads.end())
+    {
+        delete it->second.frame;
+        it->second.frame = p_frame;
+        it->second.width = p_width;
+        it->second.height = p_height;
+        it->second.priority = p_priority;
+        ++_stats.numSkipped;
+        return;
+    }
+    
+    PendingUpload& upload = _pendingUploads[name];
+    upload.texture = p_texture;
+    upload.frame = p_frame;
+    upload.width = p_width;
+    upload.height = p_height;
+    upload.priority = p_priority;
+    upload.framesWaited = 0;
+}
+
+//------------------------------------------------------------------------------
+void 
+FFmpegUploadScheduler::cancelUpload(const Ogre::String& p_textureName)
+{
+    std::map<Ogre::String, PendingUpload>::iterator it = _pendingUploads.find(p_textureName);
+    if (it != _pendingUploads.end())
+    {
+        delete it->second.frame;
+        _pendingUploads.erase(it);
+    }
+}
+
+//------------------------------------------------------------------------------
+void 
+FFmpegUploadScheduler::processUploads()
+{
+    if (_pendingUploads.empty())
+    {
+        _stats.lastFrameTime = 0.0;
+        return;
+    }
+    
+    // Most important first
+    std::vector<PendingUpload*> ordered;
+    std::map<Ogre::String, PendingUpload>::iterator it;
+    for (it = _pendingUploads.begin(); it != _pendingUploads.end(); ++it)
+    {
+        ordered.push_back(&it->second);
+    }
+    std::sort(ordered.begin(), ordered.end(), UploadOrder(_maxDeferFrames));
+    
+    // Upload until the budget is used up. At least one frame is always uploaded.
+    boost::chrono::steady_clock::time_point const start = boost::chrono::steady_clock::now();
+    size_t bytes = 0;
+    unsigned int numUploaded = 0;
+    for (unsigned int i = 0; i < ordered.size(); ++i)
+    {
+        PendingUpload& upload = *ordered[i];
+        double elapsed = boost::chrono::duration<double>(boost::chrono::steady_clock::now() - start).count();
+        bool overBudget = numUploaded > 0 
+                            && ((_byteBudget > 0 && bytes + upload.frame->dataSize > _byteBudget)
+                                || (_timeBudget > 0.0 && elapsed >= _timeBudget));
+        if (overBudget && upload.framesWaited < _maxDeferFrames)
+        {
+            ++upload.framesWaited;
+            ++_stats.numDeferred;
+            continue;
+        }
+        
+        Ogre::PixelBox pb(upload.width, upload.height, 1, upload.frame->format, upload.frame->data);
+        upload.texture->getBuffer()->blitFromMemory(pb);
+        
+        bytes += upload.frame->dataSize;
+        ++numUploaded;
+        delete upload.frame;
+        upload.frame = NULL;
+    }
+    
+    // Forget what was uploaded
+    it = _pendingUploads.begin();
+    while (it != _pendingUploads.end())
+    {
+        if (it->second.frame == NULL)
+        {
+            _pendingUploads.erase(it++);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+    
+    _stats.numUploads += numUploaded;
+    _stats.numBytes += bytes;
+    _stats.lastFrameTime = boost::chrono::duration<double>(boost::chrono::steady_clock::now() - start).count();
+    _stats.maxFrameTime = _stats.lastFrameTime > _stats.maxFrameTime ? _stats.lastFrameTime : _stats.maxFrameTime;
+}
+
+//------------------------------------------------------------------------------
+void 
+FFmpegUploadScheduler::resetStats()
+{
+    _stats = UploadStats();
+}
+
+//------------------------------------------------------------------------------
+bool 
+FFmpegUploadScheduler::frameRenderingQueued(const Ogre::FrameEvent& p_evt)
+{
+    processUploads();
+    return true;
+}
@@ -15,8 +15,11 @@ extern "C"
 #include <boost/thread.hpp>
 #include <boost/chrono.hpp>
 #include <boost/lexical_cast.hpp>
+#include <boost/thread/once.hpp>
+#include <new>
 #include <OgreLog.h>
 #include <string>
+#include <deque>
 
 #include "FFmpegVideoPlayer.h"
 
@@ -24,6 +27,13 @@ extern "C"
 // the used log too often while decoding ;)
 static Ogre::Log* staticOgreLog = NULL;
 
+// Capacity of the audio conversion buffer in samples.
+// At the slowest playback rate, resampling quadruples the number of samples of a frame.
+static const int sAudioBufferNumSamples = 4096 * 4;
+
+// How long a pooled decoding job decodes before the pool may switch to another video
+static const double sPoolTimeSlice = 0.005;
+
 //------------------------------------------------------------------------------
 // Used internally to decoding thread, to determine desired audio sample format
 inline AVSampleFormat getAVSampleFormat(AudioSampleFormat fmt)
@@ -87,16 +97,154 @@ void log_callback(void* ptr, int level, const char* fmt, va_list vl)
     }
 }
 
+//------------------------------------------------------------------------------
+// Returns the language tag of a stream, or an empty string
+Ogre::String getStreamLanguage(AVStream* p_stream)
+{
+    AVDictionaryEntry* entry = av_dict_get(p_stream->metadata, "language", NULL, 0);
+    return entry ? Ogre::String(entry->value) : Ogre::String("");
+}
+
+//------------------------------------------------------------------------------
+// Lets FFmpeg lock what it shares between codecs, e.g. while they are opened
+int lockManager(void** p_mutex, enum AVLockOp p_op)
+{
+    switch (p_op)
+    {
+        case AV_LOCK_CREATE:
+            *p_mutex = new (std::nothrow) boost::mutex();
+            return *p_mutex ? 0 : 1;
+            
+        case AV_LOCK_OBTAIN:
+            static_cast<boost::mutex*>(*p_mutex)->lock();
+            return 0;
+            
+        case AV_LOCK_RELEASE:
+            static_cast<boost::mutex*>(*p_mutex)->unlock();
+            return 0;
+            
+        case AV_LOCK_DESTROY:
+            delete static_cast<boost::mutex*>(*p_mutex);
+            *p_mutex = NULL;
+            return 0;
+    }
+    return 1;
+}
+
+//------------------------------------------------------------------------------
+// Registering is not thread safe, so it is only done once
+void registerFFmpeg()
+{
+    av_register_all();
+    av_lockmgr_register(lockManager);
+}
+
+static boost::once_flag sInitializeOnce = BOOST_ONCE_INIT;
+
+//------------------------------------------------------------------------------
+void initializeFFmpeg()
+{
+    boost::call_once(sInitializeOnce, &registerFFmpeg);
+}
+
+//------------------------------------------------------------------------------
+// Fills a StreamInfo for each stream of the format context
+void fillStreamInfos(AVFormatContext* p_formatContext, std::vector<StreamInfo>& p_outStreams)
+{
+    p_outStreams.clear();
+    for (unsigned int i = 0; i < p_formatContext->nb_streams; ++i)
+    {
+        AVStream* stream = p_formatContext->streams[i];
+        AVCodecContext* codecContext = stream->codec;
+        
+        StreamInfo info;
+        info.index = i;
+        info.codecName = avcodec_get_name(codecContext->codec_id);
+        info.language = getStreamLanguage(stream);
+        AVDictionaryEntry* title = av_dict_get(stream->metadata, "title", NULL, 0);
+        if (title)
+        {
+            info.title = title->value;
+        }
+        
+        switch (codecContext->codec_type)
+        {
+            case AVMEDIA_TYPE_VIDEO:
+                info.type = STREAMTYPE_VIDEO;
+                info.videoWidth = codecContext->width;
+                info.videoHeight = codecContext->height;
+                break;
+                
+            case AVMEDIA_TYPE_AUDIO:
+                info.type = STREAMTYPE_AUDIO;
+                info.audioSampleRate = codecContext->sample_rate;
+                info.audioNumChannels = codecContext->channels;
+                break;
+                
+            default:
+                info.type = STREAMTYPE_OTHER;
+                break;
+        }
+        
+        p_outStreams.push_back(info);
+    }
+}
+
+//------------------------------------------------------------------------------
+// Finds the stream to decode. 
+// A matching language wins over the wanted index, -1 lets FFmpeg choose.
+int findStreamIndex(AVFormatContext* p_formatContext, AVMediaType p_type, 
+                    int p_wantedStreamIndex, const Ogre::String& p_language)
+{
+    if (p_language.length() > 0)
+    {
+        for (unsigned int i = 0; i < p_formatContext->nb_streams; ++i)
+        {
+            AVStream* stream = p_formatContext->streams[i];
+            if (stream->codec->codec_type == p_type && getStreamLanguage(stream) == p_language)
+            {
+                return i;
+            }
+        }
+        
+        if (staticOgreLog)
+        {
+            staticOgreLog->logMessage("No stream with language " + p_language 
+                                        + " found, using best stream instead.");
+        }
+    }
+    
+    return av_find_best_stream(p_formatContext, p_type, p_wantedStreamIndex, -1, NULL, 0);
+}
+
+//------------------------------------------------------------------------------
+// Lets the demuxer drop all packets of streams we do not decode
+void discardUnusedStreams(AVFormatContext* p_formatContext, int p_audioStreamIndex, int p_videoStreamIndex)
+{
+    for (unsigned int i = 0; i < p_formatContext->nb_streams; ++i)
+    {
+        if ((int)i == p_audioStreamIndex || (int)i == p_videoStreamIndex)
+        {
+            p_formatContext->streams[i]->discard = AVDISCARD_DEFAULT;
+        }
+        else
+        {
+            p_formatContext->streams[i]->discard = AVDISCARD_ALL;
+        }
+    }
+}
+
 //------------------------------------------------------------------------------
 bool openCodecContext(  AVFormatContext* p_formatContext, AVMediaType p_type, VideoInfo& p_videoInfo, 
-                        int& p_outStreamIndex)
+                        int p_wantedStreamIndex, const Ogre::String& p_language, int& p_outStreamIndex,
+                        int p_threadCount = 0)
 {
     AVStream* stream;
     AVCodecContext* decodeCodecContext = NULL;
     AVCodec* decodeCodec = NULL;
     
     // Find the stream
-    p_outStreamIndex = av_find_best_stream(p_formatContext, p_type, -1, -1, NULL, 0);
+    p_outStreamIndex = findStreamIndex(p_formatContext, p_type, p_wantedStreamIndex, p_language);
     if (p_outStreamIndex < 0) 
     {
         p_videoInfo.error = "Could not find stream of type: ";
@@ -122,6 +270,12 @@ bool openCodecContext(  AVFormatContext* p_formatContext, AVMediaType p_type, Vi
 //            decodeCodecContext->request_sample_fmt = AV_SAMPLE_FMT_S16;
 //        }
         
+        // Codec threads are created when opening, they inherit the placement of this thread
+        if (p_threadCount > 0)
+        {
+            decodeCodecContext->thread_count = p_threadCount;
+        }
+        
         // Open decodec codec & context
         if (avcodec_open2(decodeCodecContext, decodeCodec, NULL) < 0) 
         {
@@ -134,11 +288,151 @@ bool openCodecContext(  AVFormatContext* p_formatContext, AVMediaType p_type, Vi
     return true;
 }
 
+//------------------------------------------------------------------------------
+// Creates the context that converts decoded audio into the player's sample format.
+// The output sample rate is passed separately so it stays the same when switching tracks.
+// The playback rate is applied by pretending the input has a higher or lower sample rate,
+// so the output plays faster or slower (with the pitch changing accordingly).
+SwrContext* createSwrContext(AVCodecContext* p_audioCodecContext, unsigned int p_outNumChannels, 
+                                unsigned int p_outSampleRate, AudioSampleFormat p_outFormat, double p_rate)
+{
+    // Get the correct target channel layout
+    uint64_t targetChannelLayout;
+    // Keep the source layout
+    if (p_audioCodecContext->channels == p_outNumChannels)
+    {
+        targetChannelLayout = p_audioCodecContext->channel_layout;
+    }
+    // Or determine a new one
+    else
+    {
+        switch (p_outNumChannels)
+        {
+            case 1:
+                targetChannelLayout = AV_CH_LAYOUT_MONO;
+                break;
+                
+            case 2:
+                targetChannelLayout = AV_CH_LAYOUT_STEREO;
+                break;
+                
+            default:
+                targetChannelLayout = p_audioCodecContext->channel_layout;
+                break;
+        }
+    }
+    
+    // Initialize SWR context
+    SwrContext* swrContext = swr_alloc_set_opts(NULL, 
+                targetChannelLayout, getAVSampleFormat(p_outFormat), p_outSampleRate,
+                p_audioCodecContext->channel_layout, p_audioCodecContext->sample_fmt, 
+                (int)(p_audioCodecContext->sample_rate * p_rate + 0.5), 
+                0, NULL);
+    return swrContext;
+}
+
+//------------------------------------------------------------------------------
+// Returns the time of the steady clock in seconds, for measuring durations
+double getSteadyTime()
+{
+    return boost::chrono::duration<double>(boost::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+//------------------------------------------------------------------------------
+// Converts the timestamp of a decoded frame into seconds relative to the start of the stream.
+// The best effort timestamp is guessed from pts and dts, if there is none at all
+// (theora & vorbis sometimes), the passed fallback is used.
+double getFramePts(AVFrame* p_frame, AVStream* p_stream, double p_fallback)
+{
+    int64_t pts = av_frame_get_best_effort_timestamp(p_frame);
+    if (pts == AV_NOPTS_VALUE)
+    {
+        return p_fallback;
+    }
+    
+    double timeBase = ((double)p_stream->time_base.num) / (double)p_stream->time_base.den;
+    int64_t startTime = p_stream->start_time != AV_NOPTS_VALUE ? p_stream->start_time : 0;
+    return timeBase * (pts - startTime);
+}
+
+//------------------------------------------------------------------------------
+// Seeks to the keyframe at or before the passed time (in seconds relative to the start of the stream)
+bool seekToKeyframe(AVFormatContext* p_formatContext, AVStream* p_stream, double p_time)
+{
+    double timeBase = ((double)p_stream->time_base.num) / (double)p_stream->time_base.den;
+    int64_t startTime = p_stream->start_time != AV_NOPTS_VALUE ? p_stream->start_time : 0;
+    int64_t timestamp = startTime + (int64_t)(p_time / timeBase);
+    return av_seek_frame(p_formatContext, p_stream->index, timestamp, AVSEEK_FLAG_BACKWARD) >= 0;
+}
+
+//------------------------------------------------------------------------------
+// Consumes an audio packet without decoding it and adds a silent frame as long as the packet would have played.
+// The lengths come from the packet, or from the codec's frame size for packets that do not tell.
+int addSilencePacket(   AVPacket& p_packet, AVCodecContext* p_audioCodecContext, AVStream* p_stream,
+                        const RateState& p_rateState, FFmpegVideoPlayer* p_player, VideoInfo& p_videoInfo,
+                        double p_skipUntil, std::deque<AudioFrame*>* p_outFrames)
+{
+    int consumed = p_packet.size;
+    double timeBase = ((double)p_stream->time_base.num) / (double)p_stream->time_base.den;
+    double frameLifeTime = timeBase * p_packet.duration;
+    if (p_packet.duration <= 0 && p_audioCodecContext->sample_rate > 0)
+    {
+        frameLifeTime = ((double)p_audioCodecContext->frame_size) / p_audioCodecContext->sample_rate;
+    }
+    if (frameLifeTime <= 0.0)
+    {
+        return consumed;
+    }
+    
+    double framePts = p_videoInfo.audioDecodedDuration;
+    if (p_packet.pts != AV_NOPTS_VALUE)
+    {
+        int64_t startTime = p_stream->start_time != AV_NOPTS_VALUE ? p_stream->start_time : 0;
+        framePts = timeBase * (p_packet.pts - startTime);
+    }
+    p_videoInfo.audioDecodedDuration = framePts + frameLifeTime;
+    if (p_videoInfo.audioDecodedDuration < p_skipUntil)
+    {
+        return consumed;
+    }
+    
+    // As many samples as the resampler would have made at this rate
+    int numSamples = (int)(frameLifeTime / p_rateState.rate * p_videoInfo.audioSampleRate + 0.5);
+    int bufferSize = av_get_bytes_per_sample(getAVSampleFormat(p_player->getAudioSampleFormat())) 
+                        * p_videoInfo.audioNumChannels * numSamples;
+    if (bufferSize <= 0)
+    {
+        return consumed;
+    }
+    
+    AudioFrame* frame = new AudioFrame();
+    frame->allocate(bufferSize);
+    memset(frame->data, 0, bufferSize);
+    frame->lifeTime = frameLifeTime / p_rateState.rate;
+    if (p_outFrames)
+    {
+        p_outFrames->push_back(frame);
+    }
+    else
+    {
+        p_player->addAudioFrame(frame);
+    }
+    return consumed;
+}
+
 //------------------------------------------------------------------------------
 int decodeAudioPacket(  AVPacket& p_packet, AVCodecContext* p_audioCodecContext, AVStream* p_stream, 
-                        AVFrame* p_frame, SwrContext* p_swrContext, uint8_t** p_destBuffer, int p_destLinesize,
-                        FFmpegVideoPlayer* p_player, VideoInfo& p_videoInfo, bool p_isLoop)
+                        AVFrame* p_frame, SwrContext* p_swrContext, uint8_t** p_destBuffer, int p_destNumSamples,
+                        const RateState& p_rateState, FFmpegVideoPlayer* p_player, VideoInfo& p_videoInfo, 
+                        double p_skipUntil, std::deque<AudioFrame*>* p_outFrames = NULL)
 {
+    // Muted audio is neither decoded nor resampled, the packet is replaced by silence of the same length
+    if (p_rateState.muteAudio)
+    {
+        return addSilencePacket(p_packet, p_audioCodecContext, p_stream, p_rateState, p_player, p_videoInfo,
+                                p_skipUntil, p_outFrames);
+    }
+    
     // Decode audio frame
     int got_frame = 0;
     int decoded = avcodec_decode_audio4(p_audioCodecContext, p_frame, &got_frame, &p_packet);
@@ -160,7 +454,7 @@ int decodeAudioPacket(  AVPacket& p_packet, AVCodecContext* p_audioCodecContext,
     if (got_frame)
     {
         int outputSamples = swr_convert(p_swrContext, 
-                                        p_destBuffer, p_destLinesize, 
+                                        p_destBuffer, p_destNumSamples, 
                                         (const uint8_t**)p_frame->extended_data, p_frame->nb_samples);
         
 		int bufferSize = av_get_bytes_per_sample(getAVSampleFormat(p_player->getAudioSampleFormat())) * p_videoInfo.audioNumChannels
@@ -182,23 +476,33 @@ int decodeAudioPacket(  AVPacket& p_packet, AVCodecContext* p_audioCodecContext,
         // Calculate frame life time
         double frameLifeTime = ((double)p_stream->time_base.num) / (double)p_stream->time_base.den;
         frameLifeTime *= duration;
-        p_videoInfo.audioDecodedDuration += frameLifeTime;
+        double framePts = getFramePts(p_frame, p_stream, p_videoInfo.audioDecodedDuration);
+        p_videoInfo.audioDecodedDuration = framePts + frameLifeTime;
         
-        // If we are a loop, only start adding frames after 0.5 seconds have been decoded
-        if (p_isLoop && p_videoInfo.audioDecodedDuration < 0.5)
+        // Skip frames before the position we want to start at 
+        // (when looping, the first 0.5 seconds are played from the backup)
+        if (p_videoInfo.audioDecodedDuration < p_skipUntil)
         {
-            staticOgreLog->logMessage("Skipping audio frame");
+            if (staticOgreLog && p_player->getLogLevel() == LOGLEVEL_EXCESSIVE)
+                staticOgreLog->logMessage("Skipping audio frame");
             return decoded;
         }
         
-        // Create the audio frame
+        // Create the audio frame, the converted samples already have the playback rate applied
         AudioFrame* frame = new AudioFrame();
-        frame->dataSize = bufferSize;
-        frame->data = new uint8_t[bufferSize];
+        frame->allocate(bufferSize);
         memcpy(frame->data, p_destBuffer[0], bufferSize);
-        frame->lifeTime = frameLifeTime;
+        frame->lifeTime = frameLifeTime / p_rateState.rate;
         
-        p_player->addAudioFrame(frame);
+        // Insert the frame into the audio queue, or the passed list
+        if (p_outFrames)
+        {
+            p_outFrames->push_back(frame);
+        }
+        else
+        {
+            p_player->addAudioFrame(frame);
+        }
     }
     
     return decoded;
@@ -206,8 +510,9 @@ int decodeAudioPacket(  AVPacket& p_packet, AVCodecContext* p_audioCodecContext,
 
 //------------------------------------------------------------------------------
 int decodeVideoPacket(  AVPacket& p_packet, AVCodecContext* p_videoCodecContext, AVStream* p_stream, 
-                        AVFrame* p_frame, SwsContext* p_swsContext, AVPicture* p_destPic, 
-                        FFmpegVideoPlayer* p_player, VideoInfo& p_videoInfo, bool p_isLoop)
+                        AVFrame* p_frame, SwsContext*& p_swsContext, unsigned int p_outWidth, unsigned int p_outHeight,
+                        FFmpegVideoPlayer* p_player, VideoInfo& p_videoInfo, double p_skipUntil,
+                        std::deque<VideoFrame*>* p_outFrames = NULL)
 {
     // Decode audio frame
     int got_frame = 0;
@@ -221,14 +526,9 @@ int decodeVideoPacket(  AVPacket& p_packet, AVCodecContext* p_videoCodecContext,
     // Frame is complete, sws_scale it and store it in video frame queue
     if (got_frame)
     {
-        // Convert the image into the video frame
-        sws_scale(p_swsContext, p_frame->data, p_frame->linesize,
-                    0, p_videoCodecContext->height, p_destPic->data, p_destPic->linesize);
-        
-        // Use packet duration and packet dts to get the lifetime and position of a frame
-        // PTS is highly erroneous and sometimes not even used at all (theora & vorbis)
+        // Use the packet duration to get the lifetime of a frame
         int64_t duration = p_frame->pkt_duration;
-        int64_t pts = p_frame->pts;
+        int64_t pts = av_frame_get_best_effort_timestamp(p_frame);
         int64_t dts = p_frame->pkt_dts;
         
 //        if (staticOgreLog && p_player->getLogLevel() == LOGLEVEL_EXCESSIVE)
@@ -240,295 +540,1015 @@ int decodeVideoPacket(  AVPacket& p_packet, AVCodecContext* p_videoCodecContext,
 //        }
         
         // Calculate frame life time
-        double frameLifeTime = ((double)p_stream->time_base.num) / (double)p_stream->time_base.den;
-        frameLifeTime *= duration;
-        p_videoInfo.videoDecodedDuration += frameLifeTime;
+        double timeBase = ((double)p_stream->time_base.num) / (double)p_stream->time_base.den;
+        double frameLifeTime = timeBase * duration;
         
-        // If we are a loop, only start adding frames after 0.5 seconds have been decoded
-        if (p_isLoop && p_videoInfo.videoDecodedDuration < 0.5)
+        // If the lifeTime is below 0.01 seconds, which would mean 1/100 fps, something
+        // is very fishy with the time_base, duration or similar. Use r_frame_rate of the stream instead.
+        // This is guessing, more or less! The frame's position comes from its timestamp, so this only 
+        // affects how much time the buffer is considered to hold.
+        if (frameLifeTime < 0.01)
+        {
+            frameLifeTime = 1.0 / ((double)(p_stream->r_frame_rate.num) / (double)(p_stream->r_frame_rate.den));
+        }
+        
+        // Get the presentation time relative to the start of the stream.
+        // Without any timestamp, we continue after the previous frame.
+        double framePts = getFramePts(p_frame, p_stream, p_videoInfo.videoDecodedDuration);
+        p_videoInfo.videoDecodedDuration = framePts + frameLifeTime;
+        
+        // Skip frames before the position we want to start at 
+        // (when looping, the first 0.5 seconds are played from the backup)
+        if (p_videoInfo.videoDecodedDuration < p_skipUntil)
         {
             return decoded;
         }
         
-        // Create the video frame
+        // YUV planes of the right size and layout are only copied, the material converts them.
         VideoFrame* videoFrame = new VideoFrame();
-        int size = p_destPic->linesize[0] * p_videoCodecContext->height;
-        videoFrame->dataSize = size;
-        videoFrame->data = new uint8_t[size];
-        memcpy(videoFrame->data, p_destPic->data[0], size);
+        bool outputPlanes = p_player->getVideoOutputFormat() == VOF_YUV_PLANES;
+        if (outputPlanes && p_frame->width == (int)p_outWidth && p_frame->height == (int)p_outHeight 
+            && FFmpegYUVPlanes::getCanExtract(p_frame->format))
+        {
+            FFmpegYUVPlanes::getImageSize(p_outWidth, p_outHeight, videoFrame->width, videoFrame->height);
+            videoFrame->format = Ogre::PF_L8;
+            videoFrame->allocate(videoFrame->width * videoFrame->height);
+            FFmpegYUVPlanes::extractPlanes(p_frame->data, p_frame->linesize, p_frame->format, 
+                                           p_outWidth, p_outHeight, videoFrame->data);
+        }
+        else
+        {
+            // The decoder may already have shrunk the frame, the scaler does the rest.
+            // Each frame is converted with the context that fits its size, so a new size only 
+            // ever starts with a new frame.
+            p_swsContext = sws_getCachedContext(p_swsContext,
+                                        p_frame->width, p_frame->height, p_videoCodecContext->pix_fmt, 
+                                        p_outWidth, p_outHeight, outputPlanes ? PIX_FMT_YUV420P : PIX_FMT_RGBA, 
+                                        SWS_BICUBIC, NULL, NULL, NULL);
+            if (!p_swsContext)
+            {
+                delete videoFrame;
+                p_videoInfo.error = "Could not initialize sws context.";
+                return -1;
+            }
+            
+            // Convert straight into the frame's memory
+            uint8_t* destData[4] = { NULL, NULL, NULL, NULL };
+            int destLinesize[4] = { 0, 0, 0, 0 };
+            if (outputPlanes)
+            {
+                FFmpegYUVPlanes::getImageSize(p_outWidth, p_outHeight, videoFrame->width, videoFrame->height);
+                videoFrame->format = Ogre::PF_L8;
+                videoFrame->allocate(videoFrame->width * videoFrame->height);
+                FFmpegYUVPlanes::getPlanes(p_outWidth, p_outHeight, videoFrame->data, destData, destLinesize);
+            }
+            else
+            {
+                videoFrame->width = p_outWidth;
+                videoFrame->height = p_outHeight;
+                videoFrame->allocate(p_outWidth * p_outHeight * 4);
+                destData[0] = videoFrame->data;
+                destLinesize[0] = p_outWidth * 4;
+            }
+            sws_scale(p_swsContext, p_frame->data, p_frame->linesize, 0, p_frame->height, destData, destLinesize);
+            if (outputPlanes)
+            {
+                FFmpegYUVPlanes::fillPadding(p_outWidth, p_outHeight, videoFrame->data);
+            }
+        }
+        videoFrame->pts = framePts;
         videoFrame->lifeTime = frameLifeTime;
         
-        // If the lifeTime is below 0.01 seconds, which would mean 1/100 fps, something
-        // is very fishy with the time_base, duration or similar. Use r_frame_rate of the stream instead.
-        // This is guessing, more or less! Only works with constant fps streams.
-        if (videoFrame->lifeTime < 0.01)
+        // Insert the frame into the video queue, or the passed list
+        if (p_outFrames)
         {
-            videoFrame->lifeTime = 1.0 / ((double)(p_stream->r_frame_rate.num) / (double)(p_stream->r_frame_rate.den));
+            p_outFrames->push_back(videoFrame);
+        }
+        else
+        {
+            p_player->addVideoFrame(videoFrame);
         }
-        
-        // Insert the frame into the video queue
-        p_player->addVideoFrame(videoFrame);
     }
     
     return decoded;
 }
 
 //------------------------------------------------------------------------------
-void videoDecodingThread(ThreadInfo* p_threadInfo)
+// Switches decoding to the currently requested audio stream without reopening the file.
+// On failure, the previous audio stream is kept.
+void switchAudioStream( AVFormatContext* p_formatContext, FFmpegVideoPlayer* p_player, VideoInfo& p_videoInfo,
+                        int& p_audioStreamIndex, int p_videoStreamIndex, AVStream*& p_audioStream, 
+                        AVCodecContext*& p_audioCodecContext, SwrContext*& p_swrContext, double p_rate)
 {
-    // Read ThreadInfo struct, then delete it
-    FFmpegVideoPlayer* videoPlayer = p_threadInfo->videoPlayer;
-    VideoInfo& videoInfo = videoPlayer->getVideoInfo();
-    boost::mutex* playerMutex = p_threadInfo->playerMutex;
-    boost::condition_variable* playerCondVar = p_threadInfo->playerCondVar;
-    boost::mutex* decodeMutex = p_threadInfo->decodingMutex;
-    boost::condition_variable* decodeCondVar = p_threadInfo->decodingCondVar;
-    bool isLoop = p_threadInfo->isLoop;
-    staticOgreLog = videoPlayer->getLog();
-    delete p_threadInfo;
-    
-    // Initialize FFmpeg  
-    av_register_all();
-    av_log_set_callback(log_callback);
-    av_log_set_level(AV_LOG_WARNING);
-    
-    // Initialize video decoding, filling the VideoInfo
-    // Open the input file
-    AVFormatContext* formatContext = NULL;
-    const char* name = videoPlayer->getVideoFilename().c_str();
-    if (avformat_open_input(&formatContext, name, NULL, NULL) < 0) 
-    {
-        videoInfo.error = "Could not open input: ";
-        videoInfo.error.append(videoPlayer->getVideoFilename());
-        playerCondVar->notify_all();
+    int newStreamIndex = findStreamIndex(p_formatContext, AVMEDIA_TYPE_AUDIO, p_player->getAudioTrack(), 
+                                         p_player->getAudioTrackLanguage());
+    if (newStreamIndex < 0 || newStreamIndex == p_audioStreamIndex)
+    {
         return;
     }
     
-    // Read stream information
-    if (avformat_find_stream_info(formatContext, NULL) < 0) 
+    // Open the new stream first, errors go into a temporary info so they do not stop decoding
+    VideoInfo switchInfo;
+    int openedStreamIndex = -1;
+    if (!openCodecContext(p_formatContext, AVMEDIA_TYPE_AUDIO, switchInfo, newStreamIndex, "", openedStreamIndex))
     {
-        videoInfo.error = "Could not find stream information.";
-        playerCondVar->notify_all();
+        if (staticOgreLog)
+        {
+            staticOgreLog->logMessage("Could not switch audio track: " + switchInfo.error, Ogre::LML_CRITICAL);
+        }
         return;
     }
     
-    // Get streams
-    // Audio stream
-    AVStream* audioStream = NULL;
-    AVCodecContext* audioCodecContext = NULL;
-    int audioStreamIndex = -1;
-    if (!openCodecContext(formatContext, AVMEDIA_TYPE_AUDIO, videoInfo, audioStreamIndex)) 
+    AVCodecContext* newCodecContext = p_formatContext->streams[openedStreamIndex]->codec;
+    SwrContext* newSwrContext = createSwrContext(newCodecContext, p_videoInfo.audioNumChannels, 
+                                    p_videoInfo.audioSampleRate, p_player->getAudioSampleFormat(), p_rate);
+    if (swr_init(newSwrContext) != 0)
     {
-        // The error itself is set by openCodecContext
-        playerCondVar->notify_all();
+        if (staticOgreLog)
+        {
+            staticOgreLog->logMessage("Could not switch audio track: swr context failed.", Ogre::LML_CRITICAL);
+        }
+        swr_free(&newSwrContext);
+        avcodec_close(newCodecContext);
         return;
     }
-    audioStream = formatContext->streams[audioStreamIndex];
-    audioCodecContext = audioStream->codec;
     
-    // Video stream
-    AVStream* videoStream = NULL;
-    AVCodecContext* videoCodecContext = NULL;
-    int videoStreamIndex = -1;
-    if (!openCodecContext(formatContext, AVMEDIA_TYPE_VIDEO, videoInfo, videoStreamIndex)) 
+    // Replace the old stream
+    avcodec_close(p_audioCodecContext);
+    swr_free(&p_swrContext);
+    p_audioStreamIndex = openedStreamIndex;
+    p_audioStream = p_formatContext->streams[openedStreamIndex];
+    p_audioCodecContext = newCodecContext;
+    p_swrContext = newSwrContext;
+    p_videoInfo.audioStreamIndex = openedStreamIndex;
+    discardUnusedStreams(p_formatContext, p_audioStreamIndex, p_videoStreamIndex);
+    
+    if (staticOgreLog && p_player->getLogLevel() >= LOGLEVEL_NORMAL)
     {
-        // The error itself is set by openCodecContext
-        playerCondVar->notify_all();
-        return;
+        staticOgreLog->logMessage("Switched to audio stream " 
+                                    + boost::lexical_cast<std::string>(openedStreamIndex) + ".");
     }
-    videoStream = formatContext->streams[videoStreamIndex];
-    videoCodecContext = videoStream->codec;
+}
+
+//------------------------------------------------------------------------------
+// Reads the wanted playback rate settings from the player
+RateState getRateState(FFmpegVideoPlayer* p_player)
+{
+    RateState state;
+    state.rate = p_player->getPlaybackRate();
+    state.keyframesOnly = state.rate > p_player->getKeyframeOnlyRate() || p_player->getIsDecodingThrottled();
+    state.muteAudio = state.rate != 1.0 
+                        && (state.keyframesOnly || p_player->getAudioRatePolicy() == ARP_MUTE);
+    return state;
+}
+
+//------------------------------------------------------------------------------
+// Applies new playback rate settings to the decoders.
+// Buffered frames are not touched, only frames decoded from now on are affected.
+void applyRateState(const RateState& p_newState, FFmpegVideoPlayer* p_player, VideoInfo& p_videoInfo, 
+                    AVCodecContext* p_videoCodecContext, AVCodecContext* p_audioCodecContext,
+                    SwrContext*& p_swrContext, RateState& p_rateState)
+{
+    // Fast playback only decodes keyframes, so it gets cheaper instead of more expensive
+    p_videoCodecContext->skip_frame = p_newState.keyframesOnly ? AVDISCARD_NONKEY : AVDISCARD_DEFAULT;
     
-    // Dump information
-    av_dump_format(formatContext, 0, videoPlayer->getVideoFilename().c_str(), 0);
+    // Muted packets never reached the audio decoder, so it must not continue from what it had before
+    if (p_audioCodecContext && p_rateState.muteAudio && !p_newState.muteAudio)
+    {
+        avcodec_flush_buffers(p_audioCodecContext);
+    }
     
-    // Store useful information in VideoInfo struct
-    double timeBase = ((double)audioStream->time_base.num) / (double)audioStream->time_base.den;
-    videoInfo.audioDuration = audioStream->duration * timeBase;
-    videoInfo.audioSampleRate = audioCodecContext->sample_rate;
-    videoInfo.audioBitRate = audioCodecContext->bit_rate;
-    videoInfo.audioNumChannels = 
-            videoInfo.audioNumChannels > 0 ? videoInfo.audioNumChannels : audioCodecContext->channels;
+    // Audio needs to be resampled to the new rate
+    if (p_newState.rate != p_rateState.rate)
+    {
+        SwrContext* newSwrContext = createSwrContext(p_audioCodecContext, p_videoInfo.audioNumChannels, 
+                                        p_videoInfo.audioSampleRate, p_player->getAudioSampleFormat(), 
+                                        p_newState.rate);
+        if (swr_init(newSwrContext) != 0)
+        {
+            if (staticOgreLog)
+            {
+                staticOgreLog->logMessage("Could not resample audio to new playback rate.", Ogre::LML_CRITICAL);
+            }
+            swr_free(&newSwrContext);
+        }
+        else
+        {
+            swr_free(&p_swrContext);
+            p_swrContext = newSwrContext;
+        }
+    }
     
-    timeBase = ((double)videoStream->time_base.num) / (double)videoStream->time_base.den;
-    videoInfo.videoDuration = videoStream->duration * timeBase;
-    videoInfo.videoWidth = videoCodecContext->width;
-    videoInfo.videoHeight = videoCodecContext->height;
+    p_rateState = p_newState;
     
-    // If the a duration is below 0 seconds, something is very fishy. 
-    // Use format duration instead, it's the best guess we have
-    if (videoInfo.audioDuration < 0.0)
+    if (staticOgreLog && p_player->getLogLevel() >= LOGLEVEL_NORMAL)
     {
-        videoInfo.audioDuration = ((double)formatContext->duration) / AV_TIME_BASE;
+        staticOgreLog->logMessage("Decoding at playback rate " + boost::lexical_cast<std::string>(p_rateState.rate)
+                                    + (p_rateState.keyframesOnly ? ", keyframes only" : "")
+                                    + (p_rateState.muteAudio ? ", audio muted." : "."));
     }
-    if (videoInfo.videoDuration < 0.0)
+}
+
+//------------------------------------------------------------------------------
+// Decodes the video backwards, starting at the passed time.
+// Each step seeks to the keyframe before the part that was not played yet, decodes that GOP 
+// once and hands its frames to the player in reverse order. While the player shows them, 
+// the GOP before is already decoded. Memory stays within the player's reverse cache budget, 
+// GOPs that are too big are decoded in several passes.
+void decodeReverse( AVFormatContext* p_formatContext, AVStream* p_videoStream, AVCodecContext* p_videoCodecContext,
+                    SwsContext*& p_swsContext, FFmpegVideoPlayer* p_player, 
+                    VideoInfo& p_videoInfo, double p_startTime,
+                    boost::mutex* p_decodeMutex, boost::condition_variable* p_decodeCondVar)
+{
+    AVFrame* frame = avcodec_alloc_frame();
+    if (!frame) 
     {
-        videoInfo.videoDuration = ((double)formatContext->duration) / AV_TIME_BASE;
+        p_videoInfo.error = "Out of memory.";
+        return;
     }
- 
-    // Store the longer of both durations. This is what determines when looped videos
-    // will begin anew
-    videoInfo.longerDuration = videoInfo.videoDuration > videoInfo.audioDuration ? 
-                                videoInfo.videoDuration : videoInfo.audioDuration;
-            
-    // Wake up video player
-    videoInfo.infoFilled = true;
-    playerCondVar->notify_all();
     
-    // Initialize packet, set data to NULL, let the demuxer fill it
     AVPacket packet;
     av_init_packet(&packet);
     packet.data = NULL;
     packet.size = 0;
     
-    // Initialize SWS context
-    SwsContext* swsContext = NULL;
-    swsContext = sws_getCachedContext(swsContext,
-                                videoInfo.videoWidth, videoInfo.videoHeight, videoCodecContext->pix_fmt, 
-                                videoInfo.videoWidth, videoInfo.videoHeight, PIX_FMT_RGBA, 
-                                SWS_BICUBIC, NULL, NULL, NULL);
-    
-    // Create destination picture
-    AVFrame* destPic = avcodec_alloc_frame();
-    avpicture_alloc((AVPicture*)destPic, PIX_FMT_RGBA, videoInfo.videoWidth, videoInfo.videoHeight);
-    
-    // Get the correct target channel layout
-    uint64_t targetChannelLayout;
-    // Keep the source layout
-    if (audioCodecContext->channels == videoInfo.audioNumChannels)
-    {
-        targetChannelLayout = audioCodecContext->channel_layout;
-    }
-    // Or determine a new one
-    else
+    std::deque<VideoFrame*> gop;
+    std::deque<VideoFrame*> decodedFrames;
+    double segmentEnd = p_startTime;    // Everything from here on was already handed to the player
+    double seekBack = 0.0;              // Extra distance if the last seek did not land before segmentEnd
+    while (segmentEnd > 0.0 && !p_videoInfo.decodingAborted)
     {
-        switch (videoInfo.audioNumChannels)
+        size_t budget = p_player->getReverseCacheBudget();
+        size_t gopBytes = 0;
+        bool truncated = false;
+        
+        // Go to the keyframe before the segment
+        double seekTime = segmentEnd - seekBack - 0.001;
+        seekToKeyframe(p_formatContext, p_videoStream, seekTime > 0.0 ? seekTime : 0.0);
+        avcodec_flush_buffers(p_videoCodecContext);
+        
+        // Decode the GOP up to the segment end.
+        // If it gets too big, the earliest frames are dropped and decoded in the next pass.
+        bool segmentDone = false;
+        bool endOfFile = false;
+        while (!segmentDone && !endOfFile)
         {
-            case 1:
-                targetChannelLayout = AV_CH_LAYOUT_MONO;
-                break;
-                
-            case 2:
-                targetChannelLayout = AV_CH_LAYOUT_STEREO;
-                break;
+            if (av_read_frame(p_formatContext, &packet) < 0)
+            {
+                // Get the frames the decoder still holds back
+                endOfFile = true;
+                packet.data = NULL;
+                packet.size = 0;
+                packet.stream_index = p_videoStream->index;
+            }
+            
+            if (packet.stream_index == p_videoStream->index)
+            {
+                unsigned int numDecoded = 0;
+                do
+                {
+                    avcodec_get_frame_defaults(frame);
+                    numDecoded = decodedFrames.size();
+                    if (decodeVideoPacket(packet, p_videoCodecContext, p_videoStream, frame, p_swsContext, 
+                                          p_videoInfo.videoWidth, p_videoInfo.videoHeight, 
+                                          p_player, p_videoInfo, -1.0, &decodedFrames) < 0)
+                    {
+                        // The error itself is set by the decode function
+                        segmentDone = true;
+                        endOfFile = true;
+                        break;
+                    }
+                } while (endOfFile && decodedFrames.size() > numDecoded);
                 
-            default:
-                targetChannelLayout = audioCodecContext->channel_layout;
+                for (unsigned int i = 0; i < decodedFrames.size(); ++i)
+                {
+                    VideoFrame* videoFrame = decodedFrames[i];
+                    if (segmentDone || videoFrame->pts >= segmentEnd - 0.0001)
+                    {
+                        segmentDone = true;
+                        delete videoFrame;
+                        continue;
+                    }
+                    
+                    gop.push_back(videoFrame);
+                    gopBytes += videoFrame->dataSize;
+                    while (gopBytes > budget / 2 && gop.size() > 1)
+                    {
+                        gopBytes -= gop.front()->dataSize;
+                        delete gop.front();
+                        gop.pop_front();
+                        truncated = true;
+                    }
+                }
+                decodedFrames.clear();
+            }
+            
+            if (!endOfFile)
+            {
+                av_free_packet(&packet);
+            }
+        }
+        
+        if (p_videoInfo.error.length() > 0)
+        {
+            break;
+        }
+        
+        // The seek landed on a keyframe at or after the segment, look further back
+        if (gop.empty())
+        {
+            if (segmentEnd - seekBack <= 0.0)
+            {
                 break;
+            }
+            seekBack += 1.0;
+            continue;
         }
+        seekBack = 0.0;
+        
+        // Wait until the player has room for the GOP
+        while (p_player->getBufferedVideoBytes() + gopBytes > budget && !p_videoInfo.decodingAborted)
+        {
+            boost::unique_lock<boost::mutex> lock(*p_decodeMutex);
+            boost::chrono::steady_clock::time_point const timeOut = 
+                boost::chrono::steady_clock::now() + boost::chrono::milliseconds(100);
+            p_decodeCondVar->wait_until(lock, timeOut);
+        }
+        
+        // Hand the GOP to the player, latest frame first
+        segmentEnd = gop.front()->pts;
+        while (!gop.empty())
+        {
+            if (p_videoInfo.decodingAborted)
+            {
+                delete gop.back();
+            }
+            else
+            {
+                p_player->addVideoFrame(gop.back());
+            }
+            gop.pop_back();
+        }
+        
+        if (staticOgreLog && p_player->getLogLevel() == LOGLEVEL_EXCESSIVE)
+        {
+            staticOgreLog->logMessage("Reverse decoded GOP down to " + boost::lexical_cast<std::string>(segmentEnd)
+                                        + (truncated ? " (partial)." : "."));
+        }
+    }
+    
+    for (unsigned int i = 0; i < gop.size(); ++i)
+    {
+        delete gop[i];
+    }
+    avcodec_free_frame(&frame);
+}
+
+
+//------------------------------------------------------------------------------
+DecodingContext::DecodingContext(ThreadInfo* p_threadInfo)
+    : _player(p_threadInfo->videoPlayer)
+    , _videoInfo(&p_threadInfo->videoPlayer->getVideoInfo())
+    , _decodingMutex(p_threadInfo->decodingMutex)
+    , _decodingCondVar(p_threadInfo->decodingCondVar)
+    , _playerCondVar(p_threadInfo->playerCondVar)
+    , _isLoop(p_threadInfo->isLoop)
+    , _startTime(p_threadInfo->startTime)
+    , _isReverse(p_threadInfo->isReverse)
+    , _codecThreadCount(p_threadInfo->codecThreadCount)
+    , _isOpen(false)
+    , _formatContext(NULL)
+    , _audioStream(NULL)
+    , _audioCodecContext(NULL)
+    , _audioStreamIndex(-1)
+    , _audioTrackSerial(0)
+    , _videoStream(NULL)
+    , _videoCodecContext(NULL)
+    , _videoStreamIndex(-1)
+    , _packet(NULL)
+    , _frame(NULL)
+    , _swsContext(NULL)
+    , _swrContext(NULL)
+    , _destBuffer(NULL)
+    , _destBufferLinesize(0)
+    , _skipUntil(0.0)
+    , _audioSkipUntil(0.0)
+    , _seekSerial(0)
+    , _openStartTime(0.0)
+    , _collectFrames(false)
+{
+    // Read ThreadInfo struct, then delete it
+    staticOgreLog = _player->getLog();
+    delete p_threadInfo;
+}
+
+//------------------------------------------------------------------------------
+DecodingContext::~DecodingContext()
+{
+    close();
+    
+    // Frames that were never handed to the player
+    for (unsigned int i = 0; i < _collectedVideoFrames.size(); ++i)
+    {
+        delete _collectedVideoFrames[i];
+    }
+    for (unsigned int i = 0; i < _collectedAudioFrames.size(); ++i)
+    {
+        delete _collectedAudioFrames[i];
+    }
+}
+
+//------------------------------------------------------------------------------
+bool 
+DecodingContext::open()
+{
+    VideoInfo& videoInfo = *_videoInfo;
+    _openStartTime = getSteadyTime();
+    
+    // Initialize FFmpeg  
+    initializeFFmpeg();
+    av_log_set_callback(log_callback);
+    av_log_set_level(AV_LOG_WARNING);
+    
+    // Initialize video decoding, filling the VideoInfo
+    // Open the input file and read stream information
+    if (!openVideoInput(_player->getVideoFilename(), _player->getResourceGroup(), _player->getInputSettings(), 
+                        _formatContext, videoInfo.error, &videoInfo.streamInfoFromCache)) 
+    {
+        _playerCondVar->notify_all();
+        return false;
+    }
+    
+    // Get streams
+    // Audio stream
+    _audioTrackSerial = _player->getAudioTrackSerial();
+    if (!openCodecContext(_formatContext, AVMEDIA_TYPE_AUDIO, videoInfo, _player->getAudioTrack(), 
+                          _player->getAudioTrackLanguage(), _audioStreamIndex)) 
+    {
+        // The error itself is set by openCodecContext
+        _playerCondVar->notify_all();
+        return false;
+    }
+    _audioStream = _formatContext->streams[_audioStreamIndex];
+    _audioCodecContext = _audioStream->codec;
+    
+    // Video stream
+    if (!openCodecContext(_formatContext, AVMEDIA_TYPE_VIDEO, videoInfo, _player->getVideoTrack(), 
+                          "", _videoStreamIndex, _codecThreadCount)) 
+    {
+        // The error itself is set by openCodecContext
+        _playerCondVar->notify_all();
+        return false;
     }
+    _videoStream = _formatContext->streams[_videoStreamIndex];
+    _videoCodecContext = _videoStream->codec;
+    
+    // Everything else does not even need to be demuxed.
+    // Reverse playback has no audio.
+    discardUnusedStreams(_formatContext, _isReverse ? -1 : _audioStreamIndex, _videoStreamIndex);
+    
+    // Dump information
+    av_dump_format(_formatContext, 0, _player->getVideoFilename().c_str(), 0);
+    
+    // Store useful information in VideoInfo struct
+    fillStreamInfos(_formatContext, videoInfo.streams);
+    videoInfo.audioStreamIndex = _audioStreamIndex;
+    videoInfo.videoStreamIndex = _videoStreamIndex;
+    double timeBase = ((double)_audioStream->time_base.num) / (double)_audioStream->time_base.den;
+    videoInfo.audioDuration = _audioStream->duration * timeBase;
+    videoInfo.audioSampleRate = _audioCodecContext->sample_rate;
+    videoInfo.audioBitRate = _audioCodecContext->bit_rate;
+    videoInfo.audioNumChannels = 
+            videoInfo.audioNumChannels > 0 ? videoInfo.audioNumChannels : _audioCodecContext->channels;
+    
+    timeBase = ((double)_videoStream->time_base.num) / (double)_videoStream->time_base.den;
+    videoInfo.videoDuration = _videoStream->duration * timeBase;
+    videoInfo.videoWidth = _videoCodecContext->width;
+    videoInfo.videoHeight = _videoCodecContext->height;
+    videoInfo.videoColorMatrix = FFmpegYUVPlanes::getColorMatrix(_videoCodecContext->colorspace, 
+                                                                 _videoCodecContext->height);
+    videoInfo.videoFullRange = FFmpegYUVPlanes::getIsFullRange(_videoCodecContext->color_range, 
+                                                               _videoCodecContext->pix_fmt);
+    
+    // If the a duration is below 0 seconds, something is very fishy. 
+    // Use format duration instead, it's the best guess we have
+    if (videoInfo.audioDuration < 0.0)
+    {
+        videoInfo.audioDuration = ((double)_formatContext->duration) / AV_TIME_BASE;
+    }
+    if (videoInfo.videoDuration < 0.0)
+    {
+        videoInfo.videoDuration = ((double)_formatContext->duration) / AV_TIME_BASE;
+    }
+ 
+    // Store the longer of both durations. This is what determines when looped videos
+    // will begin anew
+    videoInfo.longerDuration = videoInfo.videoDuration > videoInfo.audioDuration ? 
+                                videoInfo.videoDuration : videoInfo.audioDuration;
+            
+    // Wake up video player
+    videoInfo.infoFilled = true;
+    _playerCondVar->notify_all();
+    
+    // Initialize packet, set data to NULL, let the demuxer fill it
+    _packet = new AVPacket();
+    av_init_packet(_packet);
+    _packet->data = NULL;
+    _packet->size = 0;
     
     // Initialize SWR context
-    SwrContext* swrContext = swr_alloc_set_opts(NULL, 
-                targetChannelLayout, getAVSampleFormat(videoPlayer->getAudioSampleFormat()), audioCodecContext->sample_rate,
-                audioCodecContext->channel_layout, audioCodecContext->sample_fmt, audioCodecContext->sample_rate, 
-                0, NULL);
-    int result = swr_init(swrContext);
+    _swrContext = createSwrContext(_audioCodecContext, videoInfo.audioNumChannels, 
+                                videoInfo.audioSampleRate, _player->getAudioSampleFormat(), _rateState.rate);
+    int result = swr_init(_swrContext);
     if (result != 0) 
     {
         videoInfo.error = "Could not initialize swr context: " + boost::lexical_cast<std::string>(result);
-        playerCondVar->notify_all();
-        return;
+        _playerCondVar->notify_all();
+        return false;
     }
     
     // Create destination sample buffer
-    uint8_t** destBuffer = NULL;
-    int destBufferLinesize;
-    av_samples_alloc_array_and_samples( &destBuffer,
-                                        &destBufferLinesize,
+    av_samples_alloc_array_and_samples( &_destBuffer,
+                                        &_destBufferLinesize,
                                         videoInfo.audioNumChannels,
-                                        2048,
-                                        getAVSampleFormat(videoPlayer->getAudioSampleFormat()),
+                                        sAudioBufferNumSamples,
+                                        getAVSampleFormat(_player->getAudioSampleFormat()),
                                         0);
     
-    // Main decoding loop
-    // Read the input file frame by frame
-    AVFrame* frame = NULL;
-    while (av_read_frame(formatContext, &packet) >= 0) 
+    // Initialize frame
+    if (!(_frame = avcodec_alloc_frame())) 
+    {
+        videoInfo.error = "Out of memory.";
+        _playerCondVar->notify_all();
+        return false;
+    }
+    
+    // Start in the middle of the video if requested
+    _skipUntil = _isLoop ? 0.5 : 0.0;
+    _audioSkipUntil = _skipUntil;
+    if (_isReverse && _startTime <= 0.0)
     {
-        // Only start decoding when at least one of the buffers is not full
-        while (videoPlayer->getVideoBufferIsFull() && videoPlayer->getAudioBufferIsFull())
+        _startTime = videoInfo.videoDuration;
+    }
+    else if (!_isReverse && _startTime > 0.0)
+    {
+        if (seekToKeyframe(_formatContext, _videoStream, _startTime))
         {
-            boost::unique_lock<boost::mutex> lock(*decodeMutex);
-            boost::chrono::steady_clock::time_point const timeOut = 
-                boost::chrono::steady_clock::now() + boost::chrono::milliseconds((int)videoPlayer->getBufferTarget() * 1000);
-            decodeCondVar->wait_until(lock, timeOut);
-            
-            if (videoInfo.decodingAborted)
-            {
-                break;
-            }
+            avcodec_flush_buffers(_videoCodecContext);
+            avcodec_flush_buffers(_audioCodecContext);
+            _skipUntil = _startTime;
+            _audioSkipUntil = _startTime;
+            videoInfo.audioDecodedDuration = _startTime;
+            videoInfo.videoDecodedDuration = _startTime;
         }
-            
-        // Break if the decoding was aborted
-        if (videoInfo.decodingAborted)
+    }
+    
+    videoInfo.openDuration = getSteadyTime() - _openStartTime;
+    _isOpen = true;
+    return true;
+}
+
+//------------------------------------------------------------------------------
+DecodingStepResult 
+DecodingContext::step()
+{
+    VideoInfo& videoInfo = *_videoInfo;
+    
+    // Break if the decoding was aborted
+    if (videoInfo.decodingAborted)
+    {
+        return DSR_FINISHED;
+    }
+    
+    // Reverse playback has its own decoding loop
+    if (_isReverse)
+    {
+        decodeReverse(_formatContext, _videoStream, _videoCodecContext, _swsContext,
+                      _player, videoInfo, _startTime, _decodingMutex, _decodingCondVar);
+        if (videoInfo.error.length() > 0)
         {
-            break;
+            _playerCondVar->notify_all();
         }
-        
-        // Initialize frame
-        if (!frame) 
-        {
-            if (!(frame = avcodec_alloc_frame())) 
-            {
-                videoInfo.error = "Out of memory.";
-                return;
-            }
-        } 
-        else
+        return DSR_FINISHED;
+    }
+    
+    // Continue at another position if the player asked for it
+    double seekTime = 0.0;
+    bool keepAudio = false;
+    if (_player->getPendingSeek(_seekSerial, seekTime, keepAudio))
+    {
+        seek(seekTime, keepAudio);
+    }
+    
+    // Nothing is decoded while the player does not need it
+    if (_player->getIsDecodingSuspended())
+    {
+        return DSR_BUFFERS_FULL;
+    }
+    
+    // Only continue decoding when at least one of the buffers is not full
+    if (_player->getVideoBufferIsFull() && _player->getAudioBufferIsFull())
+    {
+        return DSR_BUFFERS_FULL;
+    }
+    
+    // Measure how long decoding takes compared to the decoded video time
+    boost::chrono::steady_clock::time_point workStart = boost::chrono::steady_clock::now();
+    double decodedBefore = videoInfo.videoDecodedDuration;
+    
+    // Switch the audio track if another one was requested
+    if (_player->getAudioTrackSerial() != _audioTrackSerial)
+    {
+        _audioTrackSerial = _player->getAudioTrackSerial();
+        switchAudioStream(_formatContext, _player, videoInfo, _audioStreamIndex, _videoStreamIndex, 
+                          _audioStream, _audioCodecContext, _swrContext, _rateState.rate);
+    }
+    
+    // Apply playback rate changes
+    RateState wantedRateState = getRateState(_player);
+    if (wantedRateState.rate != _rateState.rate 
+        || wantedRateState.keyframesOnly != _rateState.keyframesOnly
+        || wantedRateState.muteAudio != _rateState.muteAudio)
+    {
+        applyRateState(wantedRateState, _player, videoInfo, _videoCodecContext, _audioCodecContext, 
+                       _swrContext, _rateState);
+    }
+    
+    // Read the input file frame by frame
+    if (av_read_frame(_formatContext, _packet) < 0)
+    {
+        // A seek that came in meanwhile is done in the next step
+        unsigned int seekSerial = _seekSerial;
+        return _player->getPendingSeek(seekSerial, seekTime, keepAudio) ? DSR_DECODED : DSR_FINISHED;
+    }
+    avcodec_get_frame_defaults(_frame);
+    
+    // Decode the packet
+    AVPacket orig_pkt = *_packet;
+    do 
+    {
+        int decoded = 0;
+        if (_packet->stream_index == _audioStreamIndex)
         {
-            avcodec_get_frame_defaults(frame);
+            decoded = decodeAudioPacket(*_packet, _audioCodecContext, _audioStream, _frame, _swrContext,
+                                        _destBuffer, sAudioBufferNumSamples, _rateState, 
+                                        _player, videoInfo, _audioSkipUntil, 
+                                        _collectFrames ? &_collectedAudioFrames : NULL);
         }
-        
-        // Decode the packet
-        AVPacket orig_pkt = packet;
-        do 
+        else if (_packet->stream_index == _videoStreamIndex)
         {
-            int decoded = 0;
-            if (packet.stream_index == audioStreamIndex)
+            // When decoding keyframes only, the other packets do not even reach the decoder
+            if (_rateState.keyframesOnly && !(_packet->flags & AV_PKT_FLAG_KEY))
             {
-                decoded = decodeAudioPacket(packet, audioCodecContext, audioStream, frame, swrContext,
-                                            destBuffer, destBufferLinesize, videoPlayer, videoInfo, isLoop);
-            }
-            else if (packet.stream_index == videoStreamIndex)
-            {
-                decoded = decodeVideoPacket(packet, videoCodecContext, videoStream, frame, swsContext, 
-                                            (AVPicture*)destPic, videoPlayer, videoInfo, isLoop);
-            }
-            else
-            {
-                // This means that we have a stream that is neither our video nor audio stream
-                // Just skip the package
                 break;
             }
             
-            // decoded will be negative on an error
-            if (decoded < 0)
+            // A new decoder resolution needs a keyframe to start from
+            if ((_packet->flags & AV_PKT_FLAG_KEY) && getWantedLowres() != _videoCodecContext->lowres)
             {
-                // The error itself is set by the decode functions
-                playerCondVar->notify_all();
-                return;
+                if (!reopenVideoCodec(getWantedLowres()))
+                {
+                    av_free_packet(&orig_pkt);
+                    _playerCondVar->notify_all();
+                    return DSR_FINISHED;
+                }
             }
             
-            // Increment data pointer, subtract from size
-            packet.data += decoded;
-            packet.size -= decoded;
-        } while (packet.size > 0);
+            unsigned int outWidth = 0;
+            unsigned int outHeight = 0;
+            _player->getLodSize(_player->getLodLevel(), outWidth, outHeight);
+            decoded = decodeVideoPacket(*_packet, _videoCodecContext, _videoStream, _frame, _swsContext, 
+                                        outWidth, outHeight, _player, videoInfo, _skipUntil,
+                                        _collectFrames ? &_collectedVideoFrames : NULL);
+        }
+        else
+        {
+            // This means that we have a stream that is neither our video nor audio stream
+            // Just skip the package
+            break;
+        }
+        
+        // decoded will be negative on an error
+        if (decoded < 0)
+        {
+            // The error itself is set by the decode functions
+            av_free_packet(&orig_pkt);
+            _playerCondVar->notify_all();
+            return DSR_FINISHED;
+        }
         
-        av_free_packet(&orig_pkt);
+        // Increment data pointer, subtract from size
+        _packet->data += decoded;
+        _packet->size -= decoded;
+    } while (_packet->size > 0);
+    
+    double workTime = boost::chrono::duration<double>(boost::chrono::steady_clock::now() - workStart).count();
+    _player->addDecodeMeasurement(workTime, videoInfo.videoDecodedDuration - decodedBefore, 
+                                  orig_pkt.stream_index == _videoStreamIndex ? orig_pkt.size : 0);
+    _player->setInputStats(getVideoInputStats(_formatContext));
+    if (videoInfo.firstFrameLatency < 0.0 && videoInfo.videoDecodedDuration > decodedBefore)
+    {
+        videoInfo.firstFrameLatency = getSteadyTime() - _openStartTime;
     }
     
+    av_free_packet(&orig_pkt);
+    return DSR_DECODED;
+}
+
+//------------------------------------------------------------------------------
+void 
+DecodingContext::seek(double p_time, bool p_keepAudio)
+{
+    VideoInfo& videoInfo = *_videoInfo;
+    if (seekToKeyframe(_formatContext, _videoStream, p_time))
+    {
+        avcodec_flush_buffers(_videoCodecContext);
+        if (_audioCodecContext)
+        {
+            avcodec_flush_buffers(_audioCodecContext);
+        }
+        _skipUntil = p_time;
+        videoInfo.videoDecodedDuration = p_time;
+        
+        // Kept audio continues where it ended
+        if (p_keepAudio)
+        {
+            _audioSkipUntil = videoInfo.audioDecodedDuration;
+        }
+        else
+        {
+            _audioSkipUntil = p_time;
+            videoInfo.audioDecodedDuration = p_time;
+        }
+    }
+    else if (staticOgreLog)
+    {
+        staticOgreLog->logMessage("Seeking to " + boost::lexical_cast<std::string>(p_time) 
+                                    + " seconds failed, continuing at the current position.");
+    }
+    
+    // Collected frames belong to the old position
+    for (unsigned int i = 0; i < _collectedVideoFrames.size(); ++i)
+    {
+        delete _collectedVideoFrames[i];
+    }
+    _collectedVideoFrames.clear();
+    for (unsigned int i = 0; i < _collectedAudioFrames.size(); ++i)
+    {
+        delete _collectedAudioFrames[i];
+    }
+    _collectedAudioFrames.clear();
+    
+    _player->setSeekDone(_seekSerial);
+}
+
+//------------------------------------------------------------------------------
+int 
+DecodingContext::getWantedLowres() const
+{
+    int lowres = (int)_player->getLodLevel();
+    int maxLowres = _videoCodecContext->codec ? _videoCodecContext->codec->max_lowres : 0;
+    return lowres < maxLowres ? lowres : maxLowres;
+}
+
+//------------------------------------------------------------------------------
+bool 
+DecodingContext::reopenVideoCodec(int p_lowres)
+{
+    VideoInfo& videoInfo = *_videoInfo;
+    
+    // Frames the decoder still holds back are decoded at the old resolution first
+    AVPacket flushPacket;
+    av_init_packet(&flushPacket);
+    flushPacket.data = NULL;
+    flushPacket.size = 0;
+    unsigned int outWidth = 0;
+    unsigned int outHeight = 0;
+    _player->getLodSize(_player->getLodLevel(), outWidth, outHeight);
+    std::deque<VideoFrame*> delayedFrames;
+    unsigned int numDecoded = 0;
+    do
+    {
+        avcodec_get_frame_defaults(_frame);
+        numDecoded = delayedFrames.size();
+        if (decodeVideoPacket(flushPacket, _videoCodecContext, _videoStream, _frame, _swsContext, 
+                              outWidth, outHeight, _player, videoInfo, _skipUntil, &delayedFrames) < 0)
+        {
+            // Losing the delayed frames is no reason to stop decoding
+            videoInfo.error = "";
+            break;
+        }
+    } while (delayedFrames.size() > numDecoded);
+    for (unsigned int i = 0; i < delayedFrames.size(); ++i)
+    {
+        if (_collectFrames)
+        {
+            _collectedVideoFrames.push_back(delayedFrames[i]);
+        }
+        else
+        {
+            _player->addVideoFrame(delayedFrames[i]);
+        }
+    }
+    
+    const AVCodec* codec = _videoCodecContext->codec;
+    avcodec_close(_videoCodecContext);
+    _videoCodecContext->lowres = p_lowres;
+    if (avcodec_open2(_videoCodecContext, codec, NULL) < 0) 
+    {
+        videoInfo.error = "Failed to reopen video codec.";
+        return false;
+    }
+    
+    if (staticOgreLog && _player->getLogLevel() >= LOGLEVEL_NORMAL)
+    {
+        staticOgreLog->logMessage("Decoding video at 1/" + boost::lexical_cast<std::string>(1 << p_lowres) 
+                                    + " resolution.");
+    }
+    return true;
+}
+
+//------------------------------------------------------------------------------
+void 
+DecodingContext::close()
+{
     // We're done. Close everything
-    avcodec_free_frame(&frame);
-    avpicture_free((AVPicture*)destPic);
-    avcodec_free_frame(&destPic);
-    avcodec_close(videoCodecContext);
-    avcodec_close(audioCodecContext);
-    sws_freeContext(swsContext);
-    av_freep(&destBuffer[0]);
-    swr_free(&swrContext);
-    avformat_close_input(&formatContext);
-    
-    videoInfo.audioDuration = videoInfo.audioDecodedDuration;
-    videoInfo.decodingDone = videoInfo.decodingAborted ? false : true;
+    if (_frame)
+    {
+        avcodec_free_frame(&_frame);
+    }
+    if (_videoCodecContext)
+    {
+        avcodec_close(_videoCodecContext);
+        _videoCodecContext = NULL;
+    }
+    if (_audioCodecContext)
+    {
+        avcodec_close(_audioCodecContext);
+        _audioCodecContext = NULL;
+    }
+    if (_swsContext)
+    {
+        sws_freeContext(_swsContext);
+        _swsContext = NULL;
+    }
+    if (_destBuffer)
+    {
+        av_freep(&_destBuffer[0]);
+        av_freep(&_destBuffer);
+    }
+    if (_swrContext)
+    {
+        swr_free(&_swrContext);
+    }
+    if (_formatContext)
+    {
+        closeVideoInput(_formatContext);
+    }
+    delete _packet;
+    _packet = NULL;
+    
+    // Decoding that failed is not done
+    if (_isOpen && _videoInfo->error.length() == 0)
+    {
+        if (!_isReverse)
+        {
+            _videoInfo->audioDuration = _videoInfo->audioDecodedDuration;
+        }
+        _videoInfo->decodingDone = _videoInfo->decodingAborted ? false : true;
+    }
+    _isOpen = false;
+}
+
+//------------------------------------------------------------------------------
+void 
+DecodingContext::takeCollectedFrames(std::deque<VideoFrame*>& p_outVideoFrames, 
+                                     std::deque<AudioFrame*>& p_outAudioFrames)
+{
+    p_outVideoFrames.insert(p_outVideoFrames.end(), _collectedVideoFrames.begin(), _collectedVideoFrames.end());
+    p_outAudioFrames.insert(p_outAudioFrames.end(), _collectedAudioFrames.begin(), _collectedAudioFrames.end());
+    _collectedVideoFrames.clear();
+    _collectedAudioFrames.clear();
+}
+
+//------------------------------------------------------------------------------
+PlayerDecodingJob::PlayerDecodingJob(ThreadInfo* p_threadInfo)
+    : _player(p_threadInfo->videoPlayer)
+    , _context(p_threadInfo)
+    , _isOpen(false)
+{
+}
+
+//------------------------------------------------------------------------------
+PlayerDecodingJob::~PlayerDecodingJob()
+{
+}
+
+//------------------------------------------------------------------------------
+FFmpegDecoderPool::JobStepResult 
+PlayerDecodingJob::step()
+{
+    // The first step opens the file
+    if (!_isOpen)
+    {
+        _isOpen = true;
+        if (!_context.open())
+        {
+            _context.close();
+            return FFmpegDecoderPool::JSR_FINISHED;
+        }
+        return FFmpegDecoderPool::JSR_CONTINUE;
+    }
+    
+    // Decode until the time slice is used up, then let the pool decide again
+    boost::chrono::steady_clock::time_point const sliceEnd = boost::chrono::steady_clock::now() 
+                + boost::chrono::microseconds((int)(sPoolTimeSlice * 1000000));
+    do
+    {
+        DecodingStepResult result = _context.step();
+        if (result == DSR_FINISHED)
+        {
+            _context.close();
+            return FFmpegDecoderPool::JSR_FINISHED;
+        }
+        else if (result == DSR_BUFFERS_FULL)
+        {
+            return FFmpegDecoderPool::JSR_WAIT;
+        }
+    } while (boost::chrono::steady_clock::now() < sliceEnd);
+    
+    return FFmpegDecoderPool::JSR_CONTINUE;
+}
+
+//------------------------------------------------------------------------------
+void 
+PlayerDecodingJob::setCollectFrames(bool p_collect)
+{
+    _context.setCollectFrames(p_collect);
+}
+
+//------------------------------------------------------------------------------
+void 
+PlayerDecodingJob::deliverCollectedFrames()
+{
+    std::deque<VideoFrame*> videoFrames;
+    std::deque<AudioFrame*> audioFrames;
+    _context.takeCollectedFrames(videoFrames, audioFrames);
+    for (unsigned int i = 0; i < videoFrames.size(); ++i)
+    {
+        _player->addVideoFrame(videoFrames[i]);
+    }
+    for (unsigned int i = 0; i < audioFrames.size(); ++i)
+    {
+        _player->addAudioFrame(audioFrames[i]);
+    }
+}
+
+//------------------------------------------------------------------------------
+double 
+PlayerDecodingJob::getSecondsUntilDeadline()
+{
+    return _player->getBufferedPlaybackTime();
+}
+
+//------------------------------------------------------------------------------
+DecodingPriority 
+PlayerDecodingJob::getPriority()
+{
+    return _player->getDecodingPriority();
+}
+
+//------------------------------------------------------------------------------
+void videoDecodingThread(ThreadInfo* p_threadInfo)
+{
+    FFmpegVideoPlayer* videoPlayer = p_threadInfo->videoPlayer;
+    boost::mutex* decodeMutex = p_threadInfo->decodingMutex;
+    boost::condition_variable* decodeCondVar = p_threadInfo->decodingCondVar;
+    DecoderThreadSettings threadSettings = p_threadInfo->threadSettings;
+    DecodingContext context(p_threadInfo);
+    
+    // Place the thread before opening the codecs, so their threads end up in the same place
+    applyDecoderThreadSettings(threadSettings, 
+                               videoPlayer->getLogLevel() >= LOGLEVEL_NORMAL ? videoPlayer->getLog() : NULL, 
+                               videoPlayer->getVideoFilename().c_str());
+    if (!context.open())
+    {
+        return;
+    }
+    
+    // Main decoding loop
+    DecodingStepResult result = DSR_DECODED;
+    while ((result = context.step()) != DSR_FINISHED) 
+    {
+        // Sleep while both buffers are full, the player wakes us up when it takes frames out
+        if (result == DSR_BUFFERS_FULL)
+        {
+            boost::unique_lock<boost::mutex> lock(*decodeMutex);
+            boost::chrono::steady_clock::time_point const timeOut = 
+                boost::chrono::steady_clock::now() + boost::chrono::milliseconds((int)(videoPlayer->getCurrentBufferTarget() * 1000));
+            decodeCondVar->wait_until(lock, timeOut);
+        }
+    }
+    
+    context.close();
 }
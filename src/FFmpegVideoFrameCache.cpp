@@ -0,0 +1,143 @@
+/* 
+ * File:   FFmpegVideoFrameCache.cpp
+ * Author: TheSHEEEP
+ * 
+ * Created on 19. Oktober 2026, 14:40
+ */
+
+#include "FFmpegVideoFrameCache.h"
+#include "FFmpegVideoPlayer.h"
+
+//------------------------------------------------------------------------------
+VideoFrameCache::VideoFrameCache()
+    : _bytes(0)
+    , _budget(128 * 1024 * 1024)
+{
+}
+
+//------------------------------------------------------------------------------
+VideoFrameCache::~VideoFrameCache()
+{
+    clear();
+}
+
+//------------------------------------------------------------------------------
+void 
+VideoFrameCache::setBudget(size_t p_bytes)
+{
+    _budget = p_bytes;
+    evict();
+}
+
+//------------------------------------------------------------------------------
+size_t 
+VideoFrameCache::getBudget() const
+{
+    return _budget;
+}
+
+//------------------------------------------------------------------------------
+size_t 
+VideoFrameCache::getBytes() const
+{
+    return _bytes;
+}
+
+//------------------------------------------------------------------------------
+size_t 
+VideoFrameCache::size() const
+{
+    return _entries.size();
+}
+
+//------------------------------------------------------------------------------
+void 
+VideoFrameCache::insert(VideoFrame* p_frame)
+{
+    EntryMap::iterator it = _entries.find(p_frame->pts);
+    if (it != _entries.end())
+    {
+        _bytes -= it->second.frame->dataSize;
+        delete it->second.frame;
+        _lru.erase(it->second.lruPosition);
+        _entries.erase(it);
+    }
+    
+    _lru.push_front(p_frame->pts);
+    Entry entry;
+    entry.frame = p_frame;
+    entry.lruPosition = _lru.begin();
+    _entries[p_frame->pts] = entry;
+    _bytes += p_frame->dataSize;
+    
+    evict();
+}
+
+//------------------------------------------------------------------------------
+const VideoFrame* 
+VideoFrameCache::find(double p_time)
+{
+    EntryMap::const_iterator it = findEntry(p_time);
+    if (it == _entries.end())
+    {
+        return NULL;
+    }
+    
+    // Move to the front of the LRU list
+    _lru.splice(_lru.begin(), _lru, it->second.lruPosition);
+    return it->second.frame;
+}
+
+//------------------------------------------------------------------------------
+bool 
+VideoFrameCache::contains(double p_time) const
+{
+    return findEntry(p_time) != _entries.end();
+}
+
+//------------------------------------------------------------------------------
+void 
+VideoFrameCache::clear()
+{
+    for (EntryMap::iterator it = _entries.begin(); it != _entries.end(); ++it)
+    {
+        delete it->second.frame;
+    }
+    _entries.clear();
+    _lru.clear();
+    _bytes = 0;
+}
+
+//------------------------------------------------------------------------------
+VideoFrameCache::EntryMap::const_iterator 
+VideoFrameCache::findEntry(double p_time) const
+{
+    // The last frame that starts at or before the time must also still be shown at that time
+    EntryMap::const_iterator it = _entries.upper_bound(p_time);
+    if (it == _entries.begin())
+    {
+        return _entries.end();
+    }
+    --it;
+    
+    const VideoFrame* frame = it->second.frame;
+    if (frame->pts + frame->lifeTime <= p_time)
+    {
+        return _entries.end();
+    }
+    return it;
+}
+
+//------------------------------------------------------------------------------
+void 
+VideoFrameCache::evict()
+{
+    while (_bytes > _budget && _entries.size() > 1)
+    {
+        EntryMap::iterator it = _entries.find(_lru.back());
+        _bytes -= it->second.frame->dataSize;
+        delete it->second.frame;
+        _entries.erase(it);
+        _lru.pop_back();
+    }
+}
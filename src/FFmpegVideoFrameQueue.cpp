@@ -0,0 +1,152 @@
+/* 
+ * File:   FFmpegVideoFrameQueue.cpp
+ * Author: TheSHEEEP
+ * 
+ * Created on 19. Oktober 2026, 10:12
+ */
+
+#include "FFmpegVideoFrameQueue.h"
+#include "FFmpegVideoPlayer.h"
+
+// Initial number of slots, must be a power of two
+static const size_t sInitialCapacity = 64;
+
+//------------------------------------------------------------------------------
+VideoFrameQueue::VideoFrameQueue()
+    : _ring(sInitialCapacity, (VideoFrame*)NULL)
+    , _head(0)
+    , _count(0)
+    , _bytes(0)
+    , _reversed(false)
+{
+}
+
+//------------------------------------------------------------------------------
+VideoFrameQueue::~VideoFrameQueue()
+{
+    clear();
+}
+
+//------------------------------------------------------------------------------
+void 
+VideoFrameQueue::push(VideoFrame* p_frame)
+{
+    if (_count == _ring.size())
+    {
+        grow();
+    }
+    
+    _ring[(_head + _count) & (_ring.size() - 1)] = p_frame;
+    ++_count;
+    _bytes += p_frame->dataSize;
+}
+
+//------------------------------------------------------------------------------
+VideoFrame* 
+VideoFrameQueue::getFrameForTime(double p_time, unsigned int& p_outNumReleased)
+{
+    // Nothing is due yet
+    if (_count == 0 || !isDue(at(0), p_time))
+    {
+        return NULL;
+    }
+    
+    // Find the last frame that is due
+    size_t due = 0;
+    while (due + 1 < _count && isDue(at(due + 1), p_time))
+    {
+        ++due;
+    }
+    
+    // Release all frames before it in bulk
+    for (size_t i = 0; i < due; ++i)
+    {
+        _bytes -= at(i)->dataSize;
+        delete at(i);
+    }
+    p_outNumReleased += due;
+    
+    VideoFrame* frame = at(due);
+    _bytes -= frame->dataSize;
+    _head = (_head + due + 1) & (_ring.size() - 1);
+    _count -= due + 1;
+    return frame;
+}
+
+//------------------------------------------------------------------------------
+VideoFrame* 
+VideoFrameQueue::popBack()
+{
+    if (_count == 0)
+    {
+        return NULL;
+    }
+    
+    VideoFrame* frame = at(_count - 1);
+    _bytes -= frame->dataSize;
+    --_count;
+    return frame;
+}
+
+//------------------------------------------------------------------------------
+void 
+VideoFrameQueue::clear()
+{
+    for (size_t i = 0; i < _count; ++i)
+    {
+        delete at(i);
+    }
+    _head = 0;
+    _count = 0;
+    _bytes = 0;
+}
+
+//------------------------------------------------------------------------------
+double 
+VideoFrameQueue::getBufferedTime() const
+{
+    if (_count == 0)
+    {
+        return 0.0;
+    }
+    
+    VideoFrame* first = at(0);
+    VideoFrame* last = at(_count - 1);
+    if (_reversed)
+    {
+        return first->pts + first->lifeTime - last->pts;
+    }
+    return last->pts + last->lifeTime - first->pts;
+}
+
+//------------------------------------------------------------------------------
+double 
+VideoFrameQueue::getLastPts() const
+{
+    return _count > 0 ? at(_count - 1)->pts : -1.0;
+}
+
+//------------------------------------------------------------------------------
+bool 
+VideoFrameQueue::isDue(const VideoFrame* p_frame, double p_time) const
+{
+    if (_reversed)
+    {
+        return p_frame->pts + p_frame->lifeTime >= p_time;
+    }
+    return p_frame->pts <= p_time;
+}
+
+//------------------------------------------------------------------------------
+void 
+VideoFrameQueue::grow()
+{
+    // Unroll the ring into a bigger one, oldest frame first
+    std::vector<VideoFrame*> ring(_ring.size() * 2, (VideoFrame*)NULL);
+    for (size_t i = 0; i < _count; ++i)
+    {
+        ring[i] = at(i);
+    }
+    _ring.swap(ring);
+    _head = 0;
+}
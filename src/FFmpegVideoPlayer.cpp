@@ -6,15 +6,47 @@
  */
 
 #include "FFmpegVideoPlayer.h"
+#include "FFmpegWorkQueueDecoder.h"
+#include "FFmpegUploadScheduler.h"
+#include "FFmpegTexturePool.h"
+#include "FFmpegResidentClipCache.h"
+#include "FFmpegBakedFrameCache.h"
 
 #include <OgreLogManager.h>
 #include <OgreMaterialManager.h>
 #include <OgreMaterial.h>
 #include <OgreTechnique.h>
 #include <OgrePass.h>
+#include <OgreMatrix4.h>
 #include <OgreHardwarePixelBuffer.h>
+#include <OgreSceneManager.h>
+#include <OgreRoot.h>
+#include <OgreResourceGroupManager.h>
 #include <boost/thread.hpp>
 #include <boost/lexical_cast.hpp>
+#include <cmath>
+
+// Decode measurements are collected over this much video before they count as one sample
+static const double sDecodeSampleTime = 0.25;
+// Weight of a new sample in the running averages
+static const double sDecodeSampleWeight = 0.2;
+// How fast the adaptive buffer target grows and shrinks, per second
+static const double sBufferTargetGrowRate = 0.5;
+static const double sBufferTargetShrinkRate = 0.05;
+
+//------------------------------------------------------------------------------
+StreamInfo::StreamInfo()
+    : index(-1)
+    , type(STREAMTYPE_OTHER)
+    , codecName("")
+    , language("")
+    , title("")
+    , audioSampleRate(0)
+    , audioNumChannels(0)
+    , videoWidth(0)
+    , videoHeight(0)
+{
+}
 
 //------------------------------------------------------------------------------
 VideoInfo::VideoInfo()
@@ -30,39 +62,125 @@ VideoInfo::VideoInfo()
     , videoDuration(0.0) 
     , videoWidth(0)
     , videoHeight(0)
+    , videoColorMatrix(YCM_BT601)
+    , videoFullRange(false)
     , longerDuration(0.0)
     , error("")
+    , audioStreamIndex(-1)
+    , videoStreamIndex(-1)
+    , openDuration(0.0)
+    , firstFrameLatency(-1.0)
+    , streamInfoFromCache(false)
 { 
 }
 
+//------------------------------------------------------------------------------
+MaterialBinding::MaterialBinding()
+    : materialName("")
+    , textureUnitName("")
+    , isMain(false)
+    , material(NULL)
+    , textureUnitState(NULL)
+    , originalTextureName("")
+{
+}
+
+//------------------------------------------------------------------------------
+BufferStats::BufferStats()
+    : bufferTarget(0.0)
+    , decodeLoad(0.0)
+    , decodeLoadDeviation(0.0)
+    , bitrate(0.0)
+    , bitrateDeviation(0.0)
+    , numUnderruns(0)
+{
+}
+
 FFmpegVideoPlayer* FFmpegVideoPlayer::_instance = NULL;  
 //------------------------------------------------------------------------------
 FFmpegVideoPlayer::FFmpegVideoPlayer() 
     : _materialName("")
     , _textureUnitName("")
     , _videoFileName("")
+    , _resourceGroup(Ogre::ResourceGroupManager::AUTODETECT_RESOURCE_GROUP_NAME)
     , _isPlaying(false)
     , _isPaused(false)
     , _isWaitingForBuffers(false)
+    , _startThreshold(-1.0)
+    , _showPosterFrame(false)
+    , _isPosterShown(false)
     , _audioPlaybackTime(0.0)
     , _videoPlaybackTime(0.0)
     , _videoBuffersFilledWithBackup(false)
     , _isDecoding(false)
     , _isLooping(false)
     , _bufferTarget(1.5)
+    , _isBufferTargetAdaptive(false)
+    , _minBufferTarget(0.5)
+    , _maxBufferTarget(5.0)
+    , _adaptiveBufferTarget(1.5)
+    , _decodeLoadVariance(0.0)
+    , _bitrateVariance(0.0)
+    , _numDecodeSamples(0)
+    , _measuredWorkTime(0.0)
+    , _measuredVideoTime(0.0)
+    , _measuredVideoBytes(0)
+    , _isUnderrun(false)
     , _forcedAudioChannels(0)
+    , _audioTrack(-1)
+    , _audioTrackLanguage("")
+    , _audioTrackSerial(0)
+    , _videoTrack(-1)
+    , _playbackRate(1.0)
+    , _keyframeOnlyRate(2.0)
+    , _audioRatePolicy(ARP_RESAMPLE)
+    , _isReversed(false)
+    , _reverseCacheBudget(256 * 1024 * 1024)
+    , _decodingStartTime(0.0)
+    , _decodingMode(DM_THREAD)
+    , _decodingPriority(DP_FOREGROUND)
+    , _useUploadScheduler(false)
+    , _uploadPriority(1.0)
+    , _onScreenWidth(0)
+    , _onScreenHeight(0)
+    , _maxLodLevel(3)
+    , _lodHysteresis(0.2)
+    , _lodLevel(0)
+    , _visibilitySceneManager(NULL)
+    , _lastRenderedFrame(0)
+    , _invisibleAfterFrames(5)
+    , _invisiblePolicy(IP_KEEP_DECODING)
+    , _isVisible(true)
+    , _isDecodingSuspended(false)
+    , _seekSerial(0)
+    , _seekTime(0.0)
+    , _isSeekPending(false)
+    , _seekKeepsAudio(false)
+    , _memoryLimit(0)
+    , _residentClipMaxBytes(0)
+    , _shareResidentClips(true)
+    , _isResident(false)
+    , _useBakedFrames(false)
+    , _isPlayingBaked(false)
+    , _bakeWriter(NULL)
+    , _residentFrame(NULL)
+    , _residentAudioFrame(0)
+    , _residentAudioAhead(0.0)
     , _currentDecodingThread(NULL)
+    , _decodingJob(NULL)
+    , _decodingJobMode(DM_THREAD)
     , _playerMutex(NULL)
     , _playerCondVar(NULL)
     , _decodingMutex(NULL)
     , _decodingCondVar(NULL)
     , _currentAudioStorage(0.0)
+    , _currentAudioBytes(0)
     , _currentAudioBackupStorage(0.0)
-    , _currentVideoStorage(0.0)
     , _currentVideoBackupStorage(0.0)
-    , _lastVideoFrameTimeRemaining(0.0)
-    , _originalTextureName("")
-    , _originalTextureUnitState(NULL)
+    , _videoTextureName("FFmpegVideoTexture")
+    , _useTexturePool(false)
+    , _isTextureFromPool(false)
+    , _videoOutputFormat(VOF_RGBA)
     , _framesPopped(0)
     , _log(NULL)
     , _logLevel(LOGLEVEL_NORMAL)
@@ -72,17 +190,20 @@ FFmpegVideoPlayer::FFmpegVideoPlayer()
     _playerCondVar = new boost::condition_variable();
     _decodingMutex = new boost::mutex();
     _decodingCondVar = new boost::condition_variable();
+    
+    FFMPEG_MEMORY_BUDGET->registerPlayer(this);
 }
 
 //------------------------------------------------------------------------------
 FFmpegVideoPlayer::~FFmpegVideoPlayer() 
 {
     // Delete old thread and thread info object
-    if (_currentDecodingThread != NULL)
+    joinDecoding();
+    setVisibilitySceneManager(NULL);
+    FFMPEG_MEMORY_BUDGET->unregisterPlayer(this);
+    if (_isTextureFromPool)
     {
-        _currentDecodingThread->join();
-        delete _currentDecodingThread;
-        _currentDecodingThread = NULL;
+        releaseVideoTexture();
     }
     
     // Delete old frames
@@ -91,10 +212,6 @@ FFmpegVideoPlayer::~FFmpegVideoPlayer()
         delete _audioFrames[i];
     }
     _audioFrames.clear();
-    for (unsigned int i = 0; i < _videoFrames.size(); ++i)
-    {
-        delete _videoFrames[i];
-    }
     _videoFrames.clear();
     
     // Delete sync objects
@@ -142,9 +259,56 @@ FFmpegVideoPlayer::setVideoFilename(const Ogre::String& p_name)
     if (!_isDecoding)
     {
         _videoFileName = p_name;
+        
+        // Measurements of the previous video do not apply to this one
+        _bufferStats = BufferStats();
+        _decodeLoadVariance = 0.0;
+        _bitrateVariance = 0.0;
+        _numDecodeSamples = 0;
+        _measuredWorkTime = 0.0;
+        _measuredVideoTime = 0.0;
+        _measuredVideoBytes = 0;
+        _isUnderrun = false;
+        _inputStats = InputStats();
+    }
+}
+
+//------------------------------------------------------------------------------
+void 
+FFmpegVideoPlayer::setResourceGroup(const Ogre::String& p_group)
+{
+    if (!_isDecoding)
+    {
+        _resourceGroup = p_group;
+    }
+}
+
+//------------------------------------------------------------------------------
+void 
+FFmpegVideoPlayer::setInputSettings(const InputSettings& p_settings)
+{
+    if (!_isDecoding && p_settings.readBufferSize > 0)
+    {
+        _inputSettings = p_settings;
     }
 }
 
+//------------------------------------------------------------------------------
+InputStats 
+FFmpegVideoPlayer::getInputStats()
+{
+    boost::mutex::scoped_lock lock(*_playerMutex);
+    return _inputStats;
+}
+
+//------------------------------------------------------------------------------
+void 
+FFmpegVideoPlayer::setInputStats(const InputStats& p_stats)
+{
+    boost::mutex::scoped_lock lock(*_playerMutex);
+    _inputStats = p_stats;
+}
+
 //------------------------------------------------------------------------------
 void 
 FFmpegVideoPlayer::setBufferTarget(double p_targetSeconds)
@@ -157,312 +321,1615 @@ FFmpegVideoPlayer::setBufferTarget(double p_targetSeconds)
 
 //------------------------------------------------------------------------------
 void 
-FFmpegVideoPlayer::addAudioFrame(AudioFrame* p_frame)
+FFmpegVideoPlayer::setStartThreshold(double p_thresholdSeconds)
+{
+    _startThreshold = p_thresholdSeconds;
+}
+
+//------------------------------------------------------------------------------
+void 
+FFmpegVideoPlayer::setShowPosterFrame(bool p_show)
+{
+    _showPosterFrame = p_show;
+}
+
+//------------------------------------------------------------------------------
+void 
+FFmpegVideoPlayer::setIsBufferTargetAdaptive(bool p_adaptive)
+{
+    if (p_adaptive && !_isBufferTargetAdaptive)
+    {
+        _adaptiveBufferTarget = _bufferTarget < _minBufferTarget ? _minBufferTarget : 
+                                _bufferTarget > _maxBufferTarget ? _maxBufferTarget : _bufferTarget;
+    }
+    _isBufferTargetAdaptive = p_adaptive;
+}
+
+//------------------------------------------------------------------------------
+void 
+FFmpegVideoPlayer::setBufferTargetBounds(double p_minSeconds, double p_maxSeconds)
+{
+    _minBufferTarget = p_minSeconds;
+    _maxBufferTarget = p_maxSeconds > p_minSeconds ? p_maxSeconds : p_minSeconds;
+    _adaptiveBufferTarget = _adaptiveBufferTarget < _minBufferTarget ? _minBufferTarget : 
+                            _adaptiveBufferTarget > _maxBufferTarget ? _maxBufferTarget : _adaptiveBufferTarget;
+}
+
+//------------------------------------------------------------------------------
+BufferStats 
+FFmpegVideoPlayer::getBufferStats()
 {
     boost::mutex::scoped_lock lock(*_playerMutex);
-    _audioFrames.push_back(p_frame);
-    _currentAudioStorage += p_frame->lifeTime;
+    BufferStats stats = _bufferStats;
+    stats.bufferTarget = getCurrentBufferTarget();
+    stats.decodeLoadDeviation = std::sqrt(_decodeLoadVariance);
+    stats.bitrateDeviation = std::sqrt(_bitrateVariance);
+    return stats;
+}
+
+//------------------------------------------------------------------------------
+void 
+FFmpegVideoPlayer::addDecodeMeasurement(double p_workTime, double p_videoTime, size_t p_videoBytes)
+{
+    // Seeks move the decoded position backwards
+    if (p_videoTime < 0.0)
+    {
+        return;
+    }
     
-    // Create backup for first 0.5 seconds if looping
-    if (_isLooping && _currentAudioBackupStorage < 0.5)
+    boost::mutex::scoped_lock lock(*_playerMutex);
+    _measuredWorkTime += p_workTime;
+    _measuredVideoTime += p_videoTime;
+    _measuredVideoBytes += p_videoBytes;
+    if (_measuredVideoTime < sDecodeSampleTime)
     {
-        _backupAudioFrames.push_back(new AudioFrame(*p_frame));
-        _currentAudioBackupStorage += p_frame->lifeTime;
+        return;
+    }
+    
+    // Exponentially weighted average and variance, so old measurements fade out
+    double load = _measuredWorkTime / _measuredVideoTime;
+    double bitrate = _measuredVideoBytes / _measuredVideoTime;
+    if (_numDecodeSamples == 0)
+    {
+        _bufferStats.decodeLoad = load;
+        _bufferStats.bitrate = bitrate;
+    }
+    else
+    {
+        double loadDiff = load - _bufferStats.decodeLoad;
+        _bufferStats.decodeLoad += sDecodeSampleWeight * loadDiff;
+        _decodeLoadVariance = (1.0 - sDecodeSampleWeight) * (_decodeLoadVariance + sDecodeSampleWeight * loadDiff * loadDiff);
         
-        if (_currentAudioBackupStorage > 1.0)
+        double bitrateDiff = bitrate - _bufferStats.bitrate;
+        _bufferStats.bitrate += sDecodeSampleWeight * bitrateDiff;
+        _bitrateVariance = (1.0 - sDecodeSampleWeight) * (_bitrateVariance + sDecodeSampleWeight * bitrateDiff * bitrateDiff);
+    }
+    ++_numDecodeSamples;
+    
+    _measuredWorkTime = 0.0;
+    _measuredVideoTime = 0.0;
+    _measuredVideoBytes = 0;
+}
+
+//------------------------------------------------------------------------------
+void 
+FFmpegVideoPlayer::updateAdaptiveBufferTarget(double p_time)
+{
+    if (!_isBufferTargetAdaptive)
+    {
+        return;
+    }
+    
+    double load = 0.0;
+    double peakLoad = 0.0;
+    {
+        boost::mutex::scoped_lock lock(*_playerMutex);
+        if (_numDecodeSamples == 0)
         {
-            int i = 0;
-            ++i;
+            return;
         }
+        
+        // The share of real time the decoder needs to keep up, and the same for a bad moment.
+        // Bitrate peaks make bad moments more likely.
+        double bitrateSpread = _bufferStats.bitrate > 0.0 ? std::sqrt(_bitrateVariance) / _bufferStats.bitrate : 0.0;
+        load = _bufferStats.decodeLoad * _playbackRate;
+        peakLoad = (_bufferStats.decodeLoad + 2.0 * std::sqrt(_decodeLoadVariance)) * _playbackRate 
+                    * (1.0 + bitrateSpread);
+    }
+    
+    double target = _adaptiveBufferTarget;
+    if (load > 0.9 || peakLoad > 1.0)
+    {
+        target *= 1.0 + sBufferTargetGrowRate * p_time;
     }
+    else if (peakLoad < 0.5)
+    {
+        target *= 1.0 - sBufferTargetShrinkRate * p_time;
+    }
+    _adaptiveBufferTarget = target < _minBufferTarget ? _minBufferTarget : 
+                            target > _maxBufferTarget ? _maxBufferTarget : target;
 }
 
 //------------------------------------------------------------------------------
 void 
-FFmpegVideoPlayer::addVideoFrame(VideoFrame* p_frame)
+FFmpegVideoPlayer::setAudioTrack(int p_streamIndex)
 {
     boost::mutex::scoped_lock lock(*_playerMutex);
-    _videoFrames.push_back(p_frame);
-    _currentVideoStorage += p_frame->lifeTime;
-    
-    // Create backup for first 0.5 seconds if looping
-    if (_isLooping && _currentVideoBackupStorage < 0.5)
+    _audioTrack = p_streamIndex;
+    _audioTrackLanguage = "";
+    ++_audioTrackSerial;
+}
+
+//------------------------------------------------------------------------------
+void 
+FFmpegVideoPlayer::setAudioTrackByLanguage(const Ogre::String& p_language)
+{
+    boost::mutex::scoped_lock lock(*_playerMutex);
+    _audioTrack = -1;
+    _audioTrackLanguage = p_language;
+    ++_audioTrackSerial;
+}
+
+//------------------------------------------------------------------------------
+int 
+FFmpegVideoPlayer::getAudioTrack() const
+{
+    boost::mutex::scoped_lock lock(*_playerMutex);
+    return _audioTrack;
+}
+
+//------------------------------------------------------------------------------
+Ogre::String 
+FFmpegVideoPlayer::getAudioTrackLanguage() const
+{
+    boost::mutex::scoped_lock lock(*_playerMutex);
+    return _audioTrackLanguage;
+}
+
+//------------------------------------------------------------------------------
+unsigned int 
+FFmpegVideoPlayer::getAudioTrackSerial() const
+{
+    boost::mutex::scoped_lock lock(*_playerMutex);
+    return _audioTrackSerial;
+}
+
+//------------------------------------------------------------------------------
+void 
+FFmpegVideoPlayer::setVideoTrack(int p_streamIndex)
+{
+    if (!_isDecoding)
     {
-        _backupVideoFrames.push_back(new VideoFrame(*p_frame));
-        _currentVideoBackupStorage += p_frame->lifeTime;
+        _videoTrack = p_streamIndex;
     }
 }
 
 //------------------------------------------------------------------------------
-bool 
-FFmpegVideoPlayer::getAudioBufferIsFull()
+void 
+FFmpegVideoPlayer::setPlaybackRate(double p_rate)
 {
     boost::mutex::scoped_lock lock(*_playerMutex);
-    return _currentAudioStorage >= _bufferTarget;
+    _playbackRate = p_rate < 0.25 ? 0.25 : (p_rate > 8.0 ? 8.0 : p_rate);
+    
+    if (_log && _logLevel >= LOGLEVEL_NORMAL) 
+        _log->logMessage("Playback rate set to " + boost::lexical_cast<std::string>(_playbackRate) + ".");
 }
 
 //------------------------------------------------------------------------------
-bool 
-FFmpegVideoPlayer::getVideoBufferIsFull()
+double 
+FFmpegVideoPlayer::getPlaybackRate() const
 {
     boost::mutex::scoped_lock lock(*_playerMutex);
-    return _currentVideoStorage >= _bufferTarget;
+    return _playbackRate;
 }
 
 //------------------------------------------------------------------------------
 void 
-FFmpegVideoPlayer::setAudioPlaybackDone()
+FFmpegVideoPlayer::setKeyframeOnlyRate(double p_rate)
+{
+    boost::mutex::scoped_lock lock(*_playerMutex);
+    _keyframeOnlyRate = p_rate;
+}
+
+//------------------------------------------------------------------------------
+double 
+FFmpegVideoPlayer::getKeyframeOnlyRate() const
 {
     boost::mutex::scoped_lock lock(*_playerMutex);
+    return _keyframeOnlyRate;
+}
+
+//------------------------------------------------------------------------------
+void 
+FFmpegVideoPlayer::setIsReversed(bool p_reversed)
+{
+    if (_isReversed == p_reversed)
+    {
+        return;
+    }
     
-    // set time to maximum
-    _audioPlaybackTime = _videoInfo.audioDuration;
+    _isReversed = p_reversed;
+    if (_isDecoding)
+    {
+        restartDecodingAt(_videoPlaybackTime);
+    }
+}
+
+//------------------------------------------------------------------------------
+void 
+FFmpegVideoPlayer::getLodSize(unsigned int p_level, unsigned int& p_outWidth, unsigned int& p_outHeight) const
+{
+    // Round up like the decoders do, so a level never has less than one pixel
+    unsigned int divisor = 1 << p_level;
+    p_outWidth = (_videoInfo.videoWidth + divisor - 1) / divisor;
+    p_outHeight = (_videoInfo.videoHeight + divisor - 1) / divisor;
+}
+
+//------------------------------------------------------------------------------
+void 
+FFmpegVideoPlayer::setVisibilitySceneManager(Ogre::SceneManager* p_sceneManager)
+{
+    if (_visibilitySceneManager)
+    {
+        _visibilitySceneManager->removeRenderObjectListener(this);
+    }
+    _visibilitySceneManager = p_sceneManager;
+    if (_visibilitySceneManager)
+    {
+        _visibilitySceneManager->addRenderObjectListener(this);
+    }
     
-    if (_log && _logLevel >= LOGLEVEL_NORMAL) 
+    // Count as rendered right now, so the video does not disappear before the scene manager rendered it once
+    _lastRenderedFrame = Ogre::Root::getSingletonPtr()->getNextFrameNumber();
+}
+
+//------------------------------------------------------------------------------
+bool 
+FFmpegVideoPlayer::getPendingSeek(unsigned int& p_ioSerial, double& p_outTime, bool& p_outKeepAudio)
+{
+    boost::mutex::scoped_lock lock(*_playerMutex);
+    if (!_isSeekPending || p_ioSerial == _seekSerial)
     {
-        _log->logMessage("Audio playback reported done. ");
+        return false;
     }
+    p_ioSerial = _seekSerial;
+    p_outTime = _seekTime;
+    p_outKeepAudio = _seekKeepsAudio;
+    return true;
+}
+
+//------------------------------------------------------------------------------
+void 
+FFmpegVideoPlayer::setSeekDone(unsigned int p_serial)
+{
+    boost::mutex::scoped_lock lock(*_playerMutex);
     
-    // Update the longerDuration as it is possible that the audio duration changed
-    _videoInfo.longerDuration = _videoInfo.videoDuration > _videoInfo.audioDuration ? 
-                                _videoInfo.videoDuration : _videoInfo.audioDuration;
+    // A newer seek may have been requested in the meantime
+    if (p_serial == _seekSerial)
+    {
+        _isSeekPending = false;
+    }
+}
+
+//------------------------------------------------------------------------------
+MemoryUsage 
+FFmpegVideoPlayer::getMemoryUsage()
+{
+    boost::mutex::scoped_lock lock(*_playerMutex);
     
-    // If looping, apply the backup audio buffer here
-    if (_isLooping)
+    MemoryUsage usage;
+    usage.videoBytes = _videoFrames.getBufferedBytes();
+    usage.audioBytes = _currentAudioBytes;
+    // Backups share their data with the frames they were taken from, which count it as long as they exist
+    for (unsigned int i = 0; i < _backupVideoFrames.size(); ++i)
     {
-        for (unsigned int i = 0; i < _audioFrames.size(); ++i)
+        if (_backupVideoFrames[i]->buffer.use_count() == 1)
         {
-            delete _audioFrames[i];
+            usage.backupBytes += _backupVideoFrames[i]->dataSize;
         }
-        _audioFrames.clear();
-        
-        for (unsigned int i = 0; i < _backupAudioFrames.size(); ++i)
+    }
+    for (unsigned int i = 0; i < _backupAudioFrames.size(); ++i)
+    {
+        if (_backupAudioFrames[i]->buffer.use_count() == 1)
         {
-            _currentAudioStorage += _backupAudioFrames[i]->lifeTime;
-            _audioFrames.push_back(new AudioFrame(*_backupAudioFrames[i]));
+            usage.backupBytes += _backupAudioFrames[i]->dataSize;
         }
-        
-        if (_log && _logLevel >= LOGLEVEL_NORMAL) 
-            _log->logMessage("Added audio backup to storage.");
     }
+    
+    // Players showing the same clip split it, so it is counted once in total.
+    // Each player holds its clip once, while filling it or while playing it.
+    if (_residentClip)
+    {
+        usage.residentBytes = _residentClip->getBytes() / _residentClip.use_count();
+    }
+    else if (_frameClip)
+    {
+        usage.residentBytes = _frameClip->getBytes() / _frameClip.use_count();
+    }
+    if (_isResident)
+    {
+        // Nothing is buffered, and nothing needs to be
+        usage.bufferedTime = getCurrentBufferTarget();
+        return usage;
+    }
+    
+    // Same as getBufferedPlaybackTime
+    double videoTime = _videoFrames.getBufferedTime() / _playbackRate;
+    usage.bufferedTime = _isReversed || videoTime < _currentAudioStorage ? videoTime : _currentAudioStorage;
+    return usage;
 }
 
-
 //------------------------------------------------------------------------------
-bool  
-FFmpegVideoPlayer::startPlaying()
+void 
+FFmpegVideoPlayer::setMemoryLimit(size_t p_bytes)
 {
-    // Start decoding first
-    bool decoding = startDecoding();
-
-    // Sanity checks
-    if (!decoding)
+    bool raised = p_bytes == 0 || (_memoryLimit > 0 && p_bytes > _memoryLimit);
     {
-        if (_log && _logLevel >= LOGLEVEL_MINIMAL) 
-             _log->logMessage("Can't play video. Decoding failed.", Ogre::LML_CRITICAL);
-        return false;
+        boost::mutex::scoped_lock lock(*_playerMutex);
+        _memoryLimit = p_bytes;
     }
-    if (_isPlaying)
+    if (raised)
     {
-        if (_log && _logLevel >= LOGLEVEL_MINIMAL) 
-            _log->logMessage("Can't play another video. Video is already playing.", Ogre::LML_CRITICAL);
-        return false;
+        wakeDecoder();
     }
-    if (_materialName == "" || _textureUnitName == "")
+}
+
+//------------------------------------------------------------------------------
+void 
+FFmpegVideoPlayer::trimBuffers(size_t p_maxBytes)
+{
+    // Dropped frames can only be decoded again by a decoder that is still running forwards
+    if (!_isDecoding || _isReversed || _videoBuffersFilledWithBackup || _videoInfo.decodingDone)
+    {
+        return;
+    }
+    
+    double resumeTime = -1.0;
+    {
+        boost::mutex::scoped_lock lock(*_playerMutex);
+        if (_isSeekPending)
+        {
+            return;
+        }
+        
+        // Keep at least the frame that is shown next
+        while (_videoFrames.size() > 1 && _videoFrames.getBufferedBytes() + _currentAudioBytes > p_maxBytes)
+        {
+            VideoFrame* frame = _videoFrames.popBack();
+            resumeTime = frame->pts;
+            delete frame;
+        }
+        if (resumeTime < 0.0)
+        {
+            return;
+        }
+        
+        _seekTime = resumeTime;
+        ++_seekSerial;
+        _isSeekPending = true;
+        _seekKeepsAudio = true;
+    }
+    
+    if (_log && _logLevel >= LOGLEVEL_NORMAL) 
+        _log->logMessage("Trimmed video buffer to fit the memory budget, continuing decoding at " 
+                            + boost::lexical_cast<std::string>(resumeTime) + " seconds.");
+    wakeDecoder();
+}
+
+//------------------------------------------------------------------------------
+size_t 
+FFmpegVideoPlayer::getBufferedVideoBytes()
+{
+    boost::mutex::scoped_lock lock(*_playerMutex);
+    return _videoFrames.getBufferedBytes();
+}
+
+//------------------------------------------------------------------------------
+double 
+FFmpegVideoPlayer::getBufferedPlaybackTime()
+{
+    boost::mutex::scoped_lock lock(*_playerMutex);
+    
+    // Video frames are timed in video time, audio frames already in real time
+    double videoTime = _videoFrames.getBufferedTime() / _playbackRate;
+    if (_isReversed)
+    {
+        return videoTime;
+    }
+    return videoTime < _currentAudioStorage ? videoTime : _currentAudioStorage;
+}
+
+//------------------------------------------------------------------------------
+void 
+FFmpegVideoPlayer::addAudioFrame(AudioFrame* p_frame)
+{
+    boost::mutex::scoped_lock lock(*_playerMutex);
+    
+    // Frames decoded before a seek belong to the old position
+    if (_isSeekPending && !_seekKeepsAudio)
+    {
+        delete p_frame;
+        return;
+    }
+    
+    // Baked frames go to the bake file only, so the buffers never fill up
+    if (_bakeWriter)
+    {
+        _bakeWriter->addAudioFrame(*p_frame);
+        delete p_frame;
+        return;
+    }
+    
+    _audioFrames.push_back(p_frame);
+    _currentAudioStorage += p_frame->lifeTime;
+    _currentAudioBytes += p_frame->dataSize;
+    
+    // Keep everything of the first loop if the clip may stay in memory, audio of other rates is resampled
+    if (_residentClip && !_isResident && (_playbackRate != 1.0 || !_residentClip->addAudioFrame(*p_frame)))
+    {
+        dropResidentClip();
+    }
+    
+    // Create backup for first 0.5 seconds if looping
+    if (_isLooping && _currentAudioBackupStorage < 0.5)
+    {
+        _backupAudioFrames.push_back(new AudioFrame(*p_frame));
+        _currentAudioBackupStorage += p_frame->lifeTime;
+        
+        if (_currentAudioBackupStorage > 1.0)
+        {
+            int i = 0;
+            ++i;
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+void 
+FFmpegVideoPlayer::addVideoFrame(VideoFrame* p_frame)
+{
+    boost::mutex::scoped_lock lock(*_playerMutex);
+    
+    // While the video backup waits for the next loop, frames from the end of the 
+    // previous loop would break the presentation order
+    // Frames decoded before a seek belong to the old position
+    if (_videoBuffersFilledWithBackup || _isSeekPending)
+    {
+        delete p_frame;
+        return;
+    }
+    
+    // Baked frames go to the bake file only, so the buffers never fill up
+    if (_bakeWriter)
+    {
+        _bakeWriter->addVideoFrame(*p_frame);
+        delete p_frame;
+        return;
+    }
+    
+    // Keep everything of the first loop if the clip may stay in memory
+    if (_residentClip && !_isResident && !_residentClip->addVideoFrame(*p_frame))
+    {
+        dropResidentClip();
+    }
+    
+    _videoFrames.push(p_frame);
+    
+    // Create backup for first 0.5 seconds if looping
+    if (_isLooping && _currentVideoBackupStorage < 0.5)
+    {
+        _backupVideoFrames.push_back(new VideoFrame(*p_frame));
+        _currentVideoBackupStorage += p_frame->lifeTime;
+    }
+}
+
+//------------------------------------------------------------------------------
+bool 
+FFmpegVideoPlayer::getAudioBufferIsFull()
+{
+    boost::mutex::scoped_lock lock(*_playerMutex);
+    
+    // Baking decodes as fast as possible, nothing is buffered
+    if (_bakeWriter)
+    {
+        return false;
+    }
+    
+    // There is no audio in reverse playback
+    return _isReversed || _currentAudioStorage >= getCurrentBufferTarget() || getIsOverMemoryLimit();
+}
+
+//------------------------------------------------------------------------------
+bool 
+FFmpegVideoPlayer::getVideoBufferIsFull()
+{
+    boost::mutex::scoped_lock lock(*_playerMutex);
+    
+    // Baking decodes as fast as possible, nothing is buffered
+    if (_bakeWriter)
+    {
+        return false;
+    }
+    
+    // Video frames are timed in video time, which passes faster or slower than real time
+    return _videoFrames.getBufferedTime() >= getCurrentBufferTarget() * _playbackRate || getIsOverMemoryLimit();
+}
+
+//------------------------------------------------------------------------------
+void 
+FFmpegVideoPlayer::setAudioPlaybackDone()
+{
+    boost::mutex::scoped_lock lock(*_playerMutex);
+    
+    // set time to maximum
+    _audioPlaybackTime = _videoInfo.audioDuration;
+    
+    if (_log && _logLevel >= LOGLEVEL_NORMAL) 
+    {
+        _log->logMessage("Audio playback reported done. ");
+    }
+    
+    // Update the longerDuration as it is possible that the audio duration changed
+    _videoInfo.longerDuration = _videoInfo.videoDuration > _videoInfo.audioDuration ? 
+                                _videoInfo.videoDuration : _videoInfo.audioDuration;
+    
+    // Resident clips hand out their audio from the start again
+    if (_isResident)
+    {
+        for (unsigned int i = 0; i < _audioFrames.size(); ++i)
+        {
+            delete _audioFrames[i];
+        }
+        _audioFrames.clear();
+        _currentAudioStorage = 0.0;
+        _currentAudioBytes = 0;
+        _residentAudioFrame = 0;
+        _residentAudioAhead = 0.0;
+    }
+    // If looping, apply the backup audio buffer here
+    else if (_isLooping)
+    {
+        for (unsigned int i = 0; i < _audioFrames.size(); ++i)
+        {
+            _currentAudioBytes -= _audioFrames[i]->dataSize;
+            delete _audioFrames[i];
+        }
+        _audioFrames.clear();
+        
+        for (unsigned int i = 0; i < _backupAudioFrames.size(); ++i)
+        {
+            _currentAudioStorage += _backupAudioFrames[i]->lifeTime;
+            _currentAudioBytes += _backupAudioFrames[i]->dataSize;
+            _audioFrames.push_back(new AudioFrame(*_backupAudioFrames[i]));
+        }
+        
+        if (_log && _logLevel >= LOGLEVEL_NORMAL) 
+            _log->logMessage("Added audio backup to storage.");
+    }
+}
+
+
+//------------------------------------------------------------------------------
+bool  
+FFmpegVideoPlayer::startPlaying()
+{
+    // Start decoding first
+    bool decoding = startDecoding();
+
+    // Sanity checks
+    if (!decoding)
+    {
+        if (_log && _logLevel >= LOGLEVEL_MINIMAL) 
+             _log->logMessage("Can't play video. Decoding failed.", Ogre::LML_CRITICAL);
+        return false;
+    }
+    if (_isPlaying)
+    {
+        if (_log && _logLevel >= LOGLEVEL_MINIMAL) 
+            _log->logMessage("Can't play another video. Video is already playing.", Ogre::LML_CRITICAL);
+        return false;
+    }
+    
+    // The binding set up by setMaterialName and setTextureUnitName comes first
+    for (std::vector<MaterialBinding>::iterator it = _bindings.begin(); it != _bindings.end(); )
+    {
+        it = it->isMain ? _bindings.erase(it) : it + 1;
+    }
+    if (_materialName != "" && _textureUnitName != "")
+    {
+        MaterialBinding mainBinding;
+        mainBinding.materialName = _materialName;
+        mainBinding.textureUnitName = _textureUnitName;
+        mainBinding.isMain = true;
+        _bindings.insert(_bindings.begin(), mainBinding);
+    }
+    if (_bindings.empty())
     {
         if (_log && _logLevel >= LOGLEVEL_MINIMAL) 
             _log->logMessage("Can't play video. No material, texture or resource group specified.", Ogre::LML_CRITICAL);
         return false;
     }
     
+    // Create a new texture for our video, or take one of the right size from the pool.
+    // YUV planes need a single channel texture that is larger, but only has 1.5 bytes per pixel.
+    unsigned int textureWidth = _videoInfo.videoWidth;
+    unsigned int textureHeight = _videoInfo.videoHeight;
+    Ogre::PixelFormat textureFormat = Ogre::PF_BYTE_RGBA;
+    if (_videoOutputFormat == VOF_YUV_PLANES)
+    {
+        FFmpegYUVPlanes::getImageSize(_videoInfo.videoWidth, _videoInfo.videoHeight, textureWidth, textureHeight);
+        textureFormat = Ogre::PF_L8;
+    }
+    releaseVideoTexture();
+    if (_useTexturePool)
+    {
+        _texturePtr = FFMPEG_TEXTURE_POOL->acquireTexture(textureWidth, textureHeight, textureFormat);
+        _isTextureFromPool = true;
+    }
+    else
+    {
+        Ogre::TextureManager::getSingleton().remove(_videoTextureName);
+        _texturePtr = Ogre::TextureManager::getSingleton().createManual(
+                        _videoTextureName,
+                        Ogre::ResourceGroupManager::DEFAULT_RESOURCE_GROUP_NAME,
+                        Ogre::TEX_TYPE_2D,
+                        textureWidth, textureHeight,
+                        0,
+                        textureFormat,
+                        Ogre::TU_DYNAMIC_WRITE_ONLY_DISCARDABLE);
+    }
+    
+    // Now look for the texture units, all of them show the same texture
+    bool found = false;
+    for (unsigned int i = 0; i < _bindings.size(); ++i)
+    {
+        found = bindTextureUnit(_bindings[i]) || found;
+    }
+    if (!found)
+    {
+        if (_log && _logLevel >= LOGLEVEL_MINIMAL) 
+            _log->logMessage("Can't play video. None of the texture units was found.", Ogre::LML_CRITICAL);
+        return false;
+    }
+    
+    // Until the scene manager renders it, the video counts as visible
+    _lastRenderedFrame = Ogre::Root::getSingletonPtr()->getNextFrameNumber();
+    _isVisible = true;
+    _isDecodingSuspended = false;
+    
+    _isWaitingForBuffers = true;
+    _isPosterShown = false;
+    return true;
+}
+
+//------------------------------------------------------------------------------
+bool 
+FFmpegVideoPlayer::bindTextureUnit(MaterialBinding& p_binding)
+{
     // Get the material
-    Ogre::MaterialPtr matPtr = Ogre::MaterialManager::getSingleton().getByName(_materialName);
+    Ogre::MaterialPtr matPtr = Ogre::MaterialManager::getSingleton().getByName(p_binding.materialName);
     if (matPtr.isNull())
     {
         if (_log && _logLevel >= LOGLEVEL_MINIMAL) 
-            _log->logMessage("Can't play video. Material " + _materialName + " not found.", Ogre::LML_CRITICAL);
+            _log->logMessage("Material " + p_binding.materialName + " not found.", Ogre::LML_CRITICAL);
+        return false;
+    }
+    
+    // Now look for the texture
+    unsigned short numTechniques = matPtr->getNumTechniques();
+    for (unsigned short i = 0; i < numTechniques; ++i)
+    {
+        Ogre::Technique* tech = matPtr->getTechnique(i);
+        unsigned short numPasses = tech->getNumPasses();
+        for (unsigned short j = 0; j < numPasses; ++j)
+        {
+            Ogre::Pass* pass = tech->getPass(j);
+            unsigned short numTUs = pass->getNumTextureUnitStates();
+            for (unsigned short k = 0; k < numTUs; ++k)
+            {
+                Ogre::TextureUnitState* tu = pass->getTextureUnitState(k);
+                
+                // Is this our texture?
+                if (tu->getName() == p_binding.textureUnitName)
+                {
+                    p_binding.textureUnitState = tu;
+                    p_binding.material = matPtr.get();
+                    p_binding.originalTextureName = tu->getTextureName();
+                    applyColorConversion(p_binding);
+                    
+                    if (_log && _logLevel >= LOGLEVEL_NORMAL)
+                        _log->logMessage("Successfully found texture unit " 
+                                        + p_binding.textureUnitName + " inside material " 
+                                        + p_binding.materialName + ".", Ogre::LML_NORMAL);
+                    return true;
+                }
+            }
+        }
+    }
+    
+    if (_log && _logLevel >= LOGLEVEL_MINIMAL) 
+        _log->logMessage("Texture unit " + p_binding.textureUnitName + " not found inside material " 
+                            + p_binding.materialName + ".", Ogre::LML_CRITICAL);
+    return false;
+}
+
+//------------------------------------------------------------------------------
+void 
+FFmpegVideoPlayer::applyColorConversion(MaterialBinding& p_binding)
+{
+    // Only materials that convert YUV planes know the parameter
+    Ogre::Pass* pass = p_binding.textureUnitState->getParent();
+    if (!pass->hasFragmentProgram())
+    {
+        return;
+    }
+    Ogre::GpuProgramParametersSharedPtr params = pass->getFragmentProgramParameters();
+    if (!params->_findNamedConstantDefinition("yuvToRgb"))
+    {
+        return;
+    }
+    
+    float conversion[12];
+    FFmpegYUVPlanes::getConversionMatrix(_videoInfo.videoColorMatrix, _videoInfo.videoFullRange, conversion);
+    params->setNamedConstant("yuvToRgb", Ogre::Matrix4(
+                conversion[0], conversion[1], conversion[2], conversion[3],
+                conversion[4], conversion[5], conversion[6], conversion[7],
+                conversion[8], conversion[9], conversion[10], conversion[11],
+                0.0f, 0.0f, 0.0f, 1.0f));
+    
+    if (_log && _logLevel >= LOGLEVEL_NORMAL)
+        _log->logMessage("Converting the colors of the video in material " + p_binding.materialName 
+                        + (_videoInfo.videoColorMatrix == YCM_BT709 ? " with BT.709" : " with BT.601")
+                        + (_videoInfo.videoFullRange ? ", full range." : ", limited range."), Ogre::LML_NORMAL);
+}
+
+//------------------------------------------------------------------------------
+void 
+FFmpegVideoPlayer::showVideoTexture(bool p_show)
+{
+    for (unsigned int i = 0; i < _bindings.size(); ++i)
+    {
+        MaterialBinding& binding = _bindings[i];
+        if (!binding.textureUnitState)
+        {
+            continue;
+        }
+        
+        binding.textureUnitState->setTextureName(p_show ? _texturePtr->getName() : binding.originalTextureName);
+        if (p_show && _log && _logLevel >= LOGLEVEL_NORMAL) 
+             _log->logMessage("Replacing texture " + binding.originalTextureName + " with video texture.");
+    }
+}
+
+//------------------------------------------------------------------------------
+void 
+FFmpegVideoPlayer::addMaterialBinding(const Ogre::String& p_materialName, const Ogre::String& p_textureUnitName)
+{
+    for (unsigned int i = 0; i < _bindings.size(); ++i)
+    {
+        if (_bindings[i].materialName == p_materialName && _bindings[i].textureUnitName == p_textureUnitName)
+        {
+            return;
+        }
+    }
+    
+    MaterialBinding binding;
+    binding.materialName = p_materialName;
+    binding.textureUnitName = p_textureUnitName;
+    
+    // Join a video that already plays right away
+    if ((_isPlaying || _isWaitingForBuffers) && bindTextureUnit(binding) && _isPlaying)
+    {
+        binding.textureUnitState->setTextureName(_texturePtr->getName());
+    }
+    _bindings.push_back(binding);
+}
+
+//------------------------------------------------------------------------------
+void 
+FFmpegVideoPlayer::removeMaterialBinding(const Ogre::String& p_materialName, const Ogre::String& p_textureUnitName)
+{
+    for (std::vector<MaterialBinding>::iterator it = _bindings.begin(); it != _bindings.end(); ++it)
+    {
+        if (it->materialName == p_materialName && it->textureUnitName == p_textureUnitName)
+        {
+            if (_isPlaying && it->textureUnitState)
+            {
+                it->textureUnitState->setTextureName(it->originalTextureName);
+            }
+            _bindings.erase(it);
+            return;
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+void 
+FFmpegVideoPlayer::setVideoTextureName(const Ogre::String& p_name)
+{
+    if (!_isPlaying && !_isWaitingForBuffers)
+    {
+        _videoTextureName = p_name;
+    }
+}
+
+//------------------------------------------------------------------------------
+void 
+FFmpegVideoPlayer::setUseTexturePool(bool p_use)
+{
+    _useTexturePool = p_use;
+}
+
+//------------------------------------------------------------------------------
+void 
+FFmpegVideoPlayer::setVideoOutputFormat(VideoOutputFormat p_format)
+{
+    _videoOutputFormat = p_format;
+}
+
+//------------------------------------------------------------------------------
+void 
+FFmpegVideoPlayer::releaseVideoTexture()
+{
+    if (_texturePtr.isNull())
+    {
+        return;
+    }
+    
+    FFMPEG_UPLOAD_SCHEDULER->cancelUpload(_texturePtr->getName());
+    if (_isTextureFromPool)
+    {
+        FFMPEG_TEXTURE_POOL->releaseTexture(_texturePtr);
+    }
+    else
+    {
+        Ogre::TextureManager::getSingleton().remove(_texturePtr->getName());
+    }
+    _texturePtr.setNull();
+    _isTextureFromPool = false;
+}
+
+//------------------------------------------------------------------------------
+bool 
+FFmpegVideoPlayer::startDecoding(bool p_leaveFramesIntact)
+{
+    // Sanity checks
+    if (_isDecoding)
+    {
+        if (_log && _logLevel >= LOGLEVEL_MINIMAL) 
+             _log->logMessage("Can't decode another video. Video is already decoding.", Ogre::LML_CRITICAL);
+        return false;
+    }
+    if (_videoFileName == "")
+    {
+        if (_log && _logLevel >= LOGLEVEL_MINIMAL) 
+             _log->logMessage("Can't decode video. No video filename specified.", Ogre::LML_CRITICAL);
+        return false;
+    }
+    
+    // Delete old thread and thread info object
+    joinDecoding();
+    
+    // Delete remaining frames
+    if (!p_leaveFramesIntact)
+    {
+        _isResident = false;
+        _isPlayingBaked = false;
+        _residentClip.reset();
+        _frameClip.reset();
+        _residentFrame = NULL;
+        for (unsigned int i = 0; i < _audioFrames.size(); ++i)
+        {
+            delete _audioFrames[i];
+        }
+        _audioFrames.clear();
+        _videoFrames.clear();
+        _videoFrames.setReversed(_isReversed);
+        
+        _currentAudioStorage = 0.0;
+        _currentAudioBytes = 0;
+    }
+    
+    // Reset variables
+    // When looping, the playback time was already wrapped around by frameStarted
+    _videoInfo.audioNumChannels = _forcedAudioChannels > 0 ? _forcedAudioChannels : 0;
+    _videoBuffersFilledWithBackup = false;
+    _audioPlaybackTime = 0.0;
+    if (!p_leaveFramesIntact)
+    {
+        _videoPlaybackTime = _decodingStartTime;
+    }
+    _videoInfo.decodingDone = false;
+    _videoInfo.decodingAborted = false;
+    _videoInfo.audioDecodedDuration = 0.0;
+    _videoInfo.videoDecodedDuration = 0.0;
+    _videoInfo.openDuration = 0.0;
+    _videoInfo.firstFrameLatency = -1.0;
+    _videoInfo.streamInfoFromCache = false;
+    _isDecoding = false;
+    _isPaused = false;
+    _isSeekPending = false;
+    
+    // If we are in looping mode and currently playing, this means that this is loop X
+    // So we do not need to reset all values
+    if (!_isLooping && !_isPlaying)
+    {
+        _videoInfo.audioDuration = 0.0;
+        _videoInfo.videoDuration = 0.0;
+        _videoInfo.infoFilled = false;
+        _videoInfo.streams.clear();
+        _videoInfo.audioStreamIndex = -1;
+        _videoInfo.videoStreamIndex = -1;
+        for (unsigned int i = 0; i < _bindings.size(); ++i)
+        {
+            _bindings[i].material = NULL;
+            _bindings[i].textureUnitState = NULL;
+            _bindings[i].originalTextureName = "";
+        }
+    }
+    
+    // Baked videos need no decoding at all
+    StreamInfoKey source;
+    if (!p_leaveFramesIntact && !_bakeWriter && _useBakedFrames && _decodingStartTime <= 0.0 
+        && getVideoInputKey(_videoFileName, _resourceGroup, source))
+    {
+        BakedClipPtr clip = FFMPEG_BAKED_FRAME_CACHE->openClip(getFrameClipKey(), source);
+        if (clip)
+        {
+            _videoInfo = clip->getVideoInfo();
+            _videoPlaybackTime = _isReversed ? clip->getDuration() : 0.0;
+            startResidentPlayback(clip);
+            _isPlayingBaked = true;
+            
+            if (_log && _logLevel >= LOGLEVEL_NORMAL) 
+                _log->logMessage("Playing the baked frames of " + _videoFileName + ", nothing to decode.");
+            return true;
+        }
+    }
+    
+    // A looping clip that fits into memory is kept during the first loop.
+    // If another player already did that, there is nothing to decode at all.
+    if (!p_leaveFramesIntact && !_bakeWriter && _isLooping && !_isReversed && _residentClipMaxBytes > 0 
+        && _decodingStartTime <= 0.0)
+    {
+        ResidentClipPtr clip;
+        if (_shareResidentClips)
+        {
+            clip = FFMPEG_RESIDENT_CLIP_CACHE->findClip(getFrameClipKey());
+        }
+        if (clip)
+        {
+            _videoInfo = clip->getVideoInfo();
+            _videoPlaybackTime = 0.0;
+            startResidentPlayback(clip);
+            
+            if (_log && _logLevel >= LOGLEVEL_NORMAL) 
+                _log->logMessage("Playing the resident clip of another player, nothing to decode.");
+            return true;
+        }
+        _residentClip.reset(new ResidentClip(_residentClipMaxBytes));
+    }
+    
+    // Create thread info object - it is deleted inside the decoding thread
+    ThreadInfo* threadInfo = new ThreadInfo();
+    threadInfo->playerMutex = _playerMutex;
+    threadInfo->playerCondVar = _playerCondVar;
+    threadInfo->videoPlayer = this;
+    threadInfo->decodingMutex = _decodingMutex;
+    threadInfo->decodingCondVar = _decodingCondVar;
+    threadInfo->isLoop = _isLooping && _isPlaying;
+    threadInfo->startTime = _decodingStartTime;
+    threadInfo->isReverse = _isReversed;
+    _decodingStartTime = 0.0;
+    
+    // Start decoding, then wait until the VideoInfo object was filled
+    // Reverse decoding waits for whole GOPs, so it always gets a thread of its own.
+    // Baking waits for the thread to end.
+    _decodingJobMode = _isReversed || _bakeWriter ? DM_THREAD : _decodingMode;
+    if (_decodingJobMode == DM_WORK_QUEUE && !FFmpegWorkQueueDecoder::getIsAvailable())
+    {
+        if (_log && _logLevel >= LOGLEVEL_NORMAL) 
+            _log->logMessage("No WorkQueue worker threads available, decoding on a thread of its own.");
+        _decodingJobMode = DM_THREAD;
+    }
+    
+    // Codec threads follow the settings of whoever owns the thread that opens the codecs
+    threadInfo->threadSettings = _decoderThreadSettings;
+    threadInfo->codecThreadCount = getCodecThreadCount(_decodingJobMode == DM_DECODER_POOL ? 
+                                    FFMPEG_DECODER_POOL->getThreadSettings() : _decoderThreadSettings);
+    
+    if (_decodingJobMode == DM_DECODER_POOL)
+    {
+        _decodingJob = new PlayerDecodingJob(threadInfo);
+        FFMPEG_DECODER_POOL->addJob(_decodingJob);
+    }
+    else if (_decodingJobMode == DM_WORK_QUEUE)
+    {
+        _decodingJob = new PlayerDecodingJob(threadInfo);
+        FFmpegWorkQueueDecoder::getSingletonPtr()->addJob(_decodingJob);
+    }
+    else
+    {
+        _currentDecodingThread = new boost::thread(videoDecodingThread, threadInfo);
+    }
+    {
+        boost::mutex::scoped_lock lock(*_playerMutex);
+        while (!_videoInfo.infoFilled && !_videoInfo.error.length())
+        {
+            boost::chrono::steady_clock::time_point const timeOut = 
+                boost::chrono::steady_clock::now() + boost::chrono::milliseconds(3000);
+            _playerCondVar->wait_until(lock, timeOut);
+        }
+        
+        // Do we have an error?
+        if (_videoInfo.error.length() > 0)
+        {
+            if (_log && _logLevel >= LOGLEVEL_MINIMAL) 
+             _log->logMessage("Decoding error: " + _videoInfo.error, Ogre::LML_CRITICAL);
+            return false;
+        }
+    }
+    
+    // Reverse playback without a position starts at the end
+    if (_isReversed && _videoPlaybackTime <= 0.0)
+    {
+        _videoPlaybackTime = _videoInfo.videoDuration;
+    }
+    
+    _isDecoding = true;
+    return true;
+}
+
+//------------------------------------------------------------------------------
+bool 
+FFmpegVideoPlayer::restartDecodingAt(double p_time)
+{
+    // Stop the running decoding thread
+    _videoInfo.decodingAborted = true;
+    joinDecoding();
+    _isDecoding = false;
+    
+    if (_log && _logLevel >= LOGLEVEL_NORMAL) 
+        _log->logMessage("Restarting decoding at " + boost::lexical_cast<std::string>(p_time) 
+                            + (_isReversed ? " seconds, reversed." : " seconds."));
+    
+    // Start again, this drops all buffered frames
+    _decodingStartTime = p_time;
+    return startDecoding();
+}
+
+//------------------------------------------------------------------------------
+void 
+FFmpegVideoPlayer::seekDecoding(double p_time)
+{
+    // A finished decoder can not seek anymore, and reverse playback decodes whole GOPs
+    if (_isReversed || _videoInfo.decodingDone || _videoBuffersFilledWithBackup)
+    {
+        restartDecodingAt(p_time);
+        return;
+    }
+    
+    if (_log && _logLevel >= LOGLEVEL_NORMAL) 
+        _log->logMessage("Seeking to " + boost::lexical_cast<std::string>(p_time) + " seconds.");
+    
+    {
+        boost::mutex::scoped_lock lock(*_playerMutex);
+        for (unsigned int i = 0; i < _audioFrames.size(); ++i)
+        {
+            delete _audioFrames[i];
+        }
+        _audioFrames.clear();
+        _videoFrames.clear();
+        _currentAudioStorage = 0.0;
+        _currentAudioBytes = 0;
+        
+        _seekTime = p_time;
+        ++_seekSerial;
+        _isSeekPending = true;
+        _seekKeepsAudio = false;
+    }
+    wakeDecoder();
+}
+
+//------------------------------------------------------------------------------
+void 
+FFmpegVideoPlayer::updateVisibility()
+{
+    // Without a scene manager to ask, the video is always visible
+    bool isVisible = true;
+    if (_visibilitySceneManager)
+    {
+        unsigned long currentFrame = Ogre::Root::getSingletonPtr()->getNextFrameNumber();
+        isVisible = currentFrame - _lastRenderedFrame <= _invisibleAfterFrames;
+    }
+    if (isVisible == _isVisible)
+    {
+        return;
+    }
+    _isVisible = isVisible;
+    
+    if (_log && _logLevel >= LOGLEVEL_NORMAL) 
+        _log->logMessage(_isVisible ? "Video became visible." : "Video became invisible.");
+    
+    // Reverse playback decodes whole GOPs and only skips the uploads, resident clips have nothing to decode
+    if (_isReversed || _isResident || _invisiblePolicy == IP_KEEP_DECODING)
+    {
+        return;
+    }
+    
+    // Throttling is picked up by the decoder itself, suspending only needs a wakeup when it ends
+    _isDecodingSuspended = !_isVisible && _invisiblePolicy == IP_PAUSE_DECODING;
+    if (_isVisible)
+    {
+        // The buffers are either empty or only contain keyframes, continue where the playback is now
+        seekDecoding(_videoPlaybackTime);
+    }
+}
+
+//------------------------------------------------------------------------------
+void 
+FFmpegVideoPlayer::updateLodLevel()
+{
+    // Go down as long as the next level still has at least as many pixels as the screen shows.
+    // Levels below the current one need some extra room, so a size right at the border 
+    // does not switch back and forth.
+    unsigned int level = 0;
+    if (_onScreenWidth > 0 && _onScreenHeight > 0)
+    {
+        unsigned int width = 0;
+        unsigned int height = 0;
+        while (level < _maxLodLevel)
+        {
+            getLodSize(level + 1, width, height);
+            double margin = level + 1 > _lodLevel ? 1.0 - _lodHysteresis : 1.0;
+            if (width * margin < _onScreenWidth || height * margin < _onScreenHeight)
+            {
+                break;
+            }
+            ++level;
+        }
+    }
+    if (level == _lodLevel)
+    {
+        return;
+    }
+    
+    // The decoder picks the new level up with the next frame
+    _lodLevel = level;
+    if (_log && _logLevel >= LOGLEVEL_NORMAL) 
+        _log->logMessage("Switched to level of detail " + boost::lexical_cast<std::string>(_lodLevel) + ".");
+}
+
+//------------------------------------------------------------------------------
+void 
+FFmpegVideoPlayer::fitTextureToFrame(const VideoFrame* p_frame)
+{
+    // The render system may store the texture in another format than the one asked for
+    if (_texturePtr->getWidth() == p_frame->width && _texturePtr->getHeight() == p_frame->height
+        && _texturePtr->getDesiredFormat() == p_frame->format)
+    {
+        return;
+    }
+    
+    // A waiting upload of the old size would not fit anymore
+    FFMPEG_UPLOAD_SCHEDULER->cancelUpload(_texturePtr->getName());
+    
+    // Pooled textures keep their size, so switch to one of the new size
+    if (_isTextureFromPool)
+    {
+        FFMPEG_TEXTURE_POOL->releaseTexture(_texturePtr);
+        _texturePtr = FFMPEG_TEXTURE_POOL->acquireTexture(p_frame->width, p_frame->height, p_frame->format);
+        if (_isPlaying || _isPosterShown)
+        {
+            showVideoTexture(true);
+        }
+        return;
+    }
+    
+    // Texture coordinates are relative, so the material shows the smaller texture just the same
+    _texturePtr->freeInternalResources();
+    _texturePtr->setWidth(p_frame->width);
+    _texturePtr->setHeight(p_frame->height);
+    _texturePtr->setFormat(p_frame->format);
+    _texturePtr->createInternalResources();
+}
+
+//------------------------------------------------------------------------------
+void 
+FFmpegVideoPlayer::joinDecoding()
+{
+    if (_currentDecodingThread != NULL)
+    {
+        _currentDecodingThread->join();
+        delete _currentDecodingThread;
+        _currentDecodingThread = NULL;
+    }
+    if (_decodingJob != NULL)
+    {
+        if (_decodingJobMode == DM_DECODER_POOL)
+        {
+            FFMPEG_DECODER_POOL->waitForJob(_decodingJob);
+            FFMPEG_DECODER_POOL->removeJob(_decodingJob);
+        }
+        else
+        {
+            // Responses are handled on this thread, so there is nothing to wait for but the running request
+            FFmpegWorkQueueDecoder::getSingletonPtr()->removeJob(_decodingJob);
+        }
+        delete _decodingJob;
+        _decodingJob = NULL;
+    }
+}
+
+//------------------------------------------------------------------------------
+void 
+FFmpegVideoPlayer::wakeDecoder()
+{
+    _decodingCondVar->notify_all();
+    if (_decodingJob == NULL)
+    {
+        return;
+    }
+    
+    if (_decodingJobMode == DM_DECODER_POOL)
+    {
+        FFMPEG_DECODER_POOL->wakeJob(_decodingJob);
+    }
+    else
+    {
+        FFmpegWorkQueueDecoder::getSingletonPtr()->wakeJob(_decodingJob);
+    }
+}
+
+//------------------------------------------------------------------------------
+bool 
+FFmpegVideoPlayer::getCanStartPlayback()
+{
+    if (getAudioBufferIsFull() && getVideoBufferIsFull())
+    {
+        return true;
+    }
+    
+    boost::mutex::scoped_lock lock(*_playerMutex);
+    
+    // Videos shorter than the buffer target never fill it
+    if (_videoInfo.decodingDone)
+    {
+        return true;
+    }
+    if (_startThreshold < 0.0)
+    {
+        return false;
+    }
+    bool audioReady = _isReversed || _currentAudioStorage >= _startThreshold;
+    return audioReady && _videoFrames.getBufferedTime() >= _startThreshold * _playbackRate;
+}
+
+//------------------------------------------------------------------------------
+void 
+FFmpegVideoPlayer::showPosterFrame()
+{
+    // Frames only leave the queue on this thread, so the frame stays valid while it is uploaded
+    VideoFrame* frame = NULL;
+    {
+        boost::mutex::scoped_lock lock(*_playerMutex);
+        frame = _videoFrames.front();
+    }
+    if (!frame)
+    {
+        return;
+    }
+    
+    // Uploaded right away, the poster is what the user waits for
+    fitTextureToFrame(frame);
+    Ogre::PixelBox pb(frame->width, frame->height, 1, frame->format, frame->data);
+    _texturePtr->getBuffer()->blitFromMemory(pb);
+    showVideoTexture(true);
+    _isPosterShown = true;
+}
+
+//------------------------------------------------------------------------------
+void 
+FFmpegVideoPlayer::stopVideo()
+{
+    // Abort decoding
+    _videoInfo.decodingAborted = true;
+    joinDecoding();
+    
+    // Restore original textures
+    showVideoTexture(false);
+    if (_isTextureFromPool)
+    {
+        releaseVideoTexture();
+    }
+    else if (!_texturePtr.isNull())
+    {
+        FFMPEG_UPLOAD_SCHEDULER->cancelUpload(_texturePtr->getName());
+    }
+    
+    // Stop playback
+    _isDecoding = false;
+    _isPlaying = false;
+    _isWaitingForBuffers = false;
+    
+    // Clear frames
+    for (unsigned int i = 0; i < _audioFrames.size(); ++i)
+    {
+        delete _audioFrames[i];
+    }
+    _audioFrames.clear();
+    _videoFrames.clear();
+    _currentAudioStorage = 0.0;
+    _currentAudioBytes = 0;
+    
+    // Other players may still show the clip
+    _isResident = false;
+    _isPlayingBaked = false;
+    _residentClip.reset();
+    _frameClip.reset();
+    _residentFrame = NULL;
+}
+
+//------------------------------------------------------------------------------
+bool 
+FFmpegVideoPlayer::bakeVideo()
+{
+    // Sanity checks
+    if (_isPlaying || _isWaitingForBuffers || _isDecoding)
+    {
+        if (_log && _logLevel >= LOGLEVEL_MINIMAL) 
+            _log->logMessage("Can't bake the video while it is playing or decoding.", Ogre::LML_CRITICAL);
+        return false;
+    }
+    if (_playbackRate != 1.0 || _isReversed)
+    {
+        if (_log && _logLevel >= LOGLEVEL_MINIMAL) 
+            _log->logMessage("Can't bake the video at another playback rate or backwards.", Ogre::LML_CRITICAL);
+        return false;
+    }
+    StreamInfoKey source;
+    if (!getVideoInputKey(_videoFileName, _resourceGroup, source))
+    {
+        if (_log && _logLevel >= LOGLEVEL_MINIMAL) 
+            _log->logMessage("Can't bake " + _videoFileName + ". The file was not found.", Ogre::LML_CRITICAL);
+        return false;
+    }
+    _bakeWriter = FFMPEG_BAKED_FRAME_CACHE->createWriter();
+    if (!_bakeWriter)
+    {
+        if (_log && _logLevel >= LOGLEVEL_MINIMAL) 
+            _log->logMessage("Can't bake the video. The baked frame cache has no cache directory or can't write to it.", 
+                             Ogre::LML_CRITICAL);
+        return false;
+    }
+    
+    // Every frame at full size, from start to end
+    _decodingStartTime = 0.0;
+    _lodLevel = 0;
+    _isVisible = true;
+    _isDecodingSuspended = false;
+    
+    // The decoding thread ends once the whole video is decoded
+    bool decoding = startDecoding();
+    joinDecoding();
+    _isDecoding = false;
+    
+    BakedClipWriter* writer = _bakeWriter;
+    {
+        boost::mutex::scoped_lock lock(*_playerMutex);
+        _bakeWriter = NULL;
+    }
+    if (!decoding || !_videoInfo.decodingDone || !writer->finish(_videoInfo))
+    {
+        delete writer;
+        if (_log && _logLevel >= LOGLEVEL_MINIMAL) 
+            _log->logMessage("Baking " + _videoFileName + " failed.", Ogre::LML_CRITICAL);
+        return false;
+    }
+    
+    uint64_t bytes = writer->getBytes();
+    if (!FFMPEG_BAKED_FRAME_CACHE->addBake(getFrameClipKey(), source, writer))
+    {
+        if (_log && _logLevel >= LOGLEVEL_MINIMAL) 
+            _log->logMessage("Baking " + _videoFileName + " failed. The baked frame cache did not take the bake.", 
+                             Ogre::LML_CRITICAL);
         return false;
     }
+    if (_log && _logLevel >= LOGLEVEL_NORMAL) 
+        _log->logMessage("Baked " + _videoFileName + " into " + boost::lexical_cast<std::string>(bytes) + " bytes.");
+    return true;
+}
+
+//------------------------------------------------------------------------------
+Ogre::String 
+FFmpegVideoPlayer::getFrameClipKey() const
+{
+    // Everything that changes the decoded frames
+    return _resourceGroup + ":" + _videoFileName 
+            + ":" + boost::lexical_cast<std::string>(_audioTrack) 
+            + ":" + _audioTrackLanguage
+            + ":" + boost::lexical_cast<std::string>(_videoTrack) 
+            + ":" + boost::lexical_cast<std::string>(_forcedAudioChannels)
+            + ":" + boost::lexical_cast<std::string>((int)_decodedAudioFormat)
+            + ":" + boost::lexical_cast<std::string>((int)_videoOutputFormat);
+}
+
+//------------------------------------------------------------------------------
+void 
+FFmpegVideoPlayer::startResidentPlayback(const boost::shared_ptr<FrameClip>& p_clip)
+{
+    // The decoder has nothing left to do
+    _videoInfo.decodingAborted = true;
+    joinDecoding();
+    _isDecoding = false;
+    _videoInfo.decodingAborted = false;
     
-    // Create a new texture for our video
-    Ogre::TextureManager::getSingleton().remove("FFmpegVideoTexture");
-    _texturePtr = Ogre::TextureManager::getSingleton().createManual(
-                    "FFmpegVideoTexture",
-                    Ogre::ResourceGroupManager::DEFAULT_RESOURCE_GROUP_NAME,
-                    Ogre::TEX_TYPE_2D,
-                    _videoInfo.videoWidth, _videoInfo.videoHeight,
-                    0,
-                    Ogre::PF_BYTE_RGBA,
-                    Ogre::TU_DYNAMIC_WRITE_ONLY_DISCARDABLE);
-    
-    // Now look for the texture
-    bool found = false;
-    unsigned short numTechniques = matPtr->getNumTechniques();
-    for (unsigned short i = 0; i < numTechniques; ++i)
     {
-        Ogre::Technique* tech = matPtr->getTechnique(i);
-        unsigned short numPasses = tech->getNumPasses();
-        for (unsigned short j = 0; j < numPasses; ++j)
+        boost::mutex::scoped_lock lock(*_playerMutex);
+        
+        // If the audio already started the next loop, the audio backup is queued and the clip continues after it
+        _residentAudioFrame = 0;
+        if (_audioPlaybackTime >= _videoInfo.audioDuration && p_clip->getNumAudioFrames() > 0)
         {
-            Ogre::Pass* pass = tech->getPass(j);
-            unsigned short numTUs = pass->getNumTextureUnitStates();
-            for (unsigned short k = 0; k < numTUs; ++k)
-            {
-                Ogre::TextureUnitState* tu = pass->getTextureUnitState(k);
-                
-                // Is this our texture?
-                if (tu->getName() == _textureUnitName)
-                {
-                    _originalTextureUnitState = tu;
-                    _originalTextureName = tu->getTextureName();
-                    found = true;
-                    
-                    if (_log && _logLevel >= LOGLEVEL_NORMAL)
-                        _log->logMessage("Successfully found texture unit " 
-                                        + _textureUnitName + " inside material " 
-                                        + _materialName + ".", Ogre::LML_NORMAL);
-                }
-            }
-            
-            if (found) break;
+            _residentAudioFrame = _backupAudioFrames.size() % p_clip->getNumAudioFrames();
         }
+        _residentAudioAhead = 0.0;
         
-        if (found) break;
+        _videoFrames.clear();
+        clearLoopBackup();
+        _frameClip = p_clip;
+        _residentClip.reset();
+        _residentFrame = NULL;
+        _isResident = true;
+        _videoBuffersFilledWithBackup = false;
+        _videoInfo.decodingDone = true;
+        _videoInfo.infoFilled = true;
+        _videoInfo.error = "";
     }
-	if (!found) return false;
-    
-    _isWaitingForBuffers = true;
-    return true;
 }
 
 //------------------------------------------------------------------------------
-bool 
-FFmpegVideoPlayer::startDecoding(bool p_leaveFramesIntact)
+void 
+FFmpegVideoPlayer::updateResidentPlayback(double p_time)
 {
-    // Sanity checks
-    if (_isDecoding)
+    double duration = _frameClip->getDuration();
+    _videoPlaybackTime += _isReversed ? -p_time * _playbackRate : p_time * _playbackRate;
+    
+    // Without looping, stop at the end like decoded playback does, and pause at the start when reversed
+    if (!_isLooping && _videoPlaybackTime >= duration)
     {
-        if (_log && _logLevel >= LOGLEVEL_MINIMAL) 
-             _log->logMessage("Can't decode another video. Video is already decoding.", Ogre::LML_CRITICAL);
-        return false;
+        showVideoTexture(false);
+        _isPlaying = false;
+        return;
     }
-    if (_videoFileName == "")
+    if (!_isLooping && _videoPlaybackTime <= 0.0)
     {
-        if (_log && _logLevel >= LOGLEVEL_MINIMAL) 
-             _log->logMessage("Can't decode video. No video filename specified.", Ogre::LML_CRITICAL);
-        return false;
+        _videoPlaybackTime = 0.0;
+        _isPaused = true;
     }
     
-    // Delete old thread and thread info object
-    if (_currentDecodingThread != NULL)
+    // Wrap the playback time around the clip in both directions
+    _videoPlaybackTime = std::fmod(_videoPlaybackTime, duration);
+    if (_videoPlaybackTime < 0.0)
     {
-        _currentDecodingThread->join();
-        delete _currentDecodingThread;
-        _currentDecodingThread = NULL;
+        _videoPlaybackTime += duration;
     }
     
-    // Delete remaining frames
-    if (!p_leaveFramesIntact)
     {
-        for (unsigned int i = 0; i < _audioFrames.size(); ++i)
-        {
-            delete _audioFrames[i];
-        }
-        _audioFrames.clear();
-        for (unsigned int i = 0; i < _videoFrames.size(); ++i)
-        {
-            delete _videoFrames[i];
-        }
-        _videoFrames.clear();
-        
-        _currentAudioStorage = 0.0;
-        _currentVideoStorage = 0.0;
+        boost::mutex::scoped_lock lock(*_playerMutex);
+        _residentAudioAhead = _residentAudioAhead > p_time ? _residentAudioAhead - p_time : 0.0;
     }
     
-    // Reset variables
-    _videoInfo.audioNumChannels = _forcedAudioChannels > 0 ? _forcedAudioChannels : 0;
-    _lastVideoFrameTimeRemaining = 0.0;
-    _videoBuffersFilledWithBackup = false;
-    _audioPlaybackTime = 0.0;
-    _videoPlaybackTime = 0.0;
-    _videoInfo.decodingDone = false;
-    _videoInfo.decodingAborted = false;
-    _videoInfo.audioDecodedDuration = 0.0;
-    _videoInfo.videoDecodedDuration = 0.0;
-    _isDecoding = false;
-    _isPaused = false;
+    // Only upload when the frame changes, nobody would see it otherwise
+    const VideoFrame* frame = _frameClip->getFrameForTime(_videoPlaybackTime);
+    if (frame == NULL || frame == _residentFrame || !_isVisible)
+    {
+        return;
+    }
+    _residentFrame = frame;
+    fitTextureToFrame(frame);
     
-    // If we are in looping mode and currently playing, this means that this is loop X
-    // So we do not need to reset all values
-    if (!_isLooping && !_isPlaying)
+    if (_useUploadScheduler)
     {
-        _videoInfo.audioDuration = 0.0;
-        _videoInfo.videoDuration = 0.0;
-        _videoInfo.infoFilled = false;
-        _originalTextureName = 0.0;
-        _originalTextureUnitState = NULL;
+        // The scheduler deletes what it uploads, so it gets a frame of its own sharing the clip's data
+        FFMPEG_UPLOAD_SCHEDULER->submitUpload(_texturePtr, new VideoFrame(*frame), frame->width, 
+                                              frame->height, _uploadPriority);
+    }
+    else
+    {
+        Ogre::PixelBox pb(frame->width, frame->height, 1, frame->format, frame->data);
+        _texturePtr->getBuffer()->blitFromMemory(pb);
+    }
+}
+
+//------------------------------------------------------------------------------
+int 
+FFmpegVideoPlayer::distributeResidentAudioFrames(unsigned int p_numBuffers, 
+                                                 std::vector<uint8_t*>& p_outAudioBuffers, 
+                                                 std::vector<unsigned int>& p_outAudioBufferSizes,
+                                                 double& p_outTotalBuffersTime)
+{
+    // The clip only holds audio for the normal rate and direction
+    unsigned int numFrames = _frameClip->getNumAudioFrames();
+    if (p_numBuffers == 0 || numFrames == 0 || _isReversed || _playbackRate != 1.0)
+    {
+        return 0;
     }
     
-    // Create thread info object - it is deleted inside the decoding thread
-    ThreadInfo* threadInfo = new ThreadInfo();
-    threadInfo->playerMutex = _playerMutex;
-    threadInfo->playerCondVar = _playerCondVar;
-    threadInfo->videoPlayer = this;
-    threadInfo->decodingMutex = _decodingMutex;
-    threadInfo->decodingCondVar = _decodingCondVar;
-    threadInfo->isLoop = _isLooping && _isPlaying;
+    // Never hand out more than a buffer target ahead of playback
+    double wantedTime = getCurrentBufferTarget() - _residentAudioAhead;
+    if (wantedTime <= 0.0)
+    {
+        return 0;
+    }
+    double bufferTime = wantedTime / p_numBuffers;
     
-    // Start decoding thread, then wait until the VideoInfo object was filled
-    _currentDecodingThread = new boost::thread(videoDecodingThread, threadInfo);
+    std::vector<const AudioFrame*> frames;
+    for (unsigned int i = 0; i < p_numBuffers; ++i)
     {
-        boost::mutex::scoped_lock lock(*_playerMutex);
-        while (!_videoInfo.infoFilled && !_videoInfo.error.length())
+        // Take at least one frame, but never go around the whole clip for a single buffer
+        unsigned int dataSize = 0;
+        double totalLifeTime = 0.0;
+        while (frames.empty() || (totalLifeTime < bufferTime && frames.size() < numFrames))
         {
-            boost::chrono::steady_clock::time_point const timeOut = 
-                boost::chrono::steady_clock::now() + boost::chrono::milliseconds(3000);
-            _playerCondVar->wait_until(lock, timeOut);
+            const AudioFrame* frame = _frameClip->getAudioFrame(_residentAudioFrame);
+            _residentAudioFrame = (_residentAudioFrame + 1) % numFrames;
+            frames.push_back(frame);
+            
+            totalLifeTime += frame->lifeTime;
+            dataSize += frame->dataSize;
         }
+        p_outTotalBuffersTime += totalLifeTime;
         
-        // Do we have an error?
-        if (_videoInfo.error.length() > 0)
+        // Concatenate frames into a single memory target, the clip keeps its frames
+        uint8_t* buffer = new uint8_t[dataSize];
+        uint8_t* destination = buffer;
+        for (unsigned int j = 0; j < frames.size(); ++j)
         {
-            if (_log && _logLevel >= LOGLEVEL_MINIMAL) 
-             _log->logMessage("Decoding error: " + _videoInfo.error, Ogre::LML_CRITICAL);
-            return false;
+            memcpy(destination, frames[j]->data, frames[j]->dataSize);
+            destination += frames[j]->dataSize;
         }
+        frames.clear();
+        
+        p_outAudioBuffers.push_back(buffer);
+        p_outAudioBufferSizes.push_back(dataSize);
     }
+    _residentAudioAhead += p_outTotalBuffersTime;
     
-    _isDecoding = true;
-    return true;
+    if (_log && _logLevel >= LOGLEVEL_NORMAL) 
+        _log->logMessage("Distributed " + boost::lexical_cast<std::string>(p_outTotalBuffersTime)
+                            + " seconds of the frame clip to " + boost::lexical_cast<std::string>(p_numBuffers) 
+                            + " buffers.");
+    
+    return p_numBuffers;
 }
 
 //------------------------------------------------------------------------------
 void 
-FFmpegVideoPlayer::stopVideo()
+FFmpegVideoPlayer::clearLoopBackup()
 {
-    // Abort decoding
-    _videoInfo.decodingAborted = true;
-    _decodingCondVar->notify_all();
-    _currentDecodingThread->join();
-    
-    // Restore original texture
-    _originalTextureUnitState->setTextureName(_originalTextureName);
-    
-    // Stop playback
-    _isDecoding = false;
-    _isPlaying = false;
-    
-    // Clear frames
-    for (unsigned int i = 0; i < _audioFrames.size(); ++i)
+    for (unsigned int i = 0; i < _backupVideoFrames.size(); ++i)
     {
-        delete _audioFrames[i];
+        delete _backupVideoFrames[i];
     }
-    _audioFrames.clear();
-    for (unsigned int i = 0; i < _videoFrames.size(); ++i)
+    _backupVideoFrames.clear();
+    for (unsigned int i = 0; i < _backupAudioFrames.size(); ++i)
     {
-        delete _videoFrames[i];
+        delete _backupAudioFrames[i];
     }
-    _videoFrames.clear();
+    _backupAudioFrames.clear();
+    _currentVideoBackupStorage = 0.0;
+    _currentAudioBackupStorage = 0.0;
+}
+
+//------------------------------------------------------------------------------
+void 
+FFmpegVideoPlayer::dropResidentClip()
+{
+    _residentClip.reset();
+    
+    if (_log && _logLevel >= LOGLEVEL_NORMAL) 
+        _log->logMessage("The video does not fit into memory as a whole, looping by decoding again.");
 }
 
 //------------------------------------------------------------------------------
@@ -474,6 +1941,13 @@ FFmpegVideoPlayer::distributeDecodedAudioFrames(unsigned int p_numBuffers,
 {
     boost::mutex::scoped_lock lock(*_playerMutex);
     
+    // Once the frames of the first loop are used up, resident clips hand out their own audio
+    if (_isResident && _audioFrames.empty())
+    {
+        return distributeResidentAudioFrames(p_numBuffers, p_outAudioBuffers, p_outAudioBufferSizes, 
+                                             p_outTotalBuffersTime);
+    }
+    
     // Get the actual number of buffers to fill
     unsigned int numBuffers = 
         _audioFrames.size() >= p_numBuffers? p_numBuffers : _audioFrames.size();
@@ -519,6 +1993,7 @@ FFmpegVideoPlayer::distributeDecodedAudioFrames(unsigned int p_numBuffers,
         }
         
         _currentAudioStorage -= totalLifeTime;
+        _currentAudioBytes -= dataSize;
         p_outTotalBuffersTime += totalLifeTime;
         
         // Create the buffer
@@ -550,7 +2025,7 @@ FFmpegVideoPlayer::distributeDecodedAudioFrames(unsigned int p_numBuffers,
                             + " buffers.", Ogre::LML_CRITICAL);
         
     // We got at least one new frame, wake up the decoder for more decoding
-    _decodingCondVar->notify_all();
+    wakeDecoder();
     
     return numBuffers;
 }
@@ -559,59 +2034,86 @@ FFmpegVideoPlayer::distributeDecodedAudioFrames(unsigned int p_numBuffers,
 VideoFrame* 
 FFmpegVideoPlayer::passVideoTimeAndGetFrame(double p_time)
 {
-    _lastVideoFrameTimeRemaining -= p_time;
-    
-    // If we do not need a new frame, just return NULL
-    if (_lastVideoFrameTimeRemaining > 0.0)
+    advancePlaybackTime(p_time);
+    return getFrameForTime(_videoPlaybackTime);
+}
+
+//------------------------------------------------------------------------------
+void 
+FFmpegVideoPlayer::advancePlaybackTime(double p_time)
+{
+    if (_isReversed)
     {
-        return NULL;
+        _videoPlaybackTime -= p_time * getPlaybackRate();
+        if (_videoPlaybackTime < 0.0)
+        {
+            _videoPlaybackTime = 0.0;
+        }
     }
-    // We have passed at least the last frame
     else
     {
-        double timeToPass = - _lastVideoFrameTimeRemaining;
+        _videoPlaybackTime += p_time * getPlaybackRate();
+    }
+}
+
+//------------------------------------------------------------------------------
+VideoFrame* 
+FFmpegVideoPlayer::getFrameForTime(double p_time)
+{
+    VideoFrame* frame = NULL;
+    {
+        boost::mutex::scoped_lock lock(*_playerMutex);
         
-        // Get frames until we have passed the required time
-        VideoFrame* frame = NULL;
-        while (timeToPass > 0.0)
+        // No more frames? We're done!
+        if (_videoFrames.empty())
         {
-            // Delete skipped frame
-            if (frame != NULL)
+            // Unless the decoder just did not keep up
+            if (!_isUnderrun && _isDecoding && !_videoInfo.decodingDone)
             {
-                delete frame;
-                frame = NULL;
-            }
-            
-            // No more frames? We're done!
-            if (_videoFrames.empty())
-            {
-                if (_log && _logLevel >= LOGLEVEL_NORMAL) 
-                    _log->logMessage("No more frames left in passVideoTime.", Ogre::LML_NORMAL);
-                return NULL;
+                _isUnderrun = true;
+                ++_bufferStats.numUnderruns;
+                if (_isBufferTargetAdaptive)
+                {
+                    _adaptiveBufferTarget = _adaptiveBufferTarget * 1.5 < _maxBufferTarget ? 
+                                            _adaptiveBufferTarget * 1.5 : _maxBufferTarget;
+                }
             }
             
-            // Get new frame
-            {
-                boost::mutex::scoped_lock lock(*_playerMutex);
-                frame = _videoFrames.front();
-                _videoFrames.pop_front();
-                _currentVideoStorage -= frame->lifeTime;
-                _framesPopped++;
-            }
-            timeToPass -= frame->lifeTime;
+            if (_log && _logLevel >= LOGLEVEL_NORMAL) 
+                _log->logMessage("No more frames left in getFrameForTime.", Ogre::LML_NORMAL);
+            return NULL;
         }
         
-        // We got at least one new frame, wake up the decoder for more decoding
-        _decodingCondVar->notify_all();
-        
-        // We got the correct frame, now set the lifetime to the frame's lifetime
-        // minus what has already passed from it. Which just happens to be -timeToPass
-        _lastVideoFrameTimeRemaining = -timeToPass;
-        return frame;
+        frame = _videoFrames.getFrameForTime(p_time, _framesPopped);
+        _isUnderrun = false;
+    }
+    
+    // We got at least one new frame, wake up the decoder for more decoding
+    if (frame != NULL)
+    {
+        ++_framesPopped;
+        wakeDecoder();
     }
     
-    // We actually should never get here
-    return NULL;
+    return frame;
+}
+
+//------------------------------------------------------------------------------
+void 
+FFmpegVideoPlayer::notifyRenderSingleObject(Ogre::Renderable* p_renderable, const Ogre::Pass* p_pass, 
+                                            const Ogre::AutoParamDataSource* p_source, 
+                                            const Ogre::LightList* p_lightList, bool p_suppressRenderStateChanges)
+{
+    // Any technique of the materials counts, the camera distance may pick another one
+    const Ogre::Material* material = p_pass->getParent()->getParent();
+    for (unsigned int i = 0; i < _bindings.size(); ++i)
+    {
+        if (_bindings[i].material == material)
+        {
+            _lastRenderedFrame = Ogre::Root::getSingletonPtr()->getNextFrameNumber();
+            return;
+        }
+    }
 }
 
 //------------------------------------------------------------------------------
@@ -627,7 +2129,7 @@ FFmpegVideoPlayer::frameStarted(const Ogre::FrameEvent& p_evt)
         {
             if (_log && _logLevel >= LOGLEVEL_MINIMAL) 
                 _log->logMessage("Decoding error: " + _videoInfo.error, Ogre::LML_CRITICAL);
-            _currentDecodingThread->join();
+            joinDecoding();
             return false;
         }
     }
@@ -635,29 +2137,83 @@ FFmpegVideoPlayer::frameStarted(const Ogre::FrameEvent& p_evt)
     // Waiting for the buffers to be filled initially
     if (_isWaitingForBuffers)
     {
+        // Show the first frame while the buffers fill
+        if (_showPosterFrame && !_isPosterShown)
+        {
+            showPosterFrame();
+        }
+        
         // If the buffers are not yet filled, try again next frame
-        if (!getAudioBufferIsFull() || !getVideoBufferIsFull())
+        if (!getCanStartPlayback())
         {
             return true;
         }
         
-        // Buffers are filled, so replace the texture and start playing
-        _originalTextureUnitState->setTextureName("FFmpegVideoTexture");
-        if (_log && _logLevel >= LOGLEVEL_NORMAL) 
-             _log->logMessage("Replacing texture " + _originalTextureName + " with video texture.");
+        // Buffers are filled, so replace the textures and start playing
+        if (!_isPosterShown)
+        {
+            showVideoTexture(true);
+        }
         
         _isPlaying = true;
         _isPaused = false;
         _isWaitingForBuffers = false;
     }
     
+    // Resident clips and baked videos play without decoding
+    if (_isPlaying && !_isPaused && _isResident)
+    {
+        updateVisibility();
+        updateResidentPlayback(timeSinceLast);
+        return true;
+    }
+    
     // Update the texture we play on, if we are in playback mode and not paused
     if (_isPlaying && !_isPaused)
     {
-        VideoFrame* frame = passVideoTimeAndGetFrame(timeSinceLast);
+        updateVisibility();
+        updateLodLevel();
+        updateAdaptiveBufferTarget(timeSinceLast);
+        
+        // A seek the decoder could not do anymore because it reached the end of the file
+        if (_isSeekPending && _videoInfo.decodingDone)
+        {
+            restartDecodingAt(_seekTime);
+        }
+        
+        // There is nothing to take from suspended decoding, only the time passes
+        VideoFrame* frame = NULL;
+        if (_isDecodingSuspended)
+        {
+            advancePlaybackTime(timeSinceLast);
+        }
+        else
+        {
+            frame = passVideoTimeAndGetFrame(timeSinceLast);
+        }
+        
+        // Nobody would see the frame
+        if (frame != NULL && !_isVisible)
+        {
+            delete frame;
+            frame = NULL;
+        }
+        
+        // Frames of another level of detail come with another size
         if (frame != NULL)
         {
-            Ogre::PixelBox pb(_videoInfo.videoWidth, _videoInfo.videoHeight, 1, Ogre::PF_BYTE_RGBA, frame->data);
+            fitTextureToFrame(frame);
+        }
+        
+        if (frame != NULL && _useUploadScheduler)
+        {
+            // The scheduler uploads and deletes the frame when the budget allows it
+            FFMPEG_UPLOAD_SCHEDULER->submitUpload(_texturePtr, frame, frame->width, 
+                                                  frame->height, _uploadPriority);
+        }
+        else if (frame != NULL)
+        {
+            Ogre::PixelBox pb(frame->width, frame->height, 1, frame->format, frame->data);
             Ogre::HardwarePixelBufferSharedPtr buffer = _texturePtr->getBuffer();
             buffer->blitFromMemory(pb);
             
@@ -665,55 +2221,71 @@ FFmpegVideoPlayer::frameStarted(const Ogre::FrameEvent& p_evt)
             delete frame;
         }
         
+        // Reverse playback pauses at the start of the video
+        if (_isReversed)
+        {
+            if (_videoPlaybackTime <= 0.0)
+            {
+                _isPaused = true;
+            }
+        }
         // Stop when we're done with the video
-        _videoPlaybackTime += timeSinceLast;
-        if (_videoPlaybackTime >= _videoInfo.longerDuration)
+        else if (_videoPlaybackTime >= _videoInfo.longerDuration && !_videoBuffersFilledWithBackup)
         {
             // Stop playing when not looping
             _isDecoding = false;
             if (!_isLooping)
             {
-                // Restore the texture's original state
-                _originalTextureUnitState->setTextureName(_originalTextureName);
+                // Restore the textures' original state
+                showVideoTexture(false);
 
                 _isPlaying = false;
             }
-            // If we loop, restart the decoding
-            else
+            // A clip that was kept completely loops from memory from now on
+            else if (_videoInfo.decodingDone && _residentClip && _residentClip->complete(_videoInfo))
             {
-                if (!_videoBuffersFilledWithBackup)
+                _videoPlaybackTime -= _videoInfo.longerDuration;
+                if (_shareResidentClips)
                 {
-                    // Clean up video frames
-                    for (unsigned int i = 0; i < _videoFrames.size(); ++i)
-                    {
-                        delete _videoFrames[i];
-                    }
-                    _videoFrames.clear();
-
-                    // Apply video backup buffer
-                    for (unsigned int i = 0; i < _backupVideoFrames.size(); ++i)
-                    {
-                        _currentVideoStorage += _backupVideoFrames[i]->lifeTime;
-                        _videoFrames.push_back(new VideoFrame(*_backupVideoFrames[i]));
-                    }
-                    
-                    if (_log && _logLevel >= LOGLEVEL_NORMAL) 
-                        _log->logMessage("Added video backup to storage.");
-                    
-                    _videoBuffersFilledWithBackup = true;
+                    FFMPEG_RESIDENT_CLIP_CACHE->addClip(getFrameClipKey(), _residentClip);
                 }
+                if (_log && _logLevel >= LOGLEVEL_NORMAL) 
+                    _log->logMessage("Looping from memory, the clip holds " 
+                                        + boost::lexical_cast<std::string>(_residentClip->getBytes()) + " bytes.");
+                
+                // The clip moves from filling to playing
+                ResidentClipPtr clip = _residentClip;
+                startResidentPlayback(clip);
+            }
+            // If we loop, apply the backup and wrap the playback time around
+            else
+            {
+                boost::mutex::scoped_lock lock(*_playerMutex);
                 
-                // Restart decoding if the audio is also finished playing
-                if (_audioPlaybackTime >= _videoInfo.audioDuration)
+                // Clean up video frames, then apply video backup buffer
+                _videoFrames.clear();
+                for (unsigned int i = 0; i < _backupVideoFrames.size(); ++i)
                 {
-                    if (_log && _logLevel >= LOGLEVEL_NORMAL) 
-                        _log->logMessage("Both video and audio playback finished. Restart decoding. ");
-                    
-                    // Restart decoding, keeping the audio and video frames intact (as we just refilled them with backup)
-                    startDecoding(true);
+                    _videoFrames.push(new VideoFrame(*_backupVideoFrames[i]));
                 }
+                _videoPlaybackTime -= _videoInfo.longerDuration;
+                
+                if (_log && _logLevel >= LOGLEVEL_NORMAL) 
+                    _log->logMessage("Added video backup to storage.");
+                
+                _videoBuffersFilledWithBackup = true;
             }
         }
+        
+        // Restart decoding if the audio is also finished playing
+        if (_isLooping && _videoBuffersFilledWithBackup && _audioPlaybackTime >= _videoInfo.audioDuration)
+        {
+            if (_log && _logLevel >= LOGLEVEL_NORMAL) 
+                _log->logMessage("Both video and audio playback finished. Restart decoding. ");
+            
+            // Restart decoding, keeping the audio and video frames intact (as we just refilled them with backup)
+            startDecoding(true);
+        }
     }
     
     return true;
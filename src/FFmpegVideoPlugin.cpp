@@ -1,4 +1,10 @@
 #include "FFmpegVideoPlugin.h"
+#include "FFmpegUploadScheduler.h"
+#include "FFmpegPlayerRegistry.h"
+#include "FFmpegMemoryBudget.h"
+#include "FFmpegTexturePool.h"
+#include "FFmpegStreamInfoCache.h"
+#include "FFmpegWorkQueueDecoder.h"
 
 #include <OgreLogManager.h>
 
@@ -23,6 +29,9 @@ void
 FFmpegVideoPlugin::install()
 {
     _videoPlayer = FFmpegVideoPlayer::getSingletonPtr();
+
+    // Decoder threads are the first to use the stream info cache, it must exist before them
+    FFmpegStreamInfoCache::getSingletonPtr();
 }
 
 //------------------------------------------------------------------------------
@@ -31,17 +40,32 @@ FFmpegVideoPlugin::initialise()
 {
     // Add as a frame listener
     Ogre::Root::getSingletonPtr()->addFrameListener(_videoPlayer);
+    Ogre::Root::getSingletonPtr()->addFrameListener(FFMPEG_UPLOAD_SCHEDULER);
+    Ogre::Root::getSingletonPtr()->addFrameListener(FFMPEG_MEMORY_BUDGET);
     
     // Create and attach the log
     _videoPlayer->setLog(Ogre::LogManager::getSingletonPtr()->createLog("FFmpegVideoPlayer.log"));
+    FFMPEG_DECODER_POOL->setLog(_videoPlayer->getLog());
+    FFMPEG_PLAYER_REGISTRY->setLog(_videoPlayer->getLog());
+    FFMPEG_TEXTURE_POOL->setLog(_videoPlayer->getLog());
 }
 
 //------------------------------------------------------------------------------
 void 
 FFmpegVideoPlugin::shutdown()
 {
+    // Neither decoder is ever destroyed, their threads and handlers must not outlive the plugin and its log
+    FFMPEG_DECODER_POOL->stopWorkers();
+    FFmpegWorkQueueDecoder::getSingletonPtr()->unregisterHandlers();
+    FFMPEG_DECODER_POOL->setLog(NULL);
+    FFMPEG_PLAYER_REGISTRY->setLog(NULL);
+    FFMPEG_TEXTURE_POOL->setLog(NULL);
+    FFMPEG_TEXTURE_POOL->clear();
+    FFMPEG_STREAM_INFO_CACHE->save();
     Ogre::LogManager::getSingletonPtr()->destroyLog("FFmpegVideoPlayer.log");
     Ogre::Root::getSingletonPtr()->removeFrameListener(_videoPlayer);
+    Ogre::Root::getSingletonPtr()->removeFrameListener(FFMPEG_UPLOAD_SCHEDULER);
+    Ogre::Root::getSingletonPtr()->removeFrameListener(FFMPEG_MEMORY_BUDGET);
 }
 
 //------------------------------------------------------------------------------
@@ -0,0 +1,398 @@
+/* 
+ * File:   FFmpegVideoStreamDecoder.cpp
+ * Author: TheSHEEEP
+ * 
+ * Created on 19. Oktober 2026, 14:05
+ */
+
+#include "FFmpegVideoStreamDecoder.h"
+
+extern "C"
+{
+    #ifndef INT64_C
+    #define INT64_C(c) (c ## LL)
+    #define UINT64_C(c) (c ## ULL)
+    #endif
+    #include <libavcodec/avcodec.h>
+    #include <libavformat/avformat.h>
+    #include <libswscale/swscale.h>
+}
+
+#include "FFmpegVideoPlayer.h"
+#include "FFmpegVideoDecodingThread.h"
+
+#include <boost/lexical_cast.hpp>
+
+//------------------------------------------------------------------------------
+FFmpegVideoStreamDecoder::FFmpegVideoStreamDecoder()
+    : _formatContext(NULL)
+    , _codecContext(NULL)
+    , _stream(NULL)
+    , _frame(NULL)
+    , _swsContext(NULL)
+    , _outputWidth(0)
+    , _outputHeight(0)
+    , _lowresTargetWidth(0)
+    , _lowresTargetHeight(0)
+    , _keyframesOnly(false)
+    , _duration(0.0)
+    , _frameDuration(0.0)
+    , _lastPts(0.0)
+    , _endOfStream(false)
+{
+}
+
+//------------------------------------------------------------------------------
+FFmpegVideoStreamDecoder::~FFmpegVideoStreamDecoder()
+{
+    close();
+}
+
+//------------------------------------------------------------------------------
+bool 
+FFmpegVideoStreamDecoder::open(const Ogre::String& p_filename, Ogre::String& p_outError, 
+                               const Ogre::String& p_resourceGroup, const InputSettings& p_settings)
+{
+    close();
+    initializeFFmpeg();
+    
+    if (!openVideoInput(p_filename, p_resourceGroup, p_settings, _formatContext, p_outError)) 
+    {
+        return false;
+    }
+    
+    // Find and open the video stream, everything else is discarded
+    int streamIndex = av_find_best_stream(_formatContext, AVMEDIA_TYPE_VIDEO, -1, -1, NULL, 0);
+    if (streamIndex < 0)
+    {
+        p_outError = "Could not find stream of type: video";
+        close();
+        return false;
+    }
+    for (unsigned int i = 0; i < _formatContext->nb_streams; ++i)
+    {
+        _formatContext->streams[i]->discard = (int)i == streamIndex ? AVDISCARD_DEFAULT : AVDISCARD_ALL;
+    }
+    _stream = _formatContext->streams[streamIndex];
+    
+    // Halve the resolution as long as it stays above the target
+    AVCodec* codec = avcodec_find_decoder(_stream->codec->codec_id);
+    int lowres = 0;
+    if (codec && (_lowresTargetWidth > 0 || _lowresTargetHeight > 0))
+    {
+        while (lowres < codec->max_lowres 
+               && (unsigned int)(_stream->codec->width >> (lowres + 1)) >= _lowresTargetWidth
+               && (unsigned int)(_stream->codec->height >> (lowres + 1)) >= _lowresTargetHeight)
+        {
+            ++lowres;
+        }
+    }
+    _stream->codec->lowres = lowres;
+    _stream->codec->skip_frame = _keyframesOnly ? AVDISCARD_NONKEY : AVDISCARD_DEFAULT;
+    if (!codec || avcodec_open2(_stream->codec, codec, NULL) < 0)
+    {
+        p_outError = "Failed to open codec: video";
+        _stream = NULL;
+        close();
+        return false;
+    }
+    _codecContext = _stream->codec;
+    
+    _frame = avcodec_alloc_frame();
+    if (!_frame)
+    {
+        p_outError = "Out of memory.";
+        close();
+        return false;
+    }
+    
+    // Store timing information
+    double timeBase = ((double)_stream->time_base.num) / (double)_stream->time_base.den;
+    _duration = _stream->duration * timeBase;
+    if (_duration < 0.0)
+    {
+        _duration = ((double)_formatContext->duration) / AV_TIME_BASE;
+    }
+    _frameDuration = 1.0 / ((double)(_stream->r_frame_rate.num) / (double)(_stream->r_frame_rate.den));
+    _lastPts = 0.0;
+    _endOfStream = false;
+    
+    return true;
+}
+
+//------------------------------------------------------------------------------
+void 
+FFmpegVideoStreamDecoder::close()
+{
+    if (_frame)
+    {
+        avcodec_free_frame(&_frame);
+    }
+    if (_swsContext)
+    {
+        sws_freeContext(_swsContext);
+        _swsContext = NULL;
+    }
+    if (_codecContext)
+    {
+        avcodec_close(_codecContext);
+        _codecContext = NULL;
+    }
+    if (_formatContext)
+    {
+        closeVideoInput(_formatContext);
+    }
+    _stream = NULL;
+}
+
+//------------------------------------------------------------------------------
+bool 
+FFmpegVideoStreamDecoder::getIsOpen() const
+{
+    return _codecContext != NULL;
+}
+
+//------------------------------------------------------------------------------
+bool 
+FFmpegVideoStreamDecoder::seek(double p_time)
+{
+    if (!_codecContext)
+    {
+        return false;
+    }
+    
+    bool result = seekToKeyframe(_formatContext, _stream, p_time > 0.0 ? p_time : 0.0);
+    avcodec_flush_buffers(_codecContext);
+    _endOfStream = false;
+    return result;
+}
+
+//------------------------------------------------------------------------------
+VideoFrame* 
+FFmpegVideoStreamDecoder::decodeNextFrame()
+{
+    if (!_codecContext || _endOfStream)
+    {
+        return NULL;
+    }
+    
+    AVPacket packet;
+    av_init_packet(&packet);
+    packet.data = NULL;
+    packet.size = 0;
+    
+    while (true)
+    {
+        // At the end of the file, get the frames the decoder still holds back
+        bool endOfFile = av_read_frame(_formatContext, &packet) < 0;
+        if (endOfFile)
+        {
+            packet.data = NULL;
+            packet.size = 0;
+            packet.stream_index = _stream->index;
+        }
+        
+        if (packet.stream_index != _stream->index)
+        {
+            av_free_packet(&packet);
+            continue;
+        }
+        
+        int gotFrame = 0;
+        avcodec_get_frame_defaults(_frame);
+        int decoded = avcodec_decode_video2(_codecContext, _frame, &gotFrame, &packet);
+        if (!endOfFile)
+        {
+            av_free_packet(&packet);
+        }
+        
+        // Broken packets are skipped
+        if (decoded >= 0 && gotFrame)
+        {
+            return convertFrame();
+        }
+        if (endOfFile)
+        {
+            _endOfStream = true;
+            return NULL;
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+VideoFrame* 
+FFmpegVideoStreamDecoder::convertFrame()
+{
+    unsigned int width = getOutputWidth();
+    unsigned int height = getOutputHeight();
+    _swsContext = sws_getCachedContext(_swsContext,
+                                _codecContext->width, _codecContext->height, _codecContext->pix_fmt, 
+                                width, height, PIX_FMT_RGBA, 
+                                SWS_BICUBIC, NULL, NULL, NULL);
+    if (!_swsContext)
+    {
+        return NULL;
+    }
+    
+    // Convert straight into the frame's memory
+    VideoFrame* videoFrame = new VideoFrame();
+    videoFrame->width = width;
+    videoFrame->height = height;
+    videoFrame->allocate(width * height * 4);
+    uint8_t* destData[4] = { videoFrame->data, NULL, NULL, NULL };
+    int destLinesize[4] = { (int)width * 4, 0, 0, 0 };
+    sws_scale(_swsContext, _frame->data, _frame->linesize, 0, _codecContext->height, destData, destLinesize);
+    
+    // Get timing
+    double timeBase = ((double)_stream->time_base.num) / (double)_stream->time_base.den;
+    videoFrame->lifeTime = timeBase * _frame->pkt_duration;
+    if (videoFrame->lifeTime < 0.01)
+    {
+        videoFrame->lifeTime = _frameDuration;
+    }
+    videoFrame->pts = getFramePts(_frame, _stream, _lastPts);
+    _lastPts = videoFrame->pts + videoFrame->lifeTime;
+    
+    return videoFrame;
+}
+
+//------------------------------------------------------------------------------
+void 
+FFmpegVideoStreamDecoder::setLowresTarget(unsigned int p_width, unsigned int p_height)
+{
+    _lowresTargetWidth = p_width;
+    _lowresTargetHeight = p_height;
+}
+
+//------------------------------------------------------------------------------
+int 
+FFmpegVideoStreamDecoder::getLowres() const
+{
+    return _codecContext ? _codecContext->lowres : 0;
+}
+
+//------------------------------------------------------------------------------
+void 
+FFmpegVideoStreamDecoder::setKeyframesOnly(bool p_keyframesOnly)
+{
+    _keyframesOnly = p_keyframesOnly;
+    if (_codecContext)
+    {
+        _codecContext->skip_frame = _keyframesOnly ? AVDISCARD_NONKEY : AVDISCARD_DEFAULT;
+    }
+}
+
+//------------------------------------------------------------------------------
+void 
+FFmpegVideoStreamDecoder::setOutputSize(unsigned int p_width, unsigned int p_height)
+{
+    _outputWidth = p_width;
+    _outputHeight = p_height;
+}
+
+//------------------------------------------------------------------------------
+unsigned int 
+FFmpegVideoStreamDecoder::getOutputWidth() const
+{
+    if (_outputWidth > 0 || !_codecContext)
+    {
+        return _outputWidth;
+    }
+    return _codecContext->width;
+}
+
+//------------------------------------------------------------------------------
+unsigned int 
+FFmpegVideoStreamDecoder::getOutputHeight() const
+{
+    if (_outputHeight > 0 || !_codecContext)
+    {
+        return _outputHeight;
+    }
+    return _codecContext->height;
+}
+
+//------------------------------------------------------------------------------
+unsigned int 
+FFmpegVideoStreamDecoder::getVideoWidth() const
+{
+    return _codecContext ? _codecContext->width : 0;
+}
+
+//------------------------------------------------------------------------------
+unsigned int 
+FFmpegVideoStreamDecoder::getVideoHeight() const
+{
+    return _codecContext ? _codecContext->height : 0;
+}
+
+//------------------------------------------------------------------------------
+double 
+FFmpegVideoStreamDecoder::getDuration() const
+{
+    return _duration;
+}
+
+//------------------------------------------------------------------------------
+double 
+FFmpegVideoStreamDecoder::getFrameDuration() const
+{
+    return _frameDuration;
+}
+
+//------------------------------------------------------------------------------
+VideoFrame* 
+extractThumbnail(const Ogre::String& p_filename, double p_time, unsigned int p_maxSize, 
+                 Ogre::String& p_outError, const Ogre::String& p_resourceGroup, const InputSettings& p_settings)
+{
+    if (p_maxSize == 0)
+    {
+        p_outError = "The thumbnail size must not be 0.";
+        return NULL;
+    }
+    
+    // Probing tells the size of the video before the codec is opened, so the codec
+    // can already pick a lower resolution. Only the thumbnail's longer side matters for that.
+    FFmpegVideoStreamDecoder decoder;
+    decoder.setLowresTarget(p_maxSize, p_maxSize);
+    decoder.setKeyframesOnly(true);
+    if (!decoder.open(p_filename, p_outError, p_resourceGroup, p_settings))
+    {
+        return NULL;
+    }
+    
+    // Fit into the square, keeping the aspect ratio
+    unsigned int width = decoder.getVideoWidth() << decoder.getLowres();
+    unsigned int height = decoder.getVideoHeight() << decoder.getLowres();
+    if (width == 0 || height == 0)
+    {
+        p_outError = "The video has no size.";
+        return NULL;
+    }
+    if (width > p_maxSize || height > p_maxSize)
+    {
+        if (width >= height)
+        {
+            height = height * p_maxSize / width;
+            width = p_maxSize;
+        }
+        else
+        {
+            width = width * p_maxSize / height;
+            height = p_maxSize;
+        }
+    }
+    decoder.setOutputSize(width, height > 0 ? height : 1);
+    
+    // Past the last keyframe, the last keyframe is the right one anyway
+    if (p_time > 0.0)
+    {
+        decoder.seek(p_time < decoder.getDuration() ? p_time : decoder.getDuration());
+    }
+    VideoFrame* frame = decoder.decodeNextFrame();
+    if (!frame)
+    {
+        p_outError = "Could not decode a frame at " + boost::lexical_cast<std::string>(p_time) + " seconds.";
+    }
+    return frame;
+}
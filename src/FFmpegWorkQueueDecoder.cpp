@@ -0,0 +1,246 @@
+/* 
+ * File:   FFmpegWorkQueueDecoder.cpp
+ * Author: TheSHEEEP
+ * 
+ * Created on 19. Oktober 2026, 17:10
+ */
+
+#include "FFmpegWorkQueueDecoder.h"
+#include "FFmpegVideoDecodingThread.h"
+
+#include <OgreRoot.h>
+#include <boost/thread.hpp>
+
+// The only request type on our channel: decode one time slice
+static const Ogre::uint16 sRequestTypeDecode = 1;
+
+FFmpegWorkQueueDecoder* FFmpegWorkQueueDecoder::_instance = NULL;
+//------------------------------------------------------------------------------
+FFmpegWorkQueueDecoder::FFmpegWorkQueueDecoder()
+    : _nextJobId(0)
+    , _channel(0)
+    , _isRegistered(false)
+    , _mutex(NULL)
+    , _requestDoneCondVar(NULL)
+{
+    _mutex = new boost::mutex();
+    _requestDoneCondVar = new boost::condition_variable();
+}
+
+//------------------------------------------------------------------------------
+FFmpegWorkQueueDecoder::~FFmpegWorkQueueDecoder()
+{
+    unregisterHandlers();
+    
+    delete _mutex;
+    delete _requestDoneCondVar;
+}
+
+//------------------------------------------------------------------------------
+bool 
+FFmpegWorkQueueDecoder::getIsAvailable()
+{
+#if OGRE_THREAD_SUPPORT
+    // Without worker threads, requests would be processed right inside addRequest
+    return Ogre::Root::getSingletonPtr() 
+            && Ogre::Root::getSingletonPtr()->getWorkQueue()
+            && Ogre::Root::getSingletonPtr()->getWorkQueue()->getWorkerThreadCount() > 0;
+#else
+    return false;
+#endif
+}
+
+//------------------------------------------------------------------------------
+void 
+FFmpegWorkQueueDecoder::addJob(PlayerDecodingJob* p_job)
+{
+    registerHandlers();
+    
+    // Frames are handed to the player on the main thread
+    p_job->setCollectFrames(true);
+    
+    unsigned int jobId = 0;
+    {
+        boost::mutex::scoped_lock lock(*_mutex);
+        jobId = _nextJobId++;
+        
+        JobEntry& entry = _jobs[jobId];
+        entry.job = p_job;
+        entry.requestId = 0;
+        entry.isQueued = true;
+        entry.isRunning = false;
+        entry.isWaiting = false;
+        entry.wakePending = false;
+        entry.isFinished = false;
+    }
+    queueRequest(jobId);
+}
+
+//------------------------------------------------------------------------------
+void 
+FFmpegWorkQueueDecoder::wakeJob(PlayerDecodingJob* p_job)
+{
+    unsigned int jobId = 0;
+    {
+        boost::mutex::scoped_lock lock(*_mutex);
+        std::map<unsigned int, JobEntry>::iterator it = _jobs.begin();
+        while (it != _jobs.end() && it->second.job != p_job)
+        {
+            ++it;
+        }
+        if (it == _jobs.end() || it->second.isFinished)
+        {
+            return;
+        }
+        
+        // The running request may still find the buffers full, check again after it
+        if (!it->second.isWaiting)
+        {
+            it->second.wakePending = it->second.isQueued;
+            return;
+        }
+        
+        jobId = it->first;
+        it->second.isWaiting = false;
+        it->second.isQueued = true;
+    }
+    queueRequest(jobId);
+}
+
+//------------------------------------------------------------------------------
+void 
+FFmpegWorkQueueDecoder::removeJob(PlayerDecodingJob* p_job)
+{
+    boost::mutex::scoped_lock lock(*_mutex);
+    for (std::map<unsigned int, JobEntry>::iterator it = _jobs.begin(); it != _jobs.end(); ++it)
+    {
+        if (it->second.job == p_job)
+        {
+            // A request that did not start yet never will, responses of removed jobs are ignored
+            if (it->second.isQueued && !it->second.isRunning)
+            {
+                Ogre::Root::getSingletonPtr()->getWorkQueue()->abortRequest(it->second.requestId);
+            }
+            while (it->second.isRunning)
+            {
+                _requestDoneCondVar->wait(lock);
+            }
+            _jobs.erase(it);
+            return;
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+Ogre::WorkQueue::Response* 
+FFmpegWorkQueueDecoder::handleRequest(const Ogre::WorkQueue::Request* p_request, 
+                                      const Ogre::WorkQueue* p_srcQueue)
+{
+    unsigned int jobId = Ogre::any_cast<unsigned int>(p_request->getData());
+    PlayerDecodingJob* job = NULL;
+    {
+        boost::mutex::scoped_lock lock(*_mutex);
+        std::map<unsigned int, JobEntry>::iterator it = _jobs.find(jobId);
+        if (it == _jobs.end())
+        {
+            return OGRE_NEW Ogre::WorkQueue::Response(p_request, false, Ogre::Any());
+        }
+        it->second.isRunning = true;
+        job = it->second.job;
+    }
+    
+    // The entry stays valid, removeJob waits until we are done
+    FFmpegDecoderPool::JobStepResult result = job->step();
+    
+    {
+        boost::mutex::scoped_lock lock(*_mutex);
+        _jobs[jobId].isRunning = false;
+    }
+    _requestDoneCondVar->notify_all();
+    
+    return OGRE_NEW Ogre::WorkQueue::Response(p_request, true, Ogre::Any((int)result));
+}
+
+//------------------------------------------------------------------------------
+void 
+FFmpegWorkQueueDecoder::handleResponse(const Ogre::WorkQueue::Response* p_response, 
+                                       const Ogre::WorkQueue* p_srcQueue)
+{
+    unsigned int jobId = Ogre::any_cast<unsigned int>(p_response->getRequest()->getData());
+    PlayerDecodingJob* job = NULL;
+    FFmpegDecoderPool::JobStepResult result = FFmpegDecoderPool::JSR_FINISHED;
+    {
+        boost::mutex::scoped_lock lock(*_mutex);
+        std::map<unsigned int, JobEntry>::iterator it = _jobs.find(jobId);
+        if (it == _jobs.end() || !p_response->succeeded())
+        {
+            return;
+        }
+        
+        JobEntry& entry = it->second;
+        result = (FFmpegDecoderPool::JobStepResult)Ogre::any_cast<int>(p_response->getData());
+        if (result == FFmpegDecoderPool::JSR_WAIT && entry.wakePending)
+        {
+            result = FFmpegDecoderPool::JSR_CONTINUE;
+        }
+        entry.wakePending = false;
+        entry.isQueued = result == FFmpegDecoderPool::JSR_CONTINUE;
+        entry.isWaiting = result == FFmpegDecoderPool::JSR_WAIT;
+        entry.isFinished = result == FFmpegDecoderPool::JSR_FINISHED;
+        job = entry.job;
+    }
+    
+    // We are on the main thread, so the job cannot be removed in between
+    job->deliverCollectedFrames();
+    if (result == FFmpegDecoderPool::JSR_CONTINUE)
+    {
+        queueRequest(jobId);
+    }
+}
+
+//------------------------------------------------------------------------------
+void 
+FFmpegWorkQueueDecoder::queueRequest(unsigned int p_jobId)
+{
+    Ogre::WorkQueue::RequestID requestId = 
+        Ogre::Root::getSingletonPtr()->getWorkQueue()->addRequest(_channel, sRequestTypeDecode, Ogre::Any(p_jobId));
+    
+    boost::mutex::scoped_lock lock(*_mutex);
+    std::map<unsigned int, JobEntry>::iterator it = _jobs.find(p_jobId);
+    if (it != _jobs.end())
+    {
+        it->second.requestId = requestId;
+    }
+}
+
+//------------------------------------------------------------------------------
+void 
+FFmpegWorkQueueDecoder::registerHandlers()
+{
+    if (_isRegistered)
+    {
+        return;
+    }
+    
+    Ogre::WorkQueue* workQueue = Ogre::Root::getSingletonPtr()->getWorkQueue();
+    _channel = workQueue->getChannel("FFmpegVideoPlugin/Decoding");
+    workQueue->addRequestHandler(_channel, this);
+    workQueue->addResponseHandler(_channel, this);
+    _isRegistered = true;
+}
+
+//------------------------------------------------------------------------------
+void 
+FFmpegWorkQueueDecoder::unregisterHandlers()
+{
+    if (!_isRegistered || !Ogre::Root::getSingletonPtr())
+    {
+        return;
+    }
+    
+    Ogre::WorkQueue* workQueue = Ogre::Root::getSingletonPtr()->getWorkQueue();
+    workQueue->abortRequestsByChannel(_channel);
+    workQueue->removeRequestHandler(_channel, this);
+    workQueue->removeResponseHandler(_channel, this);
+    _isRegistered = false;
+}
@@ -0,0 +1,192 @@
+/* 
+ * File:   FFmpegYUVPlanes.cpp
+ * Author: TheSHEEEP
+ *
+ * Created on 20. Oktober 2026, 01:30
+ */
+
+#include "FFmpegYUVPlanes.h"
+
+extern "C"
+{
+    #include <libavcodec/avcodec.h>
+}
+#include <cstring>
+
+//------------------------------------------------------------------------------
+void
+FFmpegYUVPlanes::getImageSize(unsigned int p_width, unsigned int p_height,
+                              unsigned int& p_outWidth, unsigned int& p_outHeight)
+{
+    unsigned int chromaWidth = (p_width + 1) / 2;
+    unsigned int chromaHeight = (p_height + 1) / 2;
+    p_outWidth = chromaWidth * 2;
+    p_outHeight = chromaHeight * 3;
+}
+
+//------------------------------------------------------------------------------
+void
+FFmpegYUVPlanes::getPlanes(unsigned int p_width, unsigned int p_height, uint8_t* p_image,
+                           uint8_t* p_outData[3], int p_outLinesize[3])
+{
+    unsigned int chromaWidth = (p_width + 1) / 2;
+    unsigned int chromaHeight = (p_height + 1) / 2;
+    unsigned int linesize = chromaWidth * 2;
+    p_outData[0] = p_image;
+    p_outData[1] = p_image + chromaHeight * 2 * linesize;
+    p_outData[2] = p_outData[1] + chromaWidth;
+    p_outLinesize[0] = p_outLinesize[1] = p_outLinesize[2] = linesize;
+}
+
+//------------------------------------------------------------------------------
+bool
+FFmpegYUVPlanes::getCanExtract(int p_pixelFormat)
+{
+    return p_pixelFormat == PIX_FMT_YUV420P || p_pixelFormat == PIX_FMT_YUVJ420P
+            || p_pixelFormat == PIX_FMT_NV12 || p_pixelFormat == PIX_FMT_NV21;
+}
+
+//------------------------------------------------------------------------------
+bool
+FFmpegYUVPlanes::extractPlanes(const uint8_t* const p_data[], const int p_linesize[], int p_pixelFormat,
+                               unsigned int p_width, unsigned int p_height, uint8_t* p_image)
+{
+    if (!getCanExtract(p_pixelFormat) || p_width == 0 || p_height == 0)
+    {
+        return false;
+    }
+
+    uint8_t* planes[3];
+    int linesize[3];
+    getPlanes(p_width, p_height, p_image, planes, linesize);
+    unsigned int chromaWidth = (p_width + 1) / 2;
+    unsigned int chromaHeight = (p_height + 1) / 2;
+
+    // Line sizes may be negative for frames stored bottom up, so rows are found by multiplying them
+    for (unsigned int y = 0; y < p_height; ++y)
+    {
+        memcpy(planes[0] + y * linesize[0], p_data[0] + (int)y * p_linesize[0], p_width);
+    }
+
+    if (p_pixelFormat == PIX_FMT_YUV420P || p_pixelFormat == PIX_FMT_YUVJ420P)
+    {
+        for (unsigned int y = 0; y < chromaHeight; ++y)
+        {
+            memcpy(planes[1] + y * linesize[1], p_data[1] + (int)y * p_linesize[1], chromaWidth);
+            memcpy(planes[2] + y * linesize[2], p_data[2] + (int)y * p_linesize[2], chromaWidth);
+        }
+    }
+    else
+    {
+        // NV12 interleaves U and V, NV21 V and U
+        uint8_t* first = p_pixelFormat == PIX_FMT_NV12 ? planes[1] : planes[2];
+        uint8_t* second = p_pixelFormat == PIX_FMT_NV12 ? planes[2] : planes[1];
+        for (unsigned int y = 0; y < chromaHeight; ++y)
+        {
+            const uint8_t* source = p_data[1] + (int)y * p_linesize[1];
+            uint8_t* firstRow = first + y * linesize[1];
+            uint8_t* secondRow = second + y * linesize[2];
+            for (unsigned int x = 0; x < chromaWidth; ++x)
+            {
+                firstRow[x] = source[x * 2];
+                secondRow[x] = source[x * 2 + 1];
+            }
+        }
+    }
+
+    fillPadding(p_width, p_height, p_image);
+    return true;
+}
+
+//------------------------------------------------------------------------------
+void
+FFmpegYUVPlanes::fillPadding(unsigned int p_width, unsigned int p_height, uint8_t* p_image)
+{
+    if (p_width == 0 || p_height == 0)
+    {
+        return;
+    }
+
+    unsigned int imageWidth = 0;
+    unsigned int imageHeight = 0;
+    getImageSize(p_width, p_height, imageWidth, imageHeight);
+    if (imageWidth > p_width)
+    {
+        for (unsigned int y = 0; y < p_height; ++y)
+        {
+            uint8_t* row = p_image + y * imageWidth;
+            row[p_width] = row[p_width - 1];
+        }
+    }
+    if (imageHeight / 3 * 2 > p_height)
+    {
+        memcpy(p_image + p_height * imageWidth, p_image + (p_height - 1) * imageWidth, imageWidth);
+    }
+}
+
+//------------------------------------------------------------------------------
+YUVColorMatrix
+FFmpegYUVPlanes::getColorMatrix(int p_colorSpace, unsigned int p_height)
+{
+    switch (p_colorSpace)
+    {
+        case AVCOL_SPC_BT709:
+        case AVCOL_SPC_SMPTE240M:
+            return YCM_BT709;
+
+        case AVCOL_SPC_BT470BG:
+        case AVCOL_SPC_SMPTE170M:
+        case AVCOL_SPC_FCC:
+            return YCM_BT601;
+
+        default:
+            // Unspecified, guess like most players do
+            return p_height >= 720 ? YCM_BT709 : YCM_BT601;
+    }
+}
+
+//------------------------------------------------------------------------------
+bool
+FFmpegYUVPlanes::getIsFullRange(int p_colorRange, int p_pixelFormat)
+{
+    return p_colorRange == AVCOL_RANGE_JPEG || p_pixelFormat == PIX_FMT_YUVJ420P
+            || p_pixelFormat == PIX_FMT_YUVJ422P || p_pixelFormat == PIX_FMT_YUVJ444P;
+}
+
+//------------------------------------------------------------------------------
+void
+FFmpegYUVPlanes::getConversionMatrix(YUVColorMatrix p_matrix, bool p_fullRange, float p_outMatrix[12])
+{
+    // Luma and chroma weights of the matrix
+    double kr = p_matrix == YCM_BT709 ? 0.2126 : 0.299;
+    double kb = p_matrix == YCM_BT709 ? 0.0722 : 0.114;
+    double kg = 1.0 - kr - kb;
+
+    // Limited range video leaves room below black and above white
+    double lumaScale = p_fullRange ? 1.0 : 255.0 / 219.0;
+    double lumaOffset = p_fullRange ? 0.0 : 16.0 / 255.0;
+    double chromaScale = p_fullRange ? 1.0 : 255.0 / 224.0;
+    double chromaOffset = 128.0 / 255.0;
+
+    // r = y + rv * v, g = y + gu * u + gv * v, b = y + bu * u, with y, u and v scaled and centered
+    double rv = 2.0 * (1.0 - kr) * chromaScale;
+    double gu = -2.0 * kb * (1.0 - kb) / kg * chromaScale;
+    double gv = -2.0 * kr * (1.0 - kr) / kg * chromaScale;
+    double bu = 2.0 * (1.0 - kb) * chromaScale;
+    double lumaBase = -lumaScale * lumaOffset;
+
+    p_outMatrix[0] = (float)lumaScale;
+    p_outMatrix[1] = 0.0f;
+    p_outMatrix[2] = (float)rv;
+    p_outMatrix[3] = (float)(lumaBase - rv * chromaOffset);
+
+    p_outMatrix[4] = (float)lumaScale;
+    p_outMatrix[5] = (float)gu;
+    p_outMatrix[6] = (float)gv;
+    p_outMatrix[7] = (float)(lumaBase - (gu + gv) * chromaOffset);
+
+    p_outMatrix[8] = (float)lumaScale;
+    p_outMatrix[9] = (float)bu;
+    p_outMatrix[10] = 0.0f;
+    p_outMatrix[11] = (float)(lumaBase - bu * chromaOffset);
+}
@@ -0,0 +1,197 @@
+/* 
+ * File:   FFmpegYUVPlanesTest.cpp
+ * Author: TheSHEEEP
+ *
+ * Created on 20. Oktober 2026, 02:10
+ *
+ * Checks the plane extraction of FFmpegYUVPlanes against the layout getPlanes describes.
+ * Needs neither a renderer nor a decoder, frames are made up in memory.
+ */
+
+#include "FFmpegYUVPlanes.h"
+
+extern "C"
+{
+    #include <libavcodec/avcodec.h>
+}
+#include <cstdio>
+#include <vector>
+
+static unsigned int sNumFailures = 0;
+
+//------------------------------------------------------------------------------
+// Reports a failed check
+void check(bool p_condition, const char* p_what, int p_format, unsigned int p_width, unsigned int p_height)
+{
+    if (!p_condition)
+    {
+        printf("FAILED: %s (format %d, %ux%u)\n", p_what, p_format, p_width, p_height);
+        ++sNumFailures;
+    }
+}
+
+//------------------------------------------------------------------------------
+// Values that differ for each plane and position, so misplaced samples are found
+uint8_t lumaAt(unsigned int p_x, unsigned int p_y)
+{
+    return (uint8_t)(p_y * 16 + p_x);
+}
+
+uint8_t uAt(unsigned int p_x, unsigned int p_y)
+{
+    return (uint8_t)(64 + p_y * 8 + p_x);
+}
+
+uint8_t vAt(unsigned int p_x, unsigned int p_y)
+{
+    return (uint8_t)(160 + p_y * 8 + p_x);
+}
+
+//------------------------------------------------------------------------------
+// Checks the Y, U and V planes of an image, including the padding of odd sizes
+void checkImage(const std::vector<uint8_t>& p_image, int p_format, unsigned int p_width, unsigned int p_height)
+{
+    std::vector<uint8_t> image(p_image);
+    uint8_t* planes[3];
+    int linesize[3];
+    FFmpegYUVPlanes::getPlanes(p_width, p_height, &image[0], planes, linesize);
+    unsigned int chromaWidth = (p_width + 1) / 2;
+    unsigned int chromaHeight = (p_height + 1) / 2;
+
+    bool lumaMatches = true;
+    for (unsigned int y = 0; y < chromaHeight * 2; ++y)
+    {
+        for (unsigned int x = 0; x < chromaWidth * 2; ++x)
+        {
+            // Beyond odd sizes, the last column and row are repeated
+            unsigned int sourceX = x < p_width ? x : p_width - 1;
+            unsigned int sourceY = y < p_height ? y : p_height - 1;
+            lumaMatches = lumaMatches && planes[0][y * linesize[0] + x] == lumaAt(sourceX, sourceY);
+        }
+    }
+    check(lumaMatches, "luma plane and padding", p_format, p_width, p_height);
+
+    bool chromaMatches = true;
+    for (unsigned int y = 0; y < chromaHeight; ++y)
+    {
+        for (unsigned int x = 0; x < chromaWidth; ++x)
+        {
+            chromaMatches = chromaMatches && planes[1][y * linesize[1] + x] == uAt(x, y)
+                            && planes[2][y * linesize[2] + x] == vAt(x, y);
+        }
+    }
+    check(chromaMatches, "chroma planes", p_format, p_width, p_height);
+}
+
+//------------------------------------------------------------------------------
+// Makes up a frame of the passed format and checks what extractPlanes makes of it
+void checkExtraction(int p_format, unsigned int p_width, unsigned int p_height)
+{
+    unsigned int chromaWidth = (p_width + 1) / 2;
+    unsigned int chromaHeight = (p_height + 1) / 2;
+
+    // Decoders pad their lines, so do that here too
+    int lumaLinesize = p_width + 5;
+    int chromaLinesize = (p_format == PIX_FMT_YUV420P ? chromaWidth : chromaWidth * 2) + 3;
+    std::vector<uint8_t> luma(lumaLinesize * p_height, 0xEE);
+    std::vector<uint8_t> chroma1(chromaLinesize * chromaHeight, 0xEE);
+    std::vector<uint8_t> chroma2(chromaLinesize * chromaHeight, 0xEE);
+    for (unsigned int y = 0; y < p_height; ++y)
+    {
+        for (unsigned int x = 0; x < p_width; ++x)
+        {
+            luma[y * lumaLinesize + x] = lumaAt(x, y);
+        }
+    }
+    for (unsigned int y = 0; y < chromaHeight; ++y)
+    {
+        for (unsigned int x = 0; x < chromaWidth; ++x)
+        {
+            if (p_format == PIX_FMT_YUV420P)
+            {
+                chroma1[y * chromaLinesize + x] = uAt(x, y);
+                chroma2[y * chromaLinesize + x] = vAt(x, y);
+            }
+            else
+            {
+                // NV12 interleaves U and V, NV21 V and U
+                bool isNV12 = p_format == PIX_FMT_NV12;
+                chroma1[y * chromaLinesize + x * 2] = isNV12 ? uAt(x, y) : vAt(x, y);
+                chroma1[y * chromaLinesize + x * 2 + 1] = isNV12 ? vAt(x, y) : uAt(x, y);
+            }
+        }
+    }
+
+    const uint8_t* data[3] = { &luma[0], &chroma1[0], &chroma2[0] };
+    int linesize[3] = { lumaLinesize, chromaLinesize, chromaLinesize };
+    unsigned int imageWidth = 0;
+    unsigned int imageHeight = 0;
+    FFmpegYUVPlanes::getImageSize(p_width, p_height, imageWidth, imageHeight);
+    check(imageWidth == chromaWidth * 2 && imageHeight == chromaHeight * 3, "image size", p_format, p_width, p_height);
+
+    std::vector<uint8_t> image(imageWidth * imageHeight, 0xEE);
+    bool extracted = FFmpegYUVPlanes::extractPlanes(data, linesize, p_format, p_width, p_height, &image[0]);
+    check(extracted, "extraction", p_format, p_width, p_height);
+    if (extracted)
+    {
+        checkImage(image, p_format, p_width, p_height);
+    }
+}
+
+//------------------------------------------------------------------------------
+// Writes the planes the way a scaler would and checks that fillPadding completes them
+void checkPadding(unsigned int p_width, unsigned int p_height)
+{
+    unsigned int imageWidth = 0;
+    unsigned int imageHeight = 0;
+    FFmpegYUVPlanes::getImageSize(p_width, p_height, imageWidth, imageHeight);
+    std::vector<uint8_t> image(imageWidth * imageHeight, 0xEE);
+    uint8_t* planes[3];
+    int linesize[3];
+    FFmpegYUVPlanes::getPlanes(p_width, p_height, &image[0], planes, linesize);
+
+    for (unsigned int y = 0; y < p_height; ++y)
+    {
+        for (unsigned int x = 0; x < p_width; ++x)
+        {
+            planes[0][y * linesize[0] + x] = lumaAt(x, y);
+        }
+    }
+    for (unsigned int y = 0; y < (p_height + 1) / 2; ++y)
+    {
+        for (unsigned int x = 0; x < (p_width + 1) / 2; ++x)
+        {
+            planes[1][y * linesize[1] + x] = uAt(x, y);
+            planes[2][y * linesize[2] + x] = vAt(x, y);
+        }
+    }
+
+    FFmpegYUVPlanes::fillPadding(p_width, p_height, &image[0]);
+    checkImage(image, PIX_FMT_YUV420P, p_width, p_height);
+}
+
+//------------------------------------------------------------------------------
+int main()
+{
+    const unsigned int sizes[][2] = { {1, 1}, {2, 2}, {3, 5}, {6, 4}, {7, 7}, {16, 9}, {15, 8} };
+    const int formats[] = { PIX_FMT_YUV420P, PIX_FMT_NV12, PIX_FMT_NV21 };
+    for (unsigned int i = 0; i < sizeof(sizes) / sizeof(sizes[0]); ++i)
+    {
+        for (unsigned int j = 0; j < sizeof(formats) / sizeof(formats[0]); ++j)
+        {
+            checkExtraction(formats[j], sizes[i][0], sizes[i][1]);
+        }
+        checkPadding(sizes[i][0], sizes[i][1]);
+    }
+
+    // Anything else is left to the scaler
+    check(!FFmpegYUVPlanes::getCanExtract(PIX_FMT_RGBA), "RGBA is not extracted", PIX_FMT_RGBA, 0, 0);
+
+    if (sNumFailures > 0)
+    {
+        printf("%u checks failed.\n", sNumFailures);
+        return 1;
+    }
+    printf("All checks passed.\n");
+    return 0;
+}